@@ -849,6 +849,8 @@ typedef struct {
 				 * (DON'T PACK for state file) */
 	List acct_limit_list; /* slurmdb_used_limits_t's (DON'T PACK
 			       * for state file) */
+	void *acct_limit_hash; /* acct_limit_list indexed by account
+				* (DON'T PACK) */
 	List job_list; /* list of job pointers to submitted/running
 			  jobs (DON'T PACK) */
 	bitstr_t *grp_node_bitmap;	/* Bitmap of allocated nodes
@@ -874,6 +876,8 @@ typedef struct {
 	long double *usage_tres_raw; /* measure of each TRES usage */
 	List user_limit_list; /* slurmdb_used_limits_t's (DON'T PACK
 			       * for state file) */
+	void *user_limit_hash; /* user_limit_list indexed by uid
+				* (DON'T PACK) */
 } slurmdb_qos_usage_t;
 
 typedef struct {
@@ -1364,7 +1364,7 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **job_info_msg_pptr,
 	slurm_msg_t_init(&req_msg);
 	memset(&req, 0, sizeof(req));
 	req.last_update  = update_time;
-	req.show_flags   = show_flags;
+	req.show_flags   = show_flags | SHOW_STR_DICT;
 	req_msg.msg_type = REQUEST_JOB_INFO;
 	req_msg.data     = &req;
 
@@ -1412,7 +1412,7 @@ extern int slurm_load_job_user (job_info_msg_t **job_info_msg_pptr,
 
 	slurm_msg_t_init(&req_msg);
 	memset(&req, 0, sizeof(req));
-	req.show_flags   = show_flags;
+	req.show_flags   = show_flags | SHOW_STR_DICT;
 	req.user_id      = user_id;
 	req_msg.msg_type = REQUEST_JOB_USER_INFO;
 	req_msg.data     = &req;
@@ -1463,7 +1463,7 @@ slurm_load_job (job_info_msg_t **job_info_msg_pptr, uint32_t job_id,
 	memset(&req, 0, sizeof(req));
 	slurm_msg_t_init(&req_msg);
 	req.job_id       = job_id;
-	req.show_flags   = show_flags;
+	req.show_flags   = show_flags | SHOW_STR_DICT;
 	req_msg.msg_type = REQUEST_JOB_INFO_SINGLE;
 	req_msg.data     = &req;
 
@@ -80,6 +80,25 @@
 #define LDD_PATH "/usr/bin/ldd"
 #define MAX_THREADS      8	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define DEFAULT_WINDOW   1	/* Blocks in flight at one time */
+
+/* Blocks sent but not yet acknowledged by all nodes */
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	List queue;		/* blocks waiting for a sender thread */
+	bool done;		/* no more blocks, sender threads exit */
+	int active;		/* blocks queued or in flight */
+	int rc;			/* highest return code of any block */
+	uint64_t ack_time_sum;	/* usec from send to all replies */
+	uint32_t ack_time_max;
+	uint32_t block_cnt;
+} bcast_window_t;
+
+typedef struct {
+	file_bcast_msg_t msg;	/* copy of the message, owns msg.block */
+	struct bcast_parameters *params;
+} bcast_block_t;
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -176,6 +195,7 @@ static int _file_bcast(struct bcast_parameters *params,
 	slurm_msg_t_init(&msg);
 	msg.data = bcast_msg;
 	msg.flags = USE_BCAST_NETWORK;
+	msg.protocol_version = sbcast_cred->protocol_version;
 	msg.forward.tree_width = params->fanout;
 	msg.msg_type = REQUEST_FILE_BCAST;
 
@@ -219,10 +239,11 @@ static int _get_block_none(char **buffer, int *orig_len, bool *more,
 	}
 
 	if (remaining < 0) {
-		*buffer = xmalloc(block_len);
 		remaining = f_stat.st_size;
 		position = src;
 	}
+	if (!*buffer)
+		*buffer = xmalloc(block_len);
 
 	size = MIN(block_len, remaining);
 	memcpy(*buffer, position, size);
@@ -258,8 +279,9 @@ static int _get_block_lz4(struct bcast_parameters *params,
 	if (remaining < 0) {
 		position = src;
 		remaining = f_stat.st_size;
-		*buffer = xmalloc(block_len);
 	}
+	if (!*buffer)
+		*buffer = xmalloc(block_len);
 
 	/* intentionally limit decompressed size to 10x compressed
 	 * to avoid problems on receive size when decompressed */
@@ -303,6 +325,91 @@ static int _next_block(struct bcast_parameters *params,
 	return _get_block_none(buffer, orig_len, more, file_start);
 }
 
+/* Send one block and account for it in the window */
+static int _send_block(struct bcast_parameters *params,
+		       file_bcast_msg_t *bcast_msg, bcast_window_t *window)
+{
+	int rc;
+	DEF_TIMERS;
+
+	START_TIMER;
+	rc = _file_bcast(params, bcast_msg, sbcast_cred);
+	END_TIMER;
+
+	slurm_mutex_lock(&window->mutex);
+	window->rc = MAX(window->rc, rc);
+	window->ack_time_sum += DELTA_TIMER;
+	window->ack_time_max = MAX(window->ack_time_max, DELTA_TIMER);
+	window->block_cnt++;
+	slurm_mutex_unlock(&window->mutex);
+
+	return rc;
+}
+
+/* Sender thread, sends queued blocks until the window is done */
+static void *_send_block_thread(void *arg)
+{
+	bcast_window_t *window = arg;
+	bcast_block_t *block;
+
+	slurm_mutex_lock(&window->mutex);
+	while (true) {
+		while (!(block = list_dequeue(window->queue)) && !window->done)
+			slurm_cond_wait(&window->cond, &window->mutex);
+		if (!block)
+			break;
+		slurm_mutex_unlock(&window->mutex);
+
+		(void) _send_block(block->params, &block->msg, window);
+		xfree(block->msg.block);
+		xfree(block);
+
+		slurm_mutex_lock(&window->mutex);
+		window->active--;
+		slurm_cond_broadcast(&window->cond);
+	}
+	slurm_mutex_unlock(&window->mutex);
+
+	return NULL;
+}
+
+/* Queue a block for the sender threads, takes ownership of msg->block */
+static void _queue_block(struct bcast_parameters *params,
+			 file_bcast_msg_t *bcast_msg, bcast_window_t *window)
+{
+	bcast_block_t *block = xmalloc(sizeof(*block));
+
+	block->msg = *bcast_msg;
+	block->params = params;
+	slurm_mutex_lock(&window->mutex);
+	list_enqueue(window->queue, block);
+	window->active++;
+	slurm_cond_broadcast(&window->cond);
+	slurm_mutex_unlock(&window->mutex);
+}
+
+/*
+ * Wait until fewer than max_active blocks are in flight
+ * RET highest return code of any block sent so far
+ */
+static int _wait_window(bcast_window_t *window, int max_active,
+			uint64_t *stall_time)
+{
+	int rc;
+	DEF_TIMERS;
+
+	START_TIMER;
+	slurm_mutex_lock(&window->mutex);
+	while (window->active && (window->active >= max_active))
+		slurm_cond_wait(&window->cond, &window->mutex);
+	rc = window->rc;
+	slurm_mutex_unlock(&window->mutex);
+	END_TIMER;
+	*stall_time += DELTA_TIMER;
+
+	return rc;
+}
+
 /* read and broadcast the file */
 static int _bcast_file(struct bcast_parameters *params)
 {
@@ -312,7 +419,15 @@ static int _bcast_file(struct bcast_parameters *params)
 	int32_t orig_len = 0;
 	uint64_t size_uncompressed = 0, size_compressed = 0;
 	uint32_t time_compression = 0;
+	uint64_t stall_time = 0;
 	bool more = true, file_start = true;
+	int i, window_size;
+	pthread_t *senders = NULL;
+	bcast_window_t window = {
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	struct timeval start_tv;
 	DEF_TIMERS;
 
 	if (params->block_size)
@@ -346,6 +461,26 @@ static int _bcast_file(struct bcast_parameters *params)
 	else
 		params->fanout = MIN(MAX_THREADS, params->fanout);
 
+	window_size = params->window ? params->window : DEFAULT_WINDOW;
+	/*
+	 * Older slurmd write the blocks of a file in the order they arrive,
+	 * only slurmd of this protocol version write them at their offset.
+	 */
+	if ((window_size > 1) &&
+	    (sbcast_cred->protocol_version < SLURM_21_08_1_PROTOCOL_VERSION)) {
+		verbose("Nodes of an older version, window reduced from %d to 1",
+			window_size);
+		window_size = 1;
+	}
+	if (window_size > 1) {
+		window.queue = list_create(NULL);
+		senders = xcalloc(window_size, sizeof(pthread_t));
+		for (i = 0; i < window_size; i++)
+			slurm_thread_create(&senders[i], _send_block_thread,
+					    &window);
+	}
+	gettimeofday(&start_tv, NULL);
+
 	while (more) {
 		START_TIMER;
 		bcast_msg.block_len = _next_block(params, &buffer, &orig_len,
@@ -363,7 +498,24 @@ static int _bcast_file(struct bcast_parameters *params)
 		if (!more)
 			bcast_msg.flags |= FILE_BCAST_LAST_BLOCK;
 
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
+		/*
+		 * The first block creates the file and the last block closes
+		 * it, so send them only when no other block is in flight.
+		 * The blocks in between are written at their offset and may
+		 * arrive in any order, while the next block is compressed.
+		 */
+		if ((window_size <= 1) || (bcast_msg.block_no == 1) ||
+		    (bcast_msg.flags & FILE_BCAST_LAST_BLOCK)) {
+			rc = _wait_window(&window, 0, &stall_time);
+			if (rc == SLURM_SUCCESS)
+				rc = _send_block(params, &bcast_msg, &window);
+		} else {
+			rc = _wait_window(&window, window_size, &stall_time);
+			if (rc == SLURM_SUCCESS) {
+				_queue_block(params, &bcast_msg, &window);
+				buffer = NULL;	/* now owned by the queue */
+			}
+		}
 		if (rc != SLURM_SUCCESS)
 			break;
 		if (bcast_msg.flags & FILE_BCAST_LAST_BLOCK)
@@ -371,9 +523,36 @@ static int _bcast_file(struct bcast_parameters *params)
 		bcast_msg.block_no++;
 		bcast_msg.block_offset += orig_len;
 	}
+	rc = MAX(rc, _wait_window(&window, 0, &stall_time));
+	if (senders) {
+		slurm_mutex_lock(&window.mutex);
+		window.done = true;
+		slurm_cond_broadcast(&window.cond);
+		slurm_mutex_unlock(&window.mutex);
+		for (i = 0; i < window_size; i++)
+			pthread_join(senders[i], NULL);
+		xfree(senders);
+		FREE_NULL_LIST(window.queue);
+	}
 	xfree(bcast_msg.user_name);
 	xfree(buffer);
 
+	if (window.block_cnt) {
+		struct timeval end_tv;
+		uint64_t elapsed;
+
+		gettimeofday(&end_tv, NULL);
+		elapsed = ((end_tv.tv_sec - start_tv.tv_sec) * USEC_IN_SEC) +
+			  (end_tv.tv_usec - start_tv.tv_usec);
+		verbose("Sent %"PRIu64" bytes in %u blocks in %"PRIu64" usec (%.1f MB/s), window %d",
+			size_compressed, window.block_cnt, elapsed,
+			elapsed ? (double) size_compressed / elapsed : 0.0,
+			window_size);
+		verbose("Block reply time mean %"PRIu64" max %u usec, stalled %"PRIu64" usec waiting for replies",
+			window.ack_time_sum / window.block_cnt,
+			window.ack_time_max, stall_time);
+	}
+
 	if (size_uncompressed && (params->compress != 0)) {
 		int64_t pct = (int64_t) size_uncompressed - size_compressed;
 		/* Dividing a negative by a positive in C99 results in
@@ -57,6 +57,7 @@ struct bcast_parameters {
 	uint32_t step_id;
 	int timeout;
 	int verbose;
+	int window;		/* blocks in flight, 0 for default */
 };
 
 typedef struct file_bcast_info {
@@ -438,13 +438,13 @@ static char *_autodetect_cgroup_version(void)
 			return NULL;
 		}
 
-		if (F_TYPE_EQUAL(fs.f_type, CGROUP2_SUPER_MAGIC)) {
-			if (statfs("/sys/fs/cgroup/unified/", &fs) != 0) {
-				error("can't stat /sys/fs/cgroup/unified/: %m");
-				return NULL;
-			}
-			cgroup_ver = 2;
-		} else if (F_TYPE_EQUAL(fs.f_type, CGROUP_SUPER_MAGIC)) {
+		/*
+		 * Hybrid hosts keep the controllers on the v1 hierarchies and
+		 * only mount an (almost) empty cgroup2 tree, so stick to v1
+		 * there. cgroup/v2 is only autoselected on pure cgroup2 hosts.
+		 */
+		if (F_TYPE_EQUAL(fs.f_type, CGROUP2_SUPER_MAGIC) ||
+		    F_TYPE_EQUAL(fs.f_type, CGROUP_SUPER_MAGIC)) {
 			cgroup_ver = 1;
 		} else {
 			error("Unexpected fs type on /sys/fs/cgroup/systemd");
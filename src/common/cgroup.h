@@ -128,6 +128,11 @@ typedef struct {
 	uint64_t ssec;
 	uint64_t total_rss;
 	uint64_t total_pgmajfault;
+	uint64_t total_read_bytes;	/* cgroup v2 io.stat */
+	uint64_t total_write_bytes;
+	uint64_t cpu_pressure;		/* PSI "some" stall time, in usec */
+	uint64_t memory_pressure;
+	uint64_t io_pressure;
 } cgroup_acct_t;
 
 /* Slurm cgroup plugins configuration parameters */
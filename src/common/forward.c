@@ -349,7 +349,8 @@ void *_fwd_tree_thread(void *arg)
 
 	slurm_msg_t_init(&send_msg);
 	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
-	send_msg.flags = fwd_tree->orig_msg->flags;
+	/* Compressed replies are only accepted for one hop */
+	send_msg.flags = fwd_tree->orig_msg->flags & ~SLURM_COMPRESS_ACCEPT;
 	send_msg.data = fwd_tree->orig_msg->data;
 	send_msg.protocol_version = fwd_tree->orig_msg->protocol_version;
 
@@ -543,7 +544,8 @@ static void _forward_msg_internal(hostlist_t hl, hostlist_t* sp_hl,
 		       sizeof(slurm_addr_t));
 
 		fwd_msg->header.version = header->version;
-		fwd_msg->header.flags = header->flags;
+		/* Compressed replies are only accepted for one hop */
+		fwd_msg->header.flags = header->flags & ~SLURM_COMPRESS_ACCEPT;
 		fwd_msg->header.msg_type = header->msg_type;
 		fwd_msg->header.body_length = header->body_length;
 		fwd_msg->header.ret_list = NULL;
@@ -177,6 +177,9 @@ struct hostlist {
 	int magic;
 	pthread_mutex_t mutex;
 
+	/* if set, mutex is never taken (single-threaded use only) */
+	unsigned nolock:1;
+
 	/* current number of elements available in array */
 	int size;
 
@@ -335,13 +338,15 @@ static int hostset_find_host(hostset_t, const char *);
 #define LOCK_HOSTLIST(_hl)				\
 	do {						\
 		xassert(_hl != NULL);			\
-		slurm_mutex_lock(&(_hl)->mutex);		\
+		if (!(_hl)->nolock)			\
+			slurm_mutex_lock(&(_hl)->mutex);	\
 		xassert((_hl)->magic == HOSTLIST_MAGIC);	\
 	} while (0)
 
 #define UNLOCK_HOSTLIST(_hl)			\
 	do {					\
-		slurm_mutex_unlock(&(_hl)->mutex);	\
+		if (!(_hl)->nolock)			\
+			slurm_mutex_unlock(&(_hl)->mutex);	\
 	} while (0)
 
 #define seterrno_ret(_errno, _rc)		\
@@ -1197,6 +1202,7 @@ static hostlist_t hostlist_new(void)
 
 	new->magic = HOSTLIST_MAGIC;
 	slurm_mutex_init(&new->mutex);
+	new->nolock = 0;
 
 	new->hr = malloc(HOSTLIST_CHUNK * sizeof(hostrange_t *));
 	if (!new->hr)
@@ -1886,7 +1892,6 @@ hostlist_t hostlist_create(const char *str)
 	return hostlist_create_dims(str, dims);
 }
 
-
 hostlist_t hostlist_copy(const hostlist_t hl)
 {
 	int i;
@@ -3689,3 +3694,331 @@ int hostset_find(hostset_t set, const char *hostname)
 {
 	return hostlist_find(set->hl, hostname);
 }
+
+/* ----[ hostlist index functions ]---- */
+
+#define HOSTLIST_INDEX_MAGIC 0x1dc0ffee
+
+/* One host of the index, already split into prefix and numeric suffix */
+typedef struct {
+	char *prefix;		/* points into hostlist_index->prefix[] */
+	unsigned long num;	/* numeric suffix */
+	int width;		/* width of numeric suffix */
+	unsigned singlehost:1;	/* no valid suffix, prefix is the hostname */
+	unsigned vestigial:1;	/* no hostname at this position */
+} hostindex_ent_t;
+
+/* All hosts sharing one prefix, sorted by numeric suffix */
+typedef struct {
+	char *prefix;
+	unsigned singlehost:1;
+	int cnt;
+	int *inx;		/* positions in hostlist_index->ent[] */
+} hostindex_prefix_t;
+
+struct hostlist_index {
+	int magic;
+	int dims;		/* dimensions used to parse the names */
+	int cnt;		/* number of positions in the index */
+	hostindex_ent_t *ent;	/* cnt entries */
+	int *sorted;		/* positions sorted by name, backs prefix[] */
+	int prefix_cnt;
+	hostindex_prefix_t *prefix; /* sorted by prefix, then singlehost */
+};
+
+/* qsort() argument used to build a hostlist_index */
+static hostindex_ent_t *sort_ent = NULL;
+
+static int _hostindex_prefix_cmp(const char *p1, unsigned s1,
+				 const char *p2, unsigned s2)
+{
+	int rc = strcmp(p1, p2);
+
+	return rc ? rc : ((int) s1 - (int) s2);
+}
+
+static int _hostindex_ent_cmp(const void *a, const void *b)
+{
+	hostindex_ent_t *e1 = &sort_ent[*(int *) a];
+	hostindex_ent_t *e2 = &sort_ent[*(int *) b];
+	int rc;
+
+	if ((rc = _hostindex_prefix_cmp(e1->prefix, e1->singlehost,
+					e2->prefix, e2->singlehost)))
+		return rc;
+	if (e1->num != e2->num)
+		return (e1->num < e2->num) ? -1 : 1;
+	return e1->width - e2->width;
+}
+
+hostlist_index_t hostlist_index_create(char **names, int cnt, int dims)
+{
+	static pthread_mutex_t sort_mutex = PTHREAD_MUTEX_INITIALIZER;
+	hostlist_index_t hi;
+	hostname_t *hn;
+	hostindex_prefix_t *pfx = NULL;
+	int i, valid = 0;
+
+	if (!dims)
+		dims = slurmdb_setup_cluster_name_dims();
+
+	hi = xmalloc(sizeof(*hi));
+	hi->magic = HOSTLIST_INDEX_MAGIC;
+	hi->dims = dims;
+	hi->cnt = cnt;
+	hi->ent = xcalloc(MAX(cnt, 1), sizeof(hostindex_ent_t));
+	hi->sorted = xcalloc(MAX(cnt, 1), sizeof(int));
+
+	for (i = 0; i < cnt; i++) {
+		hostindex_ent_t *ent = &hi->ent[i];
+
+		if (!names[i]) {
+			ent->vestigial = 1;
+			continue;
+		}
+		hn = hostname_create_dims(names[i], dims);
+		if (hostname_suffix_is_valid(hn)) {
+			ent->prefix = xstrdup(hn->prefix);
+			ent->num = hn->num;
+			ent->width = hostname_suffix_width(hn);
+		} else {
+			ent->prefix = xstrdup(names[i]);
+			ent->singlehost = 1;
+		}
+		hostname_destroy(hn);
+		hi->sorted[valid++] = i;
+	}
+
+	slurm_mutex_lock(&sort_mutex);
+	sort_ent = hi->ent;
+	qsort(hi->sorted, valid, sizeof(int), _hostindex_ent_cmp);
+	sort_ent = NULL;
+	slurm_mutex_unlock(&sort_mutex);
+
+	/* Group by prefix, keeping a single copy of each prefix string */
+	hi->prefix = xcalloc(MAX(valid, 1), sizeof(hostindex_prefix_t));
+	for (i = 0; i < valid; i++) {
+		hostindex_ent_t *ent = &hi->ent[hi->sorted[i]];
+
+		if (!pfx || _hostindex_prefix_cmp(pfx->prefix, pfx->singlehost,
+						  ent->prefix,
+						  ent->singlehost)) {
+			pfx = &hi->prefix[hi->prefix_cnt++];
+			pfx->prefix = ent->prefix;
+			pfx->singlehost = ent->singlehost;
+			pfx->inx = &hi->sorted[i];
+		} else {
+			xfree(ent->prefix);
+			ent->prefix = pfx->prefix;
+		}
+		pfx->cnt++;
+	}
+
+	return hi;
+}
+
+void hostlist_index_destroy(hostlist_index_t hi)
+{
+	int i;
+
+	if (!hi)
+		return;
+	xassert(hi->magic == HOSTLIST_INDEX_MAGIC);
+
+	for (i = 0; i < hi->prefix_cnt; i++)
+		xfree(hi->prefix[i].prefix);
+	xfree(hi->prefix);
+	xfree(hi->sorted);
+	xfree(hi->ent);
+	hi->magic = ~HOSTLIST_INDEX_MAGIC;
+	xfree(hi);
+}
+
+int hostlist_index_count(hostlist_index_t hi)
+{
+	xassert(hi && (hi->magic == HOSTLIST_INDEX_MAGIC));
+	return hi->cnt;
+}
+
+int hostlist_index_dims(hostlist_index_t hi)
+{
+	xassert(hi && (hi->magic == HOSTLIST_INDEX_MAGIC));
+	return hi->dims;
+}
+
+/*
+ * Append a range to the end of hl without trying to join it with the
+ * current tail, hl must be locked (or unlocked) by the caller.
+ */
+static void _hostlist_append_range(hostlist_t hl, hostrange_t *hr)
+{
+	if ((hl->size == hl->nranges) && !hostlist_expand(hl))
+		out_of_memory("hostlist append range");
+	hl->hr[hl->nranges++] = hr;
+	hl->nhosts += hostrange_count(hr);
+}
+
+static hostlist_t _hostlist_index_bitmap2hostlist(hostlist_index_t hi,
+						  bitstr_t *bitmap,
+						  bool nolock)
+{
+	hostlist_t hl;
+	hostrange_t *tail = NULL;
+	int i, first, last, width;
+
+	xassert(hi && (hi->magic == HOSTLIST_INDEX_MAGIC));
+
+	if (!bitmap || ((first = bit_ffs(bitmap)) == -1))
+		return NULL;
+	last = MIN(bit_fls(bitmap), hi->cnt - 1);
+
+	hl = hostlist_new();
+	hl->nolock = nolock;
+	LOCK_HOSTLIST(hl);
+	for (i = first; i <= last; i++) {
+		hostindex_ent_t *ent;
+
+		if (!bit_test(bitmap, i))
+			continue;
+		ent = &hi->ent[i];
+		if (ent->vestigial)
+			continue;
+
+		/*
+		 * Same join test as hostlist_push_range(), so the result is
+		 * identical to pushing every hostname in turn.
+		 */
+		width = ent->width;
+		if (tail && !ent->singlehost && !tail->singlehost &&
+		    (tail->hi == ent->num - 1) &&
+		    ((tail->prefix == ent->prefix) ||
+		     !strnatcmp(tail->prefix, ent->prefix)) &&
+		    _width_equiv(tail->lo, &tail->width, ent->num, &width)) {
+			tail->hi = ent->num;
+			hl->nhosts++;
+			continue;
+		}
+
+		if (ent->singlehost)
+			tail = hostrange_create_single(ent->prefix);
+		else
+			tail = hostrange_create(ent->prefix, ent->num,
+						ent->num, ent->width);
+		_hostlist_append_range(hl, tail);
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return hl;
+}
+
+hostlist_t hostlist_index_bitmap2hostlist(hostlist_index_t hi,
+					  bitstr_t *bitmap)
+{
+	return _hostlist_index_bitmap2hostlist(hi, bitmap, false);
+}
+
+char *hostlist_index_ranged_string(hostlist_index_t hi, bitstr_t *bitmap,
+				   bool sort)
+{
+	hostlist_t hl;
+	char *buf;
+
+	if (!(hl = _hostlist_index_bitmap2hostlist(hi, bitmap, true)))
+		return xstrdup("");
+	if (sort)
+		hostlist_sort(hl);
+	buf = hostlist_ranged_string_xmalloc_dims(hl, hi->dims, 1);
+	hostlist_destroy(hl);
+
+	return buf;
+}
+
+static hostindex_prefix_t *_hostindex_find_prefix(hostlist_index_t hi,
+						  hostrange_t *hr)
+{
+	int lo = 0, hi_inx = hi->prefix_cnt - 1;
+
+	while (lo <= hi_inx) {
+		int mid = (lo + hi_inx) / 2;
+		hostindex_prefix_t *pfx = &hi->prefix[mid];
+		int rc = _hostindex_prefix_cmp(pfx->prefix, pfx->singlehost,
+					       hr->prefix, hr->singlehost);
+		if (!rc)
+			return pfx;
+		if (rc < 0)
+			lo = mid + 1;
+		else
+			hi_inx = mid - 1;
+	}
+
+	return NULL;
+}
+
+/* Number of decimal digits needed to print num */
+static int _num_digits(unsigned long num)
+{
+	int n = 1;
+
+	while (num /= 10L)
+		n++;
+	return n;
+}
+
+int hostlist_index_hostlist2bitmap(hostlist_index_t hi, hostlist_t hl,
+				   bitstr_t *bitmap)
+{
+	int i, missing = 0;
+
+	xassert(hi && (hi->magic == HOSTLIST_INDEX_MAGIC));
+
+	/* Suffixes of multi-dimensional names are not plain decimal */
+	if (hi->dims > 1)
+		return -1;
+
+	LOCK_HOSTLIST(hl);
+	for (i = 0; i < hl->nranges; i++) {
+		hostrange_t *hr = hl->hr[i];
+		hostindex_prefix_t *pfx = _hostindex_find_prefix(hi, hr);
+		int found = 0, lo, hi_inx;
+
+		if (!pfx) {
+			missing += hostrange_count(hr);
+			continue;
+		}
+		if (hr->singlehost) {
+			bit_set(bitmap, pfx->inx[0]);
+			continue;
+		}
+
+		/* find the first host with a suffix >= hr->lo */
+		lo = 0;
+		hi_inx = pfx->cnt;
+		while (lo < hi_inx) {
+			int mid = (lo + hi_inx) / 2;
+			if (hi->ent[pfx->inx[mid]].num < hr->lo)
+				lo = mid + 1;
+			else
+				hi_inx = mid;
+		}
+
+		/*
+		 * A host matches if its suffix prints identically, i.e. it is
+		 * exactly as wide as the range's zero padded suffix.
+		 */
+		for ( ; lo < pfx->cnt; lo++) {
+			int inx = pfx->inx[lo];
+			hostindex_ent_t *ent = &hi->ent[inx];
+
+			if (ent->num > hr->hi)
+				break;
+			if (ent->width != MAX(hr->width, _num_digits(ent->num)))
+				continue;
+			bit_set(bitmap, inx);
+			found++;
+		}
+		missing += hostrange_count(hr) - found;
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return missing;
+}
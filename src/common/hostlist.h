@@ -41,8 +41,11 @@
 
 #include "config.h"
 
+#include <stdbool.h>
 #include <unistd.h>		/* load ssize_t definition */
 
+#include "src/common/bitstring.h"
+
 /* Since users can specify a numeric range in the prefix, we need to prevent
  * expressions that can consume all of the memory on a system and crash the
  * daemons (e.g. "a[0-999999999].b[0-9]", which generates 1 billion distinct
@@ -544,4 +547,61 @@ char * hostset_nth(hostset_t set, int n);
  */
 ssize_t hostset_ranged_string(hostset_t set, size_t n, char *buf);
 
+/* ----[ hostlist index operations ]---- */
+
+/* A hostlist index is a fixed table of hostnames (e.g. the node table),
+ * each already split into prefix and numeric suffix and grouped by prefix.
+ * It converts bitmaps of table positions to hostlists and back in time
+ * linear in the bitmap size, without parsing any hostname again.
+ */
+typedef struct hostlist_index * hostlist_index_t;
+
+/* hostlist_index_create():
+ * Build an index of "cnt" hostnames, position i of the index being names[i].
+ * NULL entries in names are allowed and are never reported as set.
+ * If dims is 0, the cluster's dimensions are used.
+ * Release memory with hostlist_index_destroy().
+ */
+hostlist_index_t hostlist_index_create(char **names, int cnt, int dims);
+
+/* hostlist_index_destroy():
+ */
+void hostlist_index_destroy(hostlist_index_t hi);
+
+/* hostlist_index_count():
+ * Return the number of positions in the index.
+ */
+int hostlist_index_count(hostlist_index_t hi);
+
+/* hostlist_index_dims():
+ * Return the dimensions the index's hostnames were parsed with.
+ */
+int hostlist_index_dims(hostlist_index_t hi);
+
+/* hostlist_index_bitmap2hostlist():
+ * Build a hostlist of the names at every position set in bitmap, in
+ * position order. The result is identical to hostlist_push_host() of each
+ * name in turn. Returns NULL if no bit is set.
+ */
+hostlist_t hostlist_index_bitmap2hostlist(hostlist_index_t hi,
+					  bitstr_t *bitmap);
+
+/* hostlist_index_ranged_string():
+ * Return the ranged string of the names at every position set in bitmap,
+ * sorted if "sort" is set. Equivalent to hostlist_index_bitmap2hostlist(),
+ * hostlist_sort() and hostlist_ranged_string_xmalloc(), without locking.
+ * Release memory with xfree().
+ */
+char *hostlist_index_ranged_string(hostlist_index_t hi, bitstr_t *bitmap,
+				   bool sort);
+
+/* hostlist_index_hostlist2bitmap():
+ * Set the bit in bitmap of every host of hl found in the index.
+ * Returns the number of hosts of hl which are not in the index, or -1 if
+ * the index can not resolve hostlists (multi-dimensional names), in which
+ * case nothing is set.
+ */
+int hostlist_index_hostlist2bitmap(hostlist_index_t hi, hostlist_t hl,
+				   bitstr_t *bitmap);
+
 #endif /* !_HOSTLIST_H */
@@ -0,0 +1,289 @@
+/*****************************************************************************\
+ *  interval_tree.c - index of time intervals
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "src/common/interval_tree.h"
+#include "src/common/macros.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+typedef struct {
+	time_t start;
+	time_t end;
+	time_t max_end;		/* largest end of the implicit subtree */
+	uint32_t seq;		/* order in which the interval was added */
+	void *arg;
+} interval_t;
+
+typedef struct {
+	time_t end;
+	uint32_t seq;
+	void *arg;
+} end_t;
+
+struct interval_tree {
+	interval_t *intervals;	/* sorted by start once built */
+	end_t *ends;		/* interval ends, sorted once built */
+	int cnt;
+	int size;
+	bool built;
+};
+
+/* Collected lookup results */
+typedef struct {
+	end_t *found;		/* only seq and arg are used */
+	int cnt;
+	int size;
+} result_t;
+
+static int _cmp_start(const void *x, const void *y)
+{
+	const interval_t *a = x, *b = y;
+
+	if (a->start != b->start)
+		return (a->start < b->start) ? -1 : 1;
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq);
+}
+
+static int _cmp_end(const void *x, const void *y)
+{
+	const end_t *a = x, *b = y;
+
+	if (a->end != b->end)
+		return (a->end < b->end) ? -1 : 1;
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq);
+}
+
+static int _cmp_seq(const void *x, const void *y)
+{
+	const end_t *a = x, *b = y;
+
+	return (a->seq < b->seq) ? -1 : (a->seq > b->seq);
+}
+
+/* The node of subtree [lo, hi) is its middle interval */
+static time_t _set_max_end(interval_t *intervals, int lo, int hi)
+{
+	int mid;
+	time_t max_end;
+
+	if (lo >= hi)
+		return 0;
+
+	mid = lo + ((hi - lo) / 2);
+	max_end = intervals[mid].end;
+	max_end = MAX(max_end, _set_max_end(intervals, lo, mid));
+	max_end = MAX(max_end, _set_max_end(intervals, mid + 1, hi));
+	intervals[mid].max_end = max_end;
+
+	return max_end;
+}
+
+static void _build(interval_tree_t *tree)
+{
+	if (tree->built)
+		return;
+
+	qsort(tree->intervals, tree->cnt, sizeof(interval_t), _cmp_start);
+	_set_max_end(tree->intervals, 0, tree->cnt);
+
+	qsort(tree->ends, tree->cnt, sizeof(end_t), _cmp_end);
+
+	tree->built = true;
+}
+
+static void _result_add(result_t *result, uint32_t seq, void *arg)
+{
+	if (result->cnt >= result->size) {
+		result->size = MAX(16, result->size * 2);
+		xrecalloc(result->found, result->size, sizeof(end_t));
+	}
+	result->found[result->cnt].seq = seq;
+	result->found[result->cnt].arg = arg;
+	result->cnt++;
+}
+
+/* Return the collected args in the order the intervals were added */
+static int _result_fini(result_t *result, void ***args)
+{
+	*args = NULL;
+	if (!result->cnt)
+		return 0;
+
+	qsort(result->found, result->cnt, sizeof(end_t), _cmp_seq);
+	*args = xcalloc(result->cnt, sizeof(void *));
+	for (int i = 0; i < result->cnt; i++)
+		(*args)[i] = result->found[i].arg;
+	xfree(result->found);
+
+	return result->cnt;
+}
+
+static void _overlap(interval_t *intervals, int lo, int hi, time_t start,
+		     time_t end, result_t *result)
+{
+	while (lo < hi) {
+		int mid = lo + ((hi - lo) / 2);
+		interval_t *interval = &intervals[mid];
+
+		/* Nothing in this subtree ends after start */
+		if (interval->max_end <= start)
+			return;
+
+		_overlap(intervals, lo, mid, start, end, result);
+
+		/* This interval and the right subtree start too late */
+		if (interval->start >= end)
+			return;
+
+		if (interval->end > start)
+			_result_add(result, interval->seq, interval->arg);
+
+		lo = mid + 1;
+	}
+}
+
+extern interval_tree_t *interval_tree_create(void)
+{
+	return xmalloc(sizeof(interval_tree_t));
+}
+
+extern void interval_tree_destroy(interval_tree_t *tree)
+{
+	if (!tree)
+		return;
+
+	xfree(tree->intervals);
+	xfree(tree->ends);
+	xfree(tree);
+}
+
+extern void interval_tree_clear(interval_tree_t *tree)
+{
+	xassert(tree);
+
+	tree->cnt = 0;
+	tree->built = false;
+}
+
+extern void interval_tree_add(interval_tree_t *tree, time_t start, time_t end,
+			      void *arg)
+{
+	interval_t *interval;
+
+	xassert(tree);
+
+	if (tree->cnt >= tree->size) {
+		tree->size = MAX(64, tree->size * 2);
+		xrecalloc(tree->intervals, tree->size, sizeof(interval_t));
+		xrecalloc(tree->ends, tree->size, sizeof(end_t));
+	}
+
+	interval = &tree->intervals[tree->cnt];
+	interval->start = start;
+	interval->end = end;
+	interval->seq = tree->cnt;
+	interval->arg = arg;
+	tree->ends[tree->cnt].end = end;
+	tree->ends[tree->cnt].seq = tree->cnt;
+	tree->ends[tree->cnt].arg = arg;
+	tree->cnt++;
+	tree->built = false;
+}
+
+extern int interval_tree_count(interval_tree_t *tree)
+{
+	xassert(tree);
+
+	return tree->cnt;
+}
+
+extern int interval_tree_overlap(interval_tree_t *tree, time_t start,
+				 time_t end, void ***args)
+{
+	result_t result = { 0 };
+
+	xassert(tree);
+	xassert(args);
+
+	_build(tree);
+	_overlap(tree->intervals, 0, tree->cnt, start, end, &result);
+
+	return _result_fini(&result, args);
+}
+
+extern int interval_tree_ended(interval_tree_t *tree, time_t when,
+			       void ***args)
+{
+	result_t result = { 0 };
+
+	xassert(tree);
+	xassert(args);
+
+	_build(tree);
+	for (int i = 0; (i < tree->cnt) && (tree->ends[i].end <= when); i++)
+		_result_add(&result, tree->ends[i].seq, tree->ends[i].arg);
+
+	return _result_fini(&result, args);
+}
+
+extern bool interval_tree_next_end(interval_tree_t *tree, time_t when,
+				   time_t *end)
+{
+	int lo = 0, hi;
+
+	xassert(tree);
+	xassert(end);
+
+	_build(tree);
+
+	/* First interval in end order with end >= when */
+	hi = tree->cnt;
+	while (lo < hi) {
+		int mid = lo + ((hi - lo) / 2);
+
+		if (tree->ends[mid].end < when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo >= tree->cnt)
+		return false;
+
+	*end = tree->ends[lo].end;
+	return true;
+}
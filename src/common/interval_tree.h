@@ -0,0 +1,101 @@
+/*****************************************************************************\
+ *  interval_tree.h - index of time intervals
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _INTERVAL_TREE_H
+#define _INTERVAL_TREE_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Index of [start, end) time intervals answering "which intervals overlap
+ * this window" in O(log n + k). Intervals are kept in an array sorted by
+ * start, read as an implicit balanced tree whose nodes hold the largest end
+ * of their subtree. It is built by the first lookup after a change, so it
+ * suits data that is read much more often than it is modified.
+ *
+ * Lookups return intervals in the order they were added.
+ * Not thread safe, callers must serialize access.
+ */
+typedef struct interval_tree interval_tree_t;
+
+/* Create an empty interval tree */
+extern interval_tree_t *interval_tree_create(void);
+
+/* Free an interval tree, the args are not freed */
+extern void interval_tree_destroy(interval_tree_t *tree);
+
+/* Remove all the intervals of a tree */
+extern void interval_tree_clear(interval_tree_t *tree);
+
+/*
+ * Add an interval to a tree
+ * IN start, end - interval [start, end)
+ * IN arg - returned by the lookups
+ */
+extern void interval_tree_add(interval_tree_t *tree, time_t start, time_t end,
+			      void *arg);
+
+/* Return the number of intervals in a tree */
+extern int interval_tree_count(interval_tree_t *tree);
+
+/*
+ * Find the intervals overlapping [start, end), that is with an interval
+ * start < end and an interval end > start.
+ * OUT args - xmalloc()ed array of their args, NULL if none, caller must
+ *	      xfree()
+ * RET number of intervals found
+ */
+extern int interval_tree_overlap(interval_tree_t *tree, time_t start,
+				 time_t end, void ***args);
+
+/*
+ * Find the intervals ending at or before a time
+ * OUT args - xmalloc()ed array of their args, NULL if none, caller must
+ *	      xfree()
+ * RET number of intervals found
+ */
+extern int interval_tree_ended(interval_tree_t *tree, time_t when,
+			       void ***args);
+
+/*
+ * Find the first interval end at or after a time
+ * OUT end - that end
+ * RET false if no interval ends at or after when
+ */
+extern bool interval_tree_next_end(interval_tree_t *tree, time_t when,
+				   time_t *end);
+
+#endif
@@ -49,6 +49,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -89,6 +90,25 @@ int node_record_count = 0;		/* count in node_record_table_ptr */
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
 
+/*
+ * Index of node_record_table_ptr names, built on first use, and a small
+ * cache of recent bitmap2node_name() results. Both are discarded whenever
+ * the node table is rebuilt. node_index_mutex only protects building them,
+ * using the index relies on the same locking as node_record_table_ptr.
+ */
+#define NODE_NAME_CACHE_SIZE 8
+typedef struct {
+	bitstr_t *bitmap;
+	char *node_names;
+	bool sort;
+} node_name_cache_t;
+
+static pthread_mutex_t node_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hostlist_index_t node_index = NULL;
+static node_record_t *node_index_table = NULL;
+static node_name_cache_t node_name_cache[NODE_NAME_CACHE_SIZE];
+static int node_name_cache_next = 0;
+
 /* Local function definitions */
 static void _delete_config_record(void);
 #if _DEBUG
@@ -172,6 +192,50 @@ static void _node_record_hash_identity (void* item, const char** key,
 	*key_len = strlen(node_ptr->name);
 }
 
+/* Discard the node name index and cache, node_index_mutex must be held */
+static void _node_index_clear(void)
+{
+	int i;
+
+	hostlist_index_destroy(node_index);
+	node_index = NULL;
+	node_index_table = NULL;
+
+	for (i = 0; i < NODE_NAME_CACHE_SIZE; i++) {
+		FREE_NULL_BITMAP(node_name_cache[i].bitmap);
+		xfree(node_name_cache[i].node_names);
+	}
+	node_name_cache_next = 0;
+}
+
+/*
+ * Return the node name index, building it if the node table or the cluster
+ * dimensions changed since it was last built. node_index_mutex must be held.
+ */
+static hostlist_index_t _node_index_get(void)
+{
+	char **names;
+	int i, dims = slurmdb_setup_cluster_name_dims();
+
+	if (node_index && (node_index_table == node_record_table_ptr) &&
+	    (hostlist_index_count(node_index) == node_record_count) &&
+	    (hostlist_index_dims(node_index) == dims))
+		return node_index;
+
+	_node_index_clear();
+	if (!node_record_count)
+		return NULL;
+
+	names = xcalloc(node_record_count, sizeof(char *));
+	for (i = 0; i < node_record_count; i++)
+		names[i] = node_record_table_ptr[i].name;
+	node_index = hostlist_index_create(names, node_record_count, dims);
+	node_index_table = node_record_table_ptr;
+	xfree(names);
+
+	return node_index;
+}
+
 /*
  * bitmap2hostlist - given a bitmap, build a hostlist
  * IN bitmap - bitmap pointer
@@ -181,25 +245,20 @@ static void _node_record_hash_identity (void* item, const char** key,
  */
 hostlist_t bitmap2hostlist (bitstr_t *bitmap)
 {
-	int i, first, last;
-	hostlist_t hl;
+	hostlist_index_t hi;
+	hostlist_t hl = NULL;
 
 	if (bitmap == NULL)
 		return NULL;
 
-	first = bit_ffs(bitmap);
-	if (first == -1)
-		return NULL;
+	slurm_mutex_lock(&node_index_mutex);
+	hi = _node_index_get();
+	slurm_mutex_unlock(&node_index_mutex);
 
-	last  = bit_fls(bitmap);
-	hl = hostlist_create(NULL);
-	for (i = first; i <= last; i++) {
-		if (bit_test(bitmap, i) == 0)
-			continue;
-		hostlist_push_host(hl, node_record_table_ptr[i].name);
-	}
-	return hl;
+	if (hi)
+		hl = hostlist_index_bitmap2hostlist(hi, bitmap);
 
+	return hl;
 }
 
 /*
@@ -214,16 +273,49 @@ hostlist_t bitmap2hostlist (bitstr_t *bitmap)
  */
 char * bitmap2node_name_sortable (bitstr_t *bitmap, bool sort)
 {
-	hostlist_t hl;
+	hostlist_index_t hi;
+	node_name_cache_t *cache;
 	char *buf;
+	int i;
 
-	hl = bitmap2hostlist (bitmap);
-	if (hl == NULL)
+	if ((bitmap == NULL) || (bit_ffs(bitmap) == -1))
 		return xstrdup("");
-	if (sort)
-		hostlist_sort(hl);
-	buf = hostlist_ranged_string_xmalloc(hl);
-	hostlist_destroy(hl);
+
+	slurm_mutex_lock(&node_index_mutex);
+	if (!(hi = _node_index_get())) {
+		slurm_mutex_unlock(&node_index_mutex);
+		return xstrdup("");
+	}
+
+	for (i = 0; i < NODE_NAME_CACHE_SIZE; i++) {
+		cache = &node_name_cache[i];
+		if (cache->bitmap && (cache->sort == sort) &&
+		    bit_equal(cache->bitmap, bitmap)) {
+			buf = xstrdup(cache->node_names);
+			slurm_mutex_unlock(&node_index_mutex);
+			return buf;
+		}
+	}
+	slurm_mutex_unlock(&node_index_mutex);
+
+	buf = hostlist_index_ranged_string(hi, bitmap, sort);
+
+	slurm_mutex_lock(&node_index_mutex);
+	if (hi != node_index) {
+		/* node table was rebuilt meanwhile, do not cache */
+		slurm_mutex_unlock(&node_index_mutex);
+		return buf;
+	}
+	cache = &node_name_cache[node_name_cache_next];
+	node_name_cache_next = (node_name_cache_next + 1) %
+			       NODE_NAME_CACHE_SIZE;
+	FREE_NULL_BITMAP(cache->bitmap);
+	xfree(cache->node_names);
+	cache->bitmap = bit_copy(bitmap);
+	cache->node_names = xstrdup(buf);
+	cache->sort = sort;
+	slurm_mutex_unlock(&node_index_mutex);
+
 	return buf;
 }
 
@@ -796,6 +888,10 @@ extern void init_node_conf(void)
 	xfree(node_record_table_ptr);
 	xhash_free(node_hash_table);
 
+	slurm_mutex_lock(&node_index_mutex);
+	_node_index_clear();
+	slurm_mutex_unlock(&node_index_mutex);
+
 	if (config_list)	/* delete defunct configuration entries */
 		_delete_config_record();
 	else {
@@ -823,6 +919,10 @@ extern void node_fini2 (void)
 
 	xfree(node_record_table_ptr);
 	node_record_count = 0;
+
+	slurm_mutex_lock(&node_index_mutex);
+	_node_index_clear();
+	slurm_mutex_unlock(&node_index_mutex);
 }
 
 extern int node_name_get_inx(char *node_name)
@@ -854,6 +954,7 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 	char *this_node_name;
 	bitstr_t *my_bitmap;
 	hostlist_t host_list;
+	hostlist_index_t hi;
 
 	my_bitmap = (bitstr_t *) bit_alloc (node_record_count);
 	*bitmap = my_bitmap;
@@ -871,6 +972,18 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 		return rc;
 	}
 
+	/*
+	 * Resolve the whole hostlist through the node name index. Only if some
+	 * names are unknown fall back to looking up (and logging) every name.
+	 */
+	slurm_mutex_lock(&node_index_mutex);
+	hi = _node_index_get();
+	slurm_mutex_unlock(&node_index_mutex);
+	if (hi && !hostlist_index_hostlist2bitmap(hi, host_list, my_bitmap)) {
+		hostlist_destroy(host_list);
+		return rc;
+	}
+
 	while ( (this_node_name = hostlist_shift (host_list)) ) {
 		node_record_t *node_ptr;
 		node_ptr = _find_node_record(this_node_name, best_effort, true);
@@ -968,6 +1081,11 @@ extern void rehash_node (void)
 
 	xhash_free (node_hash_table);
 	node_hash_table = xhash_init(_node_record_hash_identity, NULL);
+
+	slurm_mutex_lock(&node_index_mutex);
+	_node_index_clear();
+	slurm_mutex_unlock(&node_index_mutex);
+
 	for (i = 0; i < node_record_count; i++, node_ptr++) {
 		if ((node_ptr->name == NULL) ||
 		    (node_ptr->name[0] == '\0'))
@@ -59,8 +59,10 @@
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/pack.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xassert.h"
+#include "src/common/xstring.h"
 #include "src/slurmdbd/read_config.h"
 
 #define MAX_ARRAY_LEN_SMALL	10000
@@ -1104,3 +1106,102 @@ int unpackmem_array(char *valp, uint32_t size_valp, buf_t *buffer)
 		return SLURM_ERROR;
 	}
 }
+
+typedef struct {
+	char *str;
+	uint32_t inx;
+} str_dict_ent_t;
+
+struct str_dict {
+	xhash_t *hash;		/* pack side, string to str_dict_ent_t */
+	char **strs;		/* unpack side, strings by position */
+	uint32_t cnt;
+	uint32_t size;
+};
+
+static void _str_dict_ent_id(void *item, const char **key, uint32_t *key_len)
+{
+	str_dict_ent_t *ent = item;
+
+	*key = ent->str;
+	*key_len = strlen(ent->str);
+}
+
+extern str_dict_t *str_dict_create(void)
+{
+	return xmalloc(sizeof(str_dict_t));
+}
+
+extern void str_dict_destroy(str_dict_t *dict)
+{
+	if (!dict)
+		return;
+
+	xhash_free(dict->hash);
+	for (int i = 0; dict->strs && (i < dict->cnt); i++)
+		xfree(dict->strs[i]);
+	xfree(dict->strs);
+	xfree(dict);
+}
+
+extern void packstr_dict(char *valp, str_dict_t *dict, buf_t *buffer)
+{
+	str_dict_ent_t *ent;
+
+	if (!dict) {
+		packstr(valp, buffer);
+		return;
+	}
+	if (!valp) {
+		pack32(0, buffer);
+		return;
+	}
+
+	if (!dict->hash)
+		dict->hash = xhash_init(_str_dict_ent_id, xfree_ptr);
+	else if ((ent = xhash_get_str(dict->hash, valp))) {
+		pack32(ent->inx, buffer);
+		return;
+	}
+
+	/* Entries point into the strings of the records being packed */
+	ent = xmalloc(sizeof(*ent));
+	ent->str = valp;
+	ent->inx = ++dict->cnt;
+	xhash_add(dict->hash, ent);
+	pack32(ent->inx, buffer);
+	packstr(valp, buffer);
+}
+
+extern int unpackstr_dict(char **valp, str_dict_t *dict, buf_t *buffer)
+{
+	uint32_t inx, uint32_tmp;
+
+	if (!dict)
+		return unpackstr_xmalloc_chooser(valp, &uint32_tmp, buffer);
+
+	*valp = NULL;
+	if (unpack32(&inx, buffer))
+		return SLURM_ERROR;
+	if (!inx)
+		return SLURM_SUCCESS;
+
+	if (inx <= dict->cnt) {
+		*valp = xstrdup(dict->strs[inx - 1]);
+		return SLURM_SUCCESS;
+	}
+	if (inx != (dict->cnt + 1)) {
+		error("%s: invalid string reference %u", __func__, inx);
+		return SLURM_ERROR;
+	}
+
+	if (unpackstr_xmalloc_chooser(valp, &uint32_tmp, buffer))
+		return SLURM_ERROR;
+	if (dict->cnt >= dict->size) {
+		dict->size = MAX(dict->size * 2, 64);
+		xrecalloc(dict->strs, dict->size, sizeof(char *));
+	}
+	dict->strs[dict->cnt++] = xstrdup(*valp);
+
+	return SLURM_SUCCESS;
+}
@@ -141,6 +141,21 @@ extern int unpackstr_array(char ***valp, uint32_t* size_val, buf_t *buffer);
 extern void packmem_array(char *valp, uint32_t size_val, buf_t *buffer);
 extern int unpackmem_array(char *valp, uint32_t size_valp, buf_t *buffer);
 
+/*
+ * A string dictionary sends each distinct string once per message. Strings
+ * packed with packstr_dict() are written as a 32 bit reference: 0 for NULL,
+ * the position of a string sent earlier in the message, or the next position
+ * followed by the string itself. Both sides must pack and unpack the strings
+ * of the message in the same order through the same dictionary.
+ * With a NULL dictionary these behave like packstr() and unpackstr_xmalloc().
+ */
+typedef struct str_dict str_dict_t;
+
+extern str_dict_t *str_dict_create(void);
+extern void str_dict_destroy(str_dict_t *dict);
+extern void packstr_dict(char *valp, str_dict_t *dict, buf_t *buffer);
+extern int unpackstr_dict(char **valp, str_dict_t *dict, buf_t *buffer);
+
 #define safe_unpack_time(valp,buf) do {			\
 	xassert(sizeof(*valp) == sizeof(time_t));	\
 	xassert(buf->magic == BUF_MAGIC);		\
@@ -345,6 +360,12 @@ extern int unpackmem_array(char *valp, uint32_t size_valp, buf_t *buffer);
 		goto unpack_error;		       		\
 } while (0)
 
+#define safe_unpackstr_dict(valp, dict, buf) do {		\
+	xassert(buf->magic == BUF_MAGIC);			\
+	if (unpackstr_dict(valp, dict, buf))			\
+		goto unpack_error;				\
+} while (0)
+
 #define safe_unpackstr_array(valp,size_valp,buf) do {	\
 	xassert(sizeof(*size_valp) == sizeof(uint32_t)); \
 	xassert(buf->magic == BUF_MAGIC);		\
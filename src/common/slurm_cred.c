@@ -376,22 +376,33 @@ static int _slurm_cred_fini(void)
 	return rc;
 }
 
-static int _fill_cred_gids(slurm_cred_t *cred, slurm_cred_arg_t *arg)
+/*
+ * Fill in the user's passwd entry and extended groups. On entry
+ * cred->pw_name may hold the user name given by the caller, which is only
+ * used as a hint for the group lookup.
+ */
+static int _fill_cred_gids(slurm_cred_t *cred)
 {
 	struct passwd pwd, *result;
 	char buffer[PW_BUF_SIZE];
+	char *pw_name_hint;
 	int rc;
 
-	if (!enable_nss_slurm && !enable_send_gids)
-		return SLURM_SUCCESS;
-
 	xassert(cred);
-	xassert(arg);
 
-	rc = slurm_getpwuid_r(arg->uid, &pwd, buffer, PW_BUF_SIZE, &result);
+	pw_name_hint = cred->pw_name;
+	cred->pw_name = NULL;
+
+	if (!enable_nss_slurm && !enable_send_gids) {
+		xfree(pw_name_hint);
+		return SLURM_SUCCESS;
+	}
+
+	rc = slurm_getpwuid_r(cred->uid, &pwd, buffer, PW_BUF_SIZE, &result);
 	if (rc || !result) {
 		error("%s: getpwuid failed for uid=%u: %s",
-		      __func__, arg->uid, slurm_strerror(rc));
+		      __func__, cred->uid, slurm_strerror(rc));
+		xfree(pw_name_hint);
 		return SLURM_ERROR;
 	}
 
@@ -400,8 +411,9 @@ static int _fill_cred_gids(slurm_cred_t *cred, slurm_cred_arg_t *arg)
 	cred->pw_dir = xstrdup(result->pw_dir);
 	cred->pw_shell = xstrdup(result->pw_shell);
 
-	cred->ngids = group_cache_lookup(arg->uid, arg->gid,
-					 arg->pw_name, &cred->gids);
+	cred->ngids = group_cache_lookup(cred->uid, cred->gid,
+					 pw_name_hint, &cred->gids);
+	xfree(pw_name_hint);
 
 	return SLURM_SUCCESS;
 }
@@ -575,14 +587,11 @@ slurm_cred_ctx_key_update(slurm_cred_ctx_t ctx, const char *path)
 }
 
 
-slurm_cred_t *
-slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
-		  uint16_t protocol_version)
+slurm_cred_t *slurm_cred_create_unsigned(slurm_cred_arg_t *arg)
 {
 	slurm_cred_t *cred = NULL;
 	int i = 0, sock_recs = 0;
 
-	xassert(ctx != NULL);
 	xassert(arg != NULL);
 	if (_slurm_cred_init() < 0)
 		return NULL;
@@ -667,7 +676,24 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 
 	cred->selinux_context = xstrdup(arg->selinux_context);
 
-	if (_fill_cred_gids(cred, arg) != SLURM_SUCCESS)
+	/* Only a hint for _fill_cred_gids() until signed */
+	cred->pw_name = xstrdup(arg->pw_name);
+
+	slurm_mutex_unlock(&cred->mutex);
+
+	return cred;
+}
+
+int slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+		    uint16_t protocol_version)
+{
+	xassert(ctx != NULL);
+	xassert(cred != NULL);
+
+	slurm_mutex_lock(&cred->mutex);
+	xassert(cred->magic == CRED_MAGIC);
+
+	if (_fill_cred_gids(cred) != SLURM_SUCCESS)
 		goto fail;
 
 	if (enable_nss_slurm) {
@@ -691,12 +717,30 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 	slurm_mutex_unlock(&ctx->mutex);
 	slurm_mutex_unlock(&cred->mutex);
 
-	return cred;
+	return SLURM_SUCCESS;
 
 fail:
 	slurm_mutex_unlock(&cred->mutex);
-	slurm_cred_destroy(cred);
-	return NULL;
+	return SLURM_ERROR;
+}
+
+slurm_cred_t *
+slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
+		  uint16_t protocol_version)
+{
+	slurm_cred_t *cred;
+
+	xassert(ctx != NULL);
+
+	if (!(cred = slurm_cred_create_unsigned(arg)))
+		return NULL;
+
+	if (slurm_cred_sign(ctx, cred, protocol_version) != SLURM_SUCCESS) {
+		slurm_cred_destroy(cred);
+		return NULL;
+	}
+
+	return cred;
 }
 
 slurm_cred_t *
@@ -886,7 +930,8 @@ slurm_cred_faker(slurm_cred_arg_t *arg)
 			cred->signature[i] = 'a' + (rand() & 0xf);
 	}
 
-	(void) _fill_cred_gids(cred, arg);
+	cred->pw_name = xstrdup(arg->pw_name);
+	(void) _fill_cred_gids(cred);
 
 	slurm_mutex_unlock(&cred->mutex);
 	return cred;
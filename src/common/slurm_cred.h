@@ -206,6 +206,26 @@ int slurm_cred_fini(void);
 slurm_cred_t *slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 				uint16_t protocol_version);
 
+/*
+ * First half of slurm_cred_create(): copy the values in `arg' into a new,
+ * unsigned credential. No user or group lookups are done here, so this is
+ * cheap enough to call while holding the locks protecting `arg'.
+ *
+ * Returns NULL on failure.
+ */
+slurm_cred_t *slurm_cred_create_unsigned(slurm_cred_arg_t *arg);
+
+/*
+ * Second half of slurm_cred_create(): fill in the user's identity and
+ * sign a credential from slurm_cred_create_unsigned() with the creators
+ * key. Does not need any of the data `arg' pointed to.
+ *
+ * Returns SLURM_SUCCESS or SLURM_ERROR, the credential must be destroyed
+ * by the caller in either case.
+ */
+int slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+		    uint16_t protocol_version);
+
 /*
  * Copy a slurm credential.
  * Returns NULL on failure.
@@ -56,6 +56,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#if HAVE_LZ4
+#  include <lz4.h>
+#endif
+
 /* PROJECT INCLUDES */
 #include "src/common/assoc_mgr.h"
 #include "src/common/fd.h"
@@ -72,6 +76,7 @@
 #include "src/common/slurm_protocol_pack.h"
 #include "src/common/slurm_route.h"
 #include "src/common/strlcpy.h"
+#include "src/common/timers.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmdbd/read_config.h"
@@ -89,6 +94,12 @@ strong_alias(get_unit_type, slurm_get_unit_type);
 /* STATIC VARIABLES */
 static int message_timeout = -1;
 
+static pthread_mutex_t compress_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t compress_cnt = 0;
+static uint64_t compress_bytes_in = 0;
+static uint64_t compress_bytes_out = 0;
+static uint64_t compress_usec = 0;
+
 /* STATIC FUNCTIONS */
 static char *_global_auth_key(void);
 static void  _remap_slurmctld_errno(void);
@@ -890,6 +901,151 @@ fini:	_slurm_api_free_comm_config(proto_conf);
 	return rc;
 }
 
+#if HAVE_LZ4
+/*
+ * Smallest message body to compress when the peer accepts compressed
+ * replies, set by CommunicationParameters=CompressMinSize=#. 0 if disabled.
+ */
+static uint32_t _compress_min_size(void)
+{
+	char *tmp_ptr;
+
+	if (!(tmp_ptr = xstrcasestr(slurm_conf.comm_params,
+				    "CompressMinSize=")))
+		return 0;
+
+	return (uint32_t) strtoul(tmp_ptr + strlen("CompressMinSize="),
+				  NULL, 10);
+}
+#endif
+
+extern uint32_t slurm_compress_msg_body(header_t *hdr, buf_t *buffer,
+				       uint32_t body_offset, uint32_t body_len)
+{
+#if HAVE_LZ4
+	uint32_t min_size = _compress_min_size();
+	char *out;
+	int out_max, out_len;
+	DEF_TIMERS;
+
+	if (!min_size || (body_len < min_size) ||
+	    (body_len > LZ4_MAX_INPUT_SIZE))
+		return body_len;
+
+	START_TIMER;
+	out_max = LZ4_compressBound(body_len);
+	out = xmalloc_nz(out_max);
+	out_len = LZ4_compress_default(get_buf_data(buffer) + body_offset,
+				       out, body_len, out_max);
+	if ((out_len <= 0) || ((out_len + sizeof(uint32_t)) >= body_len)) {
+		xfree(out);
+		return body_len;
+	}
+
+	set_buf_offset(buffer, body_offset);
+	pack32(body_len, buffer);
+	memcpy(get_buf_data(buffer) + get_buf_offset(buffer), out, out_len);
+	set_buf_offset(buffer, get_buf_offset(buffer) + out_len);
+	xfree(out);
+	hdr->flags |= SLURM_COMPRESSED;
+	END_TIMER;
+
+	slurm_mutex_lock(&compress_mutex);
+	compress_cnt++;
+	compress_bytes_in += body_len;
+	compress_bytes_out += out_len + sizeof(uint32_t);
+	compress_usec += DELTA_TIMER;
+	slurm_mutex_unlock(&compress_mutex);
+
+	log_flag(NET, "%s: %s body compressed from %u to %zu bytes",
+		 __func__, rpc_num2string(hdr->msg_type), body_len,
+		 out_len + sizeof(uint32_t));
+
+	return out_len + sizeof(uint32_t);
+#else
+	return body_len;
+#endif
+}
+
+extern buf_t *slurm_uncompress_msg_body(header_t *header, buf_t *buffer)
+{
+#if HAVE_LZ4
+	uint32_t orig_len;
+	int in_len;
+	char *out;
+
+	if ((header->body_length <= sizeof(uint32_t)) ||
+	    unpack32(&orig_len, buffer) || !orig_len ||
+	    (orig_len > MAX_BUF_SIZE)) {
+		error("%s: %s has an invalid compressed body",
+		      __func__, rpc_num2string(header->msg_type));
+		return NULL;
+	}
+	in_len = header->body_length - sizeof(uint32_t);
+
+	out = xmalloc_nz(orig_len);
+	if (LZ4_decompress_safe(get_buf_data(buffer) + get_buf_offset(buffer),
+				out, in_len, orig_len) != orig_len) {
+		error("%s: %s body failed to decompress",
+		      __func__, rpc_num2string(header->msg_type));
+		xfree(out);
+		return NULL;
+	}
+	set_buf_offset(buffer, get_buf_offset(buffer) + in_len);
+
+	return create_buf(out, orig_len);
+#else
+	error("%s: %s body is compressed, but lz4 support is not built in",
+	      __func__, rpc_num2string(header->msg_type));
+	return NULL;
+#endif
+}
+
+/* Unpack the message body following the header and auth credential */
+static int _unpack_msg_body(slurm_msg_t *msg, header_t *header,
+			    buf_t *buffer)
+{
+	buf_t *body = buffer;
+	int rc;
+
+	if (header->body_length > remaining_buf(buffer))
+		return SLURM_ERROR;
+
+	if (header->flags & SLURM_COMPRESSED) {
+		if (!(body = slurm_uncompress_msg_body(header, buffer)))
+			return SLURM_ERROR;
+		/* The body is sent uncompressed if it is ever passed on */
+		msg->flags &= ~SLURM_COMPRESSED;
+	}
+
+	rc = unpack_msg(msg, body);
+	if (body != buffer)
+		free_buf(body);
+
+	return rc;
+}
+
+extern void slurm_get_compress_stats(uint32_t *cnt, uint64_t *bytes_in,
+				     uint64_t *bytes_out, uint64_t *usec)
+{
+	slurm_mutex_lock(&compress_mutex);
+	*cnt = compress_cnt;
+	*bytes_in = compress_bytes_in;
+	*bytes_out = compress_bytes_out;
+	*usec = compress_usec;
+	slurm_mutex_unlock(&compress_mutex);
+}
+
+extern void slurm_reset_compress_stats(void)
+{
+	slurm_mutex_lock(&compress_mutex);
+	compress_cnt = 0;
+	compress_bytes_in = 0;
+	compress_bytes_out = 0;
+	compress_usec = 0;
+	slurm_mutex_unlock(&compress_mutex);
+}
+
 extern int slurm_unpack_received_msg(slurm_msg_t *msg, int fd, buf_t *buffer)
 {
 	header_t header;
@@ -966,8 +1122,7 @@ extern int slurm_unpack_received_msg(slurm_msg_t *msg, int fd, buf_t *buffer)
 
 	msg->body_offset =  get_buf_offset(buffer);
 
-	if ((header.body_length > remaining_buf(buffer)) ||
-	    (unpack_msg(msg, buffer) != SLURM_SUCCESS)) {
+	if (_unpack_msg_body(msg, &header, buffer) != SLURM_SUCCESS) {
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
 		(void) auth_g_destroy(auth_cred);
 		goto total_return;
@@ -1248,8 +1403,7 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 	msg.msg_type = header.msg_type;
 	msg.flags = header.flags;
 
-	if ((header.body_length > remaining_buf(buffer)) ||
-	    (unpack_msg(&msg, buffer) != SLURM_SUCCESS)) {
+	if (_unpack_msg_body(&msg, &header, buffer) != SLURM_SUCCESS) {
 		(void) auth_g_destroy(auth_cred);
 		free_buf(buffer);
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
@@ -1472,8 +1626,7 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
 	msg->msg_type = header.msg_type;
 	msg->flags = header.flags;
 
-	if ( (header.body_length > remaining_buf(buffer)) ||
-	     (unpack_msg(msg, buffer) != SLURM_SUCCESS) ) {
+	if (_unpack_msg_body(msg, &header, buffer) != SLURM_SUCCESS) {
 		(void) auth_g_destroy(auth_cred);
 		free_buf(buffer);
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
@@ -1518,6 +1671,16 @@ static void _pack_msg(slurm_msg_t *msg, header_t *hdr, buf_t *buffer)
 	pack_msg(msg, buffer);
 	msglen = get_buf_offset(buffer) - tmplen;
 
+	/*
+	 * Only replies to peers that said they can read them are compressed.
+	 * Older peers, and forwarders of their messages, copy header flags
+	 * they do not know, so the flag means nothing below this version.
+	 */
+	if ((msg->flags & SLURM_COMPRESS_ACCEPT) &&
+	    (hdr->version >= SLURM_21_08_1_PROTOCOL_VERSION))
+		msglen = slurm_compress_msg_body(hdr, buffer, tmplen,
+						 msglen);
+
 	/* update header with correct cred and msg lengths */
 	update_header(hdr, msglen);
 
@@ -1611,6 +1774,12 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	}
 
 	init_header(&header, msg, msg->flags);
+	/* Only advertise what this process can read, never the peer's flag */
+	header.flags &= ~SLURM_COMPRESS_ACCEPT;
+#if HAVE_LZ4
+	if (header.version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		header.flags |= SLURM_COMPRESS_ACCEPT;
+#endif
 
 	/*
 	 * Pack header into buffer for transmission
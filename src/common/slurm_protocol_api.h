@@ -311,6 +311,33 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(int open_fd, slurm_msg_t *msg);
 
+/*
+ * Get the count of message bodies compressed by slurm_send_node_msg(), their
+ * total size before and after compression and the time spent compressing
+ */
+extern void slurm_get_compress_stats(uint32_t *cnt, uint64_t *bytes_in,
+				     uint64_t *bytes_out, uint64_t *usec);
+
+/* Clear the message compression statistics */
+extern void slurm_reset_compress_stats(void);
+
+/*
+ * Replace the body_len bytes of message body at body_offset in buffer with
+ * the original length followed by one lz4 block, if the body is at least
+ * CommunicationParameters=CompressMinSize and compresses. Sets
+ * SLURM_COMPRESSED in hdr->flags when it does.
+ * RET length of the body to send
+ */
+extern uint32_t slurm_compress_msg_body(header_t *hdr, buf_t *buffer,
+					uint32_t body_offset, uint32_t body_len);
+
+/*
+ * Decompress the message body of length header->body_length at the current
+ * offset of buffer, which is advanced past it.
+ * RET buffer holding the original body or NULL on error
+ */
+extern buf_t *slurm_uncompress_msg_body(header_t *header, buf_t *buffer);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
@@ -66,11 +66,17 @@
  * done here with them since we have to support old version of archive
  * files since they don't update once they are created.
  */
+/*
+ * SLURM_21_08_1_PROTOCOL_VERSION is 21.08 plus the extended REQUEST_STATS_INFO
+ * reply, compressed replies and pipelined sbcast. Peers still using
+ * SLURM_21_08_PROTOCOL_VERSION are supported, see check_header_version().
+ */
+#define SLURM_21_08_1_PROTOCOL_VERSION ((37 << 8) | 1)
 #define SLURM_21_08_PROTOCOL_VERSION ((37 << 8) | 0)
 #define SLURM_20_11_PROTOCOL_VERSION ((36 << 8) | 0)
 #define SLURM_20_02_PROTOCOL_VERSION ((35 << 8) | 0)
 
-#define SLURM_PROTOCOL_VERSION SLURM_21_08_PROTOCOL_VERSION
+#define SLURM_PROTOCOL_VERSION SLURM_21_08_1_PROTOCOL_VERSION
 #define SLURM_ONE_BACK_PROTOCOL_VERSION SLURM_20_11_PROTOCOL_VERSION
 #define SLURM_MIN_PROTOCOL_VERSION SLURM_20_02_PROTOCOL_VERSION
 
@@ -105,5 +111,8 @@
 #define SLURM_DROP_PRIV		0x0008
 #define USE_BCAST_NETWORK	0x0010
 #define CTLD_QUEUE_PROCESSING	0x0020
+#define SLURM_PACK_STR_DICT	0x0040	/* strings packed with packstr_dict() */
+#define SLURM_COMPRESS_ACCEPT	0x0080	/* sender reads compressed replies */
+#define SLURM_COMPRESSED	0x0100	/* message body is lz4 compressed */
 
 #endif
@@ -1797,6 +1797,14 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 	int i;
 	if (msg) {
 		xfree(msg->rpc_type_id);
+		for (i = 0; msg->recovery_phase_name &&
+			    (i < msg->recovery_phase_cnt); i++)
+			xfree(msg->recovery_phase_name[i]);
+		xfree(msg->recovery_phase_name);
+		xfree(msg->recovery_phase_time);
+		for (i = 0; msg->mem_pools && (i < msg->mem_pool_cnt); i++)
+			xfree(msg->mem_pools[i].name);
+		xfree(msg->mem_pools);
 		xfree(msg->rpc_type_cnt);
 		xfree(msg->rpc_type_time);
 		xfree(msg->rpc_user_id);
@@ -1809,6 +1817,26 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		xfree(msg->rpc_type_max);
+		xfree(msg->rpc_type_p50);
+		xfree(msg->rpc_type_p99);
+		xfree(msg->rpc_type_lock_wait);
+		xfree(msg->rpc_user_max);
+		xfree(msg->rpc_user_p50);
+		xfree(msg->rpc_user_p99);
+		xfree(msg->rpc_user_lock_wait);
+		for (i = 0; msg->lock_stats && (i < msg->lock_stats_cnt);
+		     i++) {
+			xfree(msg->lock_stats[i].caller);
+			xfree(msg->lock_stats[i].lock_name);
+		}
+		xfree(msg->lock_stats);
+		for (i = 0;
+		     msg->lock_holders && (i < msg->lock_holder_cnt); i++) {
+			xfree(msg->lock_holders[i].lock_name);
+			xfree(msg->lock_holders[i].writer);
+		}
+		xfree(msg->lock_holders);
 		xfree(msg);
 	}
 }
@@ -100,7 +100,8 @@ static int _unpack_job_step_pids(job_step_pids_t **msg, buf_t *buffer,
 				 uint16_t protocol_version);
 
 static int _unpack_job_info_members(job_info_t *job, buf_t *buffer,
-				    uint16_t protocol_version);
+				    uint16_t protocol_version,
+				    str_dict_t *dict);
 
 static void _pack_ret_list(List ret_list, uint16_t size_val, buf_t *buffer,
 			   uint16_t protocol_version);
@@ -1617,6 +1618,8 @@ _pack_job_sbcast_cred_msg(job_sbcast_cred_msg_t * msg, buf_t *buffer,
 
 	pack32(0, buffer); /* was node_cnt */
 	pack_sbcast_cred(msg->sbcast_cred, buffer, protocol_version);
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		pack16(msg->protocol_version, buffer);
 }
 
 static int
@@ -1641,6 +1644,12 @@ _unpack_job_sbcast_cred_msg(job_sbcast_cred_msg_t ** msg, buf_t *buffer,
 	if (tmp_ptr->sbcast_cred == NULL)
 		goto unpack_error;
 
+	/* No node of an older slurmctld can be newer than it */
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		safe_unpack16(&tmp_ptr->protocol_version, buffer);
+	else
+		tmp_ptr->protocol_version = protocol_version;
+
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -3646,9 +3655,10 @@ unpack_error:
 
 static int
 _unpack_job_info_msg(job_info_msg_t ** msg, buf_t *buffer,
-		     uint16_t protocol_version)
+		     uint16_t protocol_version, bool use_dict)
 {
 	job_info_t *job = NULL;
+	str_dict_t *dict = NULL;
 
 	xassert(msg);
 	*msg = xmalloc(sizeof(job_info_msg_t));
@@ -3673,10 +3683,12 @@ _unpack_job_info_msg(job_info_msg_t ** msg, buf_t *buffer,
 		job = (*msg)->job_array;
 	}
 	/* load individual job info */
+	if (use_dict)
+		dict = str_dict_create();
 	for (int i = 0; i < (*msg)->record_count; i++) {
 		job_info_t *job_ptr = &job[i];
 		if (_unpack_job_info_members(job_ptr, buffer,
-					     protocol_version))
+					     protocol_version, dict))
 			goto unpack_error;
 		if ((job_ptr->bitflags & BACKFILL_SCHED) &&
 		    (*msg)->last_backfill &&
@@ -3684,10 +3696,12 @@ _unpack_job_info_msg(job_info_msg_t ** msg, buf_t *buffer,
 		    ((*msg)->last_backfill <= job_ptr->last_sched_eval))
 			job_ptr->bitflags |= BACKFILL_LAST;
 	}
+	str_dict_destroy(dict);
 
 	return SLURM_SUCCESS;
 
 unpack_error:
+	str_dict_destroy(dict);
 	slurm_free_job_info_msg(*msg);
 	*msg = NULL;
 	return SLURM_ERROR;
@@ -3698,10 +3712,11 @@ unpack_error:
  * OUT job - pointer to the job info buffer
  * IN/OUT buffer - source of the unpack, contains pointers that are
  *			automatically updated
+ * IN/OUT dict - string dictionary shared by the jobs of the message, or NULL
  */
 static int
 _unpack_job_info_members(job_info_t * job, buf_t *buffer,
-			 uint16_t protocol_version)
+			 uint16_t protocol_version, str_dict_t *dict)
 {
 	uint32_t uint32_tmp = 0;
 	multi_core_data_t *mc_ptr;
@@ -3758,11 +3773,11 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 		safe_unpack_time(&job->preempt_time, buffer);
 		safe_unpack32(&job->priority, buffer);
 		safe_unpackdouble(&job->billable_tres, buffer);
-		safe_unpackstr_xmalloc(&job->cluster, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->cluster, dict, buffer);
 		safe_unpackstr_xmalloc(&job->nodes, &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&job->sched_nodes, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->partition, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->account, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->partition, dict, buffer);
+		safe_unpackstr_dict(&job->account, dict, buffer);
 		safe_unpackstr_xmalloc(&job->admin_comment, &uint32_tmp,buffer);
 		safe_unpack32(&job->site_factor, buffer);
 		safe_unpackstr_xmalloc(&job->network, &uint32_tmp, buffer);
@@ -3776,7 +3791,7 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 				       buffer);
 		safe_unpackstr_xmalloc(&job->system_comment,
 				       &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->qos, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->qos, dict, buffer);
 		safe_unpack_time(&job->preemptable_time, buffer);
 		safe_unpackstr_xmalloc(&job->licenses, &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&job->state_desc, &uint32_tmp, buffer);
@@ -3793,12 +3808,12 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 				     &job->gres_detail_cnt, buffer);
 
 		safe_unpackstr_xmalloc(&job->name, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->user_name, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->wckey, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->user_name, dict, buffer);
+		safe_unpackstr_dict(&job->wckey, dict, buffer);
 		safe_unpack32(&job->req_switch, buffer);
 		safe_unpack32(&job->wait4switch, buffer);
 
-		safe_unpackstr_xmalloc(&job->alloc_node, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->alloc_node, dict, buffer);
 
 		unpack_bit_str_hex_as_inx(&job->node_inx, buffer);
 
@@ -3810,7 +3825,7 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 		safe_unpackstr_xmalloc(&job->features, &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&job->cluster_features, &uint32_tmp,
 				       buffer);
-		safe_unpackstr_xmalloc(&job->work_dir, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->work_dir, dict, buffer);
 		safe_unpackstr_xmalloc(&job->dependency, &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&job->command, &uint32_tmp, buffer);
 
@@ -3846,9 +3861,9 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 
 		unpack_bit_str_hex_as_inx(&job->exc_node_inx, buffer);
 
-		safe_unpackstr_xmalloc(&job->std_err, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->std_in, &uint32_tmp, buffer);
-		safe_unpackstr_xmalloc(&job->std_out, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->std_err, dict, buffer);
+		safe_unpackstr_dict(&job->std_in, dict, buffer);
+		safe_unpackstr_dict(&job->std_out, dict, buffer);
 
 		if (unpack_multi_core_data(&mc_ptr, buffer, protocol_version))
 			goto unpack_error;
@@ -3864,9 +3879,8 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 			xfree(mc_ptr);
 		}
 		safe_unpack64(&job->bitflags, buffer);
-		safe_unpackstr_xmalloc(&job->tres_alloc_str, &uint32_tmp,
-				       buffer);
-		safe_unpackstr_xmalloc(&job->tres_req_str, &uint32_tmp, buffer);
+		safe_unpackstr_dict(&job->tres_alloc_str, dict, buffer);
+		safe_unpackstr_dict(&job->tres_req_str, dict, buffer);
 		safe_unpack16(&job->start_protocol_ver, buffer);
 
 		safe_unpackstr_xmalloc(&job->fed_origin_str, &uint32_tmp,
@@ -3888,8 +3902,7 @@ _unpack_job_info_members(job_info_t * job, buf_t *buffer,
 				       buffer);
 		safe_unpackstr_xmalloc(&job->tres_per_job, &uint32_tmp,
 				       buffer);
-		safe_unpackstr_xmalloc(&job->tres_per_node, &uint32_tmp,
-				       buffer);
+		safe_unpackstr_dict(&job->tres_per_node, dict, buffer);
 		safe_unpackstr_xmalloc(&job->tres_per_socket, &uint32_tmp,
 				       buffer);
 		safe_unpackstr_xmalloc(&job->tres_per_task, &uint32_tmp,
@@ -12763,6 +12776,84 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 
 			safe_unpack32(&msg->bf_active,		buffer);
 			safe_unpack32(&msg->bf_backfilled_het_jobs, buffer);
+
+			if (protocol_version >=
+			    SLURM_21_08_1_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->step_create_cnt, buffer);
+				safe_unpack64(&msg->step_create_time_sum,
+					      buffer);
+				safe_unpack32(&msg->step_create_time_max,
+					      buffer);
+				safe_unpack64(&msg->step_cred_sign_time_sum,
+					      buffer);
+				safe_unpack32(&msg->step_cred_sign_time_max,
+					      buffer);
+				safe_unpack64(&msg->step_resp_time_sum, buffer);
+				safe_unpack32(&msg->step_resp_time_max, buffer);
+
+				safe_unpack32(&msg->recovery_phase_cnt, buffer);
+				safe_xcalloc(msg->recovery_phase_name,
+					     msg->recovery_phase_cnt,
+					     sizeof(char *));
+				safe_xcalloc(msg->recovery_phase_time,
+					     msg->recovery_phase_cnt,
+					     sizeof(uint32_t));
+				for (int i = 0; i < msg->recovery_phase_cnt;
+				     i++) {
+					safe_unpackstr_xmalloc(
+						&msg->recovery_phase_name[i],
+						&uint32_tmp, buffer);
+					safe_unpack32(
+						&msg->recovery_phase_time[i],
+						buffer);
+				}
+
+				safe_unpack64(&msg->mem_rss, buffer);
+				safe_unpack32(&msg->mem_pool_cnt, buffer);
+				safe_xcalloc(msg->mem_pools, msg->mem_pool_cnt,
+					     sizeof(stats_mem_pool_t));
+				for (int i = 0; i < msg->mem_pool_cnt; i++) {
+					stats_mem_pool_t *pool =
+						&msg->mem_pools[i];
+
+					safe_unpackstr_xmalloc(&pool->name,
+							       &uint32_tmp,
+							       buffer);
+					safe_unpack32(&pool->rec_size, buffer);
+					safe_unpack32(&pool->rec_cnt, buffer);
+					safe_unpack32(&pool->in_use, buffer);
+					safe_unpack32(&pool->in_use_max,
+						      buffer);
+					safe_unpack64(&pool->alloc_cnt, buffer);
+				}
+
+				safe_unpack32(&msg->mem_str_cnt, buffer);
+				safe_unpack64(&msg->mem_str_bytes, buffer);
+				safe_unpack64(&msg->mem_str_refs, buffer);
+
+				safe_unpack32(&msg->rpc_compress_cnt, buffer);
+				safe_unpack64(&msg->rpc_compress_bytes_in,
+					      buffer);
+				safe_unpack64(&msg->rpc_compress_bytes_out,
+					      buffer);
+				safe_unpack64(&msg->rpc_compress_usec, buffer);
+
+				safe_unpack32(&msg->job_submit_cnt, buffer);
+				safe_unpack64(&msg->job_submit_time_sum,
+					      buffer);
+				safe_unpack32(&msg->job_submit_time_max,
+					      buffer);
+				safe_unpack32(&msg->job_modify_cnt, buffer);
+				safe_unpack64(&msg->job_modify_time_sum,
+					      buffer);
+				safe_unpack32(&msg->job_modify_time_max,
+					      buffer);
+
+				safe_unpack32(&msg->bf_shape_cache_hits,
+					      buffer);
+				safe_unpack32(&msg->bf_shape_cache_misses,
+					      buffer);
+			}
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
@@ -12791,6 +12882,80 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+			safe_unpack32_array(&msg->rpc_type_max, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_type_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_type_p50, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_type_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_type_p99, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_type_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_type_lock_wait,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_type_size)
+				goto unpack_error;
+
+			safe_unpack32_array(&msg->rpc_user_max, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_user_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_user_p50, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_user_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_user_p99, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_user_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_user_lock_wait,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_user_size)
+				goto unpack_error;
+
+			safe_unpack32(&msg->lock_stats_cnt, buffer);
+			safe_xcalloc(msg->lock_stats, msg->lock_stats_cnt,
+				     sizeof(stats_lock_rec_t));
+			for (int i = 0; i < msg->lock_stats_cnt; i++) {
+				stats_lock_rec_t *rec = &msg->lock_stats[i];
+
+				safe_unpackstr_xmalloc(&rec->caller,
+						       &uint32_tmp, buffer);
+				safe_unpackstr_xmalloc(&rec->lock_name,
+						       &uint32_tmp, buffer);
+				safe_unpack16(&rec->lock_level, buffer);
+				safe_unpack32(&rec->count, buffer);
+				safe_unpack64(&rec->wait_time, buffer);
+				safe_unpack32(&rec->wait_max, buffer);
+				safe_unpack32(&rec->wait_p50, buffer);
+				safe_unpack32(&rec->wait_p99, buffer);
+				safe_unpack32(&rec->hold_count, buffer);
+				safe_unpack64(&rec->hold_time, buffer);
+				safe_unpack32(&rec->hold_max, buffer);
+				safe_unpack32(&rec->hold_p50, buffer);
+				safe_unpack32(&rec->hold_p99, buffer);
+			}
+
+			safe_unpack32(&msg->lock_holder_cnt, buffer);
+			safe_xcalloc(msg->lock_holders, msg->lock_holder_cnt,
+				     sizeof(stats_lock_holder_t));
+			for (int i = 0; i < msg->lock_holder_cnt; i++) {
+				stats_lock_holder_t *holder =
+					&msg->lock_holders[i];
+
+				safe_unpackstr_xmalloc(&holder->lock_name,
+						       &uint32_tmp, buffer);
+				safe_unpackstr_xmalloc(&holder->writer,
+						       &uint32_tmp, buffer);
+				safe_unpack_time(&holder->write_since, buffer);
+				safe_unpack32(&holder->readers, buffer);
+			}
+		}
 	} else {
 		error("%s: protocol_version %hu not supported",
 		      __func__, protocol_version);
@@ -14070,7 +14235,8 @@ unpack_msg(slurm_msg_t * msg, buf_t *buffer)
 	case RESPONSE_JOB_INFO:
 		rc = _unpack_job_info_msg((job_info_msg_t **) & (msg->data),
 					  buffer,
-					  msg->protocol_version);
+					  msg->protocol_version,
+					  (msg->flags & SLURM_PACK_STR_DICT));
 		break;
 	case RESPONSE_BATCH_SCRIPT:
 		rc = _unpack_job_script_msg((char **) &(msg->data),
@@ -65,6 +65,7 @@ int check_header_version(header_t * header)
 
 	if (slurmdbd_conf) {
 		if ((header->version != SLURM_PROTOCOL_VERSION)     &&
+		    (header->version != SLURM_21_08_PROTOCOL_VERSION) &&
 		    (header->version != SLURM_ONE_BACK_PROTOCOL_VERSION) &&
 		    (header->version != SLURM_MIN_PROTOCOL_VERSION)) {
 			debug("unsupported RPC version %hu msg type %s(%u)",
@@ -88,6 +89,8 @@ int check_header_version(header_t * header)
 			}
 		default:
 			if ((header->version != SLURM_PROTOCOL_VERSION)     &&
+			    (header->version !=
+			     SLURM_21_08_PROTOCOL_VERSION) &&
 			    (header->version !=
 			     SLURM_ONE_BACK_PROTOCOL_VERSION) &&
 			    (header->version != SLURM_MIN_PROTOCOL_VERSION)) {
@@ -48,6 +48,7 @@
 #include "src/common/slurm_time.h"
 #include "src/common/slurmdb_defs.h"
 #include "src/common/xmalloc.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 #include "src/slurmdbd/read_config.h"
 
@@ -751,6 +752,10 @@ extern void slurmdb_destroy_qos_usage(void *object)
 		(slurmdb_qos_usage_t *)object;
 
 	if (usage) {
+		xhash_t *hash;
+
+		hash = usage->acct_limit_hash;
+		xhash_free(hash);
 		FREE_NULL_LIST(usage->acct_limit_list);
 		FREE_NULL_BITMAP(usage->grp_node_bitmap);
 		xfree(usage->grp_node_job_cnt);
@@ -758,6 +763,8 @@ extern void slurmdb_destroy_qos_usage(void *object)
 		xfree(usage->grp_used_tres);
 		FREE_NULL_LIST(usage->job_list);
 		xfree(usage->usage_tres_raw);
+		hash = usage->user_limit_hash;
+		xhash_free(hash);
 		FREE_NULL_LIST(usage->user_limit_list);
 		xfree(usage);
 	}
@@ -1004,6 +1004,38 @@ fini:
 	return result;
 }
 
+/*
+ * Like mysql_db_query_ret() but the rows are read from the server as they are
+ * fetched instead of all being stored in memory first. Nothing else can be
+ * sent on the connection until the result is freed.
+ * NOTE: Ensure that mysql_conn->lock is NOT set on function entry
+ */
+extern MYSQL_RES *mysql_db_query_use(mysql_conn_t *mysql_conn, char *query)
+{
+	MYSQL_RES *result = NULL;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
+		if (mysql_errno(mysql_conn->db_conn) == ER_NO_SUCH_TABLE)
+			goto fini;
+		result = mysql_use_result(mysql_conn->db_conn);
+		/*
+		 * Starting in MariaDB 10.2 many of the api commands started
+		 * setting errno erroneously.
+		 */
+		errno = 0;
+		if (!result && mysql_field_count(mysql_conn->db_conn)) {
+			/* should have returned data */
+			error("We should have gotten a result: '%m' '%s'",
+			      mysql_error(mysql_conn->db_conn));
+		}
+	}
+
+fini:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return result;
+}
+
 extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query)
 {
 	int rc = SLURM_SUCCESS;
@@ -101,6 +101,7 @@ extern int mysql_db_rollback(mysql_conn_t *mysql_conn);
 
 extern MYSQL_RES *mysql_db_query_ret(mysql_conn_t *mysql_conn,
 				     char *query, bool last);
+extern MYSQL_RES *mysql_db_query_use(mysql_conn_t *mysql_conn, char *query);
 extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query);
 
 extern uint64_t mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query);
@@ -42,6 +42,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if HAVE_LZ4
+# include <lz4.h>
+#endif
+
 #include "src/common/env.h"
 #include "src/common/slurmdbd_defs.h"
 #include "src/common/slurm_auth.h"
@@ -66,6 +70,43 @@ extern char *wckey_month_table;
 extern __thread bool drop_priv;
 #endif
 
+#define ARCHIVE_FILE_MAGIC 0x534c4146	/* "SLAF" */
+#define ARCHIVE_FRAME_RECORDS 1000	/* Records per frame at most */
+#define ARCHIVE_FRAME_SIZE (1024 * 1024) /* Frame is written past this size */
+#define ARCHIVE_FRAME_HEADER_SIZE 12	/* Record count, size, stored size */
+
+enum {
+	ARCHIVE_COMPRESS_NONE,
+	ARCHIVE_COMPRESS_LZ4
+};
+
+/*
+ * A framed archive file, written and read one frame at a time:
+ *
+ * header: magic, compression, rpc version, creation time, type, cluster name
+ *	   and period (usage archives)
+ * frames: record count, size, stored size and the (compressed) records
+ * index:  frame count, then offset and record count of each frame
+ * tail:   offset of the index
+ */
+struct archive_file {
+	buf_t *buffer;		/* frame being packed or last frame read */
+	uint16_t compression;
+	int fd;
+	uint32_t frame_cnt;	/* frames left to read when reading */
+	uint32_t frame_rec_cnt;	/* records in buffer when writing */
+	buf_t *index;
+	uint64_t offset;	/* file offset of the next frame */
+	char *path;
+	uint32_t rec_cnt;
+	/* only used when writing */
+	char *arch_dir;
+	char *arch_type;
+	char *cluster_name;
+};
+
+static pthread_mutex_t local_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * We want SLURMDB_MODIFY_ASSOC always to be the last
  */
@@ -879,56 +920,377 @@ static char *_make_archive_name(time_t period_start, time_t period_end,
 	return fullname;
 }
 
-extern int archive_write_file(buf_t *buffer, char *cluster_name,
+static void _archive_file_free(archive_file_t *arch_file)
+{
+	if (arch_file->fd >= 0)
+		close(arch_file->fd);
+	FREE_NULL_BUFFER(arch_file->buffer);
+	FREE_NULL_BUFFER(arch_file->index);
+	xfree(arch_file->arch_dir);
+	xfree(arch_file->arch_type);
+	xfree(arch_file->cluster_name);
+	xfree(arch_file->path);
+	xfree(arch_file);
+}
+
+/* Write the records packed in arch_file->buffer as one frame */
+static int _archive_file_write_frame(archive_file_t *arch_file)
+{
+	buf_t *header;
+	char *data = get_buf_data(arch_file->buffer);
+	uint32_t size = get_buf_offset(arch_file->buffer), stored = size;
+	uint16_t compression = ARCHIVE_COMPRESS_NONE;
+	int rc = SLURM_SUCCESS;
+
+	if (!arch_file->frame_rec_cnt)
+		return SLURM_SUCCESS;
+
+#if HAVE_LZ4
+	if (arch_file->compression == ARCHIVE_COMPRESS_LZ4) {
+		int bound = LZ4_compressBound(size);
+		char *out = xmalloc_nz(bound);
+		int out_len = LZ4_compress_default(data, out, size, bound);
+
+		/* Store the frame as is if it did not compress. */
+		if ((out_len > 0) && (out_len < (int) size)) {
+			data = out;
+			stored = out_len;
+			compression = ARCHIVE_COMPRESS_LZ4;
+		} else
+			xfree(out);
+	}
+#endif
+
+	header = init_buf(ARCHIVE_FRAME_HEADER_SIZE);
+	pack32(arch_file->frame_rec_cnt, header);
+	pack32(size, header);
+	pack32(stored, header);
+	safe_write(arch_file->fd, get_buf_data(header), get_buf_offset(header));
+	safe_write(arch_file->fd, data, stored);
+
+	pack64(arch_file->offset, arch_file->index);
+	pack32(arch_file->frame_rec_cnt, arch_file->index);
+	arch_file->offset += get_buf_offset(header) + stored;
+	arch_file->frame_cnt++;
+	arch_file->rec_cnt += arch_file->frame_rec_cnt;
+	arch_file->frame_rec_cnt = 0;
+	set_buf_offset(arch_file->buffer, 0);
+	goto end_it;
+
+rwfail:
+	error("%s: Error writing archive file %s: %m",
+	      __func__, arch_file->path);
+	rc = SLURM_ERROR;
+end_it:
+	if (compression != ARCHIVE_COMPRESS_NONE)
+		xfree(data);
+	FREE_NULL_BUFFER(header);
+	return rc;
+}
+
+extern archive_file_t *archive_file_create(char *arch_dir, char *cluster_name,
+					   char *arch_type, uint16_t type,
+					   uint16_t period)
+{
+	archive_file_t *arch_file = xmalloc(sizeof(*arch_file));
+	buf_t *header = NULL;
+
+	arch_file->arch_dir = xstrdup(arch_dir);
+	arch_file->arch_type = xstrdup(arch_type);
+	arch_file->cluster_name = xstrdup(cluster_name);
+#if HAVE_LZ4
+	arch_file->compression = ARCHIVE_COMPRESS_LZ4;
+#endif
+	/* Renamed to its final name by archive_file_close() */
+	arch_file->path = xstrdup_printf("%s/.%s_%s_archive.XXXXXX",
+					 arch_dir, cluster_name, arch_type);
+	if ((arch_file->fd = mkstemp(arch_file->path)) < 0) {
+		error("Can't save archive, create file %s error %m",
+		      arch_file->path);
+		_archive_file_free(arch_file);
+		return NULL;
+	}
+
+	header = init_buf(BUF_SIZE);
+	pack32(ARCHIVE_FILE_MAGIC, header);
+	pack16(arch_file->compression, header);
+	pack16(SLURM_PROTOCOL_VERSION, header);
+	pack_time(time(NULL), header);
+	pack16(type, header);
+	packstr(cluster_name, header);
+	pack16(period, header);
+	safe_write(arch_file->fd, get_buf_data(header), get_buf_offset(header));
+	arch_file->offset = get_buf_offset(header);
+	FREE_NULL_BUFFER(header);
+
+	arch_file->buffer = init_buf(ARCHIVE_FRAME_SIZE);
+	arch_file->index = init_buf(BUF_SIZE);
+
+	return arch_file;
+
+rwfail:
+	error("%s: Error writing archive file %s: %m",
+	      __func__, arch_file->path);
+	FREE_NULL_BUFFER(header);
+	archive_file_abort(arch_file);
+	return NULL;
+}
+
+extern buf_t *archive_file_buf(archive_file_t *arch_file)
+{
+	return arch_file->buffer;
+}
+
+extern int archive_file_add_record(archive_file_t *arch_file)
+{
+	arch_file->frame_rec_cnt++;
+
+	if ((arch_file->frame_rec_cnt < ARCHIVE_FRAME_RECORDS) &&
+	    (get_buf_offset(arch_file->buffer) < ARCHIVE_FRAME_SIZE))
+		return SLURM_SUCCESS;
+
+	return _archive_file_write_frame(arch_file);
+}
+
+extern uint32_t archive_file_rec_cnt(archive_file_t *arch_file)
+{
+	return arch_file->rec_cnt + arch_file->frame_rec_cnt;
+}
+
+extern void archive_file_abort(archive_file_t *arch_file)
+{
+	if (!arch_file)
+		return;
+
+	(void) unlink(arch_file->path);
+	_archive_file_free(arch_file);
+}
+
+extern int archive_file_close(archive_file_t *arch_file,
 			      time_t period_start, time_t period_end,
-			      char *arch_dir, char *arch_type,
 			      uint32_t archive_period)
 {
-	int fd = 0;
-	int rc = SLURM_SUCCESS;
 	char *new_file = NULL;
-	static pthread_mutex_t local_file_lock = PTHREAD_MUTEX_INITIALIZER;
+	int rc = SLURM_SUCCESS;
 
-	xassert(buffer);
+	if (_archive_file_write_frame(arch_file) != SLURM_SUCCESS)
+		goto fail;
+
+	/* The index goes after the frames, followed by its offset. */
+	pack32(arch_file->frame_cnt, arch_file->buffer);
+	packmem(get_buf_data(arch_file->index), get_buf_offset(arch_file->index),
+		arch_file->buffer);
+	pack64(arch_file->offset, arch_file->buffer);
+	safe_write(arch_file->fd, get_buf_data(arch_file->buffer),
+		   get_buf_offset(arch_file->buffer));
+
+	if (fsync(arch_file->fd) < 0) {
+		error("%s: Error syncing archive file %s: %m",
+		      __func__, arch_file->path);
+		goto fail;
+	}
 
 	slurm_mutex_lock(&local_file_lock);
-
-	/* write the buffer to file */
 	new_file = _make_archive_name(period_start, period_end,
-				      cluster_name, arch_dir,
-				      arch_type, archive_period);
-	if (!new_file) {
-		error("%s: Unable to make archive file name.", __func__);
+				      arch_file->cluster_name,
+				      arch_file->arch_dir,
+				      arch_file->arch_type, archive_period);
+	debug("Storing %s archive for %s at %s",
+	      arch_file->arch_type, arch_file->cluster_name, new_file);
+	if (rename(arch_file->path, new_file) < 0) {
+		error("Can't save archive, rename %s to %s error %m",
+		      arch_file->path, new_file);
+		rc = SLURM_ERROR;
+	}
+	slurm_mutex_unlock(&local_file_lock);
+
+	xfree(new_file);
+	if (rc != SLURM_SUCCESS)
+		goto fail;
+
+	_archive_file_free(arch_file);
+	return SLURM_SUCCESS;
+
+rwfail:
+	error("%s: Error writing archive file %s: %m",
+	      __func__, arch_file->path);
+fail:
+	archive_file_abort(arch_file);
+	return SLURM_ERROR;
+}
+
+extern int archive_file_open(char *path, archive_file_t **arch_file_out,
+			     uint16_t *rpc_version, time_t *create_time,
+			     uint16_t *type, char **cluster_name,
+			     uint16_t *period, uint32_t *rec_cnt)
+{
+	archive_file_t *arch_file = xmalloc(sizeof(*arch_file));
+	buf_t *header = NULL;
+	uint32_t magic = 0, tmp32, index_size;
+	uint64_t index_offset, offset;
+	char *data = NULL;
+	ssize_t len;
+	off_t end;
+	int rc = SLURM_ERROR;
+
+	*arch_file_out = NULL;
+	arch_file->path = xstrdup(path);
+	if ((arch_file->fd = open(path, O_RDONLY)) < 0) {
+		info("Could not open archive file `%s`: %m", path);
+		rc = errno;
+		_archive_file_free(arch_file);
+		return rc;
+	}
+
+	/* The header is far smaller than BUF_SIZE, any excess is unused. */
+	data = xmalloc_nz(BUF_SIZE);
+	if ((len = read(arch_file->fd, data, BUF_SIZE)) < 0) {
+		xfree(data);
+		goto rwfail;
+	}
+	header = create_buf(data, len);
+	if ((len < sizeof(uint32_t)) ||
+	    (unpack32(&magic, header) != SLURM_SUCCESS) ||
+	    (magic != ARCHIVE_FILE_MAGIC))
+		goto not_framed;
+
+	safe_unpack16(&arch_file->compression, header);
+	safe_unpack16(rpc_version, header);
+	safe_unpack_time(create_time, header);
+	safe_unpack16(type, header);
+	safe_unpackstr_xmalloc(cluster_name, &tmp32, header);
+	safe_unpack16(period, header);
+	arch_file->offset = get_buf_offset(header);
+	FREE_NULL_BUFFER(header);
+
+#if !HAVE_LZ4
+	if (arch_file->compression == ARCHIVE_COMPRESS_LZ4) {
+		error("Archive file `%s` is compressed with lz4 which is not supported by this build",
+		      path);
+		_archive_file_free(arch_file);
 		return SLURM_ERROR;
 	}
+#endif
 
-	debug("Storing %s archive for %s at %s",
-	      arch_type, cluster_name, new_file);
+	/* Read the index to know how many records there are. */
+	if (((end = lseek(arch_file->fd, 0, SEEK_END)) < sizeof(uint64_t)) ||
+	    (lseek(arch_file->fd, end - sizeof(uint64_t), SEEK_SET) < 0))
+		goto unpack_error;
+	header = init_buf(sizeof(uint64_t));
+	safe_read(arch_file->fd, get_buf_data(header), sizeof(uint64_t));
+	safe_unpack64(&index_offset, header);
+	FREE_NULL_BUFFER(header);
+
+	if ((index_offset < arch_file->offset) || (index_offset >= end) ||
+	    ((end - index_offset) > MAX_BUF_SIZE))
+		goto unpack_error;
+	index_size = end - index_offset;
+	data = xmalloc_nz(index_size);
+	if (pread(arch_file->fd, data, index_size, index_offset) !=
+	    index_size) {
+		xfree(data);
+		goto unpack_error;
+	}
+	header = create_buf(data, index_size);
+	safe_unpack32(&arch_file->frame_cnt, header);
+	safe_unpackmem_xmalloc(&data, &index_size, header);
+	FREE_NULL_BUFFER(header);
+	arch_file->index = create_buf(data, index_size);
+
+	*rec_cnt = 0;
+	for (tmp32 = 0; tmp32 < arch_file->frame_cnt; tmp32++) {
+		uint32_t frame_rec_cnt;
+		safe_unpack64(&offset, arch_file->index);
+		safe_unpack32(&frame_rec_cnt, arch_file->index);
+		*rec_cnt += frame_rec_cnt;
+	}
+	set_buf_offset(arch_file->index, 0);
 
-	fd = creat(new_file, 0600);
-	if (fd < 0) {
-		error("Can't save archive, create file %s error %m", new_file);
-		rc = SLURM_ERROR;
+	if (lseek(arch_file->fd, arch_file->offset, SEEK_SET) < 0)
+		goto unpack_error;
+
+	*arch_file_out = arch_file;
+	return SLURM_SUCCESS;
+
+not_framed:
+	/* Not a framed archive, the caller reads it as a whole. */
+	FREE_NULL_BUFFER(header);
+	_archive_file_free(arch_file);
+	return SLURM_SUCCESS;
+
+rwfail:
+unpack_error:
+	error("Archive file `%s` is corrupted", path);
+	FREE_NULL_BUFFER(header);
+	_archive_file_free(arch_file);
+	return rc;
+}
+
+extern int archive_file_read_frame(archive_file_t *arch_file,
+				   buf_t **buffer, uint32_t *rec_cnt)
+{
+	buf_t *header = NULL;
+	char *data = NULL, *stored_data = NULL;
+	uint32_t frame_rec_cnt, size, stored;
+	uint64_t offset;
+
+	*buffer = NULL;
+	FREE_NULL_BUFFER(arch_file->buffer);
+
+	if (!arch_file->frame_cnt)
+		return SLURM_SUCCESS;
+
+	safe_unpack64(&offset, arch_file->index);
+	safe_unpack32(rec_cnt, arch_file->index);
+	if (offset != arch_file->offset)
+		goto unpack_error;
+
+	header = init_buf(ARCHIVE_FRAME_HEADER_SIZE);
+	safe_read(arch_file->fd, get_buf_data(header), ARCHIVE_FRAME_HEADER_SIZE);
+	safe_unpack32(&frame_rec_cnt, header);
+	safe_unpack32(&size, header);
+	safe_unpack32(&stored, header);
+	FREE_NULL_BUFFER(header);
+	if ((frame_rec_cnt != *rec_cnt) || (size > MAX_BUF_SIZE) ||
+	    (stored > size))
+		goto unpack_error;
+
+	stored_data = xmalloc_nz(stored);
+	safe_read(arch_file->fd, stored_data, stored);
+	arch_file->offset += ARCHIVE_FRAME_HEADER_SIZE + stored;
+
+	if (stored == size) {
+		data = stored_data;
+		stored_data = NULL;
 	} else {
-		int amount;
-		uint32_t pos = 0, nwrite = get_buf_offset(buffer);
-		char *data = (char *)get_buf_data(buffer);
-		while (nwrite > 0) {
-			amount = write(fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				rc = SLURM_ERROR;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-		fsync(fd);
-		close(fd);
+#if HAVE_LZ4
+		data = xmalloc_nz(size);
+		if (LZ4_decompress_safe(stored_data, data, stored, size) !=
+		    size)
+			goto unpack_error;
+		xfree(stored_data);
+#else
+		goto unpack_error;
+#endif
 	}
 
-	xfree(new_file);
-	slurm_mutex_unlock(&local_file_lock);
+	arch_file->buffer = create_buf(data, size);
+	arch_file->frame_cnt--;
+	*buffer = arch_file->buffer;
+	return SLURM_SUCCESS;
 
-	return rc;
+rwfail:
+unpack_error:
+	error("Archive file `%s` is corrupted at offset %"PRIu64,
+	      arch_file->path, arch_file->offset);
+	FREE_NULL_BUFFER(header);
+	xfree(stored_data);
+	xfree(data);
+	return SLURM_ERROR;
+}
+
+extern void archive_file_free(archive_file_t *arch_file)
+{
+	if (arch_file)
+		_archive_file_free(arch_file);
 }
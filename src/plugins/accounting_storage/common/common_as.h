@@ -80,9 +80,49 @@ extern char* acct_get_db_name(void);
 extern time_t archive_setup_end_time(time_t last_submit, uint32_t purge);
 extern int archive_run_script(slurmdb_archive_cond_t *arch_cond,
 			      char *cluster_name, time_t last_submit);
-extern int archive_write_file(buf_t *buffer, char *cluster_name,
+
+typedef struct archive_file archive_file_t;
+
+/*
+ * Create a framed archive file in arch_dir. Records are packed one at a time
+ * in archive_file_buf() followed by archive_file_add_record(), and written in
+ * frames (compressed with lz4 when available) so only one frame is held in
+ * memory. The file gets its final name in archive_file_close().
+ * IN type - slurmdbd_msg_type_t of the records
+ * IN period - rollup period of usage records, 0 otherwise
+ * RET archive file or NULL on error
+ */
+extern archive_file_t *archive_file_create(char *arch_dir, char *cluster_name,
+					   char *arch_type, uint16_t type,
+					   uint16_t period);
+extern buf_t *archive_file_buf(archive_file_t *arch_file);
+extern int archive_file_add_record(archive_file_t *arch_file);
+extern uint32_t archive_file_rec_cnt(archive_file_t *arch_file);
+/* Write the index and move the file to its archive name, frees arch_file */
+extern int archive_file_close(archive_file_t *arch_file,
 			      time_t period_start, time_t period_end,
-			      char *arch_dir, char *arch_type,
 			      uint32_t archive_period);
+/* Remove an archive file being created, frees arch_file */
+extern void archive_file_abort(archive_file_t *arch_file);
+
+/*
+ * Open a framed archive file to read it one frame at a time.
+ * OUT arch_file_out - NULL if path is not a framed archive file, which is
+ *	then read as a whole as it was before archive files were framed.
+ * RET SLURM_SUCCESS or error
+ */
+extern int archive_file_open(char *path, archive_file_t **arch_file_out,
+			     uint16_t *rpc_version, time_t *create_time,
+			     uint16_t *type, char **cluster_name,
+			     uint16_t *period, uint32_t *rec_cnt);
+/*
+ * Read the next frame of an archive file.
+ * OUT buffer - records of the frame, valid until the next call, NULL once
+ *	all frames were read
+ * OUT rec_cnt - number of records in buffer
+ */
+extern int archive_file_read_frame(archive_file_t *arch_file,
+				   buf_t **buffer, uint32_t *rec_cnt);
+extern void archive_file_free(archive_file_t *arch_file);
 
 #endif
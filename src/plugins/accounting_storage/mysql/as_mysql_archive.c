@@ -63,8 +63,11 @@
 #define SLURMDBD_2_6_VERSION   12	/* slurm version 2.6 */
 #define SLURMDBD_2_5_VERSION   11	/* slurm version 2.5 */
 
-#define MAX_PURGE_LIMIT 50000 /* Number of records that are purged at a time
-				 so that locks can be periodically released. */
+#define MAX_PURGE_LIMIT 50000 /* Number of records that are archived and
+				 purged at a time. */
+#define MAX_DELETE_LIMIT 5000 /* Number of records that are deleted per
+				 transaction so that locks can be
+				 periodically released. */
 #define MAX_ARCHIVE_AGE (60 * 60 * 24 * 60) /* If archive data is older than
 					       this then archive by month to
 					       handle large datasets. */
@@ -816,7 +819,6 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 			       char *arch_dir, uint32_t archive_period,
 			       char *sql_table, uint32_t usage_info);
 
-static uint32_t high_buffer_size = (1024 * 1024);
 
 static void _pack_local_event(local_event_t *object, uint16_t rpc_version,
 			      buf_t *buffer)
@@ -2942,21 +2944,12 @@ static char *_get_archive_columns(purge_type_t type)
 }
 
 
-static buf_t *_pack_archive_events(MYSQL_RES *result, char *cluster_name,
-				   uint32_t cnt, uint32_t usage_info,
-				   time_t *period_start)
+static int _pack_archive_events(MYSQL_RES *result, archive_file_t *arch_file,
+				time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_event_t event;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_EVENTS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[EVENT_REQ_START]);
@@ -2972,10 +2965,13 @@ static buf_t *_pack_archive_events(MYSQL_RES *result, char *cluster_name,
 		event.state = row[EVENT_REQ_STATE];
 		event.tres_str = row[EVENT_REQ_TRES];
 
-		_pack_local_event(&event, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_event(&event, SLURM_PROTOCOL_VERSION,
+				  archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -3029,21 +3025,12 @@ static char *_load_events(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
-				 uint32_t cnt, uint32_t usage_info,
-				 time_t *period_start)
+static int _pack_archive_jobs(MYSQL_RES *result, archive_file_t *arch_file,
+			      time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_job_t job;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_JOBS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[JOB_REQ_SUBMIT]);
@@ -3103,10 +3090,13 @@ static buf_t *_pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
 		job.wckey_id = row[JOB_REQ_WCKEYID];
 		job.work_dir = row[JOB_REQ_WORK_DIR];
 
-		_pack_local_job(&job, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_job(&job, SLURM_PROTOCOL_VERSION,
+				archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -3329,21 +3319,12 @@ static char *_load_jobs(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_resvs(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, uint32_t usage_info,
-				  time_t *period_start)
+static int _pack_archive_resvs(MYSQL_RES *result, archive_file_t *arch_file,
+			       time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_resv_t resv;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_RESVS, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[RESV_REQ_START]);
@@ -3362,10 +3343,13 @@ static buf_t *_pack_archive_resvs(MYSQL_RES *result, char *cluster_name,
 		resv.tres_str = row[RESV_REQ_TRES];
 		resv.unused_wall = row[RESV_REQ_UNUSED];
 
-		_pack_local_resv(&resv, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_resv(&resv, SLURM_PROTOCOL_VERSION,
+				 archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -3420,21 +3404,12 @@ static char *_load_resvs(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_steps(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, uint32_t usage_info,
-				  time_t *period_start)
+static int _pack_archive_steps(MYSQL_RES *result, archive_file_t *arch_file,
+			       time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_step_t step;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_STEP_START, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[STEP_REQ_START]);
@@ -3493,10 +3468,13 @@ static buf_t *_pack_archive_steps(MYSQL_RES *result, char *cluster_name,
 		step.user_sec = row[STEP_REQ_USER_SEC];
 		step.user_usec = row[STEP_REQ_USER_USEC];
 
-		_pack_local_step(&step, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_step(&step, SLURM_PROTOCOL_VERSION,
+				 archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -3586,21 +3564,12 @@ static char *_load_steps(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_suspends(MYSQL_RES *result, char *cluster_name,
-				     uint32_t cnt, uint32_t usage_info,
-				     time_t *period_start)
+static int _pack_archive_suspends(MYSQL_RES *result, archive_file_t *arch_file,
+				  time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_suspend_t suspend;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_JOB_SUSPEND, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[SUSPEND_REQ_START]);
@@ -3612,10 +3581,13 @@ static buf_t *_pack_archive_suspends(MYSQL_RES *result, char *cluster_name,
 		suspend.period_start = row[SUSPEND_REQ_START];
 		suspend.period_end = row[SUSPEND_REQ_END];
 
-		_pack_local_suspend(&suspend, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_suspend(&suspend, SLURM_PROTOCOL_VERSION,
+				    archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 
@@ -3664,21 +3636,12 @@ static char *_load_suspend(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_txns(MYSQL_RES *result, char *cluster_name,
-				 uint32_t cnt, uint32_t usage_info,
-				 time_t *period_start)
+static int _pack_archive_txns(MYSQL_RES *result, archive_file_t *arch_file,
+			      time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_txn_t txn;
 
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_TXN, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[TXN_REQ_TS]);
@@ -3693,10 +3656,13 @@ static buf_t *_pack_archive_txns(MYSQL_RES *result, char *cluster_name,
 		txn.info = row[TXN_REQ_INFO];
 		txn.cluster = row[TXN_REQ_CLUSTER];
 
-		_pack_local_txn(&txn, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_txn(&txn, SLURM_PROTOCOL_VERSION,
+				archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 
@@ -3748,23 +3714,11 @@ static char *_load_txn(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_usage(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, uint32_t usage_info,
-				  time_t *period_start)
+static int _pack_archive_usage(MYSQL_RES *result, archive_file_t *arch_file,
+			       time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_usage_t usage;
-	uint16_t type = usage_info & 0x0000ffff;
-	uint16_t period = usage_info >> 16;
-
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(type, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-	pack16(period, buffer);
 
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
@@ -3780,10 +3734,13 @@ static buf_t *_pack_archive_usage(MYSQL_RES *result, char *cluster_name,
 		usage.mod_time = row[USAGE_MOD_TIME];
 		usage.deleted = row[USAGE_DELETED];
 
-		_pack_local_usage(&usage, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_usage(&usage, SLURM_PROTOCOL_VERSION,
+				  archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -3876,22 +3833,11 @@ static char *_load_usage(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
-static buf_t *_pack_archive_cluster_usage(MYSQL_RES *result, char *cluster_name,
-					  uint32_t cnt, uint32_t usage_info,
-					  time_t *period_start)
+static int _pack_archive_cluster_usage(MYSQL_RES *result, archive_file_t *arch_file,
+				       time_t *period_start)
 {
 	MYSQL_ROW row;
-	buf_t *buffer;
 	local_cluster_usage_t usage;
-	uint16_t period = usage_info >> 16;
-
-	buffer = init_buf(high_buffer_size);
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
-	pack16(DBD_GOT_CLUSTER_USAGE, buffer);
-	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
-	pack16(period, buffer);
 
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
@@ -3912,11 +3858,13 @@ static buf_t *_pack_archive_cluster_usage(MYSQL_RES *result, char *cluster_name,
 		usage.mod_time = row[CLUSTER_MOD_TIME];
 		usage.deleted = row[CLUSTER_DELETED];
 
-		_pack_local_cluster_usage(
-			&usage, SLURM_PROTOCOL_VERSION, buffer);
+		_pack_local_cluster_usage(&usage, SLURM_PROTOCOL_VERSION,
+					  archive_file_buf(arch_file));
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			return SLURM_ERROR;
 	}
 
-	return buffer;
+	return SLURM_SUCCESS;
 }
 
 /* returns sql statement from archived data or NULL on error */
@@ -3999,44 +3947,54 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 	char *cols = NULL, *query = NULL;
 	time_t period_start = 0;
 	uint32_t cnt = 0;
-	buf_t *buffer;
+	archive_file_t *arch_file;
+	uint16_t msg_type, period = 0;
 	int error_code = 0;
-	buf_t *(*pack_func)(MYSQL_RES *result, char *cluster_name,
-			    uint32_t cnt, uint32_t usage_info,
-			    time_t *period_start);
-
-	cols = _get_archive_columns(type);
+	int (*pack_func)(MYSQL_RES *result, archive_file_t *arch_file,
+			 time_t *period_start);
 
 	switch (type) {
 	case PURGE_EVENT:
 		pack_func = &_pack_archive_events;
+		msg_type = DBD_GOT_EVENTS;
 		break;
 	case PURGE_SUSPEND:
 		pack_func = &_pack_archive_suspends;
+		msg_type = DBD_JOB_SUSPEND;
 		break;
 	case PURGE_RESV:
 		pack_func = &_pack_archive_resvs;
+		msg_type = DBD_GOT_RESVS;
 		break;
 	case PURGE_JOB:
 		pack_func = &_pack_archive_jobs;
+		msg_type = DBD_GOT_JOBS;
 		break;
 	case PURGE_STEP:
 		pack_func = &_pack_archive_steps;
+		msg_type = DBD_STEP_START;
 		break;
 	case PURGE_TXN:
 		pack_func = &_pack_archive_txns;
+		msg_type = DBD_GOT_TXN;
 		break;
 	case PURGE_USAGE:
 		pack_func = &_pack_archive_usage;
+		msg_type = usage_info & 0x0000ffff;
+		period = usage_info >> 16;
 		break;
 	case PURGE_CLUSTER_USAGE:
 		pack_func = &_pack_archive_cluster_usage;
+		msg_type = DBD_GOT_CLUSTER_USAGE;
+		period = usage_info >> 16;
 		break;
 	default:
 		fatal("Unknown purge type: %d", type);
 		return SLURM_ERROR;
 	}
 
+	cols = _get_archive_columns(type);
+
 	switch (type) {
 	case PURGE_TXN:
 		query = xstrdup_printf("select %s from \"%s\" where "
@@ -4072,27 +4030,41 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 
 	xfree(cols);
 
+	if (!(arch_file = archive_file_create(arch_dir, cluster_name, sql_table,
+					      msg_type, period))) {
+		xfree(query);
+		return SLURM_ERROR;
+	}
+
+	/*
+	 * Stream the rows into the archive file so only one frame of them is
+	 * in memory at a time, however many records the period holds.
+	 */
 	DB_DEBUG(DB_ARCHIVE, mysql_conn->conn, "query\n%s", query);
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
+	if (!(result = mysql_db_query_use(mysql_conn, query))) {
 		xfree(query);
+		archive_file_abort(arch_file);
 		return SLURM_ERROR;
 	}
 	xfree(query);
 
-	if (!(cnt = mysql_num_rows(result))) {
-		mysql_free_result(result);
-		return 0;
+	error_code = (*pack_func)(result, arch_file, &period_start);
+	if ((error_code == SLURM_SUCCESS) && mysql_errno(mysql_conn->db_conn)) {
+		error("%s: Couldn't read %s_%s records to archive: %s",
+		      __func__, cluster_name, sql_table,
+		      mysql_error(mysql_conn->db_conn));
+		error_code = SLURM_ERROR;
 	}
-
-	buffer = (*pack_func)(result, cluster_name, cnt, usage_info,
-			      &period_start);
 	mysql_free_result(result);
 
-	error_code = archive_write_file(buffer, cluster_name,
-					period_start, period_end,
-					arch_dir, sql_table,
+	cnt = archive_file_rec_cnt(arch_file);
+	if ((error_code != SLURM_SUCCESS) || !cnt) {
+		archive_file_abort(arch_file);
+		return error_code;
+	}
+
+	error_code = archive_file_close(arch_file, period_start, period_end,
 					archive_period);
-	free_buf(buffer);
 
 	if (error_code != SLURM_SUCCESS)
 		return error_code;
@@ -4194,7 +4166,8 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 	time_t   curr_end    = 0, tmp_end = 0, record_start = 0;
 	char    *query = NULL, *sql_table = NULL,
 		*col_name = NULL;
-	uint32_t tmp_archive_period;
+	uint32_t tmp_archive_period, purge_cnt;
+	int delete_cnt;
 
 	switch (purge_type) {
 	case PURGE_EVENT:
@@ -4330,6 +4303,8 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 		log_flag(DB_ARCHIVE, "Purging %s_%s before %ld",
 			 cluster_name, sql_table, tmp_end);
 
+		purge_cnt = MAX_PURGE_LIMIT;
+
 		/* Do archive */
 		if (SLURMDB_PURGE_ARCHIVE_SET(purge_attr)) {
 			rc = _archive_table(purge_type, mysql_conn,
@@ -4343,6 +4318,7 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 				return SLURM_ERROR;
 			} else if (rc == SLURM_ERROR)
 				return rc;
+			purge_cnt = rc;
 		}
 
 		/*
@@ -4352,49 +4328,63 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 		 * only want to delete records that have been archived (if
 		 * archiving is enabled).
 		 */
-		switch (purge_type) {
-		case PURGE_TXN:
-			query = xstrdup_printf(
-				"delete from \"%s\" where "
-				"%s <= %ld && cluster='%s' order by %s asc LIMIT %d",
-				sql_table, col_name, tmp_end, cluster_name,
-				col_name, MAX_PURGE_LIMIT);
-			break;
-		case PURGE_USAGE:
-		case PURGE_CLUSTER_USAGE:
-			query = xstrdup_printf(
-				"delete from \"%s_%s\" where "
-				"%s <= %ld order by %s asc LIMIT %d",
-				cluster_name, sql_table, col_name,
-				tmp_end, col_name, MAX_PURGE_LIMIT);
-			break;
-		default:
-			query = xstrdup_printf(
-				"delete from \"%s_%s\" where "
-				"%s <= %ld && time_end != 0 order by %s asc LIMIT %d",
-				cluster_name, sql_table, col_name,
-				tmp_end, col_name, MAX_PURGE_LIMIT);
-			break;
-		}
-		DB_DEBUG(DB_ARCHIVE, mysql_conn->conn, "query\n%s", query);
-
 		/*
-		 * Don't loop this query, just do it once, since we are only
-		 * archiving and purging MAX_PURGE_LIMIT rows at a time.
+		 * Delete the purge_cnt records archived (or MAX_PURGE_LIMIT
+		 * when not archiving) MAX_DELETE_LIMIT at a time.
 		 * mysql_db_delete_affected_rows will return < 0 on failure or
 		 * 0 if no records are affected.
 		 */
-		if ((rc = mysql_db_delete_affected_rows(
-				mysql_conn, query)) > 0) {
-			/* Commit here every time since this could create a huge
-			 * transaction.
+		rc = SLURM_SUCCESS;
+		while (purge_cnt) {
+			int limit = MIN(purge_cnt, MAX_DELETE_LIMIT);
+
+			switch (purge_type) {
+			case PURGE_TXN:
+				query = xstrdup_printf(
+					"delete from \"%s\" where "
+					"%s <= %ld && cluster='%s' order by %s asc LIMIT %d",
+					sql_table, col_name, tmp_end,
+					cluster_name, col_name, limit);
+				break;
+			case PURGE_USAGE:
+			case PURGE_CLUSTER_USAGE:
+				query = xstrdup_printf(
+					"delete from \"%s_%s\" where "
+					"%s <= %ld order by %s asc LIMIT %d",
+					cluster_name, sql_table, col_name,
+					tmp_end, col_name, limit);
+				break;
+			default:
+				query = xstrdup_printf(
+					"delete from \"%s_%s\" where "
+					"%s <= %ld && time_end != 0 order by %s asc LIMIT %d",
+					cluster_name, sql_table, col_name,
+					tmp_end, col_name, limit);
+				break;
+			}
+			DB_DEBUG(DB_ARCHIVE, mysql_conn->conn, "query\n%s",
+				 query);
+
+			delete_cnt = mysql_db_delete_affected_rows(mysql_conn,
+								   query);
+			xfree(query);
+			if (delete_cnt < 0) {
+				rc = SLURM_ERROR;
+				break;
+			} else if (!delete_cnt)
+				break;
+
+			/* Commit here every time since this could create a
+			 * huge transaction.
 			 */
-			if ((rc = mysql_db_commit(mysql_conn)))
+			if ((rc = mysql_db_commit(mysql_conn))) {
 				error("Couldn't commit cluster (%s) purge",
 				      cluster_name);
+				break;
+			}
+			purge_cnt -= MIN(purge_cnt, delete_cnt);
 		}
 
-		xfree(query);
 		if (rc != SLURM_SUCCESS) {
 			error("Couldn't remove old data from %s table",
 			      sql_table);
@@ -4533,6 +4523,83 @@ extern int as_mysql_jobacct_process_archive(mysql_conn_t *mysql_conn,
 	return rc;
 }
 
+/* returns sql statement from rec_cnt archived records or NULL on error */
+static char *_load_records(uint16_t rpc_version, buf_t *buffer,
+			   char *cluster_name, uint16_t type, uint16_t period,
+			   uint32_t rec_cnt)
+{
+	switch (type) {
+	case DBD_GOT_EVENTS:
+		return _load_events(rpc_version, buffer, cluster_name, rec_cnt);
+	case DBD_GOT_JOBS:
+		return _load_jobs(rpc_version, buffer, cluster_name, rec_cnt);
+	case DBD_GOT_RESVS:
+		return _load_resvs(rpc_version, buffer, cluster_name, rec_cnt);
+	case DBD_STEP_START:
+		return _load_steps(rpc_version, buffer, cluster_name, rec_cnt);
+	case DBD_JOB_SUSPEND:
+		return _load_suspend(rpc_version, buffer, cluster_name,
+				     rec_cnt);
+	case DBD_GOT_TXN:
+		return _load_txn(rpc_version, buffer, cluster_name, rec_cnt);
+	case DBD_GOT_ASSOC_USAGE:
+	case DBD_GOT_WCKEY_USAGE:
+		return _load_usage(rpc_version, buffer, cluster_name, type,
+				   period, rec_cnt);
+	case DBD_GOT_CLUSTER_USAGE:
+		return _load_cluster_usage(rpc_version, buffer, cluster_name,
+					   period, rec_cnt);
+	default:
+		error("Unknown type '%u' to load from archive", type);
+		return NULL;
+	}
+}
+
+/* Load a framed archive file one frame, so one sql statement, at a time */
+static int _load_archive_file(mysql_conn_t *mysql_conn,
+			      archive_file_t *arch_file, uint16_t ver,
+			      uint16_t type, char *cluster_name,
+			      uint16_t period, uint32_t rec_cnt_total)
+{
+	buf_t *buffer = NULL;
+	char *data = NULL;
+	uint32_t rec_cnt = 0, rec_cnt_done = 0, pass_cnt = 0;
+	int rc;
+
+	if (!rec_cnt_total) {
+		error("we didn't get any records from this file of type '%s'",
+		      slurmdbd_msg_type_2_str(type, 0));
+		return SLURM_ERROR;
+	}
+
+	while (((rc = archive_file_read_frame(arch_file, &buffer, &rec_cnt))
+		== SLURM_SUCCESS) && buffer) {
+		DB_DEBUG(DB_ARCHIVE, mysql_conn->conn,
+			 "%s: Pass %u: loaded %u/%u records. Attempting partial load %u.",
+			 __func__, pass_cnt, rec_cnt_done, rec_cnt_total,
+			 rec_cnt);
+
+		if (!(data = _load_records(ver, buffer, cluster_name, type,
+					   period, rec_cnt))) {
+			error("No data to load");
+			return SLURM_ERROR;
+		}
+		if (slurm_conf.debug_flags & DEBUG_FLAG_DB_ARCHIVE)
+			DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s",
+				 data);
+		rc = mysql_db_query_check_after(mysql_conn, data);
+		xfree(data);
+		if (rc != SLURM_SUCCESS) {
+			error("Couldn't load old data");
+			return rc;
+		}
+		rec_cnt_done += rec_cnt;
+		pass_cnt++;
+	}
+
+	return rc;
+}
+
 extern int as_mysql_jobacct_process_archive_load(
 	mysql_conn_t *mysql_conn, slurmdb_archive_rec_t *arch_rec)
 {
@@ -4556,7 +4623,32 @@ extern int as_mysql_jobacct_process_archive_load(
 		data = xstrdup(arch_rec->insert);
 	} else if (arch_rec->archive_file) {
 		int data_allocated, data_read = 0;
-		int state_fd = open(arch_rec->archive_file, O_RDONLY);
+		int state_fd;
+		archive_file_t *arch_file = NULL;
+
+		if ((error_code = archive_file_open(arch_rec->archive_file,
+						    &arch_file, &ver, &buf_time,
+						    &type, &cluster_name,
+						    &period, &rec_cnt)))
+			goto cleanup;
+		if (arch_file) {
+			DB_DEBUG(DB_ARCHIVE, mysql_conn->conn,
+				 "Version in archive header is %u", ver);
+			if (ver > SLURM_PROTOCOL_VERSION) {
+				error("***********************************************");
+				error("Can not recover archive file, incompatible version, got %u need <= %u",
+				      ver, SLURM_PROTOCOL_VERSION);
+				error("***********************************************");
+				error_code = EFAULT;
+			} else
+				error_code = _load_archive_file(
+					mysql_conn, arch_file, ver, type,
+					cluster_name, period, rec_cnt);
+			archive_file_free(arch_file);
+			goto cleanup;
+		}
+
+		state_fd = open(arch_rec->archive_file, O_RDONLY);
 		if (state_fd < 0) {
 			info("Could not open archive file `%s`: %m",
 			     arch_rec->archive_file);
@@ -4658,42 +4750,11 @@ pass:
 
 	rec_cnt_left -= rec_cnt;
 
-	switch (type) {
-	case DBD_GOT_EVENTS:
-		data = _load_events(ver, buffer, cluster_name, rec_cnt);
-		break;
-	case DBD_GOT_JOBS:
-		data = _load_jobs(ver, buffer, cluster_name, rec_cnt);
-		break;
-	case DBD_GOT_RESVS:
-		data = _load_resvs(ver, buffer, cluster_name, rec_cnt);
-		break;
-	case DBD_STEP_START:
-		data = _load_steps(ver, buffer, cluster_name, rec_cnt);
-		break;
-	case DBD_JOB_SUSPEND:
-		data = _load_suspend(ver, buffer, cluster_name, rec_cnt);
-		break;
-	case DBD_GOT_TXN:
-		data = _load_txn(ver, buffer, cluster_name, rec_cnt);
-		break;
-	case DBD_GOT_ASSOC_USAGE:
-	case DBD_GOT_WCKEY_USAGE:
-		if (pass_cnt == 0)
-			safe_unpack16(&period, buffer);
-		data = _load_usage(ver, buffer, cluster_name, type, period,
-				   rec_cnt);
-		break;
-	case DBD_GOT_CLUSTER_USAGE:
-		if (pass_cnt == 0)
-			safe_unpack16(&period, buffer);
-		data = _load_cluster_usage(ver, buffer, cluster_name, period,
-					   rec_cnt);
-		break;
-	default:
-		error("Unknown type '%u' to load from archive", type);
-		break;
-	}
+	if ((pass_cnt == 0) &&
+	    ((type == DBD_GOT_ASSOC_USAGE) || (type == DBD_GOT_WCKEY_USAGE) ||
+	     (type == DBD_GOT_CLUSTER_USAGE)))
+		safe_unpack16(&period, buffer);
+	data = _load_records(ver, buffer, cluster_name, type, period, rec_cnt);
 
 got_sql:
 	if (!data) {
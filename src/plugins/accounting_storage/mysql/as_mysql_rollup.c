@@ -42,6 +42,7 @@
 #include "as_mysql_archive.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_time.h"
+#include "src/common/xhash.h"
 
 enum {
 	TIME_ALLOC,
@@ -92,6 +93,30 @@ typedef struct {
 	double unused_wall;
 } local_resv_usage_t;
 
+/*
+ * Unused wall time a range of hours adds to a reservation record. The
+ * hours of a range are rolled without reading the unused_wall stored by
+ * the hours before it, so the ranges rolled in parallel can be summed
+ * afterwards.
+ */
+typedef struct {
+	int id;
+	time_t orig_start;
+	double unused_wall;
+} local_resv_unused_t;
+
+/* A range of hours rolled up on its own database connection */
+typedef struct {
+	char *cluster_name;
+	int dims;
+	time_t end;
+	mysql_conn_t *mysql_conn;
+	time_t now;
+	int rc;
+	List resv_unused_list; /* list of local_resv_unused_t */
+	time_t start;
+} local_hour_range_t;
+
 static void _destroy_local_tres_usage(void *object)
 {
 	local_tres_usage_t *a_usage = (local_tres_usage_t *)object;
@@ -139,16 +164,65 @@ static int _find_loc_tres(void *x, void *key)
 	return 0;
 }
 
-static int _find_id_usage(void *x, void *key)
+static int _find_resv_unused(void *x, void *key)
 {
-	local_id_usage_t *loc = (local_id_usage_t *)x;
-	uint32_t id = *(uint32_t *)key;
+	local_resv_unused_t *loc = (local_resv_unused_t *)x;
+	local_resv_unused_t *loc_key = (local_resv_unused_t *)key;
 
-	if (loc->id == id)
+	if ((loc->id == loc_key->id) &&
+	    (loc->orig_start == loc_key->orig_start))
 		return 1;
 	return 0;
 }
 
+static void _id_usage_hash_id(void *item, const char **key, uint32_t *key_len)
+{
+	local_id_usage_t *usage = (local_id_usage_t *)item;
+
+	*key = (const char *)&usage->id;
+	*key_len = sizeof(usage->id);
+}
+
+/*
+ * Return the usage record of id, adding it to usage_list and usage_hash if
+ * this is the first time it is seen. The loc_tres of a new record is left
+ * NULL so a job's TRES list can just be transferred to it.
+ */
+static local_id_usage_t *_get_id_usage(List usage_list, xhash_t *usage_hash,
+				       int id)
+{
+	local_id_usage_t *usage;
+
+	if ((usage = xhash_get(usage_hash, (const char *)&id, sizeof(id))))
+		return usage;
+
+	usage = xmalloc(sizeof(local_id_usage_t));
+	usage->id = id;
+	list_append(usage_list, usage);
+	xhash_add(usage_hash, usage);
+
+	return usage;
+}
+
+static void _add_resv_unused(List resv_unused_list, int id,
+			     time_t orig_start, double unused_wall)
+{
+	local_resv_unused_t key = {
+		.id = id,
+		.orig_start = orig_start,
+	};
+	local_resv_unused_t *resv_unused;
+
+	if (!(resv_unused = list_find_first(resv_unused_list,
+					    _find_resv_unused, &key))) {
+		resv_unused = xmalloc(sizeof(local_resv_unused_t));
+		resv_unused->id = id;
+		resv_unused->orig_start = orig_start;
+		list_append(resv_unused_list, resv_unused);
+	}
+	resv_unused->unused_wall += unused_wall;
+}
+
 static void _remove_job_tres_time_from_cluster(List c_tres, List j_tres,
 					       int seconds)
 {
@@ -1076,12 +1150,17 @@ static local_cluster_usage_t *_setup_cluster_usage(mysql_conn_t *mysql_conn,
 	return c_usage;
 }
 
+/*
+ * IN read_unused - when false every hour starts the unused wall time of the
+ *	reservations at 0 instead of carrying over what earlier hours stored.
+ */
 extern int _setup_resv_usage(mysql_conn_t *mysql_conn,
 			     char *cluster_name,
 			     time_t curr_start,
 			     time_t curr_end,
 			     List resv_usage_list,
-			     int dims)
+			     int dims,
+			     bool read_unused)
 {
 	MYSQL_RES *result = NULL;
 	MYSQL_ROW row;
@@ -1159,7 +1238,7 @@ extern int _setup_resv_usage(mysql_conn_t *mysql_conn,
 		int resv_seconds;
 		time_t orig_start = row_start;
 
-		if (row_start >= curr_start) {
+		if (!read_unused || (row_start >= curr_start)) {
 			/*
 			 * This is the first time we are seeing this
 			 * reservation, so set our unused to be 0.
@@ -1211,15 +1290,18 @@ extern int _setup_resv_usage(mysql_conn_t *mysql_conn,
 	return SLURM_SUCCESS;
 }
 
-extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
-				  char *cluster_name,
-				  time_t start, time_t end,
-				  uint16_t archive_data)
+/*
+ * Roll up the hours from start to end without committing.
+ * IN resv_unused_list - if not NULL the unused wall time of the reservations
+ *	is added to this list instead of being stored, see local_resv_unused_t.
+ */
+static int _roll_hours(mysql_conn_t *mysql_conn, char *cluster_name, int dims,
+		       time_t start, time_t end, time_t now,
+		       List resv_unused_list)
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
-	int i=0, dims;
-	time_t now = time(NULL);
+	int i=0;
 	time_t curr_start = start;
 	time_t curr_end = curr_start + add_sec;
 	char *query = NULL;
@@ -1232,6 +1314,8 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	List assoc_usage_list = list_create(_destroy_local_id_usage);
 	List cluster_down_list = list_create(_destroy_local_cluster_usage);
 	List wckey_usage_list = list_create(_destroy_local_id_usage);
+	xhash_t *assoc_usage_hash = xhash_init(_id_usage_hash_id, NULL);
+	xhash_t *wckey_usage_hash = xhash_init(_id_usage_hash_id, NULL);
 	List resv_usage_list = list_create(_destroy_local_resv_usage);
 	uint16_t track_wckey = slurm_get_track_wckey();
 	local_cluster_usage_t *loc_c_usage = NULL;
@@ -1295,30 +1379,6 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		xstrfmtcat(suspend_str, ", %s", suspend_req_inx[i]);
 	}
 
-	/* We need to figure out the dimensions of this cluster */
-	query = xstrdup_printf("select dimensions from %s where name='%s'",
-			       cluster_table, cluster_name);
-	DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
-	result = mysql_db_query_ret(mysql_conn, query, 0);
-	xfree(query);
-
-	if (!result) {
-		error("%s: error querying cluster_table", __func__);
-		rc = SLURM_ERROR;
-		goto end_it;
-	}
-	row = mysql_fetch_row(result);
-
-	if (!row) {
-		error("%s: no cluster by name %s known",
-		      __func__, cluster_name);
-		rc = SLURM_ERROR;
-		goto end_it;
-	}
-
-	dims = atoi(row[0]);
-	mysql_free_result(result);
-
 /* 	info("begin start %s", slurm_ctime2(&curr_start)); */
 /* 	info("begin end %s", slurm_ctime2(&curr_end)); */
 	a_itr = list_iterator_create(assoc_usage_list);
@@ -1337,7 +1397,8 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 		if ((rc = _setup_resv_usage(mysql_conn, cluster_name,
 					    curr_start, curr_end,
-					    resv_usage_list, dims))
+					    resv_usage_list, dims,
+					    !resv_unused_list))
 		    != SLURM_SUCCESS)
 			goto end_it;
 
@@ -1447,9 +1508,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			}
 
 			if (last_id != assoc_id) {
-				a_usage = xmalloc(sizeof(local_id_usage_t));
-				a_usage->id = assoc_id;
-				list_append(assoc_usage_list, a_usage);
+				a_usage = _get_id_usage(assoc_usage_list,
+							assoc_usage_hash,
+							assoc_id);
 				last_id = assoc_id;
 				/* a_usage->loc_tres is made later,
 				   don't do it here.
@@ -1462,20 +1523,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 			/* do the wckey calculation */
 			if (last_wckeyid != wckey_id) {
-				list_iterator_reset(w_itr);
-				while ((w_usage = list_next(w_itr)))
-					if (w_usage->id == wckey_id)
-						break;
-
-				if (!w_usage) {
-					w_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					w_usage->id = wckey_id;
-					list_append(wckey_usage_list,
-						    w_usage);
+				w_usage = _get_id_usage(wckey_usage_list,
+							wckey_usage_hash,
+							wckey_id);
+				if (!w_usage->loc_tres)
 					w_usage->loc_tres = list_create(
 						_destroy_local_tres_usage);
-				}
 				last_wckeyid = wckey_id;
 			}
 
@@ -1684,10 +1737,15 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			ListIterator t_itr;
 			local_tres_usage_t *loc_tres;
 
-			xstrfmtcat(query, "update \"%s_%s\" set unused_wall=%f where id_resv=%u and time_start=%ld;",
-				   cluster_name, resv_table,
-				   r_usage->unused_wall, r_usage->id,
-				   r_usage->orig_start);
+			if (resv_unused_list)
+				_add_resv_unused(resv_unused_list, r_usage->id,
+						 r_usage->orig_start,
+						 r_usage->unused_wall);
+			else
+				xstrfmtcat(query, "update \"%s_%s\" set unused_wall=%f where id_resv=%u and time_start=%ld;",
+					   cluster_name, resv_table,
+					   r_usage->unused_wall, r_usage->id,
+					   r_usage->orig_start);
 
 			if (!r_usage->loc_tres ||
 			    !list_count(r_usage->loc_tres))
@@ -1721,20 +1779,13 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 					r_usage->local_assocs);
 				while ((assoc = list_next(tmp_itr))) {
 					uint32_t associd = slurm_atoul(assoc);
-					if ((last_id != associd) &&
-					    !(a_usage = list_find_first(
-						      assoc_usage_list,
-						      _find_id_usage,
-						      &associd))) {
-						a_usage = xmalloc(
-							sizeof(local_id_usage_t));
-						a_usage->id = associd;
-						list_append(assoc_usage_list,
-							    a_usage);
-						last_id = associd;
+
+					a_usage = _get_id_usage(
+						assoc_usage_list,
+						assoc_usage_hash, associd);
+					if (!a_usage->loc_tres)
 						a_usage->loc_tres = list_create(
 							_destroy_local_tres_usage);
-					}
 
 					_add_time_tres(a_usage->loc_tres,
 						       TIME_ALLOC, loc_tres->id,
@@ -1823,6 +1874,8 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		a_usage     = NULL;
 		w_usage     = NULL;
 
+		xhash_clear(assoc_usage_hash);
+		xhash_clear(wckey_usage_hash);
 		list_flush(assoc_usage_list);
 		list_flush(cluster_down_list);
 		list_flush(wckey_usage_list);
@@ -1845,6 +1898,8 @@ end_it:
 	if (r_itr)
 		list_iterator_destroy(r_itr);
 
+	xhash_free(assoc_usage_hash);
+	xhash_free(wckey_usage_hash);
 	FREE_NULL_LIST(assoc_usage_list);
 	FREE_NULL_LIST(cluster_down_list);
 	FREE_NULL_LIST(wckey_usage_list);
@@ -1853,15 +1908,225 @@ end_it:
 /* 	info("stop start %s", slurm_ctime2(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime2(&curr_end)); */
 
+	return rc;
+}
+
+static void *_hour_range_thread(void *arg)
+{
+	local_hour_range_t *hour_range = (local_hour_range_t *)arg;
+	mysql_conn_t mysql_conn;
+	int rc;
+
+	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
+	mysql_conn.rollback = 1;
+	mysql_conn.conn = hour_range->mysql_conn->conn;
+	slurm_mutex_init(&mysql_conn.lock);
+
+	/* Each range needs its own connection to run in parallel. */
+	if ((rc = check_connection(&mysql_conn)) != SLURM_SUCCESS)
+		goto end_it;
+
+	rc = _roll_hours(&mysql_conn, hour_range->cluster_name,
+			 hour_range->dims, hour_range->start, hour_range->end,
+			 hour_range->now, hour_range->resv_unused_list);
+
+	if (rc == SLURM_SUCCESS) {
+		if (mysql_db_commit(&mysql_conn)) {
+			error("Couldn't commit cluster (%s) hour rollup for %ld - %ld",
+			      hour_range->cluster_name,
+			      hour_range->start, hour_range->end);
+			rc = SLURM_ERROR;
+		}
+	} else if (mysql_db_rollback(&mysql_conn))
+		error("rollback failed");
+
+end_it:
+	mysql_db_close_db_connection(&mysql_conn);
+	slurm_mutex_destroy(&mysql_conn.lock);
+	hour_range->rc = rc;
+
+	return NULL;
+}
+
+/*
+ * Store the unused wall time the ranges of hours added to the reservations.
+ * A reservation which started at or after start had its unused wall time
+ * reset by the first hour, so it is set, otherwise it is added to what the
+ * hours before start stored.
+ */
+static int _store_resv_unused(mysql_conn_t *mysql_conn, char *cluster_name,
+			      time_t start, List resv_unused_list)
+{
+	local_resv_unused_t *resv_unused;
+	ListIterator itr;
+	char *query = NULL;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(resv_unused_list);
+	while ((resv_unused = list_next(itr))) {
+		if (resv_unused->orig_start >= start)
+			xstrfmtcat(query, "update \"%s_%s\" set unused_wall=%f where id_resv=%u and time_start=%ld;",
+				   cluster_name, resv_table,
+				   resv_unused->unused_wall, resv_unused->id,
+				   resv_unused->orig_start);
+		else
+			xstrfmtcat(query, "update \"%s_%s\" set unused_wall=unused_wall+%f where id_resv=%u and time_start=%ld;",
+				   cluster_name, resv_table,
+				   resv_unused->unused_wall, resv_unused->id,
+				   resv_unused->orig_start);
+	}
+	list_iterator_destroy(itr);
+
+	if (query) {
+		DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		if (rc != SLURM_SUCCESS)
+			error("couldn't update reservations with unused time");
+	}
+
+	return rc;
+}
+
+/* Number of connections to roll up the hours of a cluster with */
+static int _get_rollup_threads(void)
+{
+	char *tmp_ptr;
+	int threads = 1;
+
+	if (slurmdbd_conf &&
+	    (tmp_ptr = xstrcasestr(slurmdbd_conf->parameters,
+				   "RollupThreads="))) {
+		threads = atoi(tmp_ptr + 14);
+		if (threads < 1) {
+			error("Invalid RollupThreads in Parameters, using 1");
+			threads = 1;
+		}
+	}
+
+	return threads;
+}
+
+extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end,
+				  uint16_t archive_data)
+{
+	int rc = SLURM_SUCCESS;
+	int add_sec = 3600;
+	int i, dims, hours, range_hours, threads;
+	time_t now = time(NULL);
+	char *query = NULL;
+	MYSQL_RES *result = NULL;
+	MYSQL_ROW row;
+	local_hour_range_t *hour_ranges = NULL;
+	pthread_t *thread_ids = NULL;
+	List resv_unused_list = NULL;
+	local_resv_unused_t *resv_unused;
+
+	/* We need to figure out the dimensions of this cluster */
+	query = xstrdup_printf("select dimensions from %s where name='%s'",
+			       cluster_table, cluster_name);
+	DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+	result = mysql_db_query_ret(mysql_conn, query, 0);
+	xfree(query);
+
+	if (!result) {
+		error("%s: error querying cluster_table", __func__);
+		return SLURM_ERROR;
+	}
+	row = mysql_fetch_row(result);
+
+	if (!row) {
+		error("%s: no cluster by name %s known",
+		      __func__, cluster_name);
+		mysql_free_result(result);
+		return SLURM_ERROR;
+	}
+
+	dims = atoi(row[0]);
+	mysql_free_result(result);
+
+	/*
+	 * Each hour is rolled up on its own, so when catching up on many
+	 * hours split them in ranges rolled up on their own connections.
+	 */
+	hours = (end - start + add_sec - 1) / add_sec;
+	threads = MIN(_get_rollup_threads(), hours);
+
+	if (threads <= 1) {
+		rc = _roll_hours(mysql_conn, cluster_name, dims,
+				 start, end, now, NULL);
+		goto end_it;
+	}
+
+	range_hours = (hours + threads - 1) / threads;
+	threads = (hours + range_hours - 1) / range_hours;
+	hour_ranges = xcalloc(threads, sizeof(*hour_ranges));
+	thread_ids = xcalloc(threads, sizeof(*thread_ids));
+	resv_unused_list = list_create(xfree_ptr);
+
+	DB_DEBUG(DB_USAGE, mysql_conn->conn,
+		 "%s rolling up %d hours in %d ranges of %d hours",
+		 cluster_name, hours, threads, range_hours);
+
+	for (i = 0; i < threads; i++) {
+		hour_ranges[i].cluster_name = cluster_name;
+		hour_ranges[i].dims = dims;
+		hour_ranges[i].start = start +
+			((time_t) i * range_hours * add_sec);
+		hour_ranges[i].end = MIN(hour_ranges[i].start +
+					 (range_hours * add_sec), end);
+		hour_ranges[i].mysql_conn = mysql_conn;
+		hour_ranges[i].now = now;
+		hour_ranges[i].resv_unused_list = list_create(xfree_ptr);
+		/* The first range is rolled up by this thread below */
+		if (i)
+			slurm_thread_create(&thread_ids[i], _hour_range_thread,
+					    &hour_ranges[i]);
+	}
+
+	hour_ranges[0].rc = _roll_hours(mysql_conn, cluster_name, dims,
+					hour_ranges[0].start,
+					hour_ranges[0].end, now,
+					hour_ranges[0].resv_unused_list);
+
+	for (i = 0; i < threads; i++) {
+		if (i)
+			pthread_join(thread_ids[i], NULL);
+		if (hour_ranges[i].rc != SLURM_SUCCESS) {
+			rc = hour_ranges[i].rc;
+		} else {
+			while ((resv_unused = slurm_list_pop(
+					hour_ranges[i].resv_unused_list))) {
+				_add_resv_unused(resv_unused_list,
+						 resv_unused->id,
+						 resv_unused->orig_start,
+						 resv_unused->unused_wall);
+				xfree(resv_unused);
+			}
+		}
+		FREE_NULL_LIST(hour_ranges[i].resv_unused_list);
+	}
+
+	if (rc == SLURM_SUCCESS)
+		rc = _store_resv_unused(mysql_conn, cluster_name, start,
+					resv_unused_list);
+
+end_it:
+	FREE_NULL_LIST(resv_unused_list);
+	xfree(hour_ranges);
+	xfree(thread_ids);
+
 	/* go check to see if we archive and purge */
 
 	if (rc == SLURM_SUCCESS) {
 		if (mysql_db_commit(mysql_conn)) {
-			char start[25], end[25];
+			char start_str[25], end_str[25];
 			error("Couldn't commit cluster (%s) "
 			      "hour rollup for %s - %s",
-			      cluster_name, slurm_ctime2_r(&curr_start, start),
-			      slurm_ctime2_r(&curr_end, end));
+			      cluster_name, slurm_ctime2_r(&start, start_str),
+			      slurm_ctime2_r(&end, end_str));
 			rc = SLURM_ERROR;
 		} else
 			rc = _process_purge(mysql_conn, cluster_name,
@@ -1870,6 +2135,7 @@ end_it:
 
 	return rc;
 }
+
 extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
 				   bool run_month,
 				   char *cluster_name,
@@ -414,11 +414,14 @@ char *_handle_replacement(job_record_t *job_ptr)
 				xstrfmtcat(replaced, "%u", job_ptr->job_id);
 				break;
 			case 'u':	/* '%u' => user name */
-				if (!job_ptr->user_name)
-					job_ptr->user_name =
-						uid_to_string_or_null(
-							job_ptr->user_id);
-				xstrcat(replaced, job_ptr->user_name);
+				if (job_ptr->user_name) {
+					xstrcat(replaced, job_ptr->user_name);
+				} else {
+					char *user_name = uid_to_string_or_null(
+						job_ptr->user_id);
+					xstrcat(replaced, user_name);
+					xfree(user_name);
+				}
 				break;
 			case 'x':	/* '%x' => job name */
 				xstrcat(replaced, job_ptr->name);
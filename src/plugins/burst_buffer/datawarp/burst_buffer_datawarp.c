@@ -3623,6 +3623,7 @@ static void _kill_job(job_record_t *job_ptr, bool hold_job)
 	job_ptr->job_state  = JOB_REQUEUE;
 	job_completion_logger(job_ptr, true);
 	job_ptr->job_state = JOB_PENDING | JOB_COMPLETING;
+	job_array_task_cnt_update(job_ptr);
 
 	deallocate_nodes(job_ptr, false, false, false);
 }
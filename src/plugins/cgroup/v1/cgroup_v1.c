@@ -1495,6 +1495,11 @@ extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t taskid)
 	stats->ssec = NO_VAL64;
 	stats->total_rss = NO_VAL64;
 	stats->total_pgmajfault = NO_VAL64;
+	stats->total_read_bytes = NO_VAL64;
+	stats->total_write_bytes = NO_VAL64;
+	stats->cpu_pressure = NO_VAL64;
+	stats->memory_pressure = NO_VAL64;
+	stats->io_pressure = NO_VAL64;
 
 	if (cpu_time != NULL)
 		sscanf(cpu_time, "%*s %lu %*s %lu", &stats->usec, &stats->ssec);
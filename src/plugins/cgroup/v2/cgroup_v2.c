@@ -0,0 +1,1397 @@
+/*****************************************************************************\
+ *  cgroup_v2.c - Cgroup v2 plugin
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "cgroup_v2.h"
+
+/*
+ * These variables are required by the generic plugin interface.  If they
+ * are not found in the plugin, the plugin loader will ignore it.
+ *
+ * plugin_name - a string giving a human-readable description of the
+ * plugin.  There is no maximum length, but the symbol must refer to
+ * a valid string.
+ *
+ * plugin_type - a string suggesting the type of the plugin or its
+ * applicability to a particular form of data or method of data handling.
+ * If the low-level plugin API is used, the contents of this string are
+ * unimportant and may be anything.  Slurm uses the higher-level plugin
+ * interface which requires this string to be of the form
+ *
+ *	<application>/<method>
+ *
+ * where <application> is a description of the intended application of
+ * the plugin (e.g., "select" for Slurm node selection) and <method>
+ * is a description of how this plugin satisfies that application.  Slurm will
+ * only load select plugins if the plugin_type string has a
+ * prefix of "select/".
+ *
+ * plugin_version - an unsigned 32-bit integer containing the Slurm version
+ * (major.minor.micro combined into a single number).
+ */
+const char plugin_name[] = "Cgroup v2 plugin";
+const char plugin_type[] = "cgroup/v2";
+const uint32_t plugin_version = SLURM_VERSION_NUMBER;
+
+/*
+ * In the unified hierarchy all the controllers share one tree, so a single
+ * set of directories serves every cgroup_ctl_type_t of a step:
+ *
+ *  <base>/<prepend>/system                       slurmd (CoreSpec/MemSpec)
+ *  <base>/<prepend>/uid_U/job_J/step_S/user      pids added by step_addto
+ *  <base>/<prepend>/uid_U/job_J/step_S/task_T    pids added by task_addto
+ *
+ * <base> is the cgroup slurmd was started in, e.g. the subtree delegated to
+ * the slurmd service by systemd, or the root of the hierarchy.
+ *
+ * Processes can only live in the leaves. The inner directories instead get
+ * the controllers enabled in cgroup.subtree_control. Outside of the root,
+ * <base> can not keep processes either, so slurmd moves the processes of
+ * <base> to the system leaf.
+ */
+#define CTL_CPUSET	0x0001
+#define CTL_CPU		0x0002
+#define CTL_IO		0x0004
+#define CTL_MEMORY	0x0008
+
+static const char *g_ctl_str[] = { "cpuset", "cpu", "io", "memory", NULL };
+
+static const char *g_cg_name[CG_CTL_CNT] = {
+	"freezer",
+	"cpuset",
+	"memory",
+	"devices",
+	"cpuacct"
+};
+
+static xcgroup_ns_t g_cg_ns;
+static uint32_t g_ctl_avail = 0;	/* controllers offered by the root */
+static uint32_t g_ctl_req = 0;		/* controllers requested by plugins */
+
+static xcgroup_t g_root_cg;
+static xcgroup_t g_base_cg;
+static xcgroup_t g_slurm_cg;
+static xcgroup_t g_sys_cg;
+static xcgroup_t g_user_cg;
+static xcgroup_t g_job_cg;
+static xcgroup_t g_step_cg;
+static xcgroup_t g_step_user_cg;
+
+static bool g_sys_active[CG_CTL_CNT];
+static uint16_t g_step_active_cnt[CG_CTL_CNT];
+
+/* Task tracking artifacts, one leaf per task shared by all subsystems */
+static List g_task_list = NULL;
+static uint32_t g_max_task_id = 0;
+
+/* Device access of the job, step and task cgroups of this step */
+static ebpf_dev_filter_t g_job_dev;
+static ebpf_dev_filter_t g_step_dev;
+
+typedef struct {
+	xcgroup_t task_cg;
+	uint32_t taskid;
+	ebpf_dev_filter_t dev_filter;
+} task_cg_info_t;
+
+static uint32_t _sub_to_ctl(cgroup_ctl_type_t sub)
+{
+	switch (sub) {
+	case CG_CPUS:
+		return CTL_CPUSET;
+	case CG_MEMORY:
+		return CTL_MEMORY;
+	case CG_CPUACCT:
+		/* cpu.stat is always there, the controller adds throttling */
+		return (CTL_CPU | CTL_IO);
+	default:
+		return 0;
+	}
+}
+
+static uint32_t _parse_controllers(char *controllers)
+{
+	uint32_t ctl = 0;
+	char *tok, *save_ptr = NULL, *tmp;
+
+	if (!controllers)
+		return 0;
+
+	tmp = xstrdup(controllers);
+	tok = strtok_r(tmp, " \n", &save_ptr);
+	while (tok) {
+		for (int i = 0; g_ctl_str[i]; i++) {
+			if (!xstrcmp(tok, g_ctl_str[i]))
+				ctl |= (1 << i);
+		}
+		tok = strtok_r(NULL, " \n", &save_ptr);
+	}
+	xfree(tmp);
+
+	return ctl;
+}
+
+/*
+ * Read the cgroup v2 path of a pid from /proc/<pid>/cgroup, it is the one in
+ * the "0::<path>" line. Returned string must be xfree'd.
+ */
+static char *_pid_cg_name(pid_t pid)
+{
+	char file_path[PATH_MAX], *content = NULL, *ptr, *name = NULL;
+	size_t csize = 0;
+
+	snprintf(file_path, sizeof(file_path), "/proc/%d/cgroup", pid);
+	if (common_file_read_content(file_path, &content, &csize)
+	    != SLURM_SUCCESS)
+		return NULL;
+
+	for (ptr = content; ptr && *ptr; ptr = strchr(ptr, '\n')) {
+		if (*ptr == '\n')
+			ptr++;
+		if (!xstrncmp(ptr, "0::", 3)) {
+			name = xstrdup(ptr + 3);
+			if ((ptr = strchr(name, '\n')))
+				*ptr = '\0';
+			break;
+		}
+	}
+	xfree(content);
+
+	return name;
+}
+
+static char *_get_prepend(void)
+{
+	char *pre = xstrdup(slurm_cgroup_conf.cgroup_prepend);
+
+#ifdef MULTIPLE_SLURMD
+	if (conf->node_name) {
+		xstrsubstitute(pre, "%n", conf->node_name);
+	} else {
+		xfree(pre);
+		pre = xstrdup("/slurm");
+	}
+#endif
+
+	return pre;
+}
+
+/*
+ * Cut name at the path component where our tree starts, if any. A process
+ * forked by slurmd may already have been moved into it.
+ */
+static void _strip_prepend(char *name, char *pre)
+{
+	size_t len = strlen(pre);
+	char *ptr = name;
+
+	if (!len)
+		return;
+
+	while ((ptr = xstrstr(ptr, pre))) {
+		if ((ptr[len] == '\0') || (ptr[len] == '/')) {
+			*ptr = '\0';
+			return;
+		}
+		ptr++;
+	}
+}
+
+static int _ns_init(void)
+{
+	char *mnt = slurm_cgroup_conf.cgroup_mountpoint;
+	char *path = NULL, *controllers = NULL, *base, *pre;
+	size_t csize = 0;
+	struct stat st;
+
+	if (g_cg_ns.mnt_point)
+		return SLURM_SUCCESS;
+
+	/*
+	 * Pure unified mode has cgroup2 mounted in CgroupMountpoint, hybrid
+	 * mode mounts it in its "unified" subdirectory.
+	 */
+	path = xstrdup_printf("%s/cgroup.controllers", mnt);
+	if (!stat(path, &st)) {
+		g_cg_ns.mnt_point = xstrdup(mnt);
+	} else {
+		xfree(path);
+		path = xstrdup_printf("%s/unified/cgroup.controllers", mnt);
+		if (stat(path, &st)) {
+			error("unable to find a cgroup v2 hierarchy in %s: %m",
+			      mnt);
+			xfree(path);
+			return SLURM_ERROR;
+		}
+		g_cg_ns.mnt_point = xstrdup_printf("%s/unified", mnt);
+	}
+	xfree(path);
+
+	if (common_cgroup_create(&g_cg_ns, &g_root_cg, "", 0, 0)
+	    != SLURM_SUCCESS) {
+		error("unable to create root cgroup");
+		common_cgroup_ns_destroy(&g_cg_ns);
+		return SLURM_ERROR;
+	}
+
+	/* Our tree goes in the cgroup slurmd was started in */
+	if (!(base = _pid_cg_name(getpid()))) {
+		error("unable to find the cgroup v2 of pid %d", getpid());
+		common_cgroup_destroy(&g_root_cg);
+		common_cgroup_ns_destroy(&g_cg_ns);
+		return SLURM_ERROR;
+	}
+	pre = _get_prepend();
+	_strip_prepend(base, pre);
+	xfree(pre);
+	if (!xstrcmp(base, "/"))
+		base[0] = '\0';
+	if (common_cgroup_create(&g_cg_ns, &g_base_cg, base, 0, 0)
+	    != SLURM_SUCCESS) {
+		error("unable to create base cgroup '%s'", base);
+		xfree(base);
+		common_cgroup_destroy(&g_root_cg);
+		common_cgroup_ns_destroy(&g_cg_ns);
+		return SLURM_ERROR;
+	}
+	xfree(base);
+
+	/* Only the controllers enabled above base can be used */
+	if (common_cgroup_get_param(&g_base_cg, "cgroup.controllers",
+				    &controllers, &csize) == SLURM_SUCCESS) {
+		g_ctl_avail = _parse_controllers(controllers);
+		g_cg_ns.subsystems = controllers;
+	}
+
+	log_flag(CGROUP, "using cgroup v2 hierarchy %s, base cgroup '%s', controllers: %s",
+		 g_cg_ns.mnt_point, g_base_cg.name, g_cg_ns.subsystems);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Enable all the requested controllers for the children of cg with a single
+ * write. Controllers not offered by the root are skipped, their files will
+ * just not exist.
+ */
+static int _enable_controllers(xcgroup_t *cg)
+{
+	uint32_t ctl = g_ctl_req & g_ctl_avail;
+	char *content = NULL;
+	int rc;
+
+	if (!ctl)
+		return SLURM_SUCCESS;
+
+	for (int i = 0; g_ctl_str[i]; i++) {
+		if (ctl & (1 << i))
+			xstrfmtcat(content, "%s+%s", content ? " " : "",
+				   g_ctl_str[i]);
+	}
+
+	if ((rc = common_cgroup_set_param(cg, "cgroup.subtree_control",
+					  content)) != SLURM_SUCCESS)
+		error("unable to enable controllers '%s' in %s: %m",
+		      content, cg->path);
+	xfree(content);
+
+	return rc;
+}
+
+static int _lock(xcgroup_t *cg)
+{
+	if ((cg->fd = open(cg->path, O_RDONLY)) < 0) {
+		error("error from open of cgroup '%s' : %m", cg->path);
+		return SLURM_ERROR;
+	}
+
+	if (flock(cg->fd, LOCK_EX) < 0) {
+		error("error locking cgroup '%s' : %m", cg->path);
+		close(cg->fd);
+		cg->fd = -1;
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+static void _unlock(xcgroup_t *cg)
+{
+	if (cg->fd < 0)
+		return;
+
+	if (flock(cg->fd, LOCK_UN) < 0)
+		error("error unlocking cgroup '%s' : %m", cg->path);
+	close(cg->fd);
+	cg->fd = -1;
+}
+
+static int _create_cg(xcgroup_t *cg, char *uri, uid_t uid, gid_t gid)
+{
+	if (common_cgroup_create(&g_cg_ns, cg, uri, uid, gid)
+	    != SLURM_SUCCESS) {
+		error("unable to create cgroup %s", uri);
+		return SLURM_ERROR;
+	}
+
+	if (common_cgroup_instantiate(cg) != SLURM_SUCCESS) {
+		error("unable to instantiate cgroup %s", uri);
+		common_cgroup_destroy(cg);
+		return SLURM_ERROR;
+	}
+
+	cg->fd = -1;
+	return SLURM_SUCCESS;
+}
+
+/*
+ * memory.low only protects a cgroup as far as its ancestors are protected,
+ * let the job and step protections through the directories above them.
+ */
+static void _pass_memory_protection(xcgroup_t *cg)
+{
+	if (!(g_ctl_req & g_ctl_avail & CTL_MEMORY))
+		return;
+
+	if (common_cgroup_set_param(cg, "memory.low", "max") != SLURM_SUCCESS)
+		log_flag(CGROUP, "unable to set memory.low in %s", cg->path);
+}
+
+static int _sys_cg_create(void)
+{
+	char *sys_cgpath = NULL;
+	int rc;
+
+	if (g_sys_cg.path)
+		return SLURM_SUCCESS;
+
+	xstrfmtcat(sys_cgpath, "%s/system", g_slurm_cg.name);
+	rc = _create_cg(&g_sys_cg, sys_cgpath, getuid(), getgid());
+	xfree(sys_cgpath);
+
+	return rc;
+}
+
+/*
+ * Only the root cgroup can have processes and controllers enabled for its
+ * children at the same time. Move the processes of base (slurmd and anything
+ * started along with it) to the system leaf.
+ */
+static int _empty_base_cg(void)
+{
+	pid_t *pids = NULL;
+	int npids = 0, rc = SLURM_SUCCESS;
+
+	if ((rc = _sys_cg_create()) != SLURM_SUCCESS)
+		return rc;
+
+	if (common_cgroup_get_pids(&g_base_cg, &pids, &npids)
+	    != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	for (int i = 0; i < npids; i++) {
+		if ((common_cgroup_move_process(&g_sys_cg, pids[i])
+		     != SLURM_SUCCESS) && !kill(pids[i], 0)) {
+			error("Unable to move pid %d to %s",
+			      pids[i], g_sys_cg.path);
+			rc = SLURM_ERROR;
+		}
+	}
+	xfree(pids);
+
+	return rc;
+}
+
+/*
+ * Create the slurm cgroup where all our directories hang from, and enable
+ * the controllers requested so far down to it.
+ */
+static int _slurm_cg_create(void)
+{
+	char *name = NULL, *pre;
+	int rc = SLURM_SUCCESS;
+
+	if (!g_slurm_cg.path) {
+		pre = _get_prepend();
+		xstrfmtcat(name, "%s%s", g_base_cg.name, pre);
+		xfree(pre);
+		rc = _create_cg(&g_slurm_cg, name, getuid(), getgid());
+		xfree(name);
+		if ((rc == SLURM_SUCCESS) && g_base_cg.name[0])
+			rc = _empty_base_cg();
+		if (rc != SLURM_SUCCESS)
+			return rc;
+	}
+
+	if ((rc = _enable_controllers(&g_base_cg)) == SLURM_SUCCESS)
+		rc = _enable_controllers(&g_slurm_cg);
+	if (rc == SLURM_SUCCESS)
+		_pass_memory_protection(&g_slurm_cg);
+
+	return rc;
+}
+
+/*
+ * Move a pid out of the step or system cgroup before removing it. Outside of
+ * the root the base cgroup can not take processes, use the system leaf.
+ */
+static int _move_out(pid_t pid, xcgroup_t *from)
+{
+	xcgroup_t *to = &g_root_cg;
+
+	if (g_base_cg.name[0] && (from != &g_sys_cg) && g_sys_cg.path)
+		to = &g_sys_cg;
+
+	if (common_cgroup_move_process(to, pid) != SLURM_SUCCESS) {
+		error("Unable to move pid %d to %s", pid, to->path);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/* Is pid in cg or in any of its descendants? */
+static bool _pid_in_cg(pid_t pid, xcgroup_t *cg)
+{
+	char *name;
+	size_t len;
+	bool rc = false;
+
+	if (!cg->name || !(name = _pid_cg_name(pid)))
+		return false;
+
+	len = strlen(cg->name);
+	if (!xstrncmp(name, cg->name, len) &&
+	    ((name[len] == '\0') || (name[len] == '/')))
+		rc = true;
+	xfree(name);
+
+	return rc;
+}
+
+static int _step_hierarchy_create(stepd_step_rec_t *job)
+{
+	char *user_path = NULL, *job_path = NULL, *step_path = NULL;
+	char *leaf_path = NULL, tmp_char[64];
+	int rc;
+
+	if ((rc = _slurm_cg_create()) != SLURM_SUCCESS)
+		return rc;
+
+	xstrfmtcat(user_path, "%s/uid_%u", g_slurm_cg.name, job->uid);
+	xstrfmtcat(job_path, "%s/job_%u", user_path, job->step_id.job_id);
+	xstrfmtcat(step_path, "%s/step_%s", job_path,
+		   log_build_step_id_str(&job->step_id, tmp_char,
+					 sizeof(tmp_char),
+					 STEP_ID_FLAG_NO_PREFIX |
+					 STEP_ID_FLAG_NO_JOB));
+	xstrfmtcat(leaf_path, "%s/user", step_path);
+
+	/* Don't race with a step of this node removing the job directory */
+	if ((rc = _lock(&g_slurm_cg)) != SLURM_SUCCESS)
+		goto end;
+
+	if ((rc = _create_cg(&g_user_cg, user_path, 0, 0)) ||
+	    (rc = _enable_controllers(&g_user_cg)))
+		goto unlock;
+	_pass_memory_protection(&g_user_cg);
+	if ((rc = _create_cg(&g_job_cg, job_path, 0, 0)) ||
+	    (rc = _enable_controllers(&g_job_cg)))
+		goto unlock;
+	if ((rc = _create_cg(&g_step_cg, step_path, job->uid, job->gid)) ||
+	    (rc = _enable_controllers(&g_step_cg)))
+		goto unlock;
+	rc = _create_cg(&g_step_user_cg, leaf_path, job->uid, job->gid);
+
+unlock:
+	_unlock(&g_slurm_cg);
+	if (rc != SLURM_SUCCESS) {
+		error("unable to create the cgroup hierarchy of %ps",
+		      &job->step_id);
+		common_cgroup_destroy(&g_user_cg);
+		common_cgroup_destroy(&g_job_cg);
+		common_cgroup_destroy(&g_step_cg);
+		common_cgroup_destroy(&g_step_user_cg);
+	}
+end:
+	xfree(user_path);
+	xfree(job_path);
+	xfree(step_path);
+	xfree(leaf_path);
+
+	return rc;
+}
+
+static int _rmdir_task(void *x, void *arg)
+{
+	task_cg_info_t *t = (task_cg_info_t *) x;
+
+	if (common_cgroup_delete(&t->task_cg) != SLURM_SUCCESS)
+		log_flag(CGROUP, "taskid: %d, failed to delete %s %m",
+			 t->taskid, t->task_cg.path);
+
+	return SLURM_SUCCESS;
+}
+
+static int _step_hierarchy_destroy(void)
+{
+	int rc = SLURM_SUCCESS;
+
+	/*
+	 * Our pid should never be in the step, but another plugin could have
+	 * put it there and then the rmdir would fail with EBUSY.
+	 */
+	if (_pid_in_cg(getpid(), &g_step_cg) &&
+	    (_move_out(getpid(), &g_step_cg) != SLURM_SUCCESS))
+		return SLURM_ERROR;
+
+	/* Empty the list of accounted tasks, do a best effort in rmdir */
+	list_for_each(g_task_list, _rmdir_task, NULL);
+	list_flush(g_task_list);
+
+	if (_lock(&g_slurm_cg) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	if ((rc = common_cgroup_delete(&g_step_user_cg)) != SLURM_SUCCESS)
+		goto end;
+	if ((rc = common_cgroup_delete(&g_step_cg)) != SLURM_SUCCESS)
+		goto end;
+
+	/*
+	 * Best effort for the job and user cgroups, other steps may still be
+	 * using them. The last one will remove them.
+	 */
+	if (common_cgroup_delete(&g_job_cg) == SLURM_SUCCESS)
+		(void) common_cgroup_delete(&g_user_cg);
+
+	common_cgroup_destroy(&g_user_cg);
+	common_cgroup_destroy(&g_job_cg);
+	common_cgroup_destroy(&g_step_cg);
+	common_cgroup_destroy(&g_step_user_cg);
+	ebpf_dev_filter_free(&g_job_dev);
+	ebpf_dev_filter_free(&g_step_dev);
+end:
+	_unlock(&g_slurm_cg);
+	return rc;
+}
+
+static int _find_task_cg_info(void *x, void *key)
+{
+	task_cg_info_t *task_cg = (task_cg_info_t*)x;
+	uint32_t taskid = *(uint32_t*)key;
+
+	if (task_cg->taskid == taskid)
+		return 1;
+
+	return 0;
+}
+
+static void _free_task_cg_info(void *object)
+{
+	task_cg_info_t *task_cg = (task_cg_info_t *)object;
+
+	if (task_cg) {
+		common_cgroup_destroy(&task_cg->task_cg);
+		ebpf_dev_filter_free(&task_cg->dev_filter);
+		xfree(task_cg);
+	}
+}
+
+/* Append the pids of cgroup path and all its descendants to pids */
+static void _get_pids_recursive(char *path, pid_t **pids, int *npids)
+{
+	char *file_path = NULL;
+	uint32_t *cg_pids = NULL;
+	int cg_npids = 0;
+	struct dirent *ent;
+	DIR *dir;
+
+	file_path = xstrdup_printf("%s/cgroup.procs", path);
+	if ((common_file_read_uint32s(file_path, &cg_pids, &cg_npids)
+	     == SLURM_SUCCESS) && cg_npids) {
+		xrecalloc(*pids, (*npids + cg_npids), sizeof(pid_t));
+		memcpy(*pids + *npids, cg_pids, cg_npids * sizeof(pid_t));
+		*npids += cg_npids;
+	}
+	xfree(cg_pids);
+	xfree(file_path);
+
+	if (!(dir = opendir(path)))
+		return;
+	while ((ent = readdir(dir))) {
+		if ((ent->d_type != DT_DIR) || (ent->d_name[0] == '.'))
+			continue;
+		file_path = xstrdup_printf("%s/%s", path, ent->d_name);
+		_get_pids_recursive(file_path, pids, npids);
+		xfree(file_path);
+	}
+	closedir(dir);
+}
+
+static int _set_cpuset(xcgroup_t *cg, cgroup_limits_t *limits)
+{
+	int rc;
+
+	rc = common_cgroup_set_param(cg, "cpuset.cpus", limits->allow_cores);
+	rc += common_cgroup_set_param(cg, "cpuset.mems", limits->allow_mems);
+
+	return rc;
+}
+
+static int _set_memory(xcgroup_t *cg, cgroup_limits_t *limits)
+{
+	uint64_t swap = 0;
+	int rc;
+
+	rc = common_cgroup_set_uint64_param(cg, "memory.max",
+					    limits->limit_in_bytes);
+
+	/*
+	 * There is no soft limit in v2. memory.high would throttle the cgroup
+	 * above it, memory.low instead makes the kernel reclaim from other
+	 * cgroups first while usage is below it, which is what the v1 soft
+	 * limit did.
+	 */
+	rc += common_cgroup_set_uint64_param(cg, "memory.low",
+					     limits->soft_limit_in_bytes);
+
+	/*
+	 * Kernel memory is charged into memory.max, and swap is limited on its
+	 * own instead of as memory+swap.
+	 */
+	if (limits->memsw_limit_in_bytes != NO_VAL64) {
+		if (limits->memsw_limit_in_bytes > limits->limit_in_bytes)
+			swap = limits->memsw_limit_in_bytes -
+				limits->limit_in_bytes;
+		rc += common_cgroup_set_uint64_param(cg, "memory.swap.max",
+						     swap);
+	}
+
+	return rc;
+}
+
+static int _set_device(xcgroup_t *cg, ebpf_dev_filter_t *filter,
+		       cgroup_limits_t *limits)
+{
+	if (!cg->path || !limits->device_major)
+		return SLURM_ERROR;
+
+	if (ebpf_dev_filter_update(filter, limits->allow_device,
+				   limits->device_major) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	return ebpf_dev_filter_attach(filter, cg->path);
+}
+
+extern int init(void)
+{
+	for (int i = 0; i < CG_CTL_CNT; i++) {
+		g_sys_active[i] = false;
+		g_step_active_cnt[i] = 0;
+	}
+	FREE_NULL_LIST(g_task_list);
+	g_task_list = list_create(_free_task_cg_info);
+	ebpf_dev_filter_init(&g_job_dev);
+	ebpf_dev_filter_init(&g_step_dev);
+
+	debug("%s loaded", plugin_name);
+	return SLURM_SUCCESS;
+}
+
+extern int fini(void)
+{
+	FREE_NULL_LIST(g_task_list);
+	common_cgroup_destroy(&g_step_user_cg);
+	common_cgroup_destroy(&g_step_cg);
+	common_cgroup_destroy(&g_job_cg);
+	common_cgroup_destroy(&g_user_cg);
+	common_cgroup_destroy(&g_sys_cg);
+	common_cgroup_destroy(&g_slurm_cg);
+	common_cgroup_destroy(&g_base_cg);
+	common_cgroup_destroy(&g_root_cg);
+	common_cgroup_ns_destroy(&g_cg_ns);
+	ebpf_dev_filter_free(&g_job_dev);
+	ebpf_dev_filter_free(&g_step_dev);
+
+	debug("unloading %s", plugin_name);
+	return SLURM_SUCCESS;
+}
+
+extern int cgroup_p_initialize(cgroup_ctl_type_t sub)
+{
+	int rc;
+
+	if ((rc = _ns_init()) != SLURM_SUCCESS)
+		return rc;
+
+	switch (sub) {
+	case CG_TRACK:
+	case CG_CPUS:
+	case CG_MEMORY:
+	case CG_CPUACCT:
+		break;
+	case CG_DEVICES:
+		/* Enforced with eBPF programs, there is no controller */
+		break;
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+
+	/* cpu.stat and io.stat do not strictly need their controllers */
+	if (_sub_to_ctl(sub) & (CTL_CPUSET | CTL_MEMORY) & ~g_ctl_avail)
+		error("%s controller is not enabled in the cgroup v2 hierarchy %s",
+		      g_cg_name[sub], g_cg_ns.mnt_point);
+	g_ctl_req |= _sub_to_ctl(sub);
+
+	return SLURM_SUCCESS;
+}
+
+extern int cgroup_p_system_create(cgroup_ctl_type_t sub)
+{
+	int rc;
+
+	switch (sub) {
+	case CG_CPUS:
+	case CG_MEMORY:
+		break;
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+
+	if ((rc = _slurm_cg_create()) == SLURM_SUCCESS)
+		rc = _sys_cg_create();
+
+	if (rc == SLURM_SUCCESS)
+		g_sys_active[sub] = true;
+
+	return rc;
+}
+
+extern int cgroup_p_system_addto(cgroup_ctl_type_t sub, pid_t *pids, int npids)
+{
+	switch (sub) {
+	case CG_CPUS:
+	case CG_MEMORY:
+		break;
+	default:
+		error("This operation is not supported for %s", g_cg_name[sub]);
+		return SLURM_ERROR;
+	}
+
+	if (!g_sys_cg.path)
+		return SLURM_ERROR;
+
+	return common_cgroup_add_pids(&g_sys_cg, pids, npids);
+}
+
+extern int cgroup_p_system_destroy(cgroup_ctl_type_t sub)
+{
+	int rc;
+
+	/* Another plugin may have already destroyed this subsystem. */
+	if (!g_sys_active[sub])
+		return SLURM_SUCCESS;
+	g_sys_active[sub] = false;
+
+	for (int i = 0; i < CG_CTL_CNT; i++) {
+		if (g_sys_active[i])
+			return SLURM_SUCCESS;
+	}
+
+	/*
+	 * Outside of the root, slurmd and the stepds it forks live in the
+	 * system leaf, keep it.
+	 */
+	if (g_base_cg.name[0])
+		return SLURM_SUCCESS;
+
+	if (_pid_in_cg(getpid(), &g_sys_cg) &&
+	    (_move_out(getpid(), &g_sys_cg) != SLURM_SUCCESS))
+		return SLURM_ERROR;
+
+	if ((rc = common_cgroup_delete(&g_sys_cg)) != SLURM_SUCCESS) {
+		log_flag(CGROUP, "not removing system cg, there may be attached stepds: %m");
+		return rc;
+	}
+	common_cgroup_destroy(&g_sys_cg);
+
+	return rc;
+}
+
+/*
+ * Each call to this function counts as one active user of the step directories,
+ * so the number of calls to this function must mach the number of calls of
+ * cgroup_p_step_destroy in each plugin.
+ */
+extern int cgroup_p_step_create(cgroup_ctl_type_t sub, stepd_step_rec_t *job)
+{
+	int rc = SLURM_SUCCESS;
+
+	switch (sub) {
+	case CG_TRACK:
+	case CG_CPUS:
+	case CG_MEMORY:
+	case CG_DEVICES:
+	case CG_CPUACCT:
+		break;
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+
+	/* The first subsystem creates the directories for all of them. */
+	if (!g_step_cg.path &&
+	    ((rc = _step_hierarchy_create(job)) != SLURM_SUCCESS))
+		return rc;
+
+	g_step_active_cnt[sub]++;
+
+	/* we use slurmstepd pid as the identifier of the container */
+	if (sub == CG_TRACK)
+		job->cont_id = (uint64_t)job->jmgr_pid;
+
+	return rc;
+}
+
+extern int cgroup_p_step_addto(cgroup_ctl_type_t sub, pid_t *pids, int npids)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!g_step_cg.path)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_TRACK:
+	case CG_CPUS:
+	case CG_MEMORY:
+	case CG_DEVICES:
+		break;
+	default:
+		error("This operation is not supported for %s", g_cg_name[sub]);
+		return SLURM_ERROR;
+	}
+
+	/*
+	 * Several subsystems add the same pids, and task_addto may already
+	 * have moved them to their task leaf. Only move pids which are not in
+	 * the step yet.
+	 */
+	for (int i = 0; i < npids; i++) {
+		if (_pid_in_cg(pids[i], &g_step_cg))
+			continue;
+		if (common_cgroup_move_process(&g_step_user_cg, pids[i])
+		    != SLURM_SUCCESS) {
+			error("Unable to move pid %d to %s",
+			      pids[i], g_step_user_cg.path);
+			rc = SLURM_ERROR;
+		}
+	}
+
+	return rc;
+}
+
+extern int cgroup_p_step_get_pids(pid_t **pids, int *npids)
+{
+	if (!g_step_cg.path)
+		return SLURM_ERROR;
+
+	*pids = NULL;
+	*npids = 0;
+	_get_pids_recursive(g_step_cg.path, pids, npids);
+
+	return SLURM_SUCCESS;
+}
+
+extern int cgroup_p_step_suspend(void)
+{
+	if (!g_step_cg.path)
+		return SLURM_ERROR;
+
+	return common_cgroup_set_param(&g_step_cg, "cgroup.freeze", "1");
+}
+
+extern int cgroup_p_step_resume(void)
+{
+	if (!g_step_cg.path)
+		return SLURM_ERROR;
+
+	return common_cgroup_set_param(&g_step_cg, "cgroup.freeze", "0");
+}
+
+extern int cgroup_p_step_destroy(cgroup_ctl_type_t sub)
+{
+	int rc;
+
+	if (g_step_active_cnt[sub] == 0) {
+		error("called without a previous init. This shouldn't happen!");
+		return SLURM_SUCCESS;
+	}
+	/* Only destroy the step if we're the only ones using it. */
+	if (g_step_active_cnt[sub] > 1) {
+		g_step_active_cnt[sub]--;
+		log_flag(CGROUP, "Not destroying %s step dir, resource busy by %d other plugin",
+			 g_cg_name[sub], g_step_active_cnt[sub]);
+		return SLURM_SUCCESS;
+	}
+
+	for (int i = 0; i < CG_CTL_CNT; i++) {
+		if ((i != sub) && g_step_active_cnt[i]) {
+			g_step_active_cnt[sub] = 0;
+			log_flag(CGROUP, "Not destroying step dir, still used by %s",
+				 g_cg_name[i]);
+			return SLURM_SUCCESS;
+		}
+	}
+
+	if ((rc = _step_hierarchy_destroy()) == SLURM_SUCCESS)
+		g_step_active_cnt[sub] = 0;
+
+	return rc;
+}
+
+extern bool cgroup_p_has_pid(pid_t pid)
+{
+	return _pid_in_cg(pid, &g_step_cg);
+}
+
+extern cgroup_limits_t *cgroup_p_root_constrain_get(cgroup_ctl_type_t sub)
+{
+	int rc = SLURM_SUCCESS;
+	cgroup_limits_t *limits = xmalloc(sizeof(*limits));
+
+	switch (sub) {
+	case CG_TRACK:
+		break;
+	case CG_CPUS:
+		/* The root cgroup only has the effective values */
+		rc = common_cgroup_get_param(&g_base_cg,
+					     "cpuset.cpus.effective",
+					     &limits->allow_cores,
+					     &limits->cores_size);
+
+		rc += common_cgroup_get_param(&g_base_cg,
+					      "cpuset.mems.effective",
+					      &limits->allow_mems,
+					      &limits->mems_size);
+
+		if (limits->cores_size > 0)
+			limits->allow_cores[(limits->cores_size)-1] = '\0';
+
+		if (limits->mems_size > 0)
+			limits->allow_mems[(limits->mems_size)-1] = '\0';
+
+		if (rc != SLURM_SUCCESS)
+			goto fail;
+		break;
+	case CG_MEMORY:
+		break;
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		goto fail;
+	}
+
+	return limits;
+fail:
+	cgroup_free_limits(limits);
+	return NULL;
+}
+
+extern int cgroup_p_root_constrain_set(cgroup_ctl_type_t sub,
+				       cgroup_limits_t *limits)
+{
+	if (!limits)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_TRACK:
+	case CG_CPUS:
+		break;
+	case CG_MEMORY:
+		log_flag(CGROUP, "MemorySwappiness has no equivalent in cgroup v2, ignoring it");
+		break;
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+extern cgroup_limits_t *cgroup_p_system_constrain_get(cgroup_ctl_type_t sub)
+{
+	return NULL;
+}
+
+extern int cgroup_p_system_constrain_set(cgroup_ctl_type_t sub,
+					 cgroup_limits_t *limits)
+{
+	if (!limits || !g_sys_cg.path)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_CPUS:
+		return common_cgroup_set_param(&g_sys_cg, "cpuset.cpus",
+					       limits->allow_cores);
+	case CG_MEMORY:
+		return common_cgroup_set_uint64_param(&g_sys_cg, "memory.max",
+						      limits->limit_in_bytes);
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+}
+
+extern int cgroup_p_user_constrain_set(cgroup_ctl_type_t sub,
+				       stepd_step_rec_t *job,
+				       cgroup_limits_t *limits)
+{
+	if (!limits)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_TRACK:
+	case CG_MEMORY:
+		return SLURM_SUCCESS;
+	case CG_CPUS:
+		return _set_cpuset(&g_user_cg, limits);
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+}
+
+extern int cgroup_p_job_constrain_set(cgroup_ctl_type_t sub,
+				      stepd_step_rec_t *job,
+				      cgroup_limits_t *limits)
+{
+	if (!limits)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_TRACK:
+		return SLURM_SUCCESS;
+	case CG_CPUS:
+		return _set_cpuset(&g_job_cg, limits);
+	case CG_MEMORY:
+		return _set_memory(&g_job_cg, limits);
+	case CG_DEVICES:
+		return _set_device(&g_job_cg, &g_job_dev, limits);
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+}
+
+extern int cgroup_p_step_constrain_set(cgroup_ctl_type_t sub,
+				       stepd_step_rec_t *job,
+				       cgroup_limits_t *limits)
+{
+	if (!limits)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_TRACK:
+		return SLURM_SUCCESS;
+	case CG_CPUS:
+		return _set_cpuset(&g_step_cg, limits);
+	case CG_MEMORY:
+		return _set_memory(&g_step_cg, limits);
+	case CG_DEVICES:
+		return _set_device(&g_step_cg, &g_step_dev, limits);
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+}
+
+extern int cgroup_p_task_constrain_set(cgroup_ctl_type_t sub,
+				       cgroup_limits_t *limits, uint32_t taskid)
+{
+	task_cg_info_t *task_cg_info;
+
+	if (!limits)
+		return SLURM_ERROR;
+
+	switch (sub) {
+	case CG_TRACK:
+	case CG_CPUS:
+	case CG_MEMORY:
+		/* As in cgroup/v1, these are only constrained per step */
+		return SLURM_SUCCESS;
+	case CG_DEVICES:
+		if (!(task_cg_info = list_find_first(g_task_list,
+						     _find_task_cg_info,
+						     &taskid))) {
+			error("Task %u is not being tracked, cannot set constrain.",
+			      taskid);
+			return SLURM_ERROR;
+		}
+		return _set_device(&task_cg_info->task_cg,
+				   &task_cg_info->dev_filter, limits);
+	default:
+		error("cgroup subsystem %u not supported", sub);
+		return SLURM_ERROR;
+	}
+}
+
+extern int cgroup_p_step_start_oom_mgr(void)
+{
+	/* Counters are kept by the kernel in memory.events, nothing to do */
+	return SLURM_SUCCESS;
+}
+
+/* Value of a "key value" line of a flat keyed cgroup file, or NO_VAL64 */
+static uint64_t _get_key_value(char *content, const char *key)
+{
+	size_t len = strlen(key);
+	char *ptr = content;
+
+	while (ptr && *ptr) {
+		if (!strncmp(ptr, key, len) && (ptr[len] == ' '))
+			return strtoull(ptr + len + 1, NULL, 10);
+		if ((ptr = strchr(ptr, '\n')))
+			ptr++;
+	}
+
+	return NO_VAL64;
+}
+
+static uint64_t _get_event(xcgroup_t *cg, char *param, const char *key)
+{
+	char *content = NULL;
+	size_t csize = 0;
+	uint64_t value = 0;
+
+	if (!cg->path ||
+	    (common_cgroup_get_param(cg, param, &content, &csize)
+	     != SLURM_SUCCESS)) {
+		log_flag(CGROUP, "unable to read '%s' from '%s'",
+			 param, cg->path);
+		return 0;
+	}
+
+	if ((value = _get_key_value(content, key)) == NO_VAL64)
+		value = 0;
+	xfree(content);
+
+	return value;
+}
+
+extern cgroup_oom_t *cgroup_p_step_stop_oom_mgr(stepd_step_rec_t *job)
+{
+	cgroup_oom_t *results;
+
+	if (!g_step_cg.path) {
+		log_flag(CGROUP, "OOM events were not monitored for %ps",
+			 &job->step_id);
+		return NULL;
+	}
+
+	/*
+	 * "max" counts the times usage hit memory.max (or swap.max), which is
+	 * the equivalent of the v1 failcnt.
+	 */
+	results = xmalloc(sizeof(*results));
+	results->step_memsw_failcnt = _get_event(&g_step_cg,
+						 "memory.swap.events", "max");
+	results->step_mem_failcnt = _get_event(&g_step_cg, "memory.events",
+					       "max");
+	results->job_memsw_failcnt = _get_event(&g_job_cg,
+						"memory.swap.events", "max");
+	results->job_mem_failcnt = _get_event(&g_job_cg, "memory.events",
+					      "max");
+	results->oom_kill_cnt = _get_event(&g_step_cg, "memory.events",
+					   "oom_kill");
+
+	return results;
+}
+
+/***************************************
+ ***** CGROUP TASK FUNCTIONS *****
+ **************************************/
+extern int cgroup_p_task_addto(cgroup_ctl_type_t sub, stepd_step_rec_t *job,
+			       pid_t pid, uint32_t task_id)
+{
+	task_cg_info_t *task_cg_info;
+	char *task_cgroup_path = NULL;
+	int rc;
+
+	if (!g_step_cg.path)
+		return SLURM_ERROR;
+
+	if (task_id > g_max_task_id)
+		g_max_task_id = task_id;
+
+	log_flag(CGROUP, "%ps taskid %u max_task_id %u", &job->step_id, task_id,
+		 g_max_task_id);
+
+	/* The leaf is shared by all the subsystems, create it once */
+	if (!(task_cg_info = list_find_first(g_task_list, _find_task_cg_info,
+					     &task_id))) {
+		task_cg_info = xmalloc(sizeof(*task_cg_info));
+		task_cg_info->taskid = task_id;
+		ebpf_dev_filter_init(&task_cg_info->dev_filter);
+
+		xstrfmtcat(task_cgroup_path, "%s/task_%u", g_step_cg.name,
+			   task_id);
+		rc = _create_cg(&task_cg_info->task_cg, task_cgroup_path,
+				job->uid, job->gid);
+		xfree(task_cgroup_path);
+		if (rc != SLURM_SUCCESS) {
+			error("unable to create task %u cgroup", task_id);
+			xfree(task_cg_info);
+			return rc;
+		}
+		list_append(g_task_list, task_cg_info);
+	} else if (_pid_in_cg(pid, &task_cg_info->task_cg)) {
+		return SLURM_SUCCESS;
+	}
+
+	/* Attach the pid to the corresponding step_x/task_y cgroup */
+	if ((rc = common_cgroup_move_process(&task_cg_info->task_cg, pid))
+	    != SLURM_SUCCESS)
+		error("Unable to move pid %d to %s cg", pid,
+		      task_cg_info->task_cg.path);
+
+	return rc;
+}
+
+/* Stall time from the "some" line of a PSI file, or NO_VAL64 */
+static uint64_t _get_pressure(xcgroup_t *cg, char *param)
+{
+	char *content = NULL, *ptr;
+	size_t csize = 0;
+	uint64_t total = NO_VAL64;
+
+	if (common_cgroup_get_param(cg, param, &content, &csize)
+	    != SLURM_SUCCESS)
+		return NO_VAL64;
+
+	if (!xstrncmp(content, "some", 4) && (ptr = xstrstr(content, "total=")))
+		total = strtoull(ptr + 6, NULL, 10);
+	xfree(content);
+
+	return total;
+}
+
+/* Sum the read and written bytes of all the devices in io.stat */
+static void _get_io_bytes(xcgroup_t *cg, uint64_t *rbytes, uint64_t *wbytes)
+{
+	char *content = NULL, *ptr;
+	size_t csize = 0;
+
+	if (common_cgroup_get_param(cg, "io.stat", &content, &csize)
+	    != SLURM_SUCCESS)
+		return;
+
+	/* "<maj>:<min> rbytes=X wbytes=Y rios=Z wios=W dbytes=..." */
+	*rbytes = *wbytes = 0;
+	for (ptr = content; (ptr = xstrstr(ptr, "bytes=")); ptr += 6) {
+		if (ptr == content)
+			continue;
+		if (ptr[-1] == 'r')
+			*rbytes += strtoull(ptr + 6, NULL, 10);
+		else if (ptr[-1] == 'w')
+			*wbytes += strtoull(ptr + 6, NULL, 10);
+	}
+	xfree(content);
+}
+
+extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t taskid)
+{
+	char *cpu_stat = NULL, *memory_stat = NULL;
+	size_t cpu_stat_sz = 0, memory_stat_sz = 0;
+	cgroup_acct_t *stats = NULL;
+	task_cg_info_t *task_cg_info;
+	xcgroup_t *cg;
+	uint64_t value;
+	long hertz;
+
+	/* Find which task cgroup to use */
+	if (!(task_cg_info = list_find_first(g_task_list, _find_task_cg_info,
+					     &taskid))) {
+		error("Could not find task_cg_info, this should never happen");
+		return NULL;
+	}
+	cg = &task_cg_info->task_cg;
+
+	/*
+	 * Initialize values, a NO_VAL64 will indicate to the caller that
+	 * something happened here.
+	 */
+	stats = xmalloc(sizeof(*stats));
+	stats->usec = NO_VAL64;
+	stats->ssec = NO_VAL64;
+	stats->total_rss = NO_VAL64;
+	stats->total_pgmajfault = NO_VAL64;
+	stats->total_read_bytes = NO_VAL64;
+	stats->total_write_bytes = NO_VAL64;
+
+	/* cpu.stat is in usec, callers expect clock ticks as in cpuacct.stat */
+	common_cgroup_get_param(cg, "cpu.stat", &cpu_stat, &cpu_stat_sz);
+	if (cpu_stat) {
+		if ((hertz = sysconf(_SC_CLK_TCK)) <= 0)
+			hertz = 100;
+		if ((value = _get_key_value(cpu_stat, "user_usec"))
+		    != NO_VAL64)
+			stats->usec = (value * hertz) / USEC_IN_SEC;
+		if ((value = _get_key_value(cpu_stat, "system_usec"))
+		    != NO_VAL64)
+			stats->ssec = (value * hertz) / USEC_IN_SEC;
+	}
+
+	/* anon is the v2 name of the rss of v1 */
+	common_cgroup_get_param(cg, "memory.stat", &memory_stat,
+				&memory_stat_sz);
+	if (memory_stat) {
+		stats->total_rss = _get_key_value(memory_stat, "anon");
+		stats->total_pgmajfault = _get_key_value(memory_stat,
+							 "pgmajfault");
+	}
+
+	_get_io_bytes(cg, &stats->total_read_bytes, &stats->total_write_bytes);
+
+	stats->cpu_pressure = _get_pressure(cg, "cpu.pressure");
+	stats->memory_pressure = _get_pressure(cg, "memory.pressure");
+	stats->io_pressure = _get_pressure(cg, "io.pressure");
+
+	xfree(cpu_stat);
+	xfree(memory_stat);
+
+	return stats;
+}
@@ -0,0 +1,160 @@
+/*****************************************************************************\
+ *  cgroup_v2.h - Cgroup v2 plugin
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _CGROUP_V2_H
+#define _CGROUP_V2_H
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "slurm/slurm.h"
+#include "slurm/slurm_errno.h"
+
+#include "src/common/cgroup.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/run_in_daemon.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmstepd/slurmstepd_job.h"
+#include "src/plugins/cgroup/common/cgroup_common.h"
+
+#include "ebpf.h"
+
+/*
+ * The interface is the same as the one of cgroup/v1, see cgroup_v1.h for the
+ * description of every function. Only the differences are noted here.
+ */
+
+/* Functions */
+extern int init(void);
+extern int fini(void);
+
+/*
+ * Find the unified hierarchy under CgroupMountpoint (or its "unified"
+ * subdirectory on hybrid systems) and record which v2 controller backs the
+ * given subsystem, so it is enabled when the step hierarchy is created.
+ * The hierarchy is built in the cgroup slurmd was started in, which is the
+ * subtree systemd delegates to it with Delegate=yes. CG_DEVICES needs no
+ * controller, device access is enforced with eBPF programs.
+ */
+extern int cgroup_p_initialize(cgroup_ctl_type_t sub);
+
+extern int cgroup_p_system_create(cgroup_ctl_type_t sub);
+extern int cgroup_p_system_addto(cgroup_ctl_type_t sub, pid_t *pids, int npids);
+extern int cgroup_p_system_destroy(cgroup_ctl_type_t sub);
+
+/*
+ * All subsystems share a single step directory. The first call creates it,
+ * enabling every requested controller with one cgroup.subtree_control write
+ * per level, the following ones only take a reference on it.
+ *
+ * The directory path will be <base>/<prepend>/uid_<uid>/job_<jobid>/step_<stepid>/
+ */
+extern int cgroup_p_step_create(cgroup_ctl_type_t sub, stepd_step_rec_t *job);
+
+/*
+ * Move the pids to the "user" leaf of the step, unless they already are in
+ * the step subtree (e.g. already in a task_X leaf).
+ */
+extern int cgroup_p_step_addto(cgroup_ctl_type_t sub, pid_t *pids, int npids);
+
+/* Get the pids of the whole step subtree, task_X leaves included. */
+extern int cgroup_p_step_get_pids(pid_t **pids, int *npids);
+
+/* Suspend and resume the step subtree through cgroup.freeze. */
+extern int cgroup_p_step_suspend();
+extern int cgroup_p_step_resume();
+
+/*
+ * Drop the reference of this subsystem and rmdir the step directories once
+ * no subsystem is using them anymore.
+ */
+extern int cgroup_p_step_destroy(cgroup_ctl_type_t sub);
+
+/* True if the pid is anywhere in the step subtree. */
+extern bool cgroup_p_has_pid(pid_t pid);
+
+extern cgroup_limits_t *cgroup_p_root_constrain_get(cgroup_ctl_type_t sub);
+extern int cgroup_p_root_constrain_set(cgroup_ctl_type_t sub,
+				       cgroup_limits_t *limits);
+extern cgroup_limits_t *cgroup_p_system_constrain_get(cgroup_ctl_type_t sub);
+extern int cgroup_p_system_constrain_set(cgroup_ctl_type_t sub,
+					 cgroup_limits_t *limits);
+
+/*
+ * CG_DEVICES limits update the eBPF device program of the job, step or task
+ * cgroup. The memory soft limit is set as memory.low.
+ */
+extern int cgroup_p_user_constrain_set(cgroup_ctl_type_t sub,
+				       stepd_step_rec_t *job,
+				       cgroup_limits_t *limits);
+extern int cgroup_p_job_constrain_set(cgroup_ctl_type_t sub,
+				      stepd_step_rec_t *job,
+				      cgroup_limits_t *limits);
+extern int cgroup_p_step_constrain_set(cgroup_ctl_type_t sub,
+				       stepd_step_rec_t *job,
+				       cgroup_limits_t *limits);
+extern int cgroup_p_task_constrain_set(cgroup_ctl_type_t sub,
+				       cgroup_limits_t *limits,
+				       uint32_t taskid);
+
+/*
+ * cgroup v2 keeps OOM counters in memory.events, so there is no monitoring
+ * thread: the counters of the step and job are read when the step ends.
+ */
+extern int cgroup_p_step_start_oom_mgr();
+extern cgroup_oom_t *cgroup_p_step_stop_oom_mgr(stepd_step_rec_t *job);
+
+/*
+ * Create the task_X leaf of the step, shared by all subsystems, and move the
+ * pid into it.
+ */
+extern int cgroup_p_task_addto(cgroup_ctl_type_t sub, stepd_step_rec_t *job,
+			       pid_t pid, uint32_t task_id);
+
+/*
+ * Read cpu.stat, memory.stat, io.stat and the pressure stall (PSI) files of
+ * the task leaf. The cost does not depend on the number of processes of the
+ * task, as the kernel keeps these counters per cgroup.
+ */
+extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t taskid);
+
+#endif /* !_CGROUP_V2_H */
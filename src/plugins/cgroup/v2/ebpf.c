@@ -0,0 +1,382 @@
+/*****************************************************************************\
+ *  ebpf.c - eBPF device filter of the cgroup v2 plugin
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_BPF_H
+#include <linux/bpf.h>
+#endif
+
+#include "slurm/slurm_errno.h"
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "ebpf.h"
+
+/*
+ * Device cgroup programs appeared in Linux 4.15, along with multiple programs
+ * per cgroup (BPF_DEVCG_* are enums, so check for BPF_F_ALLOW_MULTI).
+ */
+#if defined(HAVE_LINUX_BPF_H) && defined(BPF_F_ALLOW_MULTI) && \
+    defined(__NR_bpf)
+#define HAVE_BPF_DEVCG 1
+#endif
+
+#ifdef HAVE_BPF_DEVCG
+#define _INSN(c, d, s, o, i)					\
+	((struct bpf_insn) { .code = (c), .dst_reg = (d),	\
+			     .src_reg = (s), .off = (o), .imm = (i) })
+#define LDX_W(dst, src, off)	_INSN(BPF_LDX | BPF_W | BPF_MEM, dst, src, off, 0)
+#define MOV_REG(dst, src)	_INSN(BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0)
+#define MOV_IMM(dst, imm)	_INSN(BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm)
+#define AND_IMM(dst, imm)	_INSN(BPF_ALU | BPF_AND | BPF_K, dst, 0, 0, imm)
+#define RSH_IMM(dst, imm)	_INSN(BPF_ALU | BPF_RSH | BPF_K, dst, 0, 0, imm)
+#define JEQ_IMM(dst, imm, off)	_INSN(BPF_JMP | BPF_JEQ | BPF_K, dst, 0, off, imm)
+#define JNE_IMM(dst, imm, off)	_INSN(BPF_JMP | BPF_JNE | BPF_K, dst, 0, off, imm)
+#define EXIT()			_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+static int _bpf(int cmd, union bpf_attr *attr)
+{
+	return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+#endif
+
+static int _parse_dev_num(char *str, int64_t *num)
+{
+	char *end = NULL;
+
+	if (!xstrcmp(str, "*")) {
+		*num = -1;
+		return SLURM_SUCCESS;
+	}
+
+	errno = 0;
+	*num = strtoll(str, &end, 10);
+	if (errno || (end == str) || *end || (*num < 0) ||
+	    (*num > UINT32_MAX))
+		return SLURM_ERROR;
+
+	return SLURM_SUCCESS;
+}
+
+static int _parse_rule(char *dev, ebpf_dev_rule_t *rule)
+{
+	char type, major[16], minor[16], access[4];
+
+	if ((sscanf(dev, "%c %15[^:]:%15s %3s", &type, major, minor,
+		    access) != 4) ||
+	    ((type != 'a') && (type != 'b') && (type != 'c')) ||
+	    _parse_dev_num(major, &rule->major) ||
+	    _parse_dev_num(minor, &rule->minor))
+		return SLURM_ERROR;
+
+	rule->type = type;
+	rule->access = 0;
+	for (int i = 0; access[i]; i++) {
+		switch (access[i]) {
+		case 'm':
+			rule->access |= 1;	/* BPF_DEVCG_ACC_MKNOD */
+			break;
+		case 'r':
+			rule->access |= 2;	/* BPF_DEVCG_ACC_READ */
+			break;
+		case 'w':
+			rule->access |= 4;	/* BPF_DEVCG_ACC_WRITE */
+			break;
+		default:
+			return SLURM_ERROR;
+		}
+	}
+
+	return SLURM_SUCCESS;
+}
+
+static bool _same_dev(ebpf_dev_rule_t *a, ebpf_dev_rule_t *b)
+{
+	return ((a->type == b->type) && (a->major == b->major) &&
+		(a->minor == b->minor));
+}
+
+extern void ebpf_dev_filter_init(ebpf_dev_filter_t *filter)
+{
+	memset(filter, 0, sizeof(*filter));
+	filter->prog_fd = -1;
+}
+
+extern void ebpf_dev_filter_free(ebpf_dev_filter_t *filter)
+{
+	if (filter->prog_fd >= 0)
+		close(filter->prog_fd);
+	xfree(filter->rules);
+	ebpf_dev_filter_init(filter);
+}
+
+extern int ebpf_dev_filter_update(ebpf_dev_filter_t *filter, bool allow,
+				  char *dev)
+{
+	ebpf_dev_rule_t rule;
+	int i;
+
+	if (_parse_rule(dev, &rule) != SLURM_SUCCESS) {
+		error("%s: invalid device '%s'", __func__, dev);
+		return SLURM_ERROR;
+	}
+
+	for (i = 0; i < filter->rule_cnt; i++) {
+		if (_same_dev(&filter->rules[i], &rule))
+			break;
+	}
+
+	if (allow) {
+		/* Drop the allowed access, and the rule if nothing is left */
+		if (i == filter->rule_cnt)
+			return SLURM_SUCCESS;
+		filter->rules[i].access &= ~rule.access;
+		if (!filter->rules[i].access)
+			filter->rules[i] = filter->rules[--filter->rule_cnt];
+	} else if (i < filter->rule_cnt) {
+		filter->rules[i].access |= rule.access;
+	} else {
+		xrecalloc(filter->rules, filter->rule_cnt + 1,
+			  sizeof(*filter->rules));
+		filter->rules[filter->rule_cnt++] = rule;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+#ifdef HAVE_BPF_DEVCG
+/*
+ * Build the program: return 0 (deny) for the first rule matching the device
+ * type, numbers and any of the requested access bits, 1 (allow) otherwise.
+ */
+static struct bpf_insn *_build_prog(ebpf_dev_filter_t *filter, int *cnt)
+{
+	struct bpf_insn *insns;
+	int n = 0;
+
+	/* 6 to load the context, at most 8 per rule, 2 to allow */
+	insns = xcalloc(6 + (8 * filter->rule_cnt) + 2, sizeof(*insns));
+
+	/* r2 = access, r3 = type, r4 = major, r5 = minor */
+	insns[n++] = LDX_W(BPF_REG_2, BPF_REG_1,
+			   offsetof(struct bpf_cgroup_dev_ctx, access_type));
+	insns[n++] = MOV_REG(BPF_REG_3, BPF_REG_2);
+	insns[n++] = AND_IMM(BPF_REG_3, 0xffff);
+	insns[n++] = RSH_IMM(BPF_REG_2, 16);
+	insns[n++] = LDX_W(BPF_REG_4, BPF_REG_1,
+			   offsetof(struct bpf_cgroup_dev_ctx, major));
+	insns[n++] = LDX_W(BPF_REG_5, BPF_REG_1,
+			   offsetof(struct bpf_cgroup_dev_ctx, minor));
+
+	for (int i = 0; i < filter->rule_cnt; i++) {
+		ebpf_dev_rule_t *rule = &filter->rules[i];
+		int end = n + 5;
+
+		if (rule->type != 'a')
+			end++;
+		if (rule->major >= 0)
+			end++;
+		if (rule->minor >= 0)
+			end++;
+
+		/* Jump offsets are relative to the next instruction */
+		if (rule->type != 'a') {
+			insns[n] = JNE_IMM(BPF_REG_3, (rule->type == 'b') ?
+					   BPF_DEVCG_DEV_BLOCK :
+					   BPF_DEVCG_DEV_CHAR, end - n - 1);
+			n++;
+		}
+		insns[n++] = MOV_REG(BPF_REG_1, BPF_REG_2);
+		insns[n++] = AND_IMM(BPF_REG_1, rule->access);
+		insns[n] = JEQ_IMM(BPF_REG_1, 0, end - n - 1);
+		n++;
+		if (rule->major >= 0) {
+			insns[n] = JNE_IMM(BPF_REG_4, rule->major,
+					   end - n - 1);
+			n++;
+		}
+		if (rule->minor >= 0) {
+			insns[n] = JNE_IMM(BPF_REG_5, rule->minor,
+					   end - n - 1);
+			n++;
+		}
+		insns[n++] = MOV_IMM(BPF_REG_0, 0);
+		insns[n++] = EXIT();
+	}
+
+	insns[n++] = MOV_IMM(BPF_REG_0, 1);
+	insns[n++] = EXIT();
+	*cnt = n;
+
+	return insns;
+}
+
+/*
+ * Detach all the device programs of the cgroup but prog_fd. Every step of a
+ * job attaches the same program to the job cgroup, and a cgroup can only
+ * have 64 of them, so only the last one is kept.
+ */
+static void _detach_others(int cg_fd, int prog_fd, char *path)
+{
+	union bpf_attr attr;
+	struct bpf_prog_info info;
+	uint32_t ids[64], keep_id = 0;
+	int fd;
+
+	if (prog_fd >= 0) {
+		memset(&info, 0, sizeof(info));
+		memset(&attr, 0, sizeof(attr));
+		attr.info.bpf_fd = prog_fd;
+		attr.info.info_len = sizeof(info);
+		attr.info.info = (uint64_t) (uintptr_t) &info;
+		if (_bpf(BPF_OBJ_GET_INFO_BY_FD, &attr) < 0) {
+			error("%s: unable to get device program id: %m",
+			      __func__);
+			return;
+		}
+		keep_id = info.id;
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.query.target_fd = cg_fd;
+	attr.query.attach_type = BPF_CGROUP_DEVICE;
+	attr.query.prog_ids = (uint64_t) (uintptr_t) ids;
+	attr.query.prog_cnt = ARRAY_SIZE(ids);
+	if (_bpf(BPF_PROG_QUERY, &attr) < 0) {
+		error("%s: unable to list device programs of %s: %m",
+		      __func__, path);
+		return;
+	}
+
+	for (int i = 0; i < attr.query.prog_cnt; i++) {
+		union bpf_attr id_attr;
+
+		if (ids[i] == keep_id)
+			continue;
+
+		memset(&id_attr, 0, sizeof(id_attr));
+		id_attr.prog_id = ids[i];
+		if ((fd = _bpf(BPF_PROG_GET_FD_BY_ID, &id_attr)) < 0)
+			continue;	/* Detached in the meantime */
+
+		memset(&id_attr, 0, sizeof(id_attr));
+		id_attr.target_fd = cg_fd;
+		id_attr.attach_bpf_fd = fd;
+		id_attr.attach_type = BPF_CGROUP_DEVICE;
+		if ((_bpf(BPF_PROG_DETACH, &id_attr) < 0) && (errno != ENOENT))
+			error("%s: unable to detach device program from %s: %m",
+			      __func__, path);
+		close(fd);
+	}
+}
+
+extern int ebpf_dev_filter_attach(ebpf_dev_filter_t *filter, char *path)
+{
+	union bpf_attr attr;
+	struct bpf_insn *insns;
+	char log_buf[4096] = "";
+	int cnt, cg_fd, prog_fd = -1, rc = SLURM_ERROR;
+
+	if ((cg_fd = open(path, O_RDONLY | O_DIRECTORY)) < 0) {
+		error("%s: unable to open %s: %m", __func__, path);
+		return SLURM_ERROR;
+	}
+
+	if (filter->rule_cnt) {
+		insns = _build_prog(filter, &cnt);
+		memset(&attr, 0, sizeof(attr));
+		attr.prog_type = BPF_PROG_TYPE_CGROUP_DEVICE;
+		attr.insns = (uint64_t) (uintptr_t) insns;
+		attr.insn_cnt = cnt;
+		attr.license = (uint64_t) (uintptr_t) "GPL";
+		attr.log_buf = (uint64_t) (uintptr_t) log_buf;
+		attr.log_size = sizeof(log_buf);
+		attr.log_level = 1;
+		prog_fd = _bpf(BPF_PROG_LOAD, &attr);
+		xfree(insns);
+		if (prog_fd < 0) {
+			error("%s: unable to load device program for %s: %m",
+			      __func__, path);
+			debug("%s: verifier log: %s", __func__, log_buf);
+			goto end;
+		}
+
+		memset(&attr, 0, sizeof(attr));
+		attr.target_fd = cg_fd;
+		attr.attach_bpf_fd = prog_fd;
+		attr.attach_type = BPF_CGROUP_DEVICE;
+		attr.attach_flags = BPF_F_ALLOW_MULTI;
+		if (_bpf(BPF_PROG_ATTACH, &attr) < 0) {
+			error("%s: unable to attach device program to %s: %m",
+			      __func__, path);
+			close(prog_fd);
+			goto end;
+		}
+	}
+
+	/* The new program is in place, drop the previous ones */
+	_detach_others(cg_fd, prog_fd, path);
+	if (filter->prog_fd >= 0)
+		close(filter->prog_fd);
+	filter->prog_fd = prog_fd;
+	rc = SLURM_SUCCESS;
+end:
+	close(cg_fd);
+	return rc;
+}
+#else
+extern int ebpf_dev_filter_attach(ebpf_dev_filter_t *filter, char *path)
+{
+	error("%s: device cgroup programs are not supported by the kernel headers Slurm was built with",
+	      __func__);
+	return SLURM_ERROR;
+}
+#endif
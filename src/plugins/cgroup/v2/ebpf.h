@@ -0,0 +1,87 @@
+/*****************************************************************************\
+ *  ebpf.h - eBPF device filter of the cgroup v2 plugin
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifndef _CGROUP_V2_EBPF_H
+#define _CGROUP_V2_EBPF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	char type;		/* 'a', 'b' or 'c' */
+	int64_t major;		/* -1 for any */
+	int64_t minor;		/* -1 for any */
+	uint32_t access;	/* BPF_DEVCG_ACC_* bits */
+} ebpf_dev_rule_t;
+
+/*
+ * Device access of one cgroup, enforced by a BPF_PROG_TYPE_CGROUP_DEVICE
+ * program. As with a v1 devices cgroup which allows everything by default,
+ * only the denied devices are kept, and allowing a device drops its deny.
+ * The program is attached with BPF_F_ALLOW_MULTI, so the programs of the
+ * parent cgroups keep being enforced as in the v1 devices hierarchy.
+ */
+typedef struct {
+	int prog_fd;		/* attached program, -1 if none */
+	int rule_cnt;
+	ebpf_dev_rule_t *rules;	/* denied devices */
+} ebpf_dev_filter_t;
+
+extern void ebpf_dev_filter_init(ebpf_dev_filter_t *filter);
+
+/*
+ * Release the filter. The program stays attached until the cgroup is
+ * removed.
+ */
+extern void ebpf_dev_filter_free(ebpf_dev_filter_t *filter);
+
+/*
+ * Allow or deny the device described by dev, a "<type> <major>:<minor>
+ * <access>" string as written to the v1 devices.allow and devices.deny files
+ * (e.g. "c 195:0 rwm").
+ * RET SLURM_SUCCESS or SLURM_ERROR if dev can not be parsed.
+ */
+extern int ebpf_dev_filter_update(ebpf_dev_filter_t *filter, bool allow,
+				  char *dev);
+
+/*
+ * Load a program for the current rules and attach it to the cgroup directory
+ * path, replacing the device programs previously attached to it.
+ * RET SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int ebpf_dev_filter_attach(ebpf_dev_filter_t *filter, char *path);
+
+#endif /* !_CGROUP_V2_EBPF_H */
@@ -94,22 +94,41 @@ const char plugin_name[]       	= "Job submit lua plugin";
 const char plugin_type[]       	= "job_submit/lua";
 const uint32_t plugin_version   = SLURM_VERSION_NUMBER;
 
+#define MAX_LUA_STATES 64
+
+/*
+ * Each Lua state loads the script on its own, so calls from different
+ * threads can run in parallel in different states. Only one thread at a
+ * time uses a given state. Script globals are kept per state, so a script
+ * must not count on them to carry data from one call to the next.
+ */
+typedef struct {
+	bool busy;
+	lua_State *L;
+	time_t resv_update;	/* slurm.reservations built at this time */
+#if LUA_VERSION_NUM == 501
+	time_t jobs_update;	/* slurm.jobs built at this time */
+#endif
+	time_t script_last_loaded;
+} lua_submit_state_t;
+
 static char *lua_script_path;
-static time_t lua_script_last_loaded = (time_t) 0;
-static lua_State *L = NULL;
-static char *user_msg = NULL;
-time_t last_lua_jobs_update = (time_t) 0;
-time_t last_lua_resv_update = (time_t) 0;
+static lua_submit_state_t *lua_states = NULL;
+static int lua_state_cnt = 1;
+/* State in use by the current thread */
+static __thread lua_submit_state_t *curr_state = NULL;
+static __thread lua_State *L = NULL;
+static __thread char *user_msg = NULL;
 static const char *req_fxns[] = {
 	"slurm_job_submit",
 	"slurm_job_modify",
 	NULL
 };
 /*
- *  Mutex for protecting multi-threaded access to this plugin.
- *   (Only 1 thread at a time should be in here)
+ *  Mutex and condition protecting the busy flag of each Lua state.
  */
 static pthread_mutex_t lua_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lua_cond = PTHREAD_COND_INITIALIZER;
 
 /* These are defined here so when we link with something other than
  * the slurmctld we will have these symbols defined.  They will get
@@ -190,49 +209,173 @@ static int _job_rec_field_index(lua_State *L)
 	return slurm_lua_job_record_field(L, job_ptr, name);
 }
 
-/* Get the list of existing slurmctld job records. */
-static void _update_jobs_global(lua_State *st)
+static void _push_job_rec(lua_State *st, job_record_t *job_ptr)
+{
+	lua_newtable(st);
+
+	lua_newtable(st);
+	lua_pushcfunction(st, _job_rec_field_index);
+	lua_setfield(st, -2, "__index");
+	/* Store the job_ptr in the metatable, so the index
+	 * function knows which struct it's getting data for.
+	 */
+	lua_pushlightuserdata(st, job_ptr);
+	lua_setfield(st, -2, "_job_rec_ptr");
+	lua_setmetatable(st, -2);
+}
+
+/* Push a table of every job record, keyed by the job id as a string */
+static void _push_jobs_table(lua_State *st)
 {
 	char job_id_buf[11]; /* Big enough for a uint32_t */
 	ListIterator iter;
 	job_record_t *job_ptr;
 
-	if (last_lua_jobs_update >= last_job_update) {
-		return;
-	}
-
-	lua_getglobal(st, "slurm");
 	lua_newtable(st);
 
 	iter = list_iterator_create(job_list);
 	while ((job_ptr = list_next(iter))) {
-		/* Create an empty table, with a metatable that looks up the
-		 * data for the individual job.
-		 */
-		lua_newtable(st);
-
-		lua_newtable(st);
-		lua_pushcfunction(st, _job_rec_field_index);
-		lua_setfield(st, -2, "__index");
-		/* Store the job_record in the metatable, so the index
-		 * function knows which job it's getting data for.
-		 */
-		lua_pushlightuserdata(st, job_ptr);
-		lua_setfield(st, -2, "_job_rec_ptr");
-		lua_setmetatable(st, -2);
-
+		_push_job_rec(st, job_ptr);
 		/* Lua copies passed strings, so we can reuse the buffer. */
 		snprintf(job_id_buf, sizeof(job_id_buf),
-		         "%d", job_ptr->job_id);
+			 "%u", job_ptr->job_id);
 		lua_setfield(st, -2, job_id_buf);
 	}
-	last_lua_jobs_update = last_job_update;
 	list_iterator_destroy(iter);
+}
+
+#if LUA_VERSION_NUM == 501
+/*
+ * Lua 5.1 has no __pairs metamethod, so slurm.jobs has to be a real table for
+ * pairs() and next() to work. Rebuild it when the job list has changed.
+ */
+static void _update_jobs_global(lua_State *st)
+{
+	if (curr_state->jobs_update >= last_job_update)
+		return;
 
+	lua_getglobal(st, "slurm");
+	_push_jobs_table(st);
 	lua_setfield(st, -2, "jobs");
 	lua_pop(st, 1);
+
+	curr_state->jobs_update = last_job_update;
+}
+
+static void _register_jobs_global(lua_State *st)
+{
+	curr_state->jobs_update = 0;
+	_update_jobs_global(st);
+}
+#else
+/*
+ * Look up slurm.jobs[job_id]. The job is resolved through find_job_record()
+ * on each access rather than kept in the table, so no proxy can outlive its
+ * job_record and nothing has to be rebuilt when the job list changes.
+ */
+static int _jobs_index(lua_State *L)
+{
+	lua_Number id;
+	job_record_t *job_ptr = NULL;
+
+	if (lua_isnumber(L, 2)) {
+		id = lua_tonumber(L, 2);
+		if ((id >= 1) && (id < NO_VAL))
+			job_ptr = find_job_record((uint32_t) id);
+	}
+
+	if (job_ptr)
+		_push_job_rec(L, job_ptr);
+	else
+		lua_pushnil(L);
+
+	return 1;
 }
 
+/*
+ * Push the snapshot of all jobs used to iterate over slurm.jobs. It is built
+ * on the first iteration of a job_submit or job_modify call and kept in the
+ * registry until _update_jobs_global() drops it at the next call.
+ */
+static void _push_jobs_snapshot(lua_State *st)
+{
+	lua_getfield(st, LUA_REGISTRYINDEX, "_slurm_jobs_snapshot");
+	if (!lua_isnil(st, -1))
+		return;
+
+	lua_pop(st, 1);
+	_push_jobs_table(st);
+	lua_pushvalue(st, -1);
+	lua_setfield(st, LUA_REGISTRYINDEX, "_slurm_jobs_snapshot");
+}
+
+/*
+ * Replacement for the global next(): next(slurm.jobs, key) walks the job
+ * snapshot, any other table goes to the original next() (upvalue 1).
+ */
+static int _jobs_next(lua_State *L)
+{
+	lua_settop(L, 2);
+	lua_getfield(L, LUA_REGISTRYINDEX, "_slurm_jobs");
+	if (lua_rawequal(L, 1, -1)) {
+		lua_pop(L, 1);
+		_push_jobs_snapshot(L);
+		lua_replace(L, 1);
+	} else
+		lua_pop(L, 1);
+
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_insert(L, 1);
+	lua_call(L, 2, LUA_MULTRET);
+
+	return lua_gettop(L);
+}
+
+/* pairs(slurm.jobs): iterate over the job snapshot with the original next() */
+static int _jobs_pairs(lua_State *L)
+{
+	lua_pushvalue(L, lua_upvalueindex(1));
+	_push_jobs_snapshot(L);
+	lua_pushnil(L);
+
+	return 3;
+}
+
+/* Drop the job snapshot of the previous call, the job list may have changed */
+static void _update_jobs_global(lua_State *st)
+{
+	lua_pushnil(st);
+	lua_setfield(st, LUA_REGISTRYINDEX, "_slurm_jobs_snapshot");
+}
+
+/* Register slurm.jobs, a proxy for the existing slurmctld job records. */
+static void _register_jobs_global(lua_State *st)
+{
+	lua_getglobal(st, "slurm");
+	lua_newtable(st);
+
+	lua_newtable(st);
+	lua_pushcfunction(st, _jobs_index);
+	lua_setfield(st, -2, "__index");
+	lua_getglobal(st, "next");
+	lua_pushcclosure(st, _jobs_pairs, 1);
+	lua_setfield(st, -2, "__pairs");
+	lua_setmetatable(st, -2);
+
+	/* Remember the proxy so _jobs_next() can recognize it */
+	lua_pushvalue(st, -1);
+	lua_setfield(st, LUA_REGISTRYINDEX, "_slurm_jobs");
+	lua_setfield(st, -2, "jobs");
+	lua_pop(st, 1);
+
+	lua_getglobal(st, "next");
+	lua_pushcclosure(st, _jobs_next, 1);
+	lua_setglobal(st, "next");
+
+	_update_jobs_global(st);
+}
+#endif
+
 static int _resv_field(const slurmctld_resv_t *resv_ptr,
                        const char *name)
 {
@@ -297,7 +440,7 @@ static void _update_resvs_global(lua_State *st)
 	ListIterator iter;
 	slurmctld_resv_t *resv_ptr;
 
-	if (last_lua_resv_update >= last_resv_update) {
+	if (curr_state->resv_update >= last_resv_update) {
 		return;
 	}
 
@@ -323,7 +466,7 @@ static void _update_resvs_global(lua_State *st)
 
 		lua_setfield(st, -2, resv_ptr->name);
 	}
-	last_lua_resv_update = last_resv_update;
+	curr_state->resv_update = last_resv_update;
 	list_iterator_destroy(iter);
 
 	lua_setfield(st, -2, "reservations");
@@ -446,6 +589,229 @@ static void _push_job_env(job_desc_msg_t *job_desc)
 	lua_setmetatable(L, -2);
 }
 
+typedef enum {
+	JOB_DESC_FIELD_UNKNOWN = 0,
+	JOB_DESC_FIELD_ACCOUNT,
+	JOB_DESC_FIELD_ACCTG_FREQ,
+	JOB_DESC_FIELD_ADMIN_COMMENT,
+	JOB_DESC_FIELD_ALLOC_NODE,
+	JOB_DESC_FIELD_ARGC,
+	JOB_DESC_FIELD_ARGV,
+	JOB_DESC_FIELD_ARRAY_INX,
+	JOB_DESC_FIELD_BATCH_FEATURES,
+	JOB_DESC_FIELD_BEGIN_TIME,
+	JOB_DESC_FIELD_BITFLAGS,
+	JOB_DESC_FIELD_BOARDS_PER_NODE,
+	JOB_DESC_FIELD_BURST_BUFFER,
+	JOB_DESC_FIELD_CLUSTERS,
+	JOB_DESC_FIELD_COMMENT,
+	JOB_DESC_FIELD_CONTAINER,
+	JOB_DESC_FIELD_CONTIGUOUS,
+	JOB_DESC_FIELD_CORES_PER_SOCKET,
+	JOB_DESC_FIELD_CPU_FREQ_MIN,
+	JOB_DESC_FIELD_CPU_FREQ_MAX,
+	JOB_DESC_FIELD_CPU_FREQ_GOV,
+	JOB_DESC_FIELD_CPUS_PER_TASK,
+	JOB_DESC_FIELD_CPUS_PER_TRES,
+	JOB_DESC_FIELD_CRON_JOB,
+	JOB_DESC_FIELD_DEFAULT_ACCOUNT,
+	JOB_DESC_FIELD_DEFAULT_QOS,
+	JOB_DESC_FIELD_DELAY_BOOT,
+	JOB_DESC_FIELD_DEPENDENCY,
+	JOB_DESC_FIELD_END_TIME,
+	JOB_DESC_FIELD_ENVIRONMENT,
+	JOB_DESC_FIELD_EXTRA,
+	JOB_DESC_FIELD_EXC_NODES,
+	JOB_DESC_FIELD_FEATURES,
+	JOB_DESC_FIELD_GRES,
+	JOB_DESC_FIELD_GROUP_ID,
+	JOB_DESC_FIELD_IMMEDIATE,
+	JOB_DESC_FIELD_LICENSES,
+	JOB_DESC_FIELD_MAIL_TYPE,
+	JOB_DESC_FIELD_MAIL_USER,
+	JOB_DESC_FIELD_MAX_CPUS,
+	JOB_DESC_FIELD_MAX_NODES,
+	JOB_DESC_FIELD_MEM_PER_TRES,
+	JOB_DESC_FIELD_MIN_CPUS,
+	JOB_DESC_FIELD_MIN_MEM_PER_NODE,
+	JOB_DESC_FIELD_MIN_MEM_PER_CPU,
+	JOB_DESC_FIELD_MIN_NODES,
+	JOB_DESC_FIELD_NAME,
+	JOB_DESC_FIELD_NETWORK,
+	JOB_DESC_FIELD_NICE,
+	JOB_DESC_FIELD_NTASKS_PER_BOARD,
+	JOB_DESC_FIELD_NTASKS_PER_CORE,
+	JOB_DESC_FIELD_NTASKS_PER_GPU,
+	JOB_DESC_FIELD_NTASKS_PER_NODE,
+	JOB_DESC_FIELD_NTASKS_PER_SOCKET,
+	JOB_DESC_FIELD_NTASKS_PER_TRES,
+	JOB_DESC_FIELD_NUM_TASKS,
+	JOB_DESC_FIELD_HET_JOB_OFFSET,
+	JOB_DESC_FIELD_PARTITION,
+	JOB_DESC_FIELD_POWER_FLAGS,
+	JOB_DESC_FIELD_PN_MIN_CPUS,
+	JOB_DESC_FIELD_PN_MIN_MEMORY,
+	JOB_DESC_FIELD_PN_MIN_TMP_DISK,
+	JOB_DESC_FIELD_PRIORITY,
+	JOB_DESC_FIELD_QOS,
+	JOB_DESC_FIELD_REBOOT,
+	JOB_DESC_FIELD_REQ_CONTEXT,
+	JOB_DESC_FIELD_REQ_NODES,
+	JOB_DESC_FIELD_REQ_SWITCH,
+	JOB_DESC_FIELD_REQUEUE,
+	JOB_DESC_FIELD_RESERVATION,
+	JOB_DESC_FIELD_SCRIPT,
+	JOB_DESC_FIELD_SHARED,
+	JOB_DESC_FIELD_SITE_FACTOR,
+	JOB_DESC_FIELD_SOCKETS_PER_BOARD,
+	JOB_DESC_FIELD_SOCKETS_PER_NODE,
+	JOB_DESC_FIELD_SPANK_JOB_ENV,
+	JOB_DESC_FIELD_SPANK_JOB_ENV_SIZE,
+	JOB_DESC_FIELD_STD_ERR,
+	JOB_DESC_FIELD_STD_IN,
+	JOB_DESC_FIELD_STD_OUT,
+	JOB_DESC_FIELD_THREADS_PER_CORE,
+	JOB_DESC_FIELD_TIME_LIMIT,
+	JOB_DESC_FIELD_TIME_MIN,
+	JOB_DESC_FIELD_TRES_BIND,
+	JOB_DESC_FIELD_TRES_FREQ,
+	JOB_DESC_FIELD_TRES_PER_JOB,
+	JOB_DESC_FIELD_TRES_PER_NODE,
+	JOB_DESC_FIELD_TRES_PER_SOCKET,
+	JOB_DESC_FIELD_TRES_PER_TASK,
+	JOB_DESC_FIELD_USER_ID,
+	JOB_DESC_FIELD_USER_NAME,
+	JOB_DESC_FIELD_WAIT4SWITCH,
+	JOB_DESC_FIELD_WORK_DIR,
+	JOB_DESC_FIELD_WCKEY,
+} job_desc_field_t;
+
+/*
+ * Job descriptor field names, sorted by name so that _job_desc_field_lookup()
+ * can bsearch() them rather than walking a chain of string compares on every
+ * access from the Lua script. Keep this table sorted when adding fields.
+ */
+typedef struct {
+	const char *name;
+	job_desc_field_t field;
+} job_desc_field_name_t;
+
+static const job_desc_field_name_t job_desc_fields[] = {
+	{ "account", JOB_DESC_FIELD_ACCOUNT },
+	{ "acctg_freq", JOB_DESC_FIELD_ACCTG_FREQ },
+	{ "admin_comment", JOB_DESC_FIELD_ADMIN_COMMENT },
+	{ "alloc_node", JOB_DESC_FIELD_ALLOC_NODE },
+	{ "argc", JOB_DESC_FIELD_ARGC },
+	{ "argv", JOB_DESC_FIELD_ARGV },
+	{ "array_inx", JOB_DESC_FIELD_ARRAY_INX },
+	{ "batch_features", JOB_DESC_FIELD_BATCH_FEATURES },
+	{ "begin_time", JOB_DESC_FIELD_BEGIN_TIME },
+	{ "bitflags", JOB_DESC_FIELD_BITFLAGS },
+	{ "boards_per_node", JOB_DESC_FIELD_BOARDS_PER_NODE },
+	{ "burst_buffer", JOB_DESC_FIELD_BURST_BUFFER },
+	{ "clusters", JOB_DESC_FIELD_CLUSTERS },
+	{ "comment", JOB_DESC_FIELD_COMMENT },
+	{ "container", JOB_DESC_FIELD_CONTAINER },
+	{ "contiguous", JOB_DESC_FIELD_CONTIGUOUS },
+	{ "cores_per_socket", JOB_DESC_FIELD_CORES_PER_SOCKET },
+	{ "cpu_freq_gov", JOB_DESC_FIELD_CPU_FREQ_GOV },
+	{ "cpu_freq_max", JOB_DESC_FIELD_CPU_FREQ_MAX },
+	{ "cpu_freq_min", JOB_DESC_FIELD_CPU_FREQ_MIN },
+	{ "cpus_per_task", JOB_DESC_FIELD_CPUS_PER_TASK },
+	{ "cpus_per_tres", JOB_DESC_FIELD_CPUS_PER_TRES },
+	{ "cron_job", JOB_DESC_FIELD_CRON_JOB },
+	{ "default_account", JOB_DESC_FIELD_DEFAULT_ACCOUNT },
+	{ "default_qos", JOB_DESC_FIELD_DEFAULT_QOS },
+	{ "delay_boot", JOB_DESC_FIELD_DELAY_BOOT },
+	{ "dependency", JOB_DESC_FIELD_DEPENDENCY },
+	{ "end_time", JOB_DESC_FIELD_END_TIME },
+	{ "environment", JOB_DESC_FIELD_ENVIRONMENT },
+	{ "exc_nodes", JOB_DESC_FIELD_EXC_NODES },
+	{ "extra", JOB_DESC_FIELD_EXTRA },
+	{ "features", JOB_DESC_FIELD_FEATURES },
+	{ "gres", JOB_DESC_FIELD_GRES },
+	{ "group_id", JOB_DESC_FIELD_GROUP_ID },
+	{ "het_job_offset", JOB_DESC_FIELD_HET_JOB_OFFSET },
+	{ "immediate", JOB_DESC_FIELD_IMMEDIATE },
+	{ "licenses", JOB_DESC_FIELD_LICENSES },
+	{ "mail_type", JOB_DESC_FIELD_MAIL_TYPE },
+	{ "mail_user", JOB_DESC_FIELD_MAIL_USER },
+	{ "max_cpus", JOB_DESC_FIELD_MAX_CPUS },
+	{ "max_nodes", JOB_DESC_FIELD_MAX_NODES },
+	{ "mem_per_tres", JOB_DESC_FIELD_MEM_PER_TRES },
+	{ "min_cpus", JOB_DESC_FIELD_MIN_CPUS },
+	{ "min_mem_per_cpu", JOB_DESC_FIELD_MIN_MEM_PER_CPU },
+	{ "min_mem_per_node", JOB_DESC_FIELD_MIN_MEM_PER_NODE },
+	{ "min_nodes", JOB_DESC_FIELD_MIN_NODES },
+	{ "name", JOB_DESC_FIELD_NAME },
+	{ "network", JOB_DESC_FIELD_NETWORK },
+	{ "nice", JOB_DESC_FIELD_NICE },
+	{ "ntasks_per_board", JOB_DESC_FIELD_NTASKS_PER_BOARD },
+	{ "ntasks_per_core", JOB_DESC_FIELD_NTASKS_PER_CORE },
+	{ "ntasks_per_gpu", JOB_DESC_FIELD_NTASKS_PER_GPU },
+	{ "ntasks_per_node", JOB_DESC_FIELD_NTASKS_PER_NODE },
+	{ "ntasks_per_socket", JOB_DESC_FIELD_NTASKS_PER_SOCKET },
+	{ "ntasks_per_tres", JOB_DESC_FIELD_NTASKS_PER_TRES },
+	{ "num_tasks", JOB_DESC_FIELD_NUM_TASKS },
+	{ "oversubscribe", JOB_DESC_FIELD_SHARED },
+	{ "pack_job_offset", JOB_DESC_FIELD_HET_JOB_OFFSET },
+	{ "partition", JOB_DESC_FIELD_PARTITION },
+	{ "pn_min_cpus", JOB_DESC_FIELD_PN_MIN_CPUS },
+	{ "pn_min_memory", JOB_DESC_FIELD_PN_MIN_MEMORY },
+	{ "pn_min_tmp_disk", JOB_DESC_FIELD_PN_MIN_TMP_DISK },
+	{ "power_flags", JOB_DESC_FIELD_POWER_FLAGS },
+	{ "priority", JOB_DESC_FIELD_PRIORITY },
+	{ "qos", JOB_DESC_FIELD_QOS },
+	{ "reboot", JOB_DESC_FIELD_REBOOT },
+	{ "req_context", JOB_DESC_FIELD_REQ_CONTEXT },
+	{ "req_nodes", JOB_DESC_FIELD_REQ_NODES },
+	{ "req_switch", JOB_DESC_FIELD_REQ_SWITCH },
+	{ "requeue", JOB_DESC_FIELD_REQUEUE },
+	{ "reservation", JOB_DESC_FIELD_RESERVATION },
+	{ "script", JOB_DESC_FIELD_SCRIPT },
+	{ "shared", JOB_DESC_FIELD_SHARED },
+	{ "site_factor", JOB_DESC_FIELD_SITE_FACTOR },
+	{ "sockets_per_board", JOB_DESC_FIELD_SOCKETS_PER_BOARD },
+	{ "sockets_per_node", JOB_DESC_FIELD_SOCKETS_PER_NODE },
+	{ "spank_job_env", JOB_DESC_FIELD_SPANK_JOB_ENV },
+	{ "spank_job_env_size", JOB_DESC_FIELD_SPANK_JOB_ENV_SIZE },
+	{ "std_err", JOB_DESC_FIELD_STD_ERR },
+	{ "std_in", JOB_DESC_FIELD_STD_IN },
+	{ "std_out", JOB_DESC_FIELD_STD_OUT },
+	{ "threads_per_core", JOB_DESC_FIELD_THREADS_PER_CORE },
+	{ "time_limit", JOB_DESC_FIELD_TIME_LIMIT },
+	{ "time_min", JOB_DESC_FIELD_TIME_MIN },
+	{ "tres_bind", JOB_DESC_FIELD_TRES_BIND },
+	{ "tres_freq", JOB_DESC_FIELD_TRES_FREQ },
+	{ "tres_per_job", JOB_DESC_FIELD_TRES_PER_JOB },
+	{ "tres_per_node", JOB_DESC_FIELD_TRES_PER_NODE },
+	{ "tres_per_socket", JOB_DESC_FIELD_TRES_PER_SOCKET },
+	{ "tres_per_task", JOB_DESC_FIELD_TRES_PER_TASK },
+	{ "user_id", JOB_DESC_FIELD_USER_ID },
+	{ "user_name", JOB_DESC_FIELD_USER_NAME },
+	{ "wait4switch", JOB_DESC_FIELD_WAIT4SWITCH },
+	{ "wckey", JOB_DESC_FIELD_WCKEY },
+	{ "work_dir", JOB_DESC_FIELD_WORK_DIR },
+};
+
+static int _job_desc_field_cmp(const void *key, const void *elem)
+{
+	return strcmp(key, ((const job_desc_field_name_t *) elem)->name);
+}
+
+static job_desc_field_t _job_desc_field_lookup(const char *name)
+{
+	const job_desc_field_name_t *match;
+
+	if (!name)
+		return JOB_DESC_FIELD_UNKNOWN;
+	match = bsearch(name, job_desc_fields, ARRAY_SIZE(job_desc_fields),
+			sizeof(job_desc_fields[0]), _job_desc_field_cmp);
+	if (!match)
+		return JOB_DESC_FIELD_UNKNOWN;
+	return match->field;
+}
+
 static int _get_job_req_field(const job_desc_msg_t *job_desc, const char *name)
 {
 	int i;
@@ -453,17 +819,26 @@ static int _get_job_req_field(const job_desc_msg_t *job_desc, const char *name)
 	if (job_desc == NULL) {
 		error("%s: job_desc is NULL", __func__);
 		lua_pushnil(L);
-	} else if (!xstrcmp(name, "account")) {
+		return 1;
+	}
+
+	switch (_job_desc_field_lookup(name)) {
+	case JOB_DESC_FIELD_ACCOUNT:
 		lua_pushstring(L, job_desc->account);
-	} else if (!xstrcmp(name, "acctg_freq")) {
+		break;
+	case JOB_DESC_FIELD_ACCTG_FREQ:
 		lua_pushstring(L, job_desc->acctg_freq);
-	} else if (!xstrcmp(name, "admin_comment")) {
+		break;
+	case JOB_DESC_FIELD_ADMIN_COMMENT:
 		lua_pushstring(L, job_desc->admin_comment);
-	} else if (!xstrcmp(name, "alloc_node")) {
+		break;
+	case JOB_DESC_FIELD_ALLOC_NODE:
 		lua_pushstring(L, job_desc->alloc_node);
-	} else if (!xstrcmp(name, "argc")) {
+		break;
+	case JOB_DESC_FIELD_ARGC:
 		lua_pushnumber(L, job_desc->argc);
-	} else if (!xstrcmp(name, "argv")) {
+		break;
+	case JOB_DESC_FIELD_ARGV:
 		if ((job_desc->argc == 0) ||
 		    (job_desc->argv == NULL)) {
 			lua_pushnil(L);
@@ -477,162 +852,235 @@ static int _get_job_req_field(const job_desc_msg_t *job_desc, const char *name)
 				}
 			}
 		}
-	} else if (!xstrcmp(name, "array_inx")) {
+		break;
+	case JOB_DESC_FIELD_ARRAY_INX:
 		lua_pushstring(L, job_desc->array_inx);
-	} else if (!xstrcmp(name, "batch_features")) {
+		break;
+	case JOB_DESC_FIELD_BATCH_FEATURES:
 		lua_pushstring(L, job_desc->batch_features);
-	} else if (!xstrcmp(name, "begin_time")) {
+		break;
+	case JOB_DESC_FIELD_BEGIN_TIME:
 		lua_pushnumber(L, job_desc->begin_time);
-	} else if (!xstrcmp(name, "bitflags")) {
+		break;
+	case JOB_DESC_FIELD_BITFLAGS:
 		lua_pushnumber(L, job_desc->bitflags);
-	} else if (!xstrcmp(name, "boards_per_node")) {
+		break;
+	case JOB_DESC_FIELD_BOARDS_PER_NODE:
 		lua_pushnumber(L, job_desc->boards_per_node);
-	} else if (!xstrcmp(name, "burst_buffer")) {
+		break;
+	case JOB_DESC_FIELD_BURST_BUFFER:
 		lua_pushstring(L, job_desc->burst_buffer);
-	} else if (!xstrcmp(name, "clusters")) {
+		break;
+	case JOB_DESC_FIELD_CLUSTERS:
 		lua_pushstring(L, job_desc->clusters);
-	} else if (!xstrcmp(name, "comment")) {
+		break;
+	case JOB_DESC_FIELD_COMMENT:
 		lua_pushstring(L, job_desc->comment);
-	} else if (!xstrcmp(name, "container")) {
+		break;
+	case JOB_DESC_FIELD_CONTAINER:
 		lua_pushstring(L, job_desc->container);
-	} else if (!xstrcmp(name, "contiguous")) {
+		break;
+	case JOB_DESC_FIELD_CONTIGUOUS:
 		lua_pushnumber(L, job_desc->contiguous);
-	} else if (!xstrcmp(name, "cores_per_socket")) {
+		break;
+	case JOB_DESC_FIELD_CORES_PER_SOCKET:
 		lua_pushnumber(L, job_desc->cores_per_socket);
-	} else if (!xstrcmp(name, "cpu_freq_min")) {
+		break;
+	case JOB_DESC_FIELD_CPU_FREQ_MIN:
 		lua_pushnumber(L, job_desc->cpu_freq_min);
-	} else if (!xstrcmp(name, "cpu_freq_max")) {
+		break;
+	case JOB_DESC_FIELD_CPU_FREQ_MAX:
 		lua_pushnumber(L, job_desc->cpu_freq_max);
-	} else if (!xstrcmp(name, "cpu_freq_gov")) {
+		break;
+	case JOB_DESC_FIELD_CPU_FREQ_GOV:
 		lua_pushnumber(L, job_desc->cpu_freq_gov);
-	} else if (!xstrcmp(name, "cpus_per_task")) {
+		break;
+	case JOB_DESC_FIELD_CPUS_PER_TASK:
 		lua_pushnumber(L, job_desc->cpus_per_task);
-	} else if (!xstrcmp(name, "cpus_per_tres")) {
+		break;
+	case JOB_DESC_FIELD_CPUS_PER_TRES:
 		lua_pushstring(L, job_desc->cpus_per_tres);
-	} else if (!xstrcmp(name, "cron_job")) {
+		break;
+	case JOB_DESC_FIELD_CRON_JOB:
 		lua_pushboolean(L, job_desc->bitflags & CRON_JOB);
-	} else if (!xstrcmp(name, "default_account")) {
+		break;
+	case JOB_DESC_FIELD_DEFAULT_ACCOUNT:
 		lua_pushstring(L, _get_default_account(job_desc->user_id));
-	} else if (!xstrcmp(name, "default_qos")) {
+		break;
+	case JOB_DESC_FIELD_DEFAULT_QOS:
 		lua_pushstring(L, _get_default_qos(job_desc->user_id,
 						   job_desc->account,
 						   job_desc->partition));
-	} else if (!xstrcmp(name, "delay_boot")) {
+		break;
+	case JOB_DESC_FIELD_DELAY_BOOT:
 		lua_pushnumber(L, job_desc->delay_boot);
-	} else if (!xstrcmp(name, "dependency")) {
+		break;
+	case JOB_DESC_FIELD_DEPENDENCY:
 		lua_pushstring(L, job_desc->dependency);
-	} else if (!xstrcmp(name, "end_time")) {
+		break;
+	case JOB_DESC_FIELD_END_TIME:
 		lua_pushnumber(L, job_desc->end_time);
-	} else if (!xstrcmp(name, "environment")) {
+		break;
+	case JOB_DESC_FIELD_ENVIRONMENT:
 		_push_job_env((job_desc_msg_t *) job_desc); // No const
-	} else if (!xstrcmp(name, "extra")) {
+		break;
+	case JOB_DESC_FIELD_EXTRA:
 		lua_pushstring(L, job_desc->extra);
-	} else if (!xstrcmp(name, "exc_nodes")) {
+		break;
+	case JOB_DESC_FIELD_EXC_NODES:
 		lua_pushstring(L, job_desc->exc_nodes);
-	} else if (!xstrcmp(name, "features")) {
+		break;
+	case JOB_DESC_FIELD_FEATURES:
 		lua_pushstring(L, job_desc->features);
-	} else if (!xstrcmp(name, "gres")) {
+		break;
+	case JOB_DESC_FIELD_GRES:
 		/* "gres" replaced by "tres_per_node" in v18.08 */
 		lua_pushstring(L, job_desc->tres_per_node);
-	} else if (!xstrcmp(name, "group_id")) {
+		break;
+	case JOB_DESC_FIELD_GROUP_ID:
 		lua_pushnumber(L, job_desc->group_id);
-	} else if (!xstrcmp(name, "immediate")) {
+		break;
+	case JOB_DESC_FIELD_IMMEDIATE:
 		lua_pushnumber(L, job_desc->immediate);
-	} else if (!xstrcmp(name, "licenses")) {
+		break;
+	case JOB_DESC_FIELD_LICENSES:
 		lua_pushstring(L, job_desc->licenses);
-	} else if (!xstrcmp(name, "mail_type")) {
+		break;
+	case JOB_DESC_FIELD_MAIL_TYPE:
 		lua_pushnumber(L, job_desc->mail_type);
-	} else if (!xstrcmp(name, "mail_user")) {
+		break;
+	case JOB_DESC_FIELD_MAIL_USER:
 		lua_pushstring(L, job_desc->mail_user);
-	} else if (!xstrcmp(name, "max_cpus")) {
+		break;
+	case JOB_DESC_FIELD_MAX_CPUS:
 		lua_pushnumber(L, job_desc->max_cpus);
-	} else if (!xstrcmp(name, "max_nodes")) {
+		break;
+	case JOB_DESC_FIELD_MAX_NODES:
 		lua_pushnumber(L, job_desc->max_nodes);
-	} else if (!xstrcmp(name, "mem_per_tres")) {
+		break;
+	case JOB_DESC_FIELD_MEM_PER_TRES:
 		lua_pushstring(L, job_desc->mem_per_tres);
-	} else if (!xstrcmp(name, "min_cpus")) {
+		break;
+	case JOB_DESC_FIELD_MIN_CPUS:
 		lua_pushnumber(L, job_desc->min_cpus);
-	} else if (!xstrcmp(name, "min_mem_per_node") &&
-		   (job_desc->pn_min_memory != NO_VAL64) &&
-		   !(job_desc->pn_min_memory & MEM_PER_CPU)) {
-		lua_pushnumber(L, job_desc->pn_min_memory);
-	} else if (!xstrcmp(name, "min_mem_per_cpu") &&
-		   (job_desc->pn_min_memory != NO_VAL64) &&
-		   (job_desc->pn_min_memory & MEM_PER_CPU)) {
-		lua_pushnumber(L, (job_desc->pn_min_memory & (~MEM_PER_CPU)));
-	} else if (!xstrcmp(name, "min_nodes")) {
+		break;
+	case JOB_DESC_FIELD_MIN_MEM_PER_NODE:
+		if ((job_desc->pn_min_memory != NO_VAL64) &&
+		    !(job_desc->pn_min_memory & MEM_PER_CPU))
+			lua_pushnumber(L, job_desc->pn_min_memory);
+		else
+			lua_pushnil(L);
+		break;
+	case JOB_DESC_FIELD_MIN_MEM_PER_CPU:
+		if ((job_desc->pn_min_memory != NO_VAL64) &&
+		    (job_desc->pn_min_memory & MEM_PER_CPU))
+			lua_pushnumber(L, (job_desc->pn_min_memory &
+					   (~MEM_PER_CPU)));
+		else
+			lua_pushnil(L);
+		break;
+	case JOB_DESC_FIELD_MIN_NODES:
 		lua_pushnumber(L, job_desc->min_nodes);
-	} else if (!xstrcmp(name, "name")) {
+		break;
+	case JOB_DESC_FIELD_NAME:
 		lua_pushstring(L, job_desc->name);
-	} else if (!xstrcmp(name, "network")) {
+		break;
+	case JOB_DESC_FIELD_NETWORK:
 		lua_pushstring(L, job_desc->network);
-	} else if (!xstrcmp(name, "nice")) {
+		break;
+	case JOB_DESC_FIELD_NICE:
 		lua_pushnumber(L, job_desc->nice);
-	} else if (!xstrcmp(name, "ntasks_per_board")) {
+		break;
+	case JOB_DESC_FIELD_NTASKS_PER_BOARD:
 		lua_pushnumber(L, job_desc->ntasks_per_board);
-	} else if (!xstrcmp(name, "ntasks_per_core")) {
+		break;
+	case JOB_DESC_FIELD_NTASKS_PER_CORE:
 		lua_pushnumber(L, job_desc->ntasks_per_core);
-	} else if (!xstrcmp(name, "ntasks_per_gpu")) {
+		break;
+	case JOB_DESC_FIELD_NTASKS_PER_GPU:
 		lua_pushnumber(L, job_desc->ntasks_per_tres);
-	} else if (!xstrcmp(name, "ntasks_per_node")) {
+		break;
+	case JOB_DESC_FIELD_NTASKS_PER_NODE:
 		lua_pushnumber(L, job_desc->ntasks_per_node);
-	} else if (!xstrcmp(name, "ntasks_per_socket")) {
+		break;
+	case JOB_DESC_FIELD_NTASKS_PER_SOCKET:
 		lua_pushnumber(L, job_desc->ntasks_per_socket);
-	} else if (!xstrcmp(name, "ntasks_per_tres")) {
+		break;
+	case JOB_DESC_FIELD_NTASKS_PER_TRES:
 		lua_pushnumber(L, job_desc->ntasks_per_tres);
-	} else if (!xstrcmp(name, "num_tasks")) {
+		break;
+	case JOB_DESC_FIELD_NUM_TASKS:
 		lua_pushnumber(L, job_desc->num_tasks);
-		/* Continue support for old hetjob terminology. */
-	} else if (!xstrcmp(name, "pack_job_offset") ||
-		   !xstrcmp(name, "het_job_offset")) {
+		break;
+	case JOB_DESC_FIELD_HET_JOB_OFFSET:
+		/* Also "pack_job_offset", the old hetjob terminology. */
 		lua_pushnumber(L, job_desc->het_job_offset);
-	} else if (!xstrcmp(name, "partition")) {
+		break;
+	case JOB_DESC_FIELD_PARTITION:
 		lua_pushstring(L, job_desc->partition);
-	} else if (!xstrcmp(name, "power_flags")) {
+		break;
+	case JOB_DESC_FIELD_POWER_FLAGS:
 		lua_pushnumber(L, job_desc->power_flags);
-	} else if (!xstrcmp(name, "pn_min_cpus")) {
+		break;
+	case JOB_DESC_FIELD_PN_MIN_CPUS:
 		lua_pushnumber(L, job_desc->pn_min_cpus);
-	} else if (!xstrcmp(name, "pn_min_memory")) {
+		break;
+	case JOB_DESC_FIELD_PN_MIN_MEMORY:
 		/*
 		 * FIXME: Remove this in the future, lua can't handle 64bit
 		 * numbers!!!.  Use min_mem_per_node|cpu instead.
 		 */
 		lua_pushnumber(L, job_desc->pn_min_memory);
-	} else if (!xstrcmp(name, "pn_min_tmp_disk")) {
+		break;
+	case JOB_DESC_FIELD_PN_MIN_TMP_DISK:
 		lua_pushnumber(L, job_desc->pn_min_tmp_disk);
-	} else if (!xstrcmp(name, "priority")) {
+		break;
+	case JOB_DESC_FIELD_PRIORITY:
 		lua_pushnumber(L, job_desc->priority);
-	} else if (!xstrcmp(name, "qos")) {
+		break;
+	case JOB_DESC_FIELD_QOS:
 		lua_pushstring(L, job_desc->qos);
-	} else if (!xstrcmp(name, "reboot")) {
+		break;
+	case JOB_DESC_FIELD_REBOOT:
 		lua_pushnumber(L, job_desc->reboot);
-	} else if (!xstrcmp(name, "req_context")) {
+		break;
+	case JOB_DESC_FIELD_REQ_CONTEXT:
 		lua_pushstring(L, job_desc->req_context);
-	} else if (!xstrcmp(name, "req_nodes")) {
+		break;
+	case JOB_DESC_FIELD_REQ_NODES:
 		lua_pushstring(L, job_desc->req_nodes);
-	} else if (!xstrcmp(name, "req_switch")) {
+		break;
+	case JOB_DESC_FIELD_REQ_SWITCH:
 		lua_pushnumber(L, job_desc->req_switch);
-	} else if (!xstrcmp(name, "requeue")) {
+		break;
+	case JOB_DESC_FIELD_REQUEUE:
 		lua_pushnumber(L, job_desc->requeue);
-	} else if (!xstrcmp(name, "reservation")) {
+		break;
+	case JOB_DESC_FIELD_RESERVATION:
 		lua_pushstring(L, job_desc->reservation);
-	} else if (!xstrcmp(name, "script")) {
+		break;
+	case JOB_DESC_FIELD_SCRIPT:
 		lua_pushstring(L, job_desc->script);
-	} else if (!xstrcmp(name, "shared") ||
-		   !xstrcmp(name, "oversubscribe")) {
+		break;
+	case JOB_DESC_FIELD_SHARED:
+		/* Also "oversubscribe". */
 		lua_pushnumber(L, job_desc->shared);
-	} else if (!xstrcmp(name, "site_factor")) {
+		break;
+	case JOB_DESC_FIELD_SITE_FACTOR:
 		if (job_desc->site_factor == NO_VAL)
 			lua_pushnumber(L, job_desc->site_factor);
 		else
 			lua_pushnumber(L,
 				       (((int64_t)job_desc->site_factor)
 					- NICE_OFFSET));
-	} else if (!xstrcmp(name, "sockets_per_board")) {
+		break;
+	case JOB_DESC_FIELD_SOCKETS_PER_BOARD:
 		lua_pushnumber(L, job_desc->sockets_per_board);
-	} else if (!xstrcmp(name, "sockets_per_node")) {
+		break;
+	case JOB_DESC_FIELD_SOCKETS_PER_NODE:
 		lua_pushnumber(L, job_desc->sockets_per_node);
-	} else if (!xstrcmp(name, "spank_job_env")) {
+		break;
+	case JOB_DESC_FIELD_SPANK_JOB_ENV:
 		if ((job_desc->spank_job_env_size == 0) ||
 		    (job_desc->spank_job_env == NULL)) {
 			lua_pushnil(L);
@@ -647,46 +1095,66 @@ static int _get_job_req_field(const job_desc_msg_t *job_desc, const char *name)
 				}
 			}
 		}
-	} else if (!xstrcmp(name, "spank_job_env_size")) {
+		break;
+	case JOB_DESC_FIELD_SPANK_JOB_ENV_SIZE:
 		lua_pushnumber(L, job_desc->spank_job_env_size);
-	} else if (!xstrcmp(name, "std_err")) {
+		break;
+	case JOB_DESC_FIELD_STD_ERR:
 		lua_pushstring(L, job_desc->std_err);
-	} else if (!xstrcmp(name, "std_in")) {
+		break;
+	case JOB_DESC_FIELD_STD_IN:
 		lua_pushstring(L, job_desc->std_in);
-	} else if (!xstrcmp(name, "std_out")) {
+		break;
+	case JOB_DESC_FIELD_STD_OUT:
 		lua_pushstring(L, job_desc->std_out);
-	} else if (!xstrcmp(name, "threads_per_core")) {
+		break;
+	case JOB_DESC_FIELD_THREADS_PER_CORE:
 		lua_pushnumber(L, job_desc->threads_per_core);
-	} else if (!xstrcmp(name, "time_limit")) {
+		break;
+	case JOB_DESC_FIELD_TIME_LIMIT:
 		lua_pushnumber(L, job_desc->time_limit);
-	} else if (!xstrcmp(name, "time_min")) {
+		break;
+	case JOB_DESC_FIELD_TIME_MIN:
 		lua_pushnumber(L, job_desc->time_min);
-	} else if (!xstrcmp(name, "tres_bind")) {
+		break;
+	case JOB_DESC_FIELD_TRES_BIND:
 		lua_pushstring(L, job_desc->tres_bind);
-	} else if (!xstrcmp(name, "tres_freq")) {
+		break;
+	case JOB_DESC_FIELD_TRES_FREQ:
 		lua_pushstring(L, job_desc->tres_freq);
-	} else if (!xstrcmp(name, "tres_per_job")) {
+		break;
+	case JOB_DESC_FIELD_TRES_PER_JOB:
 		lua_pushstring(L, job_desc->tres_per_job);
-	} else if (!xstrcmp(name, "tres_per_node")) {
+		break;
+	case JOB_DESC_FIELD_TRES_PER_NODE:
 		lua_pushstring(L, job_desc->tres_per_node);
-	} else if (!xstrcmp(name, "tres_per_socket")) {
+		break;
+	case JOB_DESC_FIELD_TRES_PER_SOCKET:
 		lua_pushstring(L, job_desc->tres_per_socket);
-	} else if (!xstrcmp(name, "tres_per_task")) {
+		break;
+	case JOB_DESC_FIELD_TRES_PER_TASK:
 		lua_pushstring(L, job_desc->tres_per_task);
-	} else if (!xstrcmp(name, "user_id")) {
+		break;
+	case JOB_DESC_FIELD_USER_ID:
 		lua_pushnumber(L, job_desc->user_id);
-	} else if (!xstrcmp(name, "user_name")) {
+		break;
+	case JOB_DESC_FIELD_USER_NAME:
 		char *username = uid_to_string_or_null(job_desc->user_id);
 		lua_pushstring(L, username);
 		xfree(username);
-	} else if (!xstrcmp(name, "wait4switch")) {
+		break;
+	case JOB_DESC_FIELD_WAIT4SWITCH:
 		lua_pushnumber(L, job_desc->wait4switch);
-	} else if (!xstrcmp(name, "work_dir")) {
+		break;
+	case JOB_DESC_FIELD_WORK_DIR:
 		lua_pushstring(L, job_desc->work_dir);
-	} else if (!xstrcmp(name, "wckey")) {
+		break;
+	case JOB_DESC_FIELD_WCKEY:
 		lua_pushstring(L, job_desc->wckey);
-	} else {
+		break;
+	default:
 		lua_pushnil(L);
+		break;
 	}
 
 	return 1;
@@ -1012,21 +1480,6 @@ static void _push_job_desc(job_desc_msg_t *job_desc)
 	lua_setmetatable(L, -2);
 }
 
-static void _push_job_rec(job_record_t *job_ptr)
-{
-	lua_newtable(L);
-
-	lua_newtable(L);
-	lua_pushcfunction(L, _job_rec_field_index);
-	lua_setfield(L, -2, "__index");
-	/* Store the job_ptr in the metatable, so the index
-	 * function knows which struct it's getting data for.
-	 */
-	lua_pushlightuserdata(L, job_ptr);
-	lua_setfield(L, -2, "_job_rec_ptr");
-	lua_setmetatable(L, -2);
-}
-
 /* Get fields in an existing slurmctld partition record
  *
  * This is an incomplete list of partition record fields. Add more as needed
@@ -1232,9 +1685,8 @@ static void _register_local_output_functions(lua_State *L)
 	/* Must be always done after we register the slurm_functions */
 	lua_setglobal(L, "slurm");
 
-	last_lua_jobs_update = 0;
-	_update_jobs_global(L);
-	last_lua_resv_update = 0;
+	_register_jobs_global(L);
+	curr_state->resv_update = 0;
 	_update_resvs_global(L);
 }
 
@@ -1259,6 +1711,66 @@ static void _loadscript_extra(lua_State *st)
 	_register_lua_slurm_struct_functions(st);
 }
 
+static void _get_config(void)
+{
+	char *opt;
+
+	if ((opt = xstrcasestr(slurm_conf.sched_params,
+			       "job_submit_lua_states="))) {
+		lua_state_cnt = atoi(opt + strlen("job_submit_lua_states="));
+		if ((lua_state_cnt < 1) || (lua_state_cnt > MAX_LUA_STATES)) {
+			error("%s: invalid job_submit_lua_states, using 1",
+			      plugin_type);
+			lua_state_cnt = 1;
+		}
+	}
+	debug("%s: using %d Lua state(s)", plugin_type, lua_state_cnt);
+}
+
+/*
+ * Get an idle Lua state, waiting for one if all are busy, and make it the
+ * current state of this thread. The script is (re)loaded into the state as
+ * needed.
+ */
+static int _acquire_state(void)
+{
+	int i, rc;
+
+	slurm_mutex_lock(&lua_lock);
+	while (!curr_state) {
+		for (i = 0; i < lua_state_cnt; i++) {
+			if (!lua_states[i].busy) {
+				curr_state = &lua_states[i];
+				curr_state->busy = true;
+				break;
+			}
+		}
+		if (!curr_state)
+			slurm_cond_wait(&lua_cond, &lua_lock);
+	}
+	slurm_mutex_unlock(&lua_lock);
+
+	L = curr_state->L;
+	rc = slurm_lua_loadscript(&curr_state->L, "job_submit/lua",
+				  lua_script_path, req_fxns,
+				  &curr_state->script_last_loaded,
+				  _loadscript_extra);
+	L = curr_state->L;
+
+	return rc;
+}
+
+static void _release_state(void)
+{
+	slurm_mutex_lock(&lua_lock);
+	curr_state->busy = false;
+	slurm_cond_signal(&lua_cond);
+	slurm_mutex_unlock(&lua_lock);
+
+	curr_state = NULL;
+	L = NULL;
+}
+
 /*
  *  NOTE: The init callback should never be called multiple times,
  *   let alone called from multiple threads. Therefore, locking
@@ -1271,21 +1783,26 @@ int init(void)
 	if ((rc = slurm_lua_init()) != SLURM_SUCCESS)
 		return rc;
 	lua_script_path = get_extra_conf_path("job_submit.lua");
+	_get_config();
+	lua_states = xcalloc(lua_state_cnt, sizeof(*lua_states));
+
+	/* Load the first state now to report script errors at startup */
+	rc = _acquire_state();
+	_release_state();
 
-	return slurm_lua_loadscript(&L, "job_submit/lua",
-				    lua_script_path, req_fxns,
-				    &lua_script_last_loaded,
-				    _loadscript_extra);
+	return rc;
 }
 
 int fini(void)
 {
-	if (L) {
-		debug3("%s: Unloading Lua script", __func__);
-		lua_close(L);
-		L = NULL;
-		lua_script_last_loaded = 0;
+	for (int i = 0; i < lua_state_cnt; i++) {
+		if (lua_states && lua_states[i].L) {
+			debug3("%s: Unloading Lua script", __func__);
+			lua_close(lua_states[i].L);
+		}
 	}
+	xfree(lua_states);
+	lua_state_cnt = 1;
 	xfree(lua_script_path);
 
 	slurm_lua_fini();
@@ -1299,11 +1816,8 @@ extern int job_submit(job_desc_msg_t *job_desc, uint32_t submit_uid,
 		      char **err_msg)
 {
 	int rc;
-	slurm_mutex_lock (&lua_lock);
 
-	rc = slurm_lua_loadscript(&L, "job_submit/lua",
-				  lua_script_path, req_fxns,
-				  &lua_script_last_loaded, _loadscript_extra);
+	rc = _acquire_state();
 
 	if (rc != SLURM_SUCCESS)
 		goto out;
@@ -1344,7 +1858,7 @@ extern int job_submit(job_desc_msg_t *job_desc, uint32_t submit_uid,
 		user_msg = NULL;
 	}
 
-out:	slurm_mutex_unlock (&lua_lock);
+out:	_release_state();
 	return rc;
 }
 
@@ -1353,11 +1867,8 @@ extern int job_modify(job_desc_msg_t *job_desc, job_record_t *job_ptr,
 		      uint32_t submit_uid)
 {
 	int rc;
-	slurm_mutex_lock (&lua_lock);
 
-	rc = slurm_lua_loadscript(&L, "job_submit/lua",
-				  lua_script_path, req_fxns,
-				  &lua_script_last_loaded, _loadscript_extra);
+	rc = _acquire_state();
 
 	if (rc == SLURM_ERROR)
 		goto out;
@@ -1374,7 +1885,7 @@ extern int job_modify(job_desc_msg_t *job_desc, job_record_t *job_ptr,
 	_update_resvs_global(L);
 
 	_push_job_desc(job_desc);
-	_push_job_rec(job_ptr);
+	_push_job_rec(L, job_ptr);
 	_push_partition_list(job_ptr->user_id, submit_uid);
 	lua_pushnumber(L, submit_uid);
 	slurm_lua_stack_dump(
@@ -1400,6 +1911,6 @@ extern int job_modify(job_desc_msg_t *job_desc, job_record_t *job_ptr,
 		xfree(user_msg);
 	}
 
-out:	slurm_mutex_unlock (&lua_lock);
+out:	_release_state();
 	return rc;
 }
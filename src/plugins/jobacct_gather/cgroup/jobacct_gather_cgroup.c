@@ -127,6 +127,25 @@ static void _prec_extra(jag_prec_t *prec, uint32_t taskid)
 			cgroup_acct_data->total_pgmajfault;
 	}
 
+	/*
+	 * Only cgroup/v2 provides these. io.stat accounts the block device
+	 * traffic of the whole task subtree, where /proc/<pid>/io would need a
+	 * read per process.
+	 */
+	if ((cgroup_acct_data->total_read_bytes != NO_VAL64) &&
+	    (cgroup_acct_data->total_write_bytes != NO_VAL64)) {
+		prec->tres_data[TRES_ARRAY_FS_DISK].size_read =
+			cgroup_acct_data->total_read_bytes;
+		prec->tres_data[TRES_ARRAY_FS_DISK].size_write =
+			cgroup_acct_data->total_write_bytes;
+	}
+
+	if (cgroup_acct_data->cpu_pressure != NO_VAL64)
+		log_flag(JAG, "taskid %u pressure stall usec cpu:%"PRIu64" memory:%"PRIu64" io:%"PRIu64,
+			 taskid, cgroup_acct_data->cpu_pressure,
+			 cgroup_acct_data->memory_pressure,
+			 cgroup_acct_data->io_pressure);
+
 	xfree(cgroup_acct_data);
 	return;
 }
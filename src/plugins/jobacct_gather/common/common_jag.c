@@ -52,6 +52,7 @@
 #include "src/common/slurm_acct_gather_energy.h"
 #include "src/common/slurm_acct_gather_filesystem.h"
 #include "src/common/slurm_acct_gather_interconnect.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 #include "src/slurmd/common/proctrack.h"
 
@@ -142,17 +143,32 @@ inline static bool _get_freq(char *str)
 }
 
 /*
- * collects the Pss value from /proc/<pid>/smaps
+ * collects the Pss value from /proc/<pid>/smaps_rollup, or from
+ * /proc/<pid>/smaps on kernels without it
  */
-static int _get_pss(char *proc_smaps_file, jag_prec_t *prec)
+static int _get_pss(jag_prec_t *prec)
 {
+	static bool no_smaps_rollup = false;
+	char proc_smaps_file[256];	/* Allow ~20x extra length */
         uint64_t pss;
 	uint64_t p;
         char line[128];
-        FILE *fp;
+        FILE *fp = NULL;
 	int i;
 
-	fp = fopen(proc_smaps_file, "r");
+	if (!no_smaps_rollup) {
+		snprintf(proc_smaps_file, sizeof(proc_smaps_file),
+			 "/proc/%d/smaps_rollup", prec->pid);
+		if (!(fp = fopen(proc_smaps_file, "r")) && (errno == ENOENT) &&
+		    (access("/proc/self/smaps_rollup", F_OK) == -1))
+			no_smaps_rollup = true;
+	}
+	if (no_smaps_rollup) {
+		/* Sums up the Pss: line of every mapping */
+		snprintf(proc_smaps_file, sizeof(proc_smaps_file),
+			 "/proc/%d/smaps", prec->pid);
+		fp = fopen(proc_smaps_file, "r");
+	}
         if (!fp) {
                 return -1;
         }
@@ -428,14 +444,14 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	return 1;
 }
 
-static int _remove_share_data(char *proc_stat_file, jag_prec_t *prec)
+static int _remove_share_data(jag_prec_t *prec)
 {
 	FILE *statm_fp = NULL;
 	char proc_statm_file[256];	/* Allow ~20x extra length */
 	int rc = 0, fd;
 
-	snprintf(proc_statm_file, sizeof(proc_statm_file), "%sm",
-		 proc_stat_file);
+	snprintf(proc_statm_file, sizeof(proc_statm_file), "/proc/%d/statm",
+		 prec->pid);
 	if (!(statm_fp = fopen(proc_statm_file, "r")))
 		return rc;  /* Assume the process went away */
 	fd = fileno(statm_fp);
@@ -498,31 +514,18 @@ static int _init_tres(jag_prec_t *prec, void *empty)
 	return SLURM_SUCCESS;
 }
 
-static void _handle_stats(char *proc_stat_file, char *proc_io_file,
-			  char *proc_smaps_file, jag_callbacks_t *callbacks,
-			  int tres_count)
+/*
+ * Read /proc/<pid>/stat into a new process record
+ * RET the record or NULL if the process went away
+ */
+static jag_prec_t *_handle_stats(char *proc_stat_file, int tres_count)
 {
-	static int no_share_data = -1;
-	static int use_pss = -1;
 	FILE *stat_fp = NULL;
-	FILE *io_fp = NULL;
-	int fd, fd2;
+	int fd;
 	jag_prec_t *prec = NULL;
 
-	if (no_share_data == -1) {
-		if (xstrcasestr(slurm_conf.job_acct_gather_params, "NoShare"))
-			no_share_data = 1;
-		else
-			no_share_data = 0;
-
-		if (xstrcasestr(slurm_conf.job_acct_gather_params, "UsePss"))
-			use_pss = 1;
-		else
-			use_pss = 0;
-	}
-
 	if (!(stat_fp = fopen(proc_stat_file, "r")))
-		return;  /* Assume the process went away */
+		return NULL;  /* Assume the process went away */
 	/*
 	 * Close the file on exec() of user tasks.
 	 *
@@ -538,16 +541,6 @@ static void _handle_stats(char *proc_stat_file, char *proc_io_file,
 		error("%s: fcntl(%s): %m", __func__, proc_stat_file);
 
 	prec = xmalloc(sizeof(jag_prec_t));
-
-	if (!tres_count) {
-		assoc_mgr_lock_t locks = {
-			NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
-			READ_LOCK, NO_LOCK, NO_LOCK };
-		assoc_mgr_lock(&locks);
-		tres_count = g_tres_count;
-		assoc_mgr_unlock(&locks);
-	}
-
 	prec->tres_count = tres_count;
 	prec->tres_data = xmalloc(prec->tres_count *
 				  sizeof(acct_gather_data_t));
@@ -556,62 +549,199 @@ static void _handle_stats(char *proc_stat_file, char *proc_io_file,
 
 	if (!_get_process_data_line(fd, prec)) {
 		fclose(stat_fp);
-		goto bail_out;
+		destroy_jag_prec(prec);
+		return NULL;
 	}
 
 	fclose(stat_fp);
+	return prec;
+}
 
-	if (acct_gather_filesystem_g_get_data(prec->tres_data) < 0) {
-		log_flag(JAG, "problem retrieving filesystem data");
-	}
+/*
+ * Fill in the rest of a process record read by _handle_stats()
+ * node_data IN/OUT - filesystem and interconnect data read for this poll,
+ *	zeroed once given to a record
+ * RET SLURM_SUCCESS or SLURM_ERROR if the record is not valid
+ */
+static int _handle_extra_stats(jag_prec_t *prec,
+			       acct_gather_data_t *node_data)
+{
+	static int no_share_data = -1;
+	static int use_pss = -1;
+	char proc_io_file[256];	/* Allow ~20x extra length */
+	FILE *io_fp = NULL;
+	int fd2;
 
-	if (acct_gather_interconnect_g_get_data(prec->tres_data) < 0) {
-		log_flag(JAG, "problem retrieving interconnect data");
+	if (no_share_data == -1) {
+		if (xstrcasestr(slurm_conf.job_acct_gather_params, "NoShare"))
+			no_share_data = 1;
+		else
+			no_share_data = 0;
+
+		if (xstrcasestr(slurm_conf.job_acct_gather_params, "UsePss"))
+			use_pss = 1;
+		else
+			use_pss = 0;
 	}
 
 	/* Remove shared data from rss */
-	if (no_share_data && !_remove_share_data(proc_stat_file, prec))
-		goto bail_out;
+	if (no_share_data && !_remove_share_data(prec))
+		return SLURM_ERROR;
 
 	/* Use PSS instead if RSS */
-	if (use_pss && _get_pss(proc_smaps_file, prec) == -1)
-		goto bail_out;
+	if (use_pss && _get_pss(prec) == -1)
+		return SLURM_ERROR;
 
+	snprintf(proc_io_file, sizeof(proc_io_file), "/proc/%d/io", prec->pid);
 	if ((io_fp = fopen(proc_io_file, "r"))) {
 		fd2 = fileno(io_fp);
 		if (fcntl(fd2, F_SETFD, FD_CLOEXEC) == -1)
 			error("%s: fcntl: %m", __func__);
 		if (!_get_process_io_data_line(fd2, prec)) {
 			fclose(io_fp);
-			goto bail_out;
+			return SLURM_ERROR;
 		}
 		fclose(io_fp);
 	}
 
+	/*
+	 * Filesystem and interconnect counters are node wide deltas, so only
+	 * the first valid record of a poll gets them and the rest get zeroes.
+	 * Otherwise _aggregate_prec() would count them once per process.
+	 */
+	for (int i = 0; i < prec->tres_count; i++) {
+		if (node_data[i].size_read == INFINITE64)
+			continue;
+		prec->tres_data[i] = node_data[i];
+		node_data[i].num_reads = 0;
+		node_data[i].num_writes = 0;
+		node_data[i].size_read = 0;
+		node_data[i].size_write = 0;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/* Replace the record of the same process in prec_list */
+static void _add_prec(jag_prec_t *prec)
+{
 	destroy_jag_prec(list_remove_first(prec_list, _find_prec, &prec->pid));
 	list_append(prec_list, prec);
-	return;
+}
 
-bail_out:
-	xfree(prec->tres_data);
-	xfree(prec);
-	return;
+static void _pid_hash_id(void *item, const char **key, uint32_t *key_len)
+{
+	*key = item;
+	*key_len = sizeof(pid_t);
+}
+
+static bool _pid_in_hash(xhash_t *pid_hash, pid_t pid)
+{
+	return xhash_get(pid_hash, (char *) &pid, sizeof(pid_t));
+}
+
+/*
+ * Add the records read by _handle_stats() while scanning all of /proc.
+ * Only the tasks and their descendants get the rest of their data read,
+ * the records of other processes are kept with the stat data only.
+ */
+static void _handle_scanned_precs(List task_list, List scan_list,
+				  acct_gather_data_t *node_data)
+{
+	struct jobacctinfo *jobacct;
+	jag_prec_t *prec;
+	ListIterator itr;
+	xhash_t *pid_hash = xhash_init(_pid_hash_id, NULL);
+	pid_t *pids;
+	int npids = 0;
+	bool changed = true;
+
+	/* pids is never grown, the hash points into it */
+	pids = xcalloc(list_count(task_list) + list_count(scan_list),
+		       sizeof(pid_t));
+	itr = list_iterator_create(task_list);
+	while ((jobacct = list_next(itr))) {
+		if (_pid_in_hash(pid_hash, jobacct->pid))
+			continue;
+		pids[npids] = jobacct->pid;
+		xhash_add(pid_hash, &pids[npids++]);
+	}
+	list_iterator_destroy(itr);
+
+	/* One pass per generation of descendants */
+	itr = list_iterator_create(scan_list);
+	while (changed) {
+		changed = false;
+		list_iterator_reset(itr);
+		while ((prec = list_next(itr))) {
+			if (_pid_in_hash(pid_hash, prec->ppid) &&
+			    !_pid_in_hash(pid_hash, prec->pid)) {
+				pids[npids] = prec->pid;
+				xhash_add(pid_hash, &pids[npids++]);
+				changed = true;
+			}
+		}
+	}
+
+	list_iterator_reset(itr);
+	while ((prec = list_next(itr))) {
+		list_remove(itr);
+		if (_pid_in_hash(pid_hash, prec->pid) &&
+		    _handle_extra_stats(prec, node_data)) {
+			destroy_jag_prec(prec);
+			continue;
+		}
+		_add_prec(prec);
+	}
+	list_iterator_destroy(itr);
+	xhash_free(pid_hash);
+	xfree(pids);
 }
 
 static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 		       jag_callbacks_t *callbacks)
 {
 	char	proc_stat_file[256];	/* Allow ~20x extra length */
-	char	proc_io_file[256];	/* Allow ~20x extra length */
-	char	proc_smaps_file[256];	/* Allow ~20x extra length */
 	static	int	slash_proc_open = 0;
-	int i;
+	int i, tres_count;
 	struct jobacctinfo *jobacct = NULL;
+	acct_gather_data_t *node_data = NULL;
+	jag_prec_t *prec;
 
 	xassert(task_list);
 
 	jobacct = list_peek(task_list);
 
+	if (jobacct) {
+		tres_count = jobacct->tres_count;
+	} else {
+		assoc_mgr_lock_t locks = {
+			NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+			READ_LOCK, NO_LOCK, NO_LOCK };
+		assoc_mgr_lock(&locks);
+		tres_count = g_tres_count;
+		assoc_mgr_unlock(&locks);
+	}
+
+	/*
+	 * Filesystem and interconnect counters are node wide, so read them
+	 * once per poll rather than once per process.
+	 */
+	node_data = xcalloc(tres_count, sizeof(acct_gather_data_t));
+	for (i = 0; i < tres_count; i++) {
+		node_data[i].num_reads = INFINITE64;
+		node_data[i].num_writes = INFINITE64;
+		node_data[i].size_read = INFINITE64;
+		node_data[i].size_write = INFINITE64;
+	}
+	if (acct_gather_filesystem_g_get_data(node_data) < 0) {
+		log_flag(JAG, "problem retrieving filesystem data");
+	}
+
+	if (acct_gather_interconnect_g_get_data(node_data) < 0) {
+		log_flag(JAG, "problem retrieving interconnect data");
+	}
+
 	if (!pgid_plugin) {
 		pid_t *pids = NULL;
 		int npids = 0;
@@ -640,16 +770,18 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 		}
 		for (i = 0; i < npids; i++) {
 			snprintf(proc_stat_file, 256, "/proc/%d/stat", pids[i]);
-			snprintf(proc_io_file, 256, "/proc/%d/io", pids[i]);
-			snprintf(proc_smaps_file, 256, "/proc/%d/smaps", pids[i]);
-			_handle_stats(proc_stat_file, proc_io_file,
-				      proc_smaps_file, callbacks,
-				      jobacct ? jobacct->tres_count : 0);
+			if (!(prec = _handle_stats(proc_stat_file, tres_count)))
+				continue;
+			if (_handle_extra_stats(prec, node_data))
+				destroy_jag_prec(prec);
+			else
+				_add_prec(prec);
 		}
 		xfree(pids);
 	} else {
 		struct dirent *slash_proc_entry;
-		char  *iptr = NULL, *optr = NULL, *optr2 = NULL;
+		char  *iptr = NULL, *optr = NULL;
+		List scan_list;
 
 		if (slash_proc_open) {
 			rewinddir(slash_proc);
@@ -662,17 +794,15 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			slash_proc_open=1;
 		}
 		strcpy(proc_stat_file, "/proc/");
-		strcpy(proc_io_file, "/proc/");
-		strcpy(proc_smaps_file, "/proc/");
 
+		scan_list = list_create(destroy_jag_prec);
 		while ((slash_proc_entry = readdir(slash_proc))) {
 
 			/* Save a few cyles by simulating
 			 * strcat(statFileName, slash_proc_entry->d_name);
 			 * strcat(statFileName, "/stat");
 			 * while checking for a numeric filename (which really
-			 * should be a pid). Then do the same for the
-			 * /proc/<pid>/io file name.
+			 * should be a pid).
 			 */
 			optr = proc_stat_file + sizeof("/proc");
 			iptr = slash_proc_entry->d_name;
@@ -694,51 +824,15 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			} while (*iptr);
 			*optr = 0;
 
-			optr2 = proc_io_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/io";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			optr2 = proc_smaps_file + sizeof("/proc");
-			iptr = slash_proc_entry->d_name;
-			i = 0;
-			do {
-				if ((*iptr < '0') ||
-				    ((*optr2++ = *iptr++) > '9')) {
-					i = -1;
-					break;
-				}
-			} while (*iptr);
-			if (i == -1)
-				continue;
-			iptr = (char*)"/smaps";
-
-			do {
-				*optr2++ = *iptr++;
-			} while (*iptr);
-			*optr2 = 0;
-
-			_handle_stats(proc_stat_file, proc_io_file,
-				      proc_smaps_file, callbacks,
-				      jobacct ? jobacct->tres_count : 0);
+			if ((prec = _handle_stats(proc_stat_file, tres_count)))
+				list_append(scan_list, prec);
 		}
+		_handle_scanned_precs(task_list, scan_list, node_data);
+		FREE_NULL_LIST(scan_list);
 	}
 
 finished:
+	xfree(node_data);
 
 	return prec_list;
 }
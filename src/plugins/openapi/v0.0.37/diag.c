@@ -44,6 +44,8 @@
 #include "src/common/log.h"
 #include "src/common/read_config.h"
 #include "src/common/ref.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/uid.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
@@ -66,6 +68,7 @@ static int _op_handler_diag(const char *context_id,
 	int rc;
 	stats_info_response_msg_t *resp = NULL;
 	stats_info_request_msg_t *req = xmalloc(sizeof(*req));
+	data_t *rpcs;
 	req->command_id = STAT_COMMAND_GET;
 
 	data_t *errors = populate_response_format(p);
@@ -144,6 +147,61 @@ static int _op_handler_diag(const char *context_id,
 		     resp->bf_when_last_cycle);
 	data_set_bool(data_key_set(d, "bf_active"), (resp->bf_active != 0));
 
+	rpcs = data_set_list(data_key_set(d, "rpcs_by_message_type"));
+	for (int i = 0; i < resp->rpc_type_size; i++) {
+		data_t *r = data_set_dict(data_list_append(rpcs));
+
+		data_set_string(data_key_set(r, "message_type"),
+				rpc_num2string(resp->rpc_type_id[i]));
+		data_set_int(data_key_set(r, "type_id"), resp->rpc_type_id[i]);
+		data_set_int(data_key_set(r, "count"), resp->rpc_type_cnt[i]);
+		data_set_int(data_key_set(r, "average_time"),
+			     (resp->rpc_type_cnt[i] ?
+			      (resp->rpc_type_time[i] /
+			       resp->rpc_type_cnt[i]) : 0));
+		data_set_int(data_key_set(r, "total_time"),
+			     resp->rpc_type_time[i]);
+		if (resp->rpc_type_max) {
+			data_set_int(data_key_set(r, "p50_time"),
+				     resp->rpc_type_p50[i]);
+			data_set_int(data_key_set(r, "p99_time"),
+				     resp->rpc_type_p99[i]);
+			data_set_int(data_key_set(r, "max_time"),
+				     resp->rpc_type_max[i]);
+			data_set_int(data_key_set(r, "total_lock_wait"),
+				     resp->rpc_type_lock_wait[i]);
+		}
+	}
+
+	rpcs = data_set_list(data_key_set(d, "rpcs_by_user"));
+	for (int i = 0; i < resp->rpc_user_size; i++) {
+		data_t *r = data_set_dict(data_list_append(rpcs));
+		char *user = uid_to_string_or_null(resp->rpc_user_id[i]);
+
+		if (user)
+			data_set_string_own(data_key_set(r, "user"), user);
+		else
+			data_set_null(data_key_set(r, "user"));
+		data_set_int(data_key_set(r, "user_id"), resp->rpc_user_id[i]);
+		data_set_int(data_key_set(r, "count"), resp->rpc_user_cnt[i]);
+		data_set_int(data_key_set(r, "average_time"),
+			     (resp->rpc_user_cnt[i] ?
+			      (resp->rpc_user_time[i] /
+			       resp->rpc_user_cnt[i]) : 0));
+		data_set_int(data_key_set(r, "total_time"),
+			     resp->rpc_user_time[i]);
+		if (resp->rpc_user_max) {
+			data_set_int(data_key_set(r, "p50_time"),
+				     resp->rpc_user_p50[i]);
+			data_set_int(data_key_set(r, "p99_time"),
+				     resp->rpc_user_p99[i]);
+			data_set_int(data_key_set(r, "max_time"),
+				     resp->rpc_user_max[i]);
+			data_set_int(data_key_set(r, "total_lock_wait"),
+				     resp->rpc_user_lock_wait[i]);
+		}
+	}
+
 cleanup:
 	if (rc) {
 		data_t *e = data_set_dict(data_list_append(errors));
@@ -379,12 +379,16 @@ extern pid_t find_ancestor(pid_t process, char *process_name)
 	return pid;
 }
 
-/* The returned "pids" array does NOT include the slurmstepd */
-extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids)
+/*
+ * Collect the descendants of top. If usercmd is NULL only user commands are
+ * returned, otherwise every descendant with its user command flag.
+ */
+static int _get_pids(pid_t top, pid_t **pids, bool **usercmd, int *npids)
 {
 	xppid_t **hashtbl;
 	xpid_t *list, *ptr;
 	pid_t *p;
+	bool *u = NULL;
 	int i, len = 32, rc;
 
 	if ((hashtbl = _build_hashtbl()) == NULL)
@@ -399,15 +403,22 @@ extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids)
 	}
 
 	p = (pid_t *)xmalloc(sizeof(pid_t) * len);
+	if (usercmd)
+		u = xmalloc(sizeof(bool) * len);
 	ptr = list;
 	i = 0;
 	while (ptr != NULL) {
-		if (ptr->is_usercmd) { /* don't include the slurmstepd */
+		/* don't include the slurmstepd unless asked to */
+		if (ptr->is_usercmd || usercmd) {
 			if (i >= len - 1) {
 				len *= 2;
 				xrealloc(p, (sizeof(pid_t) * len));
+				if (u)
+					xrealloc(u, (sizeof(bool) * len));
 			}
 			p[i] = ptr->pid;
+			if (u)
+				u[i] = ptr->is_usercmd;
 			i++;
 		}
 		ptr = ptr->next;
@@ -415,6 +426,7 @@ extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids)
 
 	if (i == 0) {
 		xfree(p);
+		xfree(u);
 		*pids = NULL;
 		*npids = 0;
 		rc = SLURM_ERROR;
@@ -423,7 +435,21 @@ extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids)
 		*npids = i;
 		rc = SLURM_SUCCESS;
 	}
+	if (usercmd)
+		*usercmd = u;
 	_destroy_hashtbl(hashtbl);
 	_destroy_list(list);
 	return rc;
 }
+
+/* The returned "pids" array does NOT include the slurmstepd */
+extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids)
+{
+	return _get_pids(top, pids, NULL, npids);
+}
+
+extern int proctrack_linuxproc_get_tree(pid_t top, pid_t **pids,
+					bool **usercmd, int *npids)
+{
+	return _get_pids(top, pids, usercmd, npids);
+}
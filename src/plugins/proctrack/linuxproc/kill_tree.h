@@ -40,6 +40,7 @@
 #ifndef _HAVE_KILL_TREE_H
 #define _HAVE_KILL_TREE_H
 
+#include <stdbool.h>
 #include <sys/types.h>
 
 extern int kill_proc_tree(pid_t top, int sig);
@@ -52,4 +53,12 @@ extern pid_t find_ancestor(pid_t process, char *process_name);
 
 extern int proctrack_linuxproc_get_pids(pid_t top, pid_t **pids, int *npids);
 
+/*
+ * Like proctrack_linuxproc_get_pids(), but return every descendant of top,
+ * including slurmstepd processes. usercmd[i] is set if pids[i] is a user
+ * command. The caller must xfree() both arrays.
+ */
+extern int proctrack_linuxproc_get_tree(pid_t top, pid_t **pids,
+					bool **usercmd, int *npids);
+
 #endif  /* _HAVE_KILL_TREE_H */
@@ -0,0 +1,630 @@
+/*****************************************************************************\
+ *  proc_events.c - Track a process tree with the proc connector
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#define _GNU_SOURCE	/* pipe2 */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#include "slurm/slurm.h"
+#include "slurm/slurm_errno.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "kill_tree.h"
+#include "proc_events.h"
+
+/* Events of the whole node go through this buffer, make room for bursts */
+#define PROC_EVENTS_RCVBUF	(4 * 1024 * 1024)
+
+/* How long to wait for the events of the test child, in microseconds */
+#define PROC_EVENTS_VERIFY_USEC	1000000
+
+#define NSEC_PER_SEC	1000000000ULL
+
+#define HASH_LEN 1024
+
+#define GET_HASH_IDX(pid) ((pid) % HASH_LEN)
+
+typedef struct tracked_pid_s {
+	pid_t pid;
+	bool is_usercmd;
+	uint32_t gen;		/* resync_gen when last added */
+	uint64_t start_ns;	/* fork time, 0 if unknown */
+	struct tracked_pid_s *next;
+} tracked_pid_t;
+
+static tracked_pid_t *hashtbl[HASH_LEN];
+static int tracked_cnt = 0;
+static uint32_t resync_gen = 0;
+static pid_t tracked_top = 0;
+static bool tracking_failed = false;
+static pid_t verify_pid = 0;
+static bool verify_seen = false;
+static pthread_mutex_t events_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int nl_fd = -1;
+static int stop_pipe[2] = { -1, -1 };
+static pthread_t event_thread = 0;
+
+/*
+ * Get the start time of a process from /proc, in nanoseconds since boot.
+ * RET 0 if the process does not exist anymore or on error
+ */
+static uint64_t _get_start_ns(pid_t pid)
+{
+	char path[PATH_MAX], rbuf[1024], *p;
+	unsigned long long start_ticks;
+	long clk_tck;
+	ssize_t buf_used;
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%ld/stat", (long) pid);
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;
+	buf_used = read(fd, rbuf, sizeof(rbuf) - 1);
+	close(fd);
+	if (buf_used <= 0)
+		return 0;
+	rbuf[buf_used] = '\0';
+
+	/* The command name may contain spaces, start after it */
+	if (!(p = strrchr(rbuf, ')')))
+		return 0;
+	if (sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+		   "%*u %*u %*d %*d %*d %*d %*d %*d %llu", &start_ticks) != 1)
+		return 0;
+	if ((clk_tck = sysconf(_SC_CLK_TCK)) <= 0)
+		return 0;
+
+	return (start_ticks * NSEC_PER_SEC) / clk_tck;
+}
+
+/* Call with events_mutex locked */
+static tracked_pid_t *_find_pid(pid_t pid)
+{
+	tracked_pid_t *tp;
+
+	for (tp = hashtbl[GET_HASH_IDX(pid)]; tp; tp = tp->next) {
+		if (tp->pid == pid)
+			return tp;
+	}
+
+	return NULL;
+}
+
+/* Call with events_mutex locked */
+static void _add_pid(pid_t pid, bool is_usercmd, uint64_t start_ns)
+{
+	tracked_pid_t *tp;
+	int idx = GET_HASH_IDX(pid);
+
+	if ((tp = _find_pid(pid))) {
+		tp->is_usercmd = is_usercmd;
+		tp->gen = resync_gen;
+		tp->start_ns = start_ns;
+		return;
+	}
+
+	tp = xmalloc(sizeof(*tp));
+	tp->pid = pid;
+	tp->is_usercmd = is_usercmd;
+	tp->gen = resync_gen;
+	tp->start_ns = start_ns;
+	tp->next = hashtbl[idx];
+	hashtbl[idx] = tp;
+	tracked_cnt++;
+}
+
+/* Call with events_mutex locked */
+static void _remove_pid(pid_t pid)
+{
+	tracked_pid_t **tpp, *tp;
+
+	for (tpp = &hashtbl[GET_HASH_IDX(pid)]; (tp = *tpp);
+	     tpp = &tp->next) {
+		if (tp->pid == pid) {
+			*tpp = tp->next;
+			xfree(tp);
+			tracked_cnt--;
+			return;
+		}
+	}
+}
+
+/* Call with events_mutex locked */
+static void _free_hashtbl(void)
+{
+	tracked_pid_t *tp, *next;
+
+	for (int i = 0; i < HASH_LEN; i++) {
+		for (tp = hashtbl[i]; tp; tp = next) {
+			next = tp->next;
+			xfree(tp);
+		}
+		hashtbl[i] = NULL;
+	}
+	tracked_cnt = 0;
+}
+
+/*
+ * Is the process of an entry the walk did not find still the one we tracked?
+ * Processes reparented to init are no longer below top in /proc but are
+ * still ours until their exit event. Their pid may however have been reused
+ * if the exit event was among the dropped ones, so the process must not have
+ * started after the one we tracked. The fork event time and /proc use
+ * different clocks which only drift apart when the node is suspended, which
+ * makes the process look younger and drops it.
+ */
+static bool _still_tracked(tracked_pid_t *tp)
+{
+	uint64_t start_ns;
+
+	if (!tp->start_ns || !(start_ns = _get_start_ns(tp->pid)))
+		return false;
+
+	return (start_ns <= (tp->start_ns + NSEC_PER_SEC));
+}
+
+/*
+ * Rebuild the tracked processes from /proc. Used to get the processes which
+ * existed before we subscribed and when the kernel dropped events because
+ * our socket buffer was full.
+ *
+ * Entries which the walk did not find are kept if _still_tracked(), and
+ * dropped otherwise. Entries added by events after the walk started carry
+ * the new generation and are kept.
+ */
+static void _resync(void)
+{
+	pid_t *pids = NULL;
+	bool *usercmd = NULL;
+	int npids = 0;
+	uint32_t gen;
+	tracked_pid_t *tp, *next;
+
+	slurm_mutex_lock(&events_mutex);
+	gen = ++resync_gen;
+	slurm_mutex_unlock(&events_mutex);
+
+	(void) proctrack_linuxproc_get_tree(tracked_top, &pids, &usercmd,
+					    &npids);
+
+	slurm_mutex_lock(&events_mutex);
+	for (int i = 0; i < npids; i++) {
+		if (!(tp = _find_pid(pids[i])))
+			_add_pid(pids[i], usercmd[i], _get_start_ns(pids[i]));
+		else if (tp->gen < gen) {
+			tp->is_usercmd = usercmd[i];
+			tp->gen = gen;
+		}
+	}
+	/* Forget the processes the walk did not find, except orphans */
+	for (int i = 0; i < HASH_LEN; i++) {
+		for (tp = hashtbl[i]; tp; tp = next) {
+			next = tp->next;
+			if ((tp->pid == tracked_top) || (tp->gen >= gen))
+				continue;
+			if (_still_tracked(tp))
+				tp->gen = gen;
+			else
+				_remove_pid(tp->pid);
+		}
+	}
+	slurm_mutex_unlock(&events_mutex);
+
+	xfree(pids);
+	xfree(usercmd);
+}
+
+static void _handle_event(struct proc_event *ev)
+{
+	tracked_pid_t *parent, *tp;
+
+	slurm_mutex_lock(&events_mutex);
+	switch (ev->what) {
+	case PROC_EVENT_FORK:
+		/* New threads are not new processes */
+		if (ev->event_data.fork.child_pid !=
+		    ev->event_data.fork.child_tgid)
+			break;
+		if ((parent = _find_pid(ev->event_data.fork.parent_tgid)))
+			_add_pid(ev->event_data.fork.child_tgid,
+				 parent->is_usercmd, ev->timestamp_ns);
+		break;
+	case PROC_EVENT_EXEC:
+		if ((tp = _find_pid(ev->event_data.exec.process_tgid)))
+			tp->is_usercmd = true;
+		break;
+	case PROC_EVENT_EXIT:
+		if (ev->event_data.exit.process_pid !=
+		    ev->event_data.exit.process_tgid)
+			break;
+		_remove_pid(ev->event_data.exit.process_tgid);
+		if (verify_pid &&
+		    (ev->event_data.exit.process_tgid == verify_pid))
+			verify_seen = true;
+		break;
+	default:
+		break;
+	}
+	slurm_mutex_unlock(&events_mutex);
+}
+
+static void _handle_msgs(void *buf, ssize_t len)
+{
+	struct nlmsghdr *nlh;
+	struct cn_msg *cn;
+
+	for (nlh = buf; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+		if ((nlh->nlmsg_type == NLMSG_NOOP) ||
+		    (nlh->nlmsg_type == NLMSG_ERROR))
+			continue;
+		cn = NLMSG_DATA(nlh);
+		if ((cn->id.idx != CN_IDX_PROC) ||
+		    (cn->id.val != CN_VAL_PROC))
+			continue;
+		_handle_event((struct proc_event *) cn->data);
+	}
+}
+
+static void *_event_thread(void *arg)
+{
+	char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+	struct pollfd pfds[2];
+	ssize_t len;
+
+	pfds[0].fd = nl_fd;
+	pfds[0].events = POLLIN;
+	pfds[1].fd = stop_pipe[0];
+	pfds[1].events = POLLIN;
+
+	while (1) {
+		if (poll(pfds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			error("%s: poll: %m", __func__);
+			break;
+		}
+		if (pfds[1].revents)
+			return NULL;
+
+		if ((len = recv(nl_fd, buf, sizeof(buf), 0)) < 0) {
+			if (errno == ENOBUFS) {
+				debug("%s: proc connector events lost, rescanning /proc",
+				      __func__);
+				_resync();
+				continue;
+			}
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			error("%s: recv: %m", __func__);
+			break;
+		}
+
+		_handle_msgs(buf, len);
+	}
+
+	/* We can't trust the tracked processes anymore */
+	slurm_mutex_lock(&events_mutex);
+	tracking_failed = true;
+	slurm_mutex_unlock(&events_mutex);
+	error("%s: stopped tracking processes with the proc connector",
+	      __func__);
+
+	return NULL;
+}
+
+static int _send_op(enum proc_cn_mcast_op op)
+{
+	char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))]
+		__attribute__((aligned(NLMSG_ALIGNTO)));
+	struct nlmsghdr *nlh = (struct nlmsghdr *) buf;
+	struct cn_msg *cn = NLMSG_DATA(nlh);
+
+	memset(buf, 0, sizeof(buf));
+	nlh->nlmsg_len = NLMSG_LENGTH(sizeof(*cn) + sizeof(op));
+	nlh->nlmsg_type = NLMSG_DONE;
+	cn->id.idx = CN_IDX_PROC;
+	cn->id.val = CN_VAL_PROC;
+	cn->len = sizeof(op);
+	memcpy(cn->data, &op, sizeof(op));
+
+	if (send(nl_fd, buf, nlh->nlmsg_len, 0) < 0) {
+		debug("%s: send: %m", __func__);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * The kernel does not acknowledge PROC_CN_MCAST_LISTEN. It silently sends no
+ * events to listeners outside of the initial user namespace, and reports the
+ * pids of the initial pid namespace. Fork a child which exits at once and
+ * wait for its exit event under the pid we know it by, to make sure the
+ * events can be used.
+ */
+static int _verify_events(void)
+{
+	char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+	struct pollfd pfd = { .fd = nl_fd, .events = POLLIN };
+	struct timeval start_tv = { 0, 0 };
+	int delta_t, rc;
+	bool seen = false;
+	ssize_t len;
+	pid_t pid;
+
+	if ((pid = fork()) < 0) {
+		debug("%s: fork: %m", __func__);
+		return SLURM_ERROR;
+	}
+	if (pid == 0)
+		_exit(0);
+	(void) waitpid(pid, NULL, 0);
+
+	slurm_mutex_lock(&events_mutex);
+	verify_pid = pid;
+	verify_seen = false;
+	slurm_mutex_unlock(&events_mutex);
+
+	(void) slurm_delta_tv(&start_tv);
+	while (!seen &&
+	       ((delta_t = slurm_delta_tv(&start_tv)) <
+		PROC_EVENTS_VERIFY_USEC)) {
+		rc = poll(&pfd, 1, ((PROC_EVENTS_VERIFY_USEC - delta_t) / 1000)
+			  + 1);
+		if ((rc < 0) && (errno != EINTR)) {
+			debug("%s: poll: %m", __func__);
+			break;
+		}
+		if (rc <= 0)
+			continue;
+		/* On ENOBUFS keep waiting, the event may still come */
+		if ((len = recv(nl_fd, buf, sizeof(buf), 0)) < 0) {
+			if ((errno == ENOBUFS) || (errno == EINTR) ||
+			    (errno == EAGAIN))
+				continue;
+			debug("%s: recv: %m", __func__);
+			break;
+		}
+		_handle_msgs(buf, len);
+
+		slurm_mutex_lock(&events_mutex);
+		seen = verify_seen;
+		slurm_mutex_unlock(&events_mutex);
+	}
+
+	slurm_mutex_lock(&events_mutex);
+	verify_pid = 0;
+	slurm_mutex_unlock(&events_mutex);
+
+	if (!seen) {
+		debug("%s: no proc connector event for test child %d",
+		      __func__, pid);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+extern int proc_events_init(pid_t top)
+{
+	struct sockaddr_nl addr;
+	int rcvbuf = PROC_EVENTS_RCVBUF;
+
+	if (nl_fd != -1)
+		return SLURM_ERROR;
+
+	if ((nl_fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+			    NETLINK_CONNECTOR)) < 0) {
+		debug("%s: socket: %m", __func__);
+		return SLURM_ERROR;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = CN_IDX_PROC;
+	if (bind(nl_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		debug("%s: bind: %m", __func__);
+		goto fail;
+	}
+
+	if (setsockopt(nl_fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf,
+		       sizeof(rcvbuf)) &&
+	    setsockopt(nl_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)))
+		debug("%s: unable to grow receive buffer: %m", __func__);
+
+	if (_send_op(PROC_CN_MCAST_LISTEN) != SLURM_SUCCESS)
+		goto fail;
+
+	slurm_mutex_lock(&events_mutex);
+	tracked_top = top;
+	tracking_failed = false;
+	_add_pid(top, false, 0);
+	slurm_mutex_unlock(&events_mutex);
+
+	if (_verify_events() != SLURM_SUCCESS) {
+		(void) _send_op(PROC_CN_MCAST_IGNORE);
+		goto fail;
+	}
+
+	if (pipe2(stop_pipe, O_CLOEXEC) < 0) {
+		error("%s: pipe2: %m", __func__);
+		(void) _send_op(PROC_CN_MCAST_IGNORE);
+		goto fail;
+	}
+
+	slurm_thread_create(&event_thread, _event_thread, NULL);
+
+	/* Processes forked before we subscribed */
+	_resync();
+
+	debug("%s: tracking descendants of pid %d with the proc connector",
+	      __func__, top);
+	return SLURM_SUCCESS;
+
+fail:
+	close(nl_fd);
+	nl_fd = -1;
+	slurm_mutex_lock(&events_mutex);
+	_free_hashtbl();
+	tracked_top = 0;
+	slurm_mutex_unlock(&events_mutex);
+	return SLURM_ERROR;
+}
+
+extern void proc_events_fini(void)
+{
+	char c = 0;
+
+	if (nl_fd == -1)
+		return;
+
+	(void) _send_op(PROC_CN_MCAST_IGNORE);
+	if (write(stop_pipe[1], &c, 1) != 1)
+		error("%s: write: %m", __func__);
+	pthread_join(event_thread, NULL);
+	event_thread = 0;
+
+	close(stop_pipe[0]);
+	close(stop_pipe[1]);
+	stop_pipe[0] = stop_pipe[1] = -1;
+	close(nl_fd);
+	nl_fd = -1;
+
+	slurm_mutex_lock(&events_mutex);
+	_free_hashtbl();
+	tracked_top = 0;
+	slurm_mutex_unlock(&events_mutex);
+}
+
+extern bool proc_events_tracking(pid_t top)
+{
+	bool rc;
+
+	if (nl_fd == -1)
+		return false;
+
+	slurm_mutex_lock(&events_mutex);
+	rc = (!tracking_failed && (top == tracked_top));
+	slurm_mutex_unlock(&events_mutex);
+
+	return rc;
+}
+
+extern void proc_events_add_pid(pid_t pid)
+{
+	uint64_t start_ns = _get_start_ns(pid);
+
+	slurm_mutex_lock(&events_mutex);
+	_add_pid(pid, true, start_ns);
+	slurm_mutex_unlock(&events_mutex);
+}
+
+extern bool proc_events_has_pid(pid_t pid)
+{
+	bool rc;
+
+	slurm_mutex_lock(&events_mutex);
+	rc = (_find_pid(pid) != NULL);
+	slurm_mutex_unlock(&events_mutex);
+
+	return rc;
+}
+
+extern int proc_events_get_pids(pid_t **pids, int *npids)
+{
+	tracked_pid_t *tp;
+	pid_t *p = NULL;
+	int i = 0;
+
+	slurm_mutex_lock(&events_mutex);
+	if (tracked_cnt)
+		p = xmalloc(sizeof(pid_t) * tracked_cnt);
+	for (int j = 0; j < HASH_LEN; j++) {
+		for (tp = hashtbl[j]; tp; tp = tp->next) {
+			if (tp->is_usercmd)
+				p[i++] = tp->pid;
+		}
+	}
+	slurm_mutex_unlock(&events_mutex);
+
+	if (!i) {
+		xfree(p);
+		*pids = NULL;
+		*npids = 0;
+		return SLURM_ERROR;
+	}
+
+	*pids = p;
+	*npids = i;
+	return SLURM_SUCCESS;
+}
+
+extern int proc_events_signal(int sig)
+{
+	pid_t *pids = NULL;
+	int npids = 0, rc = 0;
+
+	if (proc_events_get_pids(&pids, &npids) != SLURM_SUCCESS)
+		return 0;
+
+	for (int i = 0; i < npids; i++) {
+		if (pids[i] <= 1)
+			continue;
+		verbose("Sending signal %d to pid %d", sig, pids[i]);
+		if (kill(pids[i], sig))
+			rc = errno; /* save the last error */
+	}
+	xfree(pids);
+
+	return rc;
+}
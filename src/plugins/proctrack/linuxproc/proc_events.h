@@ -0,0 +1,85 @@
+/*****************************************************************************\
+ *  proc_events.h - Track a process tree with the proc connector
+ *****************************************************************************
+ *  Copyright (C) 2021 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_PROC_EVENTS_H
+#define _HAVE_PROC_EVENTS_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Start tracking the descendants of "top" from the fork, exec and exit
+ * events of the kernel proc connector (netlink), so that listing or
+ * signalling them does not need to read every process of the node.
+ *
+ * Processes are tracked from the moment they are forked, so they stay
+ * tracked when reparented to init. Processes which did not exec since being
+ * forked from "top" are not user commands and are skipped like in
+ * kill_proc_tree().
+ *
+ * Requires CAP_NET_ADMIN and the initial user and pid namespaces, which is
+ * checked by waiting for the events of a test child. On failure the caller
+ * should keep using the /proc based functions of kill_tree.h.
+ *
+ * RET SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int proc_events_init(pid_t top);
+
+/* Stop tracking and free all resources */
+extern void proc_events_fini(void);
+
+/* Are the descendants of "top" being tracked? */
+extern bool proc_events_tracking(pid_t top);
+
+/* Add a process started elsewhere (e.g. adopted) as a user command */
+extern void proc_events_add_pid(pid_t pid);
+
+/* Is "pid" a tracked process? */
+extern bool proc_events_has_pid(pid_t pid);
+
+/*
+ * Get the tracked user commands. pids must be xfree'd.
+ * RET SLURM_SUCCESS, or SLURM_ERROR if there are none, like
+ *     proctrack_linuxproc_get_pids()
+ */
+extern int proc_events_get_pids(pid_t **pids, int *npids);
+
+/*
+ * Send "sig" to all the tracked user commands.
+ * RET 0 or the errno of the last failed kill(), like kill_proc_tree()
+ */
+extern int proc_events_signal(int sig);
+
+#endif	/* _HAVE_PROC_EVENTS_H */
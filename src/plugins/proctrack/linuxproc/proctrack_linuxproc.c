@@ -43,8 +43,10 @@
 #include "slurm/slurm.h"
 #include "slurm/slurm_errno.h"
 #include "src/common/log.h"
+#include "src/common/run_in_daemon.h"
 #include "src/slurmd/slurmstepd/slurmstepd_job.h"
 #include "kill_tree.h"
+#include "proc_events.h"
 
 /*
  * These variables are required by the generic plugin interface.  If they
@@ -87,6 +89,7 @@ extern int init ( void )
 
 extern int fini ( void )
 {
+	proc_events_fini();
 	return SLURM_SUCCESS;
 }
 
@@ -96,16 +99,34 @@ extern int fini ( void )
 extern int proctrack_p_create ( stepd_step_rec_t *job )
 {
 	job->cont_id = (uint64_t)job->jmgr_pid;
+
+	/*
+	 * Keep the process tree up to date from kernel events so we don't
+	 * have to read every process of the node each time we need it. If not
+	 * possible (e.g. no CAP_NET_ADMIN) just fall back to reading /proc.
+	 */
+	if (running_in_slurmstepd() &&
+	    (proc_events_init(job->jmgr_pid) != SLURM_SUCCESS))
+		debug("%s: proc connector not available, scanning /proc to track processes",
+		      plugin_type);
+
 	return SLURM_SUCCESS;
 }
 
 extern int proctrack_p_add ( stepd_step_rec_t *job, pid_t pid )
 {
+	/* Descendants are found by the events, this is for adopted pids */
+	if (proc_events_tracking((pid_t)job->cont_id))
+		proc_events_add_pid(pid);
+
 	return SLURM_SUCCESS;
 }
 
 extern int proctrack_p_signal ( uint64_t id, int signal )
 {
+	if (proc_events_tracking((pid_t)id))
+		return proc_events_signal(signal);
+
 	return kill_proc_tree((pid_t)id, signal);
 }
 
@@ -123,6 +144,9 @@ extern bool proctrack_p_has_pid(uint64_t cont_id, pid_t pid)
 {
 	uint64_t cont;
 
+	if (proc_events_tracking((pid_t)cont_id))
+		return proc_events_has_pid(pid);
+
 	cont = (uint64_t) find_ancestor(pid, "slurmstepd");
 	if (cont == cont_id)
 		return true;
@@ -144,5 +168,8 @@ proctrack_p_wait(uint64_t cont_id)
 extern int
 proctrack_p_get_pids(uint64_t cont_id, pid_t **pids, int *npids)
 {
+	if (proc_events_tracking((pid_t)cont_id))
+		return proc_events_get_pids(pids, npids);
+
 	return proctrack_linuxproc_get_pids((pid_t)cont_id, pids, npids);
 }
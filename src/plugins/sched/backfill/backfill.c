@@ -176,6 +176,12 @@ typedef struct backfill_user_usage {
 	uid_t uid;
 } bf_user_usage_t;
 
+/* Outcome of testing a job shape, see _job_shape_key() */
+typedef struct bf_shape_rec {
+	char *key;
+	time_t start_time;	/* Expected start or 0 if not runnable */
+} bf_shape_rec_t;
+
 /*********************** local variables *********************/
 static bool stop_backfill = false;
 static pthread_mutex_t thread_flag_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -197,6 +203,8 @@ static List deadlock_global_list;
 static bool bf_hetjob_immediate = false;
 static uint16_t bf_hetjob_prio = 0;
 static bool bf_one_resv_per_job = false;
+static bool bf_shape_cache = false;
+static xhash_t *shape_cache = NULL;
 static uint32_t job_start_cnt = 0;
 static int max_backfill_job_cnt = DEF_BF_MAX_JOB_TEST;
 static int max_backfill_job_per_assoc = 0;
@@ -262,6 +270,8 @@ static int  _try_sched(job_record_t *job_ptr, bitstr_t **avail_bitmap,
 static int  _yield_locks(int64_t usec);
 static void _bf_map_key_id(void *item, const char **key, uint32_t *key_len);
 static void _bf_map_free(void *item);
+static void _bf_shape_key_id(void *item, const char **key, uint32_t *key_len);
+static void _bf_shape_free(void *item);
 
 /* Log resources to be allocated to a pending job */
 static void _dump_job_sched(job_record_t *job_ptr, time_t end_time,
@@ -947,6 +957,11 @@ static void _load_config(void)
 	else
 		bf_one_resv_per_job = false;
 
+	if (xstrcasestr(sched_params, "bf_shape_cache"))
+		bf_shape_cache = true;
+	else
+		bf_shape_cache = false;
+
 	if (xstrcasestr(sched_params, "bf_running_job_reserve"))
 		bf_running_job_reserve = true;
 	else
@@ -1444,6 +1459,112 @@ static void _bf_map_free(void *item)
 	xfree(user);
 }
 
+/* Fetch key from shape_cache item. Called from function ptr */
+static void _bf_shape_key_id(void *item, const char **key, uint32_t *key_len)
+{
+	bf_shape_rec_t *shape = (bf_shape_rec_t *)item;
+
+	xassert(shape);
+
+	*key = shape->key;
+	*key_len = strlen(shape->key);
+}
+
+/* Free item from shape_cache. Called from function ptr */
+static void _bf_shape_free(void *item)
+{
+	bf_shape_rec_t *shape = (bf_shape_rec_t *)item;
+
+	if (!shape)
+		return;
+
+	xfree(shape->key);
+	xfree(shape);
+}
+
+/*
+ * Build a string describing everything which determines where and when a
+ * pending job can run in its current partition. Two jobs with the same key
+ * get the same result from the node space table and the select plugin, so
+ * the outcome of testing one can be reused for the other within a cycle.
+ * Returns NULL if the job can not be cached, caller must xfree() the result.
+ */
+static char *_job_shape_key(job_record_t *job_ptr, uint32_t time_limit,
+			    uint32_t min_nodes, uint32_t req_nodes,
+			    uint32_t max_nodes, time_t qos_blocked_until,
+			    time_t qos_part_blocked_until)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	multi_core_data_t *mc_ptr;
+	char *key = NULL;
+
+	/*
+	 * Reservations, hetjobs, burst buffers and deadlines make the
+	 * outcome depend on more than the resource request.
+	 */
+	if (job_ptr->resv_name || job_ptr->resv_ptr || job_ptr->het_job_id ||
+	    job_ptr->burst_buffer || !detail_ptr ||
+	    ((job_ptr->deadline) && (job_ptr->deadline != NO_VAL)))
+		return NULL;
+
+	xstrfmtcat(key, "%p|%p|%p|%u|%u|%u|%u|%u|%ld|%ld",
+		   job_ptr->part_ptr, job_ptr->qos_ptr, job_ptr->assoc_ptr,
+		   job_ptr->user_id, time_limit, min_nodes, req_nodes,
+		   max_nodes, (long) qos_blocked_until,
+		   (long) qos_part_blocked_until);
+	xstrfmtcat(key, "|%u|%u|%u|%"PRIu64"|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u",
+		   detail_ptr->min_cpus, detail_ptr->max_cpus,
+		   detail_ptr->pn_min_cpus, detail_ptr->pn_min_memory,
+		   detail_ptr->pn_min_tmp_disk, detail_ptr->num_tasks,
+		   detail_ptr->ntasks_per_node, detail_ptr->ntasks_per_tres,
+		   detail_ptr->cpus_per_task, detail_ptr->contiguous,
+		   detail_ptr->share_res, detail_ptr->whole_node,
+		   detail_ptr->core_spec, detail_ptr->overcommit,
+		   detail_ptr->task_dist, detail_ptr->plane_size);
+	xstrfmtcat(key, "|%s|%s|%s|%s",
+		   detail_ptr->features, detail_ptr->cluster_features,
+		   detail_ptr->req_nodes, detail_ptr->exc_nodes);
+	if ((mc_ptr = detail_ptr->mc_ptr)) {
+		xstrfmtcat(key, "|%u|%u|%u|%u|%u|%u|%u|%u|%u",
+			   mc_ptr->boards_per_node, mc_ptr->sockets_per_board,
+			   mc_ptr->sockets_per_node, mc_ptr->cores_per_socket,
+			   mc_ptr->threads_per_core, mc_ptr->ntasks_per_board,
+			   mc_ptr->ntasks_per_socket, mc_ptr->ntasks_per_core,
+			   mc_ptr->plane_size);
+	}
+	xstrfmtcat(key, "|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s",
+		   job_ptr->tres_per_job, job_ptr->tres_per_node,
+		   job_ptr->tres_per_socket, job_ptr->tres_per_task,
+		   job_ptr->cpus_per_tres, job_ptr->mem_per_tres,
+		   job_ptr->licenses, job_ptr->network, job_ptr->mcs_label,
+		   job_ptr->batch_features);
+	xstrfmtcat(key, "|%u|%u|%u|%u|%"PRIu64"|%u|%u",
+		   job_ptr->warn_flags, job_ptr->warn_time, job_ptr->reboot,
+		   job_ptr->power_flags, job_ptr->bit_flags,
+		   job_ptr->req_switch, job_ptr->wait4switch);
+
+	return key;
+}
+
+/* Remember the outcome of testing a job shape for the rest of the cycle */
+static void _bf_shape_add(char **key, time_t start_time)
+{
+	bf_shape_rec_t *shape;
+
+	if (!*key)
+		return;
+	if (xhash_get_str(shape_cache, *key)) {
+		xfree(*key);
+		return;
+	}
+
+	shape = xmalloc(sizeof(bf_shape_rec_t));
+	shape->key = *key;
+	shape->start_time = start_time;
+	*key = NULL;
+	xhash_add(shape_cache, shape);
+}
+
 /* Allocate new user and add to xhash_t map */
 static bf_user_usage_t *_bf_map_add_user(xhash_t *map, uid_t uid)
 {
@@ -1668,6 +1789,8 @@ static int _attempt_backfill(void)
 	time_t tmp_preempt_start_time = 0;
 	bool tmp_preempt_in_progress = false;
 	bitstr_t *tmp_bitmap = NULL;
+	char *shape_key = NULL;
+	bf_shape_rec_t *shape;
 	/* QOS Read lock */
 	assoc_mgr_lock_t qos_read_lock =
 		{ NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK,
@@ -1755,6 +1878,9 @@ static int _attempt_backfill(void)
 
 	sort_job_queue(job_queue);
 
+	if (bf_shape_cache)
+		shape_cache = xhash_init(_bf_shape_key_id, _bf_shape_free);
+
 	/* Ignore nodes that have been set as available during this cycle. */
 	bit_clear_all(bf_ignore_node_bitmap);
 
@@ -1830,6 +1956,8 @@ static int _attempt_backfill(void)
 			}
 			if (stop_backfill)
 				break;
+			/* Jobs may have ended or started, forget old results */
+			xhash_clear(shape_cache);
 			/* Reset backfill scheduling timers, resume testing */
 			sched_start = time(NULL);
 			gettimeofday(&start_tv, NULL);
@@ -2107,6 +2235,32 @@ next_task:
 		    slurm_conf.preempt_mode)
 			time_limit = job_ptr->time_limit = 1;
 
+		/*
+		 * An identical job already failed or was found to start
+		 * beyond the window in this cycle, reuse its result.
+		 */
+		xfree(shape_key);
+		if (shape_cache && !job_no_reserve &&
+		    (shape_key = _job_shape_key(job_ptr, time_limit, min_nodes,
+						req_nodes, max_nodes,
+						qos_blocked_until,
+						qos_part_blocked_until))) {
+			if ((shape = xhash_get_str(shape_cache, shape_key))) {
+				slurmctld_diag_stats.bf_shape_cache_hits++;
+				log_flag(BACKFILL, "%pJ matches a job shape tested earlier in this cycle",
+					 job_ptr);
+				_set_job_time_limit(job_ptr, orig_time_limit);
+				if (shape->start_time &&
+				    (!orig_start_time ||
+				     (shape->start_time < orig_start_time)))
+					job_ptr->start_time = shape->start_time;
+				else
+					job_ptr->start_time = orig_start_time;
+				continue;
+			}
+			slurmctld_diag_stats.bf_shape_cache_misses++;
+		}
+
 		later_start = now;
 
 		if (assoc_limit_stop) {
@@ -2159,6 +2313,8 @@ next_task:
 			}
 			if (stop_backfill)
 				break;
+			/* Jobs may have ended or started, forget old results */
+			xhash_clear(shape_cache);
 
 			/* Reset backfill scheduling timers, resume testing */
 			sched_start = time(NULL);
@@ -2305,6 +2461,7 @@ next_task:
 			 * start in different partition it will be 0
 			 */
 			job_ptr->start_time = orig_start_time;
+			_bf_shape_add(&shape_key, 0);
 			continue;
 		}
 
@@ -2419,6 +2576,7 @@ next_task:
 				goto TRY_LATER;
 			}
 			job_ptr->start_time = orig_start_time;
+			_bf_shape_add(&shape_key, 0);
 			continue;	/* not runable in this partition */
 		}
 
@@ -2673,6 +2831,7 @@ skip_start:
 			if (slurm_conf.debug_flags & DEBUG_FLAG_BACKFILL)
 				_dump_job_sched(job_ptr, end_reserve,
 						avail_bitmap);
+			_bf_shape_add(&shape_key, job_ptr->start_time);
 			if ((orig_start_time != 0) &&
 			    (orig_start_time < job_ptr->start_time)) {
 				/* Can start earlier in different partition */
@@ -2878,6 +3037,8 @@ skip_start:
 	}
 	xfree(node_space);
 	FREE_NULL_LIST(job_queue);
+	xfree(shape_key);
+	xhash_free(shape_cache);
 
 	gettimeofday(&bf_time2, NULL);
 	_do_diag_stats(&bf_time1, &bf_time2, node_space_recs);
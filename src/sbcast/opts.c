@@ -59,6 +59,7 @@
 #define OPT_LONG_HELP      0x101
 #define OPT_LONG_USAGE     0x102
 #define OPT_LONG_SEND_LIBS 0x103
+#define OPT_LONG_WINDOW    0x104
 
 
 /* getopt_long options, integers but not characters */
@@ -89,6 +90,7 @@ extern void parse_command_line(int argc, char **argv)
 		{"timeout",   required_argument, 0, 't'},
 		{"verbose",   no_argument,       0, 'v'},
 		{"version",   no_argument,       0, 'V'},
+		{"window",    required_argument, 0, OPT_LONG_WINDOW},
 		{"help",      no_argument,       0, OPT_LONG_HELP},
 		{"usage",     no_argument,       0, OPT_LONG_USAGE},
 		{NULL,        0,                 0, 0}
@@ -141,6 +143,8 @@ extern void parse_command_line(int argc, char **argv)
 		params.block_size = 8 * 1024 * 1024;
 	if ( ( env_val = getenv("SBCAST_TIMEOUT") ) )
 		params.timeout = (atoi(env_val) * 1000);
+	if ((env_val = getenv("SBCAST_WINDOW")))
+		params.window = atoi(env_val);
 
 	optind = 0;
 	while ((opt_char = getopt_long(argc, argv, "C::fF:j:ps:t:vV",
@@ -192,6 +196,9 @@ extern void parse_command_line(int argc, char **argv)
 		case (int) 'V':
 			print_slurm_version();
 			exit(0);
+		case (int) OPT_LONG_WINDOW:
+			params.window = atoi(optarg);
+			break;
 		case (int) OPT_LONG_HELP:
 			_help();
 			exit(0);
@@ -297,6 +304,7 @@ static void _print_options( void )
 	     (params.flags & BCAST_FLAG_SEND_LIBS) ? "true" : "false");
 	info("timeout    = %d", params.timeout);
 	info("verbose    = %d", params.verbose);
+	info("window     = %d", params.window);
 	info("source     = %s", params.src_fname);
 	info("dest       = %s", params.dst_fname);
 	info("-----------------------------");
@@ -305,7 +313,7 @@ static void _print_options( void )
 
 static void _usage( void )
 {
-	printf("Usage: sbcast [--exclude] [-CfFjpvV] [--send-libs] SOURCE DEST\n");
+	printf("Usage: sbcast [--exclude] [-CfFjpvV] [--send-libs] [--window] SOURCE DEST\n");
 }
 
 static void _help( void )
@@ -323,6 +331,7 @@ Usage: sbcast [OPTIONS] SOURCE DEST\n\
   -t, --timeout=secs    specify message timeout (seconds)\n\
   -v, --verbose         provide detailed event logging\n\
   -V, --version         print version information and exit\n\
+  --window=num          blocks sent before waiting for replies\n\
 \nHelp options:\n\
   --help                show this help message\n\
   --usage               display brief usage message\n");
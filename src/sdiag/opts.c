@@ -76,6 +76,7 @@ extern void parse_command_line(int argc, char **argv)
 		{"sort-by-id",	no_argument,	0,	'i'},
 		{"cluster",     required_argument, 0,   'M'},
 		{"clusters",    required_argument, 0,   'M'},
+		{"prometheus",	no_argument,	0,	'p'},
 		{"sort-by-time",no_argument,	0,	't'},
 		{"sort-by-time2",no_argument,	0,	'T'},
 		{"usage",	no_argument,	0,	OPT_LONG_USAGE},
@@ -90,7 +91,7 @@ extern void parse_command_line(int argc, char **argv)
 	/* get defaults from environment */
 	_opt_env();
 
-	while ((opt_char = getopt_long(argc, argv, "ahiM:rtTV", long_options,
+	while ((opt_char = getopt_long(argc, argv, "ahiM:prtTV", long_options,
 				       &option_index)) != -1) {
 		switch (opt_char) {
 			case (int)'?':
@@ -116,6 +117,9 @@ extern void parse_command_line(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case (int)'p':
+				params.prometheus = true;
+				break;
 			case (int)'r':
 				params.mode = STAT_COMMAND_RESET;
 				break;
@@ -147,7 +151,7 @@ extern void parse_command_line(int argc, char **argv)
 
 static void _usage( void )
 {
-	printf("Usage: sdiag [-M cluster] [-aritT]\n");
+	printf("Usage: sdiag [-M cluster] [-apritT]\n");
 }
 
 static void _help( void )
@@ -157,6 +161,7 @@ Usage: sdiag [OPTIONS]\n\
   -a, --all           all statistics\n\
   -r, --reset         reset statistics\n\
   -M, --cluster       direct the request to a specific cluster\n\
+  -p, --prometheus    print statistics in Prometheus text format\n\
   -i, --sort-by-id    sort RPCs by id\n\
   -t, --sort-by-time  sort RPCs by total run time\n\
   -T, --sort-by-time2 sort RPCs by average run time\n\
@@ -58,6 +58,8 @@ struct sdiag_parameters params;
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
+static void _print_lock_stats(void);
+static int  _print_prometheus(void);
 static int  _print_stats(void);
 static void _sort_rpc(void);
 
@@ -85,7 +87,10 @@ int main(int argc, char **argv)
 					  (stats_info_request_msg_t *)&req);
 		if (rc == SLURM_SUCCESS) {
 			_sort_rpc();
-			rc = _print_stats();
+			if (params.prometheus)
+				rc = _print_prometheus();
+			else
+				rc = _print_stats();
 #ifdef MEMORY_LEAK_DEBUG
 			slurm_free_stats_response_msg(buf);
 			xfree(rpc_type_ave_time);
@@ -192,6 +197,76 @@ static int _print_stats(void)
 		printf("\tMean table size: %u\n",
 		       buf->bf_table_size_sum / buf->bf_cycle_counter);
 	}
+	if (buf->bf_shape_cache_hits || buf->bf_shape_cache_misses) {
+		printf("\tShape cache hits: %u\n", buf->bf_shape_cache_hits);
+		printf("\tShape cache misses: %u\n",
+		       buf->bf_shape_cache_misses);
+	}
+
+	printf("\nJob step creation stats (microseconds)\n");
+	printf("\tTotal steps created: %u\n", buf->step_create_cnt);
+	if (buf->step_create_cnt > 0) {
+		printf("\tStep create under lock:  max %u mean %"PRIu64"\n",
+		       buf->step_create_time_max,
+		       buf->step_create_time_sum / buf->step_create_cnt);
+		printf("\tCredential signing:      max %u mean %"PRIu64"\n",
+		       buf->step_cred_sign_time_max,
+		       buf->step_cred_sign_time_sum / buf->step_create_cnt);
+		printf("\tResponse send:           max %u mean %"PRIu64"\n",
+		       buf->step_resp_time_max,
+		       buf->step_resp_time_sum / buf->step_create_cnt);
+	}
+
+	if (buf->recovery_phase_cnt) {
+		printf("\nState recovery at startup (microseconds)\n");
+		for (i = 0; i < buf->recovery_phase_cnt; i++)
+			printf("\t%-20s %u\n", buf->recovery_phase_name[i],
+			       buf->recovery_phase_time[i]);
+	}
+
+	if (buf->mem_rss || buf->mem_pool_cnt) {
+		printf("\nMemory usage\n");
+		if (buf->mem_rss)
+			printf("\tResident set size: %"PRIu64" KiB\n",
+			       buf->mem_rss / 1024);
+		for (i = 0; i < buf->mem_pool_cnt; i++) {
+			stats_mem_pool_t *pool = &buf->mem_pools[i];
+
+			printf("\t%-12s records:%-8u in_use:%-8u in_use_max:%-8u size:%-5u allocs:%"PRIu64"\n",
+			       pool->name, pool->rec_cnt, pool->in_use,
+			       pool->in_use_max, pool->rec_size,
+			       pool->alloc_cnt);
+		}
+		if (buf->mem_str_cnt)
+			printf("\tShared strings: %u (%"PRIu64" bytes) referenced %"PRIu64" times\n",
+			       buf->mem_str_cnt, buf->mem_str_bytes,
+			       buf->mem_str_refs);
+	}
+
+	if (buf->rpc_compress_cnt) {
+		printf("\nCompressed replies\n");
+		printf("\tReplies compressed: %u\n", buf->rpc_compress_cnt);
+		printf("\tBytes before:       %"PRIu64"\n",
+		       buf->rpc_compress_bytes_in);
+		printf("\tBytes after:        %"PRIu64"\n",
+		       buf->rpc_compress_bytes_out);
+		printf("\tMean time:          %"PRIu64" microseconds\n",
+		       buf->rpc_compress_usec / buf->rpc_compress_cnt);
+	}
+
+	if (buf->job_submit_cnt || buf->job_modify_cnt) {
+		printf("\nJob submit plugin stats (microseconds)\n");
+		printf("\tJob submit calls: %u\n", buf->job_submit_cnt);
+		if (buf->job_submit_cnt > 0)
+			printf("\tJob submit:       max %u mean %"PRIu64"\n",
+			       buf->job_submit_time_max,
+			       buf->job_submit_time_sum / buf->job_submit_cnt);
+		printf("\tJob modify calls: %u\n", buf->job_modify_cnt);
+		if (buf->job_modify_cnt > 0)
+			printf("\tJob modify:       max %u mean %"PRIu64"\n",
+			       buf->job_modify_time_max,
+			       buf->job_modify_time_sum / buf->job_modify_cnt);
+	}
 
 	printf("\nLatency for 1000 calls to gettimeofday(): %d microseconds\n",
 	       buf->gettimeofday_latency);
@@ -199,10 +274,18 @@ static int _print_stats(void)
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
 		printf("\t%-40s(%5u) count:%-6u "
-		       "ave_time:%-6u total_time:%"PRIu64"\n",
+		       "ave_time:%-6u total_time:%"PRIu64,
 		       rpc_num2string(buf->rpc_type_id[i]),
 		       buf->rpc_type_id[i], buf->rpc_type_cnt[i],
 		       rpc_type_ave_time[i], buf->rpc_type_time[i]);
+		if (buf->rpc_type_max) {
+			printf(" p50:%u p99:%u max_time:%u "
+			       "total_lock_wait:%"PRIu64,
+			       buf->rpc_type_p50[i], buf->rpc_type_p99[i],
+			       buf->rpc_type_max[i],
+			       buf->rpc_type_lock_wait[i]);
+		}
+		printf("\n");
 	}
 
 	printf("\nRemote Procedure Call statistics by user\n");
@@ -212,13 +295,24 @@ static int _print_stats(void)
 			xstrfmtcat(user, "%u", buf->rpc_user_id[i]);
 
 		printf("\t%-16s(%8u) count:%-6u "
-		       "ave_time:%-6u total_time:%"PRIu64"\n",
+		       "ave_time:%-6u total_time:%"PRIu64,
 		       user, buf->rpc_user_id[i], buf->rpc_user_cnt[i],
 		       rpc_user_ave_time[i], buf->rpc_user_time[i]);
+		if (buf->rpc_user_max) {
+			printf(" p50:%u p99:%u max_time:%u "
+			       "total_lock_wait:%"PRIu64,
+			       buf->rpc_user_p50[i], buf->rpc_user_p99[i],
+			       buf->rpc_user_max[i],
+			       buf->rpc_user_lock_wait[i]);
+		}
+		printf("\n");
 
 		xfree(user);
 	}
 
+	if (buf->lock_stats_cnt)
+		_print_lock_stats();
+
 	printf("\nPending RPC statistics\n");
 	if (buf->rpc_queue_type_count == 0)
 		printf("\tNo pending RPCs\n");
@@ -243,181 +337,415 @@ static int _print_stats(void)
 	return 0;
 }
 
+#define SWAP_RPC(array, i, j, type) do {		\
+	type _tmp = array[i];				\
+	array[i] = array[j];				\
+	array[j] = _tmp;				\
+} while (0)
+
+static void _swap_rpc_type(int i, int j)
+{
+	SWAP_RPC(buf->rpc_type_id, i, j, uint16_t);
+	SWAP_RPC(buf->rpc_type_cnt, i, j, uint32_t);
+	SWAP_RPC(buf->rpc_type_time, i, j, uint64_t);
+	SWAP_RPC(rpc_type_ave_time, i, j, uint32_t);
+	if (buf->rpc_type_max) {
+		SWAP_RPC(buf->rpc_type_max, i, j, uint32_t);
+		SWAP_RPC(buf->rpc_type_p50, i, j, uint32_t);
+		SWAP_RPC(buf->rpc_type_p99, i, j, uint32_t);
+		SWAP_RPC(buf->rpc_type_lock_wait, i, j, uint64_t);
+	}
+}
+
+static void _swap_rpc_user(int i, int j)
+{
+	SWAP_RPC(buf->rpc_user_id, i, j, uint32_t);
+	SWAP_RPC(buf->rpc_user_cnt, i, j, uint32_t);
+	SWAP_RPC(buf->rpc_user_time, i, j, uint64_t);
+	SWAP_RPC(rpc_user_ave_time, i, j, uint32_t);
+	if (buf->rpc_user_max) {
+		SWAP_RPC(buf->rpc_user_max, i, j, uint32_t);
+		SWAP_RPC(buf->rpc_user_p50, i, j, uint32_t);
+		SWAP_RPC(buf->rpc_user_p99, i, j, uint32_t);
+		SWAP_RPC(buf->rpc_user_lock_wait, i, j, uint64_t);
+	}
+}
+
+/* Return true if RPC type record i should be listed after record j */
+static bool _rpc_type_after(int i, int j)
+{
+	switch (params.sort) {
+	case SORT_ID:
+		return (buf->rpc_type_id[i] > buf->rpc_type_id[j]);
+	case SORT_TIME:
+		return (buf->rpc_type_time[i] < buf->rpc_type_time[j]);
+	case SORT_TIME2:
+		return (rpc_type_ave_time[i] < rpc_type_ave_time[j]);
+	default:
+		return (buf->rpc_type_cnt[i] < buf->rpc_type_cnt[j]);
+	}
+}
+
+/* Return true if RPC user record i should be listed after record j */
+static bool _rpc_user_after(int i, int j)
+{
+	switch (params.sort) {
+	case SORT_ID:
+		return (buf->rpc_user_id[i] > buf->rpc_user_id[j]);
+	case SORT_TIME:
+		return (buf->rpc_user_time[i] < buf->rpc_user_time[j]);
+	case SORT_TIME2:
+		return (rpc_user_ave_time[i] < rpc_user_ave_time[j]);
+	default:
+		return (buf->rpc_user_cnt[i] < buf->rpc_user_cnt[j]);
+	}
+}
+
+/* Sort lock statistics by descending total hold time */
+static int _cmp_lock_hold(const void *x, const void *y)
+{
+	const stats_lock_rec_t *rec1 = x, *rec2 = y;
+
+	if (rec1->hold_time > rec2->hold_time)
+		return -1;
+	if (rec1->hold_time < rec2->hold_time)
+		return 1;
+	return 0;
+}
+
+static void _print_lock_stats(void)
+{
+	int i;
+
+	printf("\nSlurmctld lock holders\n");
+	for (i = 0; i < buf->lock_holder_cnt; i++) {
+		stats_lock_holder_t *holder = &buf->lock_holders[i];
+
+		if (holder->writer) {
+			printf("\t%-10s writer:%s since:%s readers:%u\n",
+			       holder->lock_name, holder->writer,
+			       slurm_ctime2(&holder->write_since),
+			       holder->readers);
+		} else {
+			printf("\t%-10s writer:none readers:%u\n",
+			       holder->lock_name, holder->readers);
+		}
+	}
+
+	qsort(buf->lock_stats, buf->lock_stats_cnt, sizeof(stats_lock_rec_t),
+	      _cmp_lock_hold);
+
+	printf("\nSlurmctld lock statistics by caller (microseconds)\n");
+	for (i = 0; i < buf->lock_stats_cnt; i++) {
+		stats_lock_rec_t *rec = &buf->lock_stats[i];
+
+		printf("\t%-40s %-10s %-5s count:%-6u "
+		       "wait_ave:%"PRIu64" wait_p99:%u wait_max:%u "
+		       "hold_ave:%"PRIu64" hold_p99:%u hold_max:%u\n",
+		       rec->caller, rec->lock_name,
+		       (rec->lock_level == 2) ? "write" : "read", rec->count,
+		       rec->count ? (rec->wait_time / rec->count) : 0,
+		       rec->wait_p99, rec->wait_max,
+		       rec->hold_count ?
+		       (rec->hold_time / rec->hold_count) : 0,
+		       rec->hold_p99, rec->hold_max);
+	}
+}
+
+static void _prom_header(const char *name, const char *type,
+			 const char *help)
+{
+	printf("# HELP slurmctld_%s %s\n", name, help);
+	printf("# TYPE slurmctld_%s %s\n", name, type);
+}
+
+static void _prom_value(const char *name, const char *type, const char *help,
+			uint64_t value)
+{
+	_prom_header(name, type, help);
+	printf("slurmctld_%s %"PRIu64"\n", name, value);
+}
+
+static void _prom_rpc(const char *name, const char *label, const char *id,
+		      uint32_t cnt, uint64_t time, uint32_t p50, uint32_t p99,
+		      bool quantiles)
+{
+	if (quantiles) {
+		printf("slurmctld_%s{%s=\"%s\",quantile=\"0.5\"} %u\n",
+		       name, label, id, p50);
+		printf("slurmctld_%s{%s=\"%s\",quantile=\"0.99\"} %u\n",
+		       name, label, id, p99);
+	}
+	printf("slurmctld_%s_sum{%s=\"%s\"} %"PRIu64"\n",
+	       name, label, id, time);
+	printf("slurmctld_%s_count{%s=\"%s\"} %u\n", name, label, id, cnt);
+}
+
+/* Print the statistics in the Prometheus text exposition format */
+static int _print_prometheus(void)
+{
+	int i;
+	char **users;
+
+	if (!buf) {
+		fprintf(stderr, "No data available. Probably slurmctld is not working\n");
+		return -1;
+	}
+
+	_prom_value("server_threads", "gauge", "Server thread count",
+		    buf->server_thread_count);
+	_prom_value("agent_queue_size", "gauge", "Agent queue size",
+		    buf->agent_queue_size);
+	_prom_value("agent_count", "gauge", "Agent count", buf->agent_count);
+	_prom_value("agent_threads", "gauge", "Agent thread count",
+		    buf->agent_thread_count);
+	_prom_value("dbd_agent_queue_size", "gauge", "DBD agent queue size",
+		    buf->dbd_agent_queue_size);
+
+	_prom_value("jobs_submitted", "counter", "Jobs submitted",
+		    buf->jobs_submitted);
+	_prom_value("jobs_started", "counter", "Jobs started",
+		    buf->jobs_started);
+	_prom_value("jobs_completed", "counter", "Jobs completed",
+		    buf->jobs_completed);
+	_prom_value("jobs_canceled", "counter", "Jobs canceled",
+		    buf->jobs_canceled);
+	_prom_value("jobs_failed", "counter", "Jobs failed", buf->jobs_failed);
+	_prom_value("jobs_pending", "gauge", "Jobs pending", buf->jobs_pending);
+	_prom_value("jobs_running", "gauge", "Jobs running", buf->jobs_running);
+
+	_prom_value("schedule_cycle_last_usec", "gauge",
+		    "Last main scheduler cycle", buf->schedule_cycle_last);
+	_prom_value("schedule_cycle_max_usec", "gauge",
+		    "Longest main scheduler cycle", buf->schedule_cycle_max);
+	_prom_value("schedule_cycle_usec_sum", "counter",
+		    "Time spent in main scheduler cycles",
+		    buf->schedule_cycle_sum);
+	_prom_value("schedule_cycles", "counter", "Main scheduler cycles",
+		    buf->schedule_cycle_counter);
+
+	_prom_value("bf_backfilled_jobs", "counter", "Backfilled jobs",
+		    buf->bf_backfilled_jobs);
+	_prom_value("bf_cycle_last_usec", "gauge", "Last backfill cycle",
+		    buf->bf_cycle_last);
+	_prom_value("bf_cycle_max_usec", "gauge", "Longest backfill cycle",
+		    buf->bf_cycle_max);
+	_prom_value("bf_cycle_usec_sum", "counter",
+		    "Time spent in backfill cycles", buf->bf_cycle_sum);
+	_prom_value("bf_cycles", "counter", "Backfill cycles",
+		    buf->bf_cycle_counter);
+	_prom_value("bf_active", "gauge", "Backfill scheduler running",
+		    buf->bf_active);
+	if (buf->bf_shape_cache_hits || buf->bf_shape_cache_misses) {
+		_prom_value("bf_shape_cache_hits", "counter",
+			    "Backfill jobs resolved from the shape cache",
+			    buf->bf_shape_cache_hits);
+		_prom_value("bf_shape_cache_misses", "counter",
+			    "Backfill jobs tested after a shape cache miss",
+			    buf->bf_shape_cache_misses);
+	}
+
+	if (buf->recovery_phase_cnt) {
+		_prom_header("state_recovery_usec", "gauge",
+			     "Time spent in each phase of the state recovery at startup");
+		for (i = 0; i < buf->recovery_phase_cnt; i++)
+			printf("slurmctld_state_recovery_usec{phase=\"%s\"} %u\n",
+			       buf->recovery_phase_name[i],
+			       buf->recovery_phase_time[i]);
+	}
+
+	if (buf->mem_rss)
+		_prom_value("resident_bytes", "gauge",
+			    "Resident set size of slurmctld", buf->mem_rss);
+	if (buf->mem_pool_cnt) {
+		_prom_header("record_pool_records", "gauge",
+			     "Records carved from slabs by record type");
+		for (i = 0; i < buf->mem_pool_cnt; i++)
+			printf("slurmctld_record_pool_records{type=\"%s\"} %u\n",
+			       buf->mem_pools[i].name,
+			       buf->mem_pools[i].rec_cnt);
+		_prom_header("record_pool_in_use", "gauge",
+			     "Records in use by record type");
+		for (i = 0; i < buf->mem_pool_cnt; i++)
+			printf("slurmctld_record_pool_in_use{type=\"%s\"} %u\n",
+			       buf->mem_pools[i].name,
+			       buf->mem_pools[i].in_use);
+		_prom_header("record_pool_allocs", "counter",
+			     "Records handed out by record type");
+		for (i = 0; i < buf->mem_pool_cnt; i++)
+			printf("slurmctld_record_pool_allocs{type=\"%s\"} %"PRIu64"\n",
+			       buf->mem_pools[i].name,
+			       buf->mem_pools[i].alloc_cnt);
+	}
+	if (buf->mem_str_cnt) {
+		_prom_value("shared_strings", "gauge",
+			    "Distinct strings shared by job records",
+			    buf->mem_str_cnt);
+		_prom_value("shared_string_bytes", "gauge",
+			    "Bytes held by strings shared by job records",
+			    buf->mem_str_bytes);
+		_prom_value("shared_string_refs", "gauge",
+			    "Job record fields referring to shared strings",
+			    buf->mem_str_refs);
+	}
+	if (buf->rpc_compress_cnt) {
+		_prom_value("rpc_compressed", "counter",
+			    "Replies sent compressed", buf->rpc_compress_cnt);
+		_prom_value("rpc_compress_bytes_in", "counter",
+			    "Reply bytes before compression",
+			    buf->rpc_compress_bytes_in);
+		_prom_value("rpc_compress_bytes_out", "counter",
+			    "Reply bytes after compression",
+			    buf->rpc_compress_bytes_out);
+		_prom_value("rpc_compress_usec", "counter",
+			    "Time spent compressing replies",
+			    buf->rpc_compress_usec);
+	}
+	if (buf->job_submit_cnt || buf->job_modify_cnt) {
+		_prom_value("job_submit_plugin_calls", "counter",
+			    "Calls to the job_submit plugins on job submit",
+			    buf->job_submit_cnt);
+		_prom_value("job_submit_plugin_usec", "counter",
+			    "Time spent in the job_submit plugins on job submit",
+			    buf->job_submit_time_sum);
+		_prom_value("job_modify_plugin_calls", "counter",
+			    "Calls to the job_submit plugins on job modify",
+			    buf->job_modify_cnt);
+		_prom_value("job_modify_plugin_usec", "counter",
+			    "Time spent in the job_submit plugins on job modify",
+			    buf->job_modify_time_sum);
+	}
+
+	_prom_header("rpc_usec", buf->rpc_type_max ? "summary" : "untyped",
+		     "RPC processing time by message type");
+	for (i = 0; i < buf->rpc_type_size; i++) {
+		_prom_rpc("rpc_usec", "type",
+			  rpc_num2string(buf->rpc_type_id[i]),
+			  buf->rpc_type_cnt[i], buf->rpc_type_time[i],
+			  buf->rpc_type_max ? buf->rpc_type_p50[i] : 0,
+			  buf->rpc_type_max ? buf->rpc_type_p99[i] : 0,
+			  buf->rpc_type_max);
+	}
+
+	users = xcalloc(buf->rpc_user_size + 1, sizeof(char *));
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		if (!(users[i] = uid_to_string_or_null(buf->rpc_user_id[i])))
+			xstrfmtcat(users[i], "%u", buf->rpc_user_id[i]);
+	}
+
+	_prom_header("rpc_user_usec", buf->rpc_user_max ? "summary" : "untyped",
+		     "RPC processing time by user");
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		_prom_rpc("rpc_user_usec", "user", users[i],
+			  buf->rpc_user_cnt[i], buf->rpc_user_time[i],
+			  buf->rpc_user_max ? buf->rpc_user_p50[i] : 0,
+			  buf->rpc_user_max ? buf->rpc_user_p99[i] : 0,
+			  buf->rpc_user_max);
+	}
+
+	if (buf->rpc_type_max) {
+		_prom_header("rpc_max_usec", "gauge",
+			     "Longest RPC by message type");
+		for (i = 0; i < buf->rpc_type_size; i++)
+			printf("slurmctld_rpc_max_usec{type=\"%s\"} %u\n",
+			       rpc_num2string(buf->rpc_type_id[i]),
+			       buf->rpc_type_max[i]);
+		_prom_header("rpc_lock_wait_usec", "counter",
+			     "Time RPCs waited for slurmctld locks by message type");
+		for (i = 0; i < buf->rpc_type_size; i++)
+			printf("slurmctld_rpc_lock_wait_usec{type=\"%s\"} %"PRIu64"\n",
+			       rpc_num2string(buf->rpc_type_id[i]),
+			       buf->rpc_type_lock_wait[i]);
+	}
+	if (buf->rpc_user_max) {
+		_prom_header("rpc_user_max_usec", "gauge",
+			     "Longest RPC by user");
+		for (i = 0; i < buf->rpc_user_size; i++)
+			printf("slurmctld_rpc_user_max_usec{user=\"%s\"} %u\n",
+			       users[i], buf->rpc_user_max[i]);
+		_prom_header("rpc_user_lock_wait_usec", "counter",
+			     "Time RPCs waited for slurmctld locks by user");
+		for (i = 0; i < buf->rpc_user_size; i++)
+			printf("slurmctld_rpc_user_lock_wait_usec{user=\"%s\"} %"PRIu64"\n",
+			       users[i], buf->rpc_user_lock_wait[i]);
+	}
+
+	if (buf->lock_stats_cnt) {
+		_prom_header("lock_wait_usec", "summary",
+			     "Time waiting for slurmctld locks by caller");
+		for (i = 0; i < buf->lock_stats_cnt; i++) {
+			stats_lock_rec_t *rec = &buf->lock_stats[i];
+			char *id = xstrdup_printf("%s\",lock=\"%s\",mode=\"%s",
+						  rec->caller, rec->lock_name,
+						  (rec->lock_level == 2) ?
+						  "write" : "read");
+
+			_prom_rpc("lock_wait_usec", "caller", id, rec->count,
+				  rec->wait_time, rec->wait_p50, rec->wait_p99,
+				  true);
+			xfree(id);
+		}
+		_prom_header("lock_hold_usec", "summary",
+			     "Time holding slurmctld locks by caller");
+		for (i = 0; i < buf->lock_stats_cnt; i++) {
+			stats_lock_rec_t *rec = &buf->lock_stats[i];
+			char *id = xstrdup_printf("%s\",lock=\"%s\",mode=\"%s",
+						  rec->caller, rec->lock_name,
+						  (rec->lock_level == 2) ?
+						  "write" : "read");
+
+			_prom_rpc("lock_hold_usec", "caller", id,
+				  rec->hold_count,
+				  rec->hold_time, rec->hold_p50, rec->hold_p99,
+				  true);
+			xfree(id);
+		}
+	}
+
+	_prom_header("pending_rpcs", "gauge",
+		     "Pending outgoing RPCs by message type");
+	for (i = 0; i < buf->rpc_queue_type_count; i++)
+		printf("slurmctld_pending_rpcs{type=\"%s\"} %u\n",
+		       rpc_num2string(buf->rpc_queue_type_id[i]),
+		       buf->rpc_queue_count[i]);
+
+	for (i = 0; i < buf->rpc_user_size; i++)
+		xfree(users[i]);
+	xfree(users);
+
+	return 0;
+}
+
 static void _sort_rpc(void)
 {
 	int i, j;
-	uint16_t type_id;
-	uint32_t type_ave, type_cnt, user_ave, user_cnt, user_id;
-	uint64_t type_time, user_time;
 
 	rpc_type_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_type_size);
 	rpc_user_ave_time = xmalloc(sizeof(uint32_t) * buf->rpc_user_size);
 
-	if (params.sort == SORT_ID) {
-		for (i = 0; i < buf->rpc_type_size; i++) {
-			for (j = i+1; j < buf->rpc_type_size; j++) {
-				if (buf->rpc_type_id[i] <= buf->rpc_type_id[j])
-					continue;
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
-			}
-		}
-		for (i = 0; i < buf->rpc_user_size; i++) {
-			for (j = i+1; j < buf->rpc_user_size; j++) {
-				if (buf->rpc_user_id[i] <= buf->rpc_user_id[j])
-					continue;
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
-			}
-		}
-	} else if (params.sort == SORT_TIME) {
-		for (i = 0; i < buf->rpc_type_size; i++) {
-			for (j = i+1; j < buf->rpc_type_size; j++) {
-				if (buf->rpc_type_time[i] >= buf->rpc_type_time[j])
-					continue;
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
-			}
-		}
-		for (i = 0; i < buf->rpc_user_size; i++) {
-			for (j = i+1; j < buf->rpc_user_size; j++) {
-				if (buf->rpc_user_time[i] >= buf->rpc_user_time[j])
-					continue;
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
-			}
-		}
-	} else if (params.sort == SORT_TIME2) {
-		for (i = 0; i < buf->rpc_type_size; i++) {
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
-			}
-		}
-		for (i = 0; i < buf->rpc_type_size; i++) {
-			for (j = i+1; j < buf->rpc_type_size; j++) {
-				if (rpc_type_ave_time[i] >= rpc_type_ave_time[j])
-					continue;
-				type_ave  = rpc_type_ave_time[i];
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				rpc_type_ave_time[i]  = rpc_type_ave_time[j];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				rpc_type_ave_time[j]  = type_ave;
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-		}
-		for (i = 0; i < buf->rpc_user_size; i++) {
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
-			}
+	for (i = 0; i < buf->rpc_type_size; i++) {
+		if (buf->rpc_type_cnt[i]) {
+			rpc_type_ave_time[i] = buf->rpc_type_time[i] /
+					       buf->rpc_type_cnt[i];
 		}
-		for (i = 0; i < buf->rpc_user_size; i++) {
-			for (j = i+1; j < buf->rpc_user_size; j++) {
-				if (rpc_user_ave_time[i] >= rpc_user_ave_time[j])
-					continue;
-				user_ave  = rpc_user_ave_time[i];
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				rpc_user_ave_time[i]  = rpc_user_ave_time[j];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				rpc_user_ave_time[j]  = user_ave;
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
+	}
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		if (buf->rpc_user_cnt[i]) {
+			rpc_user_ave_time[i] = buf->rpc_user_time[i] /
+					       buf->rpc_user_cnt[i];
 		}
-	} else { /* sort by count */
-		for (i = 0; i < buf->rpc_type_size; i++) {
-			for (j = i+1; j < buf->rpc_type_size; j++) {
-				if (buf->rpc_type_cnt[i] >= buf->rpc_type_cnt[j])
-					continue;
-				type_id   = buf->rpc_type_id[i];
-				type_cnt  = buf->rpc_type_cnt[i];
-				type_time = buf->rpc_type_time[i];
-				buf->rpc_type_id[i]   = buf->rpc_type_id[j];
-				buf->rpc_type_cnt[i]  = buf->rpc_type_cnt[j];
-				buf->rpc_type_time[i] = buf->rpc_type_time[j];
-				buf->rpc_type_id[j]   = type_id;
-				buf->rpc_type_cnt[j]  = type_cnt;
-				buf->rpc_type_time[j] = type_time;
-			}
-			if (buf->rpc_type_cnt[i]) {
-				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
-						       buf->rpc_type_cnt[i];
-			}
+	}
+
+	for (i = 0; i < buf->rpc_type_size; i++) {
+		for (j = i + 1; j < buf->rpc_type_size; j++) {
+			if (_rpc_type_after(i, j))
+				_swap_rpc_type(i, j);
 		}
-		for (i = 0; i < buf->rpc_user_size; i++) {
-			for (j = i+1; j < buf->rpc_user_size; j++) {
-				if (buf->rpc_user_cnt[i] >= buf->rpc_user_cnt[j])
-					continue;
-				user_id   = buf->rpc_user_id[i];
-				user_cnt  = buf->rpc_user_cnt[i];
-				user_time = buf->rpc_user_time[i];
-				buf->rpc_user_id[i]   = buf->rpc_user_id[j];
-				buf->rpc_user_cnt[i]  = buf->rpc_user_cnt[j];
-				buf->rpc_user_time[i] = buf->rpc_user_time[j];
-				buf->rpc_user_id[j]   = user_id;
-				buf->rpc_user_cnt[j]  = user_cnt;
-				buf->rpc_user_time[j] = user_time;
-			}
-			if (buf->rpc_user_cnt[i]) {
-				rpc_user_ave_time[i] = buf->rpc_user_time[i] /
-						       buf->rpc_user_cnt[i];
-			}
+	}
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		for (j = i + 1; j < buf->rpc_user_size; j++) {
+			if (_rpc_user_after(i, j))
+				_swap_rpc_user(i, j);
 		}
 	}
 }
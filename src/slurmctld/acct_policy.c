@@ -40,6 +40,7 @@
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/slurm_accounting_storage.h"
+#include "src/common/xhash.h"
 
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/acct_policy.h"
@@ -548,17 +549,61 @@ static int _find_used_limits_for_acct(void *x, void *key)
 	return 0;
 }
 
-static int _find_used_limits_for_user(void *x, void *key)
+static void _used_limits_acct_id(void *item, const char **key,
+				 uint32_t *key_len)
 {
-	slurmdb_used_limits_t *used_limits = (slurmdb_used_limits_t *)x;
-	uint32_t user_id = *(uint32_t *)key;
+	slurmdb_used_limits_t *used_limits = item;
 
-	if (used_limits->uid == user_id)
-		return 1;
+	*key = used_limits->acct;
+	*key_len = strlen(used_limits->acct);
+}
+
+static void _used_limits_user_id(void *item, const char **key,
+				 uint32_t *key_len)
+{
+	slurmdb_used_limits_t *used_limits = item;
+
+	*key = (const char *) &used_limits->uid;
+	*key_len = sizeof(used_limits->uid);
+}
+
+static int _hash_acct_used_limits(void *x, void *arg)
+{
+	slurmdb_used_limits_t *used_limits = x;
+
+	/* Records without an account are only found by the list search */
+	if (used_limits->acct)
+		xhash_add(arg, used_limits);
+
+	return 0;
+}
+
+static int _hash_user_used_limits(void *x, void *arg)
+{
+	xhash_add(arg, x);
 
 	return 0;
 }
 
+/*
+ * Return the hash indexing a QOS used limits list, creating the list and
+ * its index as needed. The index refers to the records of the list, which
+ * are only ever appended to and freed with it.
+ */
+static xhash_t *_used_limits_hash(List *limit_list, void **hash_ptr,
+				  xhash_idfunc_t idfunc, ListForF add_func)
+{
+	if (!*limit_list)
+		*limit_list = list_create(slurmdb_destroy_used_limits);
+
+	if (!*hash_ptr) {
+		*hash_ptr = xhash_init(idfunc, NULL);
+		list_for_each(*limit_list, add_func, *hash_ptr);
+	}
+
+	return *hash_ptr;
+}
+
 static bool _valid_job_assoc(job_record_t *job_ptr)
 {
 	slurmdb_assoc_rec_t assoc_rec;
@@ -599,10 +644,12 @@ static void _qos_adjust_limit_usage(int type, job_record_t *job_ptr,
 
 	used_limits_a =	acct_policy_get_acct_used_limits(
 		&qos_ptr->usage->acct_limit_list,
+		&qos_ptr->usage->acct_limit_hash,
 		job_ptr->assoc_ptr->acct);
 
 	used_limits = acct_policy_get_user_used_limits(
 		&qos_ptr->usage->user_limit_list,
+		&qos_ptr->usage->user_limit_hash,
 		job_ptr->user_id);
 
 	switch (type) {
@@ -1851,6 +1898,7 @@ static int _qos_policy_validate(job_desc_msg_t *job_desc,
 		slurmdb_used_limits_t *used_limits =
 			acct_policy_get_acct_used_limits(
 				&qos_ptr->usage->acct_limit_list,
+				&qos_ptr->usage->acct_limit_hash,
 				assoc_ptr->acct);
 
 		qos_out_ptr->max_submit_jobs_pa = qos_ptr->max_submit_jobs_pa;
@@ -1874,6 +1922,7 @@ static int _qos_policy_validate(job_desc_msg_t *job_desc,
 		slurmdb_used_limits_t *used_limits =
 			acct_policy_get_user_used_limits(
 				&qos_ptr->usage->user_limit_list,
+				&qos_ptr->usage->user_limit_hash,
 				job_desc->user_id);
 
 		qos_out_ptr->max_submit_jobs_pu = qos_ptr->max_submit_jobs_pu;
@@ -1948,10 +1997,12 @@ static int _qos_job_runnable_pre_select(job_record_t *job_ptr,
 
 	used_limits_a =	acct_policy_get_acct_used_limits(
 		&qos_ptr->usage->acct_limit_list,
+		&qos_ptr->usage->acct_limit_hash,
 		assoc_ptr->acct);
 
 	used_limits = acct_policy_get_user_used_limits(
 		&qos_ptr->usage->user_limit_list,
+		&qos_ptr->usage->user_limit_hash,
 		job_ptr->user_id);
 
 
@@ -2172,10 +2223,12 @@ static int _qos_job_runnable_post_select(job_record_t *job_ptr,
 
 	used_limits_a =	acct_policy_get_acct_used_limits(
 		&qos_ptr->usage->acct_limit_list,
+		&qos_ptr->usage->acct_limit_hash,
 		assoc_ptr->acct);
 
 	used_limits = acct_policy_get_user_used_limits(
 		&qos_ptr->usage->user_limit_list,
+		&qos_ptr->usage->user_limit_hash,
 		job_ptr->user_id);
 
 	tres_usage = _validate_tres_usage_limits_for_qos(
@@ -4485,9 +4538,11 @@ extern int acct_policy_handle_accrue_time(job_record_t *job_ptr,
 	if (qos_ptr) {
 		used_limits_acct = acct_policy_get_acct_used_limits(
 			&qos_ptr->usage->acct_limit_list,
+			&qos_ptr->usage->acct_limit_hash,
 			assoc_ptr->acct);
 		used_limits_user = acct_policy_get_user_used_limits(
 				&qos_ptr->usage->user_limit_list,
+				&qos_ptr->usage->user_limit_hash,
 				job_ptr->user_id);
 	}
 
@@ -4684,9 +4739,11 @@ extern void acct_policy_add_accrue_time(job_record_t *job_ptr,
 	if (qos_ptr) {
 		used_limits_acct = acct_policy_get_acct_used_limits(
 			&qos_ptr->usage->acct_limit_list,
+			&qos_ptr->usage->acct_limit_hash,
 			assoc_ptr->acct);
 		used_limits_user = acct_policy_get_user_used_limits(
 				&qos_ptr->usage->user_limit_list,
+				&qos_ptr->usage->user_limit_hash,
 				job_ptr->user_id);
 	}
 
@@ -4743,9 +4800,11 @@ extern void acct_policy_remove_accrue_time(job_record_t *job_ptr,
 	if (qos_ptr) {
 		used_limits_acct = acct_policy_get_acct_used_limits(
 			&qos_ptr->usage->acct_limit_list,
+			&qos_ptr->usage->acct_limit_hash,
 			assoc_ptr->acct);
 		used_limits_user = acct_policy_get_user_used_limits(
 				&qos_ptr->usage->user_limit_list,
+				&qos_ptr->usage->user_limit_hash,
 				job_ptr->user_id);
 	}
 
@@ -4901,18 +4960,24 @@ extern void acct_policy_set_qos_order(job_record_t *job_ptr,
  * In all cases the user record is returned.
  */
 extern slurmdb_used_limits_t *acct_policy_get_acct_used_limits(
-	List *acct_limit_list, char *acct)
+	List *acct_limit_list, void **acct_limit_hash, char *acct)
 {
 	slurmdb_used_limits_t *used_limits;
+	xhash_t *hash;
 
 	xassert(acct_limit_list);
+	xassert(acct_limit_hash);
 
-	if (!*acct_limit_list)
-		*acct_limit_list = list_create(slurmdb_destroy_used_limits);
+	hash = _used_limits_hash(acct_limit_list, acct_limit_hash,
+				 _used_limits_acct_id, _hash_acct_used_limits);
 
-	if (!(used_limits = list_find_first(*acct_limit_list,
-					    _find_used_limits_for_acct,
-					    acct))) {
+	if (acct)
+		used_limits = xhash_get_str(hash, acct);
+	else
+		used_limits = list_find_first(*acct_limit_list,
+					      _find_used_limits_for_acct,
+					      acct);
+	if (!used_limits) {
 		int i = sizeof(uint64_t) * slurmctld_tres_cnt;
 
 		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
@@ -4922,6 +4987,8 @@ extern slurmdb_used_limits_t *acct_policy_get_acct_used_limits(
 		used_limits->tres_run_mins = xmalloc(i);
 
 		list_append(*acct_limit_list, used_limits);
+		if (acct)
+			xhash_add(hash, used_limits);
 	}
 
 	return used_limits;
@@ -4934,18 +5001,19 @@ extern slurmdb_used_limits_t *acct_policy_get_acct_used_limits(
  * In all cases the user record is returned.
  */
 extern slurmdb_used_limits_t *acct_policy_get_user_used_limits(
-	List *user_limit_list, uint32_t user_id)
+	List *user_limit_list, void **user_limit_hash, uint32_t user_id)
 {
 	slurmdb_used_limits_t *used_limits;
+	xhash_t *hash;
 
 	xassert(user_limit_list);
+	xassert(user_limit_hash);
 
-	if (!*user_limit_list)
-		*user_limit_list = list_create(slurmdb_destroy_used_limits);
+	hash = _used_limits_hash(user_limit_list, user_limit_hash,
+				 _used_limits_user_id, _hash_user_used_limits);
 
-	if (!(used_limits = list_find_first(*user_limit_list,
-					    _find_used_limits_for_user,
-					    &user_id))) {
+	if (!(used_limits = xhash_get(hash, (const char *) &user_id,
+				      sizeof(user_id)))) {
 		int i = sizeof(uint64_t) * slurmctld_tres_cnt;
 
 		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
@@ -4955,6 +5023,7 @@ extern slurmdb_used_limits_t *acct_policy_get_user_used_limits(
 		used_limits->tres_run_mins = xmalloc(i);
 
 		list_append(*user_limit_list, used_limits);
+		xhash_add(hash, used_limits);
 	}
 
 	return used_limits;
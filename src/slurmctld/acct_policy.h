@@ -208,9 +208,9 @@ extern void acct_policy_set_qos_order(job_record_t *job_ptr,
 				      slurmdb_qos_rec_t **qos_ptr_2);
 
 extern slurmdb_used_limits_t *acct_policy_get_acct_used_limits(
-	List *acct_limit_list, char *acct);
+	List *acct_limit_list, void **acct_limit_hash, char *acct);
 
 extern slurmdb_used_limits_t *acct_policy_get_user_used_limits(
-	 List *user_limit_list, uint32_t user_id);
+	 List *user_limit_list, void **user_limit_hash, uint32_t user_id);
 
 #endif /* !_HAVE_ACCT_POLICY_H */
@@ -111,6 +111,7 @@
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
+#include "src/slurmctld/record_pool.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
@@ -897,6 +898,7 @@ int main(int argc, char **argv)
 	route_fini();
 
 	/* purge remaining data structures */
+	record_pool_fini();
 	group_cache_purge();
 	license_free();
 	slurm_cred_ctx_destroy(slurmctld_config.cred_ctx);
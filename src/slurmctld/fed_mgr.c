@@ -48,6 +48,7 @@
 #include "src/common/parse_time.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurmdbd_defs.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/fed_mgr.h"
@@ -62,6 +63,8 @@
 #define FED_MGR_STATE_FILE       "fed_mgr_state"
 #define FED_MGR_CLUSTER_ID_BEGIN 26
 #define TEST_REMOTE_DEP_FREQ 30 /* seconds */
+#define FED_RPC_BATCH_DELAY  10 /* default rpc_batch_delay, msec */
+#define FED_RPC_BATCH_MAX  1000 /* send without further delay */
 
 #define FED_SIBLING_BIT(x) ((uint64_t)1 << (x - 1))
 
@@ -83,7 +86,7 @@ static pthread_mutex_t open_send_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t update_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static List fed_job_list        = NULL;
+static xhash_t *fed_job_hash    = NULL; /* fed_job_info_t's by job id */
 static List fed_job_update_list = NULL;
 static pthread_t       fed_job_update_thread_id = (pthread_t) 0;
 static pthread_mutex_t fed_job_list_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -160,6 +163,7 @@ typedef struct {
 /* Local Structs */
 typedef struct {
 	job_info_msg_t *job_info_msg;
+	xhash_t        *remote_jobs; /* job_info_msg records by job id */
 	uint32_t        sibling_id;
 	char           *sibling_name;
 	time_t          sync_time;
@@ -1235,6 +1239,29 @@ static int _find_sibling_by_id(void *x, void *key)
 	return 0;
 }
 
+static void _fed_job_info_id(void *item, const char **key, uint32_t *key_len)
+{
+	fed_job_info_t *job_info = item;
+
+	*key = (const char *) &job_info->job_id;
+	*key_len = sizeof(job_info->job_id);
+}
+
+/*
+ * Must have fed_job_mutex before entering. Consumes job_info. A record
+ * already held for the job is kept, as the first record of a job was the
+ * one found when these were kept in a list.
+ */
+static void _add_fed_job_info_locked(fed_job_info_t *job_info)
+{
+	if (!fed_job_hash ||
+	    xhash_get(fed_job_hash, (const char *) &job_info->job_id,
+		      sizeof(job_info->job_id)))
+		xfree(job_info);
+	else
+		xhash_add(fed_job_hash, job_info);
+}
+
 extern void add_fed_job_info(job_record_t *job_ptr)
 {
 	fed_job_info_t *job_info;
@@ -1245,53 +1272,27 @@ extern void add_fed_job_info(job_record_t *job_ptr)
 	job_info->siblings_viable = job_ptr->fed_details->siblings_viable;
 
 	slurm_mutex_lock(&fed_job_list_mutex);
-	if (fed_job_list)
-		list_append(fed_job_list, job_info);
-	else
-		xfree(job_info);
+	_add_fed_job_info_locked(job_info);
 	slurm_mutex_unlock(&fed_job_list_mutex);
 }
 
-static int _delete_fed_job_info_by_id(void *object, void *arg)
-{
-	fed_job_info_t *job_info = (fed_job_info_t *)object;
-	uint32_t job_id          = *(uint32_t *)arg;
-
-	if (job_info->job_id == job_id)
-		return true;
-
-	return false;
-}
-
 extern void fed_mgr_remove_fed_job_info(uint32_t job_id)
 {
 	slurm_mutex_lock(&fed_job_list_mutex);
 
-	if (fed_job_list)
-		list_delete_all(fed_job_list, _delete_fed_job_info_by_id,
-				&job_id);
+	if (fed_job_hash)
+		xhash_delete(fed_job_hash, (const char *) &job_id,
+			     sizeof(job_id));
 
 	slurm_mutex_unlock(&fed_job_list_mutex);
 }
 
-static int _list_find_fed_job_info_by_jobid(void *x, void *key)
-{
-	fed_job_info_t *job_info = (fed_job_info_t *)x;
-	uint32_t        job_id   = *(uint32_t *)key;
-
-	if (job_info->job_id == job_id)
-		return 1;
-
-	return 0;
-}
-
 /* Must have fed_job_mutex before entering */
 static fed_job_info_t *_find_fed_job_info(uint32_t job_id)
 {
-	if (!fed_job_list)
+	if (!fed_job_hash)
 		return NULL;
-	return list_find_first(fed_job_list, _list_find_fed_job_info_by_jobid,
-			       &job_id);
+	return xhash_get(fed_job_hash, (const char *) &job_id, sizeof(job_id));
 }
 
 static void _destroy_fed_job_update_info(void *object)
@@ -1737,6 +1738,7 @@ static void _do_fed_job_complete(job_record_t *job_ptr, uint32_t job_state,
 		 * state in place. JOB_SPECIAL_EXIT may be in the
 		 * states. */
 		job_ptr->job_state &= ~(JOB_PENDING | JOB_COMPLETING);
+		job_array_task_cnt_update(job_ptr);
 		batch_requeue_fini(job_ptr);
 	} else {
 		fed_mgr_job_revoke(job_ptr, true, job_state, exit_code,
@@ -2529,6 +2531,67 @@ static void *_fed_job_update_thread(void *arg)
 	return NULL;
 }
 
+/*
+ * Return how long (in msec) the agent should let newly queued RPCs accumulate
+ * before sending them, based upon FederationParameters=rpc_batch_delay=#
+ */
+static int _rpc_batch_delay(void)
+{
+	static time_t conf_update = 0;
+	static int batch_delay = FED_RPC_BATCH_DELAY;
+	slurmctld_lock_t conf_read_lock = { .conf = READ_LOCK };
+	char *tmp_ptr;
+	int i;
+
+	lock_slurmctld(conf_read_lock);
+	if (conf_update != slurm_conf.last_update) {
+		conf_update = slurm_conf.last_update;
+		batch_delay = FED_RPC_BATCH_DELAY;
+		if ((tmp_ptr = xstrcasestr(slurm_conf.fed_params,
+					   "rpc_batch_delay="))) {
+		/*                          0123456789012345 */
+			i = atoi(tmp_ptr + 16);
+			if ((i < 0) || (i > 1000)) {
+				error("ignoring FederationParameters: rpc_batch_delay of %d",
+				      i);
+			} else {
+				batch_delay = i;
+			}
+		}
+	}
+	unlock_slurmctld(conf_read_lock);
+
+	return batch_delay;
+}
+
+/*
+ * Wait up to batch_delay msec for more RPCs to be queued so that they can be
+ * sent to each sibling in a single REQUEST_CTLD_MULT_MSG.
+ * agent_mutex must be locked.
+ */
+static void _agent_batch_wait(int batch_delay)
+{
+	struct timespec ts, now;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec  += batch_delay / 1000;
+	ts.tv_nsec += (batch_delay % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	while (!slurmctld_config.shutdown_time &&
+	       (agent_queue_size < FED_RPC_BATCH_MAX)) {
+		slurm_cond_timedwait(&agent_cond, &agent_mutex, &ts);
+		clock_gettime(CLOCK_REALTIME, &now);
+		if ((now.tv_sec > ts.tv_sec) ||
+		    ((now.tv_sec == ts.tv_sec) &&
+		     (now.tv_nsec >= ts.tv_nsec)))
+			break;
+	}
+}
+
 /* Start a thread to manage queued agent requests */
 static void *_agent_thread(void *arg)
 {
@@ -2539,7 +2602,7 @@ static void *_agent_thread(void *arg)
 	slurm_msg_t req_msg, resp_msg;
 	ctld_list_msg_t ctld_req_msg;
 	bitstr_t *success_bits;
-	int rc, resp_inx, success_size;
+	int rc, resp_inx, success_size, batch_delay;
 
 	slurmctld_lock_t fed_read_lock = {
 		NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK, READ_LOCK };
@@ -2551,12 +2614,16 @@ static void *_agent_thread(void *arg)
 #endif
 
 	while (!slurmctld_config.shutdown_time) {
+		batch_delay = _rpc_batch_delay();
+
 		/* Wait for new work or re-issue RPCs after 2 second wait */
 		slurm_mutex_lock(&agent_mutex);
 		if (!slurmctld_config.shutdown_time && !agent_queue_size) {
 			ts.tv_sec  = time(NULL) + 2;
 			slurm_cond_timedwait(&agent_cond, &agent_mutex, &ts);
 		}
+		if (agent_queue_size && batch_delay)
+			_agent_batch_wait(batch_delay);
 		agent_queue_size = 0;
 		slurm_mutex_unlock(&agent_mutex);
 		if (slurmctld_config.shutdown_time)
@@ -2779,8 +2846,8 @@ extern int fed_mgr_init(void *db_conn)
 		goto end_it;
 
 	slurm_mutex_lock(&fed_job_list_mutex);
-	if (!fed_job_list)
-		fed_job_list = list_create(xfree_ptr);
+	if (!fed_job_hash)
+		fed_job_hash = xhash_init(_fed_job_info_id, xfree_ptr);
 	slurm_mutex_unlock(&fed_job_list_mutex);
 
 	/*
@@ -2955,7 +3022,7 @@ extern int fed_mgr_fini(void)
 	_remove_job_watch_thread();
 
 	slurm_mutex_lock(&fed_job_list_mutex);
-	FREE_NULL_LIST(fed_job_list);
+	xhash_free(fed_job_hash);
 	slurm_mutex_unlock(&fed_job_list_mutex);
 
 	FREE_NULL_LIST(fed_job_update_list);
@@ -3122,31 +3189,41 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+typedef struct {
+	buf_t *buffer;
+	uint16_t protocol_version;
+} pack_fed_job_info_args_t;
+
+static void _pack_fed_job_info_walk(void *item, void *arg)
+{
+	pack_fed_job_info_args_t *args = arg;
+
+	_pack_fed_job_info(item, args->buffer, args->protocol_version);
+}
+
 static void _dump_fed_job_list(buf_t *buffer, uint16_t protocol_version)
 {
 	uint32_t count = NO_VAL;
-	fed_job_info_t *fed_job_info;
+	pack_fed_job_info_args_t args = {
+		.buffer = buffer,
+		.protocol_version = protocol_version,
+	};
 
 	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		/*
 		 * Need to be in the lock to prevent the window between getting
-		 * the count and actually looping on the list.
+		 * the count and actually looping on the table.
 		 */
 		slurm_mutex_lock(&fed_job_list_mutex);
-		if (fed_job_list)
-			count = list_count(fed_job_list);
+		if (fed_job_hash)
+			count = xhash_count(fed_job_hash);
 		else
 			count = NO_VAL;
 
 		pack32(count, buffer);
-		if (count && (count != NO_VAL)) {
-			ListIterator itr = list_iterator_create(fed_job_list);
-			while ((fed_job_info = list_next(itr))) {
-				_pack_fed_job_info(fed_job_info, buffer,
-						   protocol_version);
-			}
-			list_iterator_destroy(itr);
-		}
+		if (count && (count != NO_VAL))
+			xhash_walk(fed_job_hash, _pack_fed_job_info_walk,
+				   &args);
 		slurm_mutex_unlock(&fed_job_list_mutex);
 	} else {
 		error("%s: protocol_version %hu not supported.",
@@ -3461,11 +3538,11 @@ static slurmdb_federation_rec_t *_state_load(char *state_save_location)
 		fed_job_info_t *tmp_info;
 
 		slurm_mutex_lock(&fed_job_list_mutex);
-		if (fed_job_list) {
+		if (fed_job_hash) {
 			lock_slurmctld(job_read_lock);
 			while ((tmp_info = list_pop(tmp_list))) {
 				if (find_job_record(tmp_info->job_id))
-					list_append(fed_job_list, tmp_info);
+					_add_fed_job_info_locked(tmp_info);
 				else
 					xfree(tmp_info);
 			}
@@ -5432,11 +5509,17 @@ extern int fed_mgr_update_job_cluster_features(job_record_t *job_ptr,
 	return rc;
 }
 
+static void _remote_job_id(void *item, const char **key, uint32_t *key_len)
+{
+	slurm_job_info_t *remote_job = item;
+
+	*key = (const char *) &remote_job->job_id;
+	*key_len = sizeof(remote_job->job_id);
+}
+
 static int _reconcile_fed_job(job_record_t *job_ptr, reconcile_sib_t *rec_sib)
 {
-	int i;
 	bool found_job = false;
-	job_info_msg_t *remote_jobs_ptr = rec_sib->job_info_msg;
 	uint32_t origin_id    = fed_mgr_get_cluster_id(job_ptr->job_id);
 	uint32_t sibling_id   = rec_sib->sibling_id;
 	uint64_t sibling_bit  = FED_SIBLING_BIT(sibling_id);
@@ -5445,7 +5528,7 @@ static int _reconcile_fed_job(job_record_t *job_ptr, reconcile_sib_t *rec_sib)
 	fed_job_info_t *job_info;
 
 	xassert(job_ptr);
-	xassert(remote_jobs_ptr);
+	xassert(rec_sib->remote_jobs);
 
 	/*
 	 * Only look at jobs that:
@@ -5463,13 +5546,10 @@ static int _reconcile_fed_job(job_record_t *job_ptr, reconcile_sib_t *rec_sib)
 		return SLURM_SUCCESS;
 	}
 
-	for (i = 0; i < remote_jobs_ptr->record_count; i++) {
-		remote_job = &remote_jobs_ptr->job_array[i];
-		if (job_ptr->job_id == remote_job->job_id) {
-			found_job = true;
-			break;
-		}
-	}
+	if ((remote_job = xhash_get(rec_sib->remote_jobs,
+				    (const char *) &job_ptr->job_id,
+				    sizeof(job_ptr->job_id))))
+		found_job = true;
 
 	/* Jobs that originated on the remote sibling */
 	if (origin_id == sibling_id) {
@@ -5702,6 +5782,14 @@ static int _reconcile_fed_job(job_record_t *job_ptr, reconcile_sib_t *rec_sib)
 /*
  * Sync jobs with the given sibling name.
  *
+ * The sibling always sends all of the jobs it shares with us rather than
+ * the jobs changed since the last sync. Job records have no modification
+ * time of their own (job_state alone is assigned directly in over a hundred
+ * places), so a watermark would silently miss changes. The sync also only
+ * runs when a connection to the sibling is (re)established, which is when
+ * either controller may have restarted from older saved state, and
+ * _reconcile_fed_job() kills or revokes jobs based on what it receives.
+ *
  * IN sib_name - name of the sibling to sync with.
  */
 static int _sync_jobs(const char *sib_name, job_info_msg_t *job_info_msg,
@@ -5722,11 +5810,28 @@ static int _sync_jobs(const char *sib_name, job_info_msg_t *job_info_msg,
 	rec_sib.job_info_msg = job_info_msg;
 	rec_sib.sync_time    = sync_time;
 
+	/*
+	 * Index the sibling's jobs so that each local job is matched in
+	 * constant time rather than by scanning all of the sibling's jobs.
+	 * The first record of a job wins, as with the former scan.
+	 */
+	rec_sib.remote_jobs = xhash_init(_remote_job_id, NULL);
+	for (int i = 0; i < job_info_msg->record_count; i++) {
+		slurm_job_info_t *remote_job = &job_info_msg->job_array[i];
+
+		if (!xhash_get(rec_sib.remote_jobs,
+			       (const char *) &remote_job->job_id,
+			       sizeof(remote_job->job_id)))
+			xhash_add(rec_sib.remote_jobs, remote_job);
+	}
+
 	itr = list_iterator_create(job_list);
 	while ((job_ptr = list_next(itr)))
 		_reconcile_fed_job(job_ptr, &rec_sib);
 	list_iterator_destroy(itr);
 
+	xhash_free(rec_sib.remote_jobs);
+
 	sib->fed.sync_recvd = true;
 
 	return SLURM_SUCCESS;
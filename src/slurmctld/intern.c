@@ -0,0 +1,147 @@
+/*****************************************************************************\
+ *  intern.c - shared copies of strings repeated across job records
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xassert.h"
+#include "src/common/xhash.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/intern.h"
+
+#define INTERN_MAGIC 0x1a7e5a11
+
+typedef struct {
+	uint32_t refcnt;
+	uint32_t len;
+#ifndef NDEBUG
+	uint32_t magic;
+#endif
+	char str[];
+} intern_ent_t;
+
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *intern_hash = NULL;
+static uint64_t intern_bytes = 0;
+static uint64_t intern_refs = 0;
+
+static void _intern_ent_id(void *item, const char **key, uint32_t *key_len)
+{
+	intern_ent_t *ent = item;
+
+	*key = ent->str;
+	*key_len = ent->len;
+}
+
+static intern_ent_t *_str2ent(const char *str)
+{
+	intern_ent_t *ent = (intern_ent_t *) (str -
+					      offsetof(intern_ent_t, str));
+
+	xassert(ent->magic == INTERN_MAGIC);
+	return ent;
+}
+
+extern char *intern_str(const char *str)
+{
+	intern_ent_t *ent;
+	uint32_t len;
+
+	if (!str)
+		return NULL;
+
+	len = strlen(str);
+	slurm_mutex_lock(&intern_mutex);
+	if (!intern_hash)
+		intern_hash = xhash_init(_intern_ent_id, NULL);
+	if (!(ent = xhash_get(intern_hash, str, len))) {
+		ent = xmalloc(sizeof(*ent) + len + 1);
+		ent->len = len;
+#ifndef NDEBUG
+		ent->magic = INTERN_MAGIC;
+#endif
+		memcpy(ent->str, str, len);
+		xhash_add(intern_hash, ent);
+		intern_bytes += len + 1;
+	}
+	ent->refcnt++;
+	intern_refs++;
+	slurm_mutex_unlock(&intern_mutex);
+
+	return ent->str;
+}
+
+extern void intern_free(char **str)
+{
+	intern_ent_t *ent;
+
+	if (!*str)
+		return;
+
+	ent = _str2ent(*str);
+	*str = NULL;
+
+	slurm_mutex_lock(&intern_mutex);
+	xassert(ent->refcnt);
+	intern_refs--;
+	if (--ent->refcnt == 0) {
+		xhash_pop(intern_hash, ent->str, ent->len);
+		intern_bytes -= ent->len + 1;
+#ifndef NDEBUG
+		ent->magic = ~INTERN_MAGIC;
+#endif
+		xfree(ent);
+	}
+	slurm_mutex_unlock(&intern_mutex);
+}
+
+extern void intern_replace(char **dst, const char *src)
+{
+	char *old = *dst;
+
+	/* Take the new reference first, src may be the string at *dst */
+	*dst = intern_str(src);
+	intern_free(&old);
+}
+
+extern void intern_stats(uint32_t *str_cnt, uint64_t *str_bytes,
+			 uint64_t *ref_cnt)
+{
+	slurm_mutex_lock(&intern_mutex);
+	*str_cnt = intern_hash ? xhash_count(intern_hash) : 0;
+	*str_bytes = intern_bytes;
+	*ref_cnt = intern_refs;
+	slurm_mutex_unlock(&intern_mutex);
+}
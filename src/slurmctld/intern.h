@@ -0,0 +1,58 @@
+/*****************************************************************************\
+ *  intern.h - shared copies of strings repeated across job records
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_INTERN_H
+#define _HAVE_INTERN_H
+
+#include <inttypes.h>
+
+/*
+ * Interned strings are reference counted, read only copies shared by every
+ * record holding the same value. They must only be released with
+ * intern_free(), never with xfree(), and never modified in place.
+ */
+
+/* Return a shared copy of str, or NULL if str is NULL */
+extern char *intern_str(const char *str);
+
+/* Release a string returned by intern_str() and set the pointer to NULL */
+extern void intern_free(char **str);
+
+/* Replace the interned string at *dst with a shared copy of src */
+extern void intern_replace(char **dst, const char *src);
+
+/* Report the distinct strings held, their total size and reference count */
+extern void intern_stats(uint32_t *str_cnt, uint64_t *str_bytes,
+			 uint64_t *ref_cnt);
+
+#endif /* !_HAVE_INTERN_H */
@@ -94,6 +94,7 @@
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/gres_ctld.h"
+#include "src/slurmctld/intern.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -102,6 +103,7 @@
 #include "src/slurmctld/power_save.h"
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/record_pool.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
@@ -119,8 +121,17 @@
 #define PURGE_OLD_JOB_IN_SEC 2592000 /* 30 days in seconds */
 
 #define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
+/*
+ * Spread the job IDs so that the same task IDs of arrays with consecutive job
+ * IDs do not all land in the same chain.
+ */
 #define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
-	((_job_id + _task_id) % hash_table_size)
+	((((uint64_t) (_job_id)) * 2654435761U + (_task_id)) % hash_table_size)
+
+/* job_record_t->job_array_cnt_flags */
+#define ARRAY_TASK_CNT_IN	0x01	/* Counted in array_recs */
+#define ARRAY_TASK_CNT_PEND	0x02	/* Counted in pend_task_recs */
+#define ARRAY_TASK_CNT_INCOMP	0x04	/* Counted in incomp_task_recs */
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define JOB_STATE_VERSION     "PROTOCOL_VERSION"
@@ -150,6 +161,7 @@ typedef struct {
 	slurmdb_user_rec_t user_rec;
 	bool privileged;
 	part_record_t **allowed_parts;
+	str_dict_t *dict;
 } _foreach_pack_job_info_t;
 
 typedef struct {
@@ -174,6 +186,10 @@ static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
 static struct   job_record **job_hash = NULL;
 static struct   job_record **job_array_hash_j = NULL;
 static struct   job_record **job_array_hash_t = NULL;
+static record_pool_t job_pool =
+	RECORD_POOL_INITIALIZER("job", sizeof(job_record_t));
+static record_pool_t job_details_pool =
+	RECORD_POOL_INITIALIZER("job_details", sizeof(struct job_details));
 static bool     kill_invalid_dep;
 static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
@@ -226,9 +242,11 @@ static void _notify_srun_missing_step(job_record_t *job_ptr, int node_inx,
 static buf_t *_open_job_state_file(char **state_file);
 static time_t _get_last_job_state_write_time(void);
 static void _pack_default_job_details(job_record_t *job_ptr, buf_t *buffer,
-				      uint16_t protocol_version);
+				      uint16_t protocol_version,
+				      str_dict_t *dict);
 static void _pack_pending_job_details(struct job_details *detail_ptr,
-				      buf_t *buffer, uint16_t protocol_version);
+				      buf_t *buffer, uint16_t protocol_version,
+				      str_dict_t *dict);
 static bool _parse_array_tok(char *tok, bitstr_t *array_bitmap, uint32_t max);
 static void _purge_missing_jobs(int node_inx, time_t now);
 static int  _read_data_array_from_file(int fd, char *file_name, char ***data,
@@ -596,12 +614,12 @@ static job_array_resp_msg_t *_resp_array_xlate(resp_array_struct_t *resp,
  *    = 1 - simple job OR job array with one task
  *    > 1 - job array create with the task count as num_jobs
  * RET pointer to the record or NULL if error
- * NOTE: allocates memory that should be xfreed with _list_delete_job
+ * NOTE: allocates memory that should be freed with _list_delete_job
  */
 static job_record_t *_create_job_record(uint32_t num_jobs)
 {
-	job_record_t *job_ptr = xmalloc(sizeof(*job_ptr));
-	struct job_details *detail_ptr = xmalloc(sizeof(*detail_ptr));
+	job_record_t *job_ptr = record_pool_alloc(&job_pool);
+	struct job_details *detail_ptr = record_pool_alloc(&job_details_pool);
 
 	if ((job_count + num_jobs) >= slurm_conf.max_job_cnt) {
 		error("%s: MaxJobCount limit from slurm.conf reached (%u)",
@@ -665,7 +683,7 @@ static void _delete_job_details(job_record_t *job_entry)
 	for (i=0; i<job_entry->details->env_cnt; i++)
 		xfree(job_entry->details->env_sup[i]);
 	xfree(job_entry->details->env_sup);
-	xfree(job_entry->details->std_err);
+	intern_free(&job_entry->details->std_err);
 	FREE_NULL_BITMAP(job_entry->details->exc_node_bitmap);
 	xfree(job_entry->details->exc_nodes);
 	xfree(job_entry->details->extra);
@@ -676,15 +694,16 @@ static void _delete_job_details(job_record_t *job_entry)
 	xfree(job_entry->details->mc_ptr);
 	xfree(job_entry->details->mem_bind);
 	xfree(job_entry->details->req_context);
-	xfree(job_entry->details->std_out);
+	intern_free(&job_entry->details->std_out);
 	xfree(job_entry->details->submit_line);
 	FREE_NULL_BITMAP(job_entry->details->req_node_bitmap);
 	xfree(job_entry->details->req_nodes);
 	xfree(job_entry->details->script);
-	xfree(job_entry->details->work_dir);
+	intern_free(&job_entry->details->work_dir);
 	xfree(job_entry->details->x11_magic_cookie);
 	xfree(job_entry->details->x11_target);
-	xfree(job_entry->details);	/* Must be last */
+	record_pool_free(&job_details_pool, job_entry->details);
+	job_entry->details = NULL;	/* Must be last */
 }
 
 /*
@@ -1204,6 +1223,15 @@ extern int load_all_job_state(void)
 		slurmctld_diag_stats.bf_when_last_cycle = buf_time;
 
 	/*
+	 * Job records are unpacked one at a time on purpose. They are not
+	 * length prefixed and their size depends on the select, gres and step
+	 * data packed by plugins, so finding where each record starts already
+	 * takes a full unpack. _load_job_state() also creates the job record
+	 * in job_list, resolves the partition and association and loads the
+	 * steps into it while unpacking, in one branch per protocol version.
+	 * Those lookups are a list or hash lookup per job, so batching them
+	 * would not save anything measurable next to the unpack itself.
+	 *
 	 * Previously we locked the tres read lock before this loop.  It turned
 	 * out that created a double lock when steps were being loaded during
 	 * the calls to jobacctinfo_create() which also locks the read lock.
@@ -2338,10 +2366,9 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	job_ptr->tres_fmt_req_str = tres_fmt_req_str;
 	tres_fmt_req_str = NULL;
 
-	xfree(job_ptr->account);
-	job_ptr->account = account;
-	xstrtolower(job_ptr->account);
-	account          = NULL;  /* reused, nothing left to free */
+	xstrtolower(account);
+	intern_replace(&job_ptr->account, account);
+	xfree(account);
 	xfree(job_ptr->alloc_node);
 	job_ptr->alloc_node   = alloc_node;
 	alloc_node             = NULL;	/* reused, nothing left to free */
@@ -2404,13 +2431,11 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	xfree(job_ptr->name);		/* in case duplicate record */
 	job_ptr->name         = name;
 	name                  = NULL;	/* reused, nothing left to free */
-	xfree(job_ptr->user_name);
-	job_ptr->user_name    = user_name;
-	user_name             = NULL;   /* reused, nothing left to free */
-	xfree(job_ptr->wckey);		/* in case duplicate record */
-	job_ptr->wckey        = wckey;
-	xstrtolower(job_ptr->wckey);
-	wckey                 = NULL;	/* reused, nothing left to free */
+	intern_replace(&job_ptr->user_name, user_name);
+	xfree(user_name);
+	xstrtolower(wckey);
+	intern_replace(&job_ptr->wckey, wckey);	/* in case duplicate record */
+	xfree(wckey);
 	xfree(job_ptr->network);
 	job_ptr->network      = network;
 	network               = NULL;  /* reused, nothing left to free */
@@ -2430,9 +2455,8 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	job_ptr->het_job_id_set = het_job_id_set;
 	het_job_id_set       = NULL;	/* reused, nothing left to free */
 	job_ptr->het_job_offset = het_job_offset;
-	xfree(job_ptr->partition);
-	job_ptr->partition    = partition;
-	partition             = NULL;	/* reused, nothing left to free */
+	intern_replace(&job_ptr->partition, partition);
+	xfree(partition);
 	job_ptr->part_ptr = part_ptr;
 	job_ptr->part_ptr_list = part_ptr_list;
 	job_ptr->pre_sus_time = pre_sus_time;
@@ -3007,7 +3031,7 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	FREE_NULL_LIST(job_ptr->details->depend_list);
 	xfree(job_ptr->details->dependency);
 	xfree(job_ptr->details->orig_dependency);
-	xfree(job_ptr->details->std_err);
+	intern_free(&job_ptr->details->std_err);
 	for (i=0; i<job_ptr->details->env_cnt; i++)
 		xfree(job_ptr->details->env_sup[i]);
 	xfree(job_ptr->details->env_sup);
@@ -3016,10 +3040,10 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	xfree(job_ptr->details->cluster_features);
 	xfree(job_ptr->details->std_in);
 	xfree(job_ptr->details->mem_bind);
-	xfree(job_ptr->details->std_out);
+	intern_free(&job_ptr->details->std_out);
 	xfree(job_ptr->details->submit_line);
 	xfree(job_ptr->details->req_nodes);
-	xfree(job_ptr->details->work_dir);
+	intern_free(&job_ptr->details->work_dir);
 
 	/* now put the details into the job record */
 	job_ptr->details->acctg_freq = acctg_freq;
@@ -3045,7 +3069,8 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	job_ptr->details->orig_dependency = orig_dependency;
 	job_ptr->details->env_cnt = env_cnt;
 	job_ptr->details->env_sup = env_sup;
-	job_ptr->details->std_err = err;
+	job_ptr->details->std_err = intern_str(err);
+	xfree(err);
 	job_ptr->details->exc_nodes = exc_nodes;
 	job_ptr->details->features = features;
 	job_ptr->details->cluster_features = cluster_features;
@@ -3068,7 +3093,8 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	job_ptr->details->ntasks_per_node = ntasks_per_node;
 	job_ptr->details->num_tasks = num_tasks;
 	job_ptr->details->open_mode = open_mode;
-	job_ptr->details->std_out = out;
+	job_ptr->details->std_out = intern_str(out);
+	xfree(out);
 	job_ptr->details->submit_line = submit_line;
 	job_ptr->details->overcommit = overcommit;
 	job_ptr->details->plane_size = plane_size;
@@ -3079,7 +3105,8 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	job_ptr->details->submit_time = submit_time;
 	job_ptr->details->task_dist = task_dist;
 	job_ptr->details->whole_node = whole_node;
-	job_ptr->details->work_dir = work_dir;
+	job_ptr->details->work_dir = intern_str(work_dir);
+	xfree(work_dir);
 
 	return SLURM_SUCCESS;
 
@@ -3108,6 +3135,118 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static uint8_t _array_task_cnt_flags(job_record_t *job_ptr)
+{
+	uint8_t flags = ARRAY_TASK_CNT_IN;
+
+	if (IS_JOB_PENDING(job_ptr))
+		flags |= ARRAY_TASK_CNT_PEND;
+	if (!IS_JOB_COMPLETED(job_ptr))
+		flags |= ARRAY_TASK_CNT_INCOMP;
+
+	return flags;
+}
+
+/* Move a task record from the counts of its current flags to new_flags */
+static void _array_task_cnt_set(job_array_struct_t *array_recs,
+				job_record_t *job_ptr, uint8_t new_flags)
+{
+	uint8_t old_flags = job_ptr->job_array_cnt_flags;
+
+	if (old_flags & ARRAY_TASK_CNT_PEND)
+		array_recs->pend_task_recs--;
+	if (old_flags & ARRAY_TASK_CNT_INCOMP)
+		array_recs->incomp_task_recs--;
+	if (new_flags & ARRAY_TASK_CNT_PEND)
+		array_recs->pend_task_recs++;
+	if (new_flags & ARRAY_TASK_CNT_INCOMP)
+		array_recs->incomp_task_recs++;
+	job_ptr->job_array_cnt_flags = new_flags;
+}
+
+/*
+ * Return the meta job record's array_recs if its task record counts are
+ * set, NULL otherwise.
+ */
+static job_array_struct_t *_array_task_cnt_recs(uint32_t array_job_id)
+{
+	job_record_t *meta_ptr = find_job_record(array_job_id);
+
+	if (!meta_ptr || !meta_ptr->array_recs ||
+	    !meta_ptr->array_recs->task_recs_valid)
+		return NULL;
+
+	return meta_ptr->array_recs;
+}
+
+/*
+ * Get the array_recs of a job array with its task record counts set,
+ * counting the records of job_array_hash_j the first time (e.g. after the
+ * job state was loaded). The records are then counted as they are added,
+ * change state and are removed.
+ * IN meta_ptr - meta job record of the array or NULL
+ * RET NULL if meta_ptr is not a job array meta job record
+ */
+static job_array_struct_t *_array_task_cnts(job_record_t *meta_ptr)
+{
+	job_array_struct_t *array_recs;
+	job_record_t *job_ptr;
+
+	if (!meta_ptr || !(array_recs = meta_ptr->array_recs))
+		return NULL;
+	if (array_recs->task_recs_valid) {
+#ifndef NDEBUG
+		/*
+		 * Recount to catch a task record state change which skipped
+		 * job_array_task_cnt_update()
+		 */
+		uint32_t pend_cnt = 0, incomp_cnt = 0;
+		uint8_t flags;
+
+		job_ptr = job_array_hash_j[JOB_HASH_INX(meta_ptr->array_job_id)];
+		for ( ; job_ptr; job_ptr = job_ptr->job_array_next_j) {
+			if (job_ptr->array_job_id != meta_ptr->array_job_id)
+				continue;
+			flags = _array_task_cnt_flags(job_ptr);
+			xassert(job_ptr->job_array_cnt_flags == flags);
+			if (flags & ARRAY_TASK_CNT_PEND)
+				pend_cnt++;
+			if (flags & ARRAY_TASK_CNT_INCOMP)
+				incomp_cnt++;
+		}
+		xassert(array_recs->pend_task_recs == pend_cnt);
+		xassert(array_recs->incomp_task_recs == incomp_cnt);
+#endif
+		return array_recs;
+	}
+
+	array_recs->pend_task_recs = 0;
+	array_recs->incomp_task_recs = 0;
+	job_ptr = job_array_hash_j[JOB_HASH_INX(meta_ptr->array_job_id)];
+	for ( ; job_ptr; job_ptr = job_ptr->job_array_next_j) {
+		if (job_ptr->array_job_id != meta_ptr->array_job_id)
+			continue;
+		job_ptr->job_array_cnt_flags = 0;
+		_array_task_cnt_set(array_recs, job_ptr,
+				    _array_task_cnt_flags(job_ptr));
+	}
+	array_recs->task_recs_valid = true;
+
+	return array_recs;
+}
+
+extern void job_array_task_cnt_update(job_record_t *job_ptr)
+{
+	job_array_struct_t *array_recs;
+
+	if (!(job_ptr->job_array_cnt_flags & ARRAY_TASK_CNT_IN) ||
+	    !(array_recs = _array_task_cnt_recs(job_ptr->array_job_id)))
+		return;
+
+	_array_task_cnt_set(array_recs, job_ptr,
+			    _array_task_cnt_flags(job_ptr));
+}
+
 /* _add_job_hash - add a job hash entry for given job record, job_id must
  *	already be set
  * IN job_ptr - pointer to job record
@@ -3130,7 +3269,8 @@ static void _add_job_hash(job_record_t *job_ptr)
  */
 static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
 {
-	job_record_t *job_ptr, **job_pptr;
+	job_record_t *job_ptr, **job_pptr, *prev_ptr = NULL;
+	job_array_struct_t *array_recs;
 
 	xassert(job_entry);
 
@@ -3141,6 +3281,16 @@ static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
 	case JOB_HASH_ARRAY_JOB:
 		job_pptr = &job_array_hash_j[
 			JOB_HASH_INX(job_entry->array_job_id)];
+		/*
+		 * All tasks of an array share this chain, so unlink through
+		 * job_array_prev_j rather than searching it.
+		 */
+		if (job_entry->job_array_prev_j &&
+		    (job_entry->job_array_prev_j->job_array_next_j ==
+		     job_entry)) {
+			prev_ptr = job_entry->job_array_prev_j;
+			job_pptr = &prev_ptr->job_array_next_j;
+		}
 		break;
 	case JOB_HASH_ARRAY_TASK:
 		job_pptr = &job_array_hash_t[
@@ -3160,6 +3310,7 @@ static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
 			job_pptr = &job_ptr->job_next;
 			break;
 		case JOB_HASH_ARRAY_JOB:
+			prev_ptr = job_ptr;
 			job_pptr = &job_ptr->job_array_next_j;
 			break;
 		case JOB_HASH_ARRAY_TASK:
@@ -3198,7 +3349,16 @@ static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
 		break;
 	case JOB_HASH_ARRAY_JOB:
 		*job_pptr = job_entry->job_array_next_j;
+		if (job_entry->job_array_next_j)
+			job_entry->job_array_next_j->job_array_prev_j =
+				prev_ptr;
 		job_entry->job_array_next_j = NULL;
+		job_entry->job_array_prev_j = NULL;
+		if ((job_entry->job_array_cnt_flags & ARRAY_TASK_CNT_IN) &&
+		    (array_recs =
+		     _array_task_cnt_recs(job_entry->array_job_id)))
+			_array_task_cnt_set(array_recs, job_entry, 0);
+		job_entry->job_array_cnt_flags = 0;
 		break;
 	case JOB_HASH_ARRAY_TASK:
 		*job_pptr = job_entry->job_array_next_t;
@@ -3214,6 +3374,7 @@ static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
  */
 void _add_job_array_hash(job_record_t *job_ptr)
 {
+	job_array_struct_t *array_recs;
 	int inx;
 
 	if (job_ptr->array_task_id == NO_VAL)
@@ -3221,7 +3382,15 @@ void _add_job_array_hash(job_record_t *job_ptr)
 
 	inx = JOB_HASH_INX(job_ptr->array_job_id);
 	job_ptr->job_array_next_j = job_array_hash_j[inx];
+	job_ptr->job_array_prev_j = NULL;
+	if (job_array_hash_j[inx])
+		job_array_hash_j[inx]->job_array_prev_j = job_ptr;
 	job_array_hash_j[inx] = job_ptr;
+	if ((array_recs = _array_task_cnt_recs(job_ptr->array_job_id))) {
+		job_ptr->job_array_cnt_flags = 0;
+		_array_task_cnt_set(array_recs, job_ptr,
+				    _array_task_cnt_flags(job_ptr));
+	}
 
 	inx = JOB_ARRAY_HASH_INX(job_ptr->array_job_id,job_ptr->array_task_id);
 	job_ptr->job_array_next_t = job_array_hash_t[inx];
@@ -3296,6 +3465,7 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 extern bool test_job_array_completed(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
+	job_array_struct_t *array_recs;
 	int inx;
 
 	job_ptr = find_job_record(array_job_id);
@@ -3304,7 +3474,10 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 			return false;
 	}
 
-	/* Need to test individual job array records */
+	if ((array_recs = _array_task_cnts(job_ptr)))
+		return (array_recs->incomp_task_recs == 0);
+
+	/* No meta job record, need to test individual job array records */
 	inx = JOB_HASH_INX(array_job_id);
 	job_ptr = job_array_hash_j[inx];
 	while (job_ptr) {
@@ -3375,6 +3548,7 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 extern bool test_job_array_pending(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
+	job_array_struct_t *array_recs;
 	int inx;
 
 	job_ptr = find_job_record(array_job_id);
@@ -3385,7 +3559,10 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 			return true;
 	}
 
-	/* Need to test individual job array records */
+	if ((array_recs = _array_task_cnts(job_ptr)))
+		return (array_recs->pend_task_recs != 0);
+
+	/* No meta job record, need to test individual job array records */
 	inx = JOB_HASH_INX(array_job_id);
 	job_ptr = job_array_hash_j[inx];
 	while (job_ptr) {
@@ -3403,8 +3580,12 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 extern int num_pending_job_array_tasks(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
+	job_array_struct_t *array_recs;
 	int count = 0, inx;
 
+	if ((array_recs = _array_task_cnts(find_job_record(array_job_id))))
+		return array_recs->pend_task_recs;
+
 	inx = JOB_HASH_INX(array_job_id);
 	job_ptr = job_array_hash_j[inx];
 	while (job_ptr) {
@@ -3544,18 +3725,17 @@ static void _rebuild_part_name_list(job_record_t *job_ptr)
 	bool job_active = false, job_pending = false;
 	part_record_t *part_ptr;
 	ListIterator part_iterator;
-
-	xfree(job_ptr->partition);
+	char *part_names = NULL;
 
 	if (!job_ptr->part_ptr_list) {
-		job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
+		intern_replace(&job_ptr->partition, job_ptr->part_ptr->name);
 		last_job_update = time(NULL);
 		return;
 	}
 
 	if (IS_JOB_RUNNING(job_ptr) || IS_JOB_SUSPENDED(job_ptr)) {
 		job_active = true;
-		job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
+		part_names = xstrdup(job_ptr->part_ptr->name);
 	} else if (IS_JOB_PENDING(job_ptr))
 		job_pending = true;
 
@@ -3568,11 +3748,13 @@ static void _rebuild_part_name_list(job_record_t *job_ptr)
 		}
 		if (job_active && (part_ptr == job_ptr->part_ptr))
 			continue;	/* already added */
-		if (job_ptr->partition)
-			xstrcat(job_ptr->partition, ",");
-		xstrcat(job_ptr->partition, part_ptr->name);
+		if (part_names)
+			xstrcat(part_names, ",");
+		xstrcat(part_names, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
+	intern_replace(&job_ptr->partition, part_names);
+	xfree(part_names);
 	last_job_update = time(NULL);
 }
 
@@ -3940,6 +4122,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 				 * removes the submit we need to add it
 				 * again. */
 				acct_policy_add_job_submit(job_ptr);
+				job_array_task_cnt_update(job_ptr);
 
 				if (!job_ptr->node_bitmap_cg ||
 				    bit_set_count(job_ptr->node_bitmap_cg) == 0)
@@ -4210,6 +4393,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 				 * again.
 				 */
 				acct_policy_add_job_submit(job_ptr);
+				job_array_task_cnt_update(job_ptr);
 
 				if (!job_ptr->node_bitmap_cg ||
 				    bit_set_count(job_ptr->node_bitmap_cg) == 0)
@@ -4618,6 +4802,7 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 
 	job_ptr_pend->job_id   = save_job_id;
 	job_ptr_pend->details  = save_details;
+	job_ptr_pend->job_array_cnt_flags = 0;
 	job_ptr_pend->db_flags = 0;
 	job_ptr_pend->step_list = save_step_list;
 	job_ptr_pend->db_index = save_db_index;
@@ -4626,7 +4811,7 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	slurm_copy_priority_factors_object(job_ptr_pend->prio_factors,
 					   job_ptr->prio_factors);
 
-	job_ptr_pend->account = xstrdup(job_ptr->account);
+	job_ptr_pend->account = intern_str(job_ptr->account);
 	job_ptr_pend->admin_comment = xstrdup(job_ptr->admin_comment);
 	job_ptr_pend->alias_list = xstrdup(job_ptr->alias_list);
 	job_ptr_pend->alloc_node = xstrdup(job_ptr->alloc_node);
@@ -4693,7 +4878,7 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	job_ptr_pend->nodes = NULL;
 	job_ptr_pend->nodes_completing = NULL;
 	job_ptr_pend->origin_cluster = xstrdup(job_ptr->origin_cluster);
-	job_ptr_pend->partition = xstrdup(job_ptr->partition);
+	job_ptr_pend->partition = intern_str(job_ptr->partition);
 	job_ptr_pend->part_ptr_list = part_list_copy(job_ptr->part_ptr_list);
 	/* On jobs that are held the priority_array isn't set up yet,
 	 * so check to see if it exists before copying. */
@@ -4742,8 +4927,8 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	job_ptr_pend->tres_per_socket = xstrdup(job_ptr->tres_per_socket);
 	job_ptr_pend->tres_per_task = xstrdup(job_ptr->tres_per_task);
 
-	job_ptr_pend->user_name = xstrdup(job_ptr->user_name);
-	job_ptr_pend->wckey = xstrdup(job_ptr->wckey);
+	job_ptr_pend->user_name = intern_str(job_ptr->user_name);
+	job_ptr_pend->wckey = intern_str(job_ptr->wckey);
 	job_ptr_pend->deadline = job_ptr->deadline;
 
 	job_details = job_ptr->details;
@@ -4802,11 +4987,11 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	}
 	details_new->req_context = xstrdup(job_details->req_context);
 	details_new->req_nodes = xstrdup(job_details->req_nodes);
-	details_new->std_err = xstrdup(job_details->std_err);
+	details_new->std_err = intern_str(job_details->std_err);
 	details_new->std_in = xstrdup(job_details->std_in);
-	details_new->std_out = xstrdup(job_details->std_out);
+	details_new->std_out = intern_str(job_details->std_out);
 	details_new->submit_line = xstrdup(job_details->submit_line);
-	details_new->work_dir = xstrdup(job_details->work_dir);
+	details_new->work_dir = intern_str(job_details->work_dir);
 	details_new->x11_magic_cookie = xstrdup(job_details->x11_magic_cookie);
 
 	if (job_ptr->fed_details) {
@@ -5559,6 +5744,7 @@ extern int job_signal(job_record_t *job_ptr, uint16_t signal,
 	    (signal == SIGKILL)) {
 		/* Prevent job requeue, otherwise preserve state */
 		job_ptr->job_state = JOB_CANCELLED | JOB_COMPLETING;
+		job_array_task_cnt_update(job_ptr);
 
 		/* build_cg_bitmap() not needed, job already completing */
 		verbose("%s: %u of requeuing %pJ successful",
@@ -6241,6 +6427,7 @@ static int _job_complete(job_record_t *job_ptr, uid_t uid, bool requeue,
 		 * information, we need to add it again.
 		 */
 		acct_policy_add_job_submit(job_ptr);
+		job_array_task_cnt_update(job_ptr);
 		if (node_fail) {
 			info("%s: requeue %pJ due to node failure",
 			     __func__, job_ptr);
@@ -8242,7 +8429,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 		return SLURM_ERROR;
 
 	*job_rec_ptr = job_ptr;
-	job_ptr->partition = xstrdup(job_desc->partition);
+	job_ptr->partition = intern_str(job_desc->partition);
 	if (job_desc->profile != ACCT_GATHER_PROFILE_NOT_SET)
 		job_ptr->profile = job_desc->profile;
 
@@ -8255,7 +8442,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 	}
 
 	job_ptr->name = xstrdup(job_desc->name);
-	job_ptr->wckey = xstrdup(job_desc->wckey);
+	job_ptr->wckey = intern_str(job_desc->wckey);
 
 	/* Since this is only used in the slurmctld, copy it now. */
 	job_ptr->tres_req_cnt = job_desc->tres_req_cnt;
@@ -8276,7 +8463,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 		job_ptr->time_min = job_desc->time_min;
 	job_ptr->alloc_sid  = job_desc->alloc_sid;
 	job_ptr->alloc_node = xstrdup(job_desc->alloc_node);
-	job_ptr->account    = xstrdup(job_desc->account);
+	job_ptr->account    = intern_str(job_desc->account);
 	job_ptr->batch_features = xstrdup(job_desc->batch_features);
 	job_ptr->burst_buffer = xstrdup(job_desc->burst_buffer);
 	job_ptr->network    = xstrdup(job_desc->network);
@@ -8444,11 +8631,11 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 	detail_ptr->orig_pn_min_memory = detail_ptr->pn_min_memory;
 	if (job_desc->pn_min_tmp_disk != NO_VAL)
 		detail_ptr->pn_min_tmp_disk = job_desc->pn_min_tmp_disk;
-	detail_ptr->std_err = xstrdup(job_desc->std_err);
+	detail_ptr->std_err = intern_str(job_desc->std_err);
 	detail_ptr->std_in = xstrdup(job_desc->std_in);
-	detail_ptr->std_out = xstrdup(job_desc->std_out);
+	detail_ptr->std_out = intern_str(job_desc->std_out);
 	detail_ptr->submit_line = xstrdup(job_desc->submit_line);
-	detail_ptr->work_dir = xstrdup(job_desc->work_dir);
+	detail_ptr->work_dir = intern_str(job_desc->work_dir);
 	if (job_desc->begin_time > time(NULL))
 		detail_ptr->begin_time = job_desc->begin_time;
 	job_ptr->select_jobinfo =
@@ -9609,7 +9796,7 @@ static void _list_delete_job(void *job_entry)
 	}
 
 	_delete_job_details(job_ptr);
-	xfree(job_ptr->account);
+	intern_free(&job_ptr->account);
 	xfree(job_ptr->admin_comment);
 	xfree(job_ptr->alias_list);
 	xfree(job_ptr->alloc_node);
@@ -9656,7 +9843,7 @@ static void _list_delete_job(void *job_entry)
 	}
 	xfree(job_ptr->het_job_id_set);
 	FREE_NULL_LIST(job_ptr->het_job_list);
-	xfree(job_ptr->partition);
+	intern_free(&job_ptr->partition);
 	FREE_NULL_LIST(job_ptr->part_ptr_list);
 	xfree(job_ptr->priority_array);
 	slurm_destroy_priority_factors_object(job_ptr->prio_factors);
@@ -9683,8 +9870,8 @@ static void _list_delete_job(void *job_entry)
 	xfree(job_ptr->tres_req_str);
 	xfree(job_ptr->tres_fmt_req_str);
 	select_g_select_jobinfo_free(job_ptr->select_jobinfo);
-	xfree(job_ptr->user_name);
-	xfree(job_ptr->wckey);
+	intern_free(&job_ptr->user_name);
+	intern_free(&job_ptr->wckey);
 	if (job_array_size > job_count) {
 		error("job_count underflow");
 		job_count = 0;
@@ -9692,7 +9879,7 @@ static void _list_delete_job(void *job_entry)
 		job_count -= job_array_size;
 	}
 	job_ptr->job_id = 0;
-	xfree(job_ptr);
+	record_pool_free(&job_pool, job_ptr);
 }
 
 
@@ -9886,7 +10073,7 @@ static int _pack_job(void *object, void *arg)
 
 	pack_job(job_ptr, pack_info->show_flags, pack_info->buffer,
 		 pack_info->protocol_version, pack_info->uid,
-		 pack_info->has_qos_lock);
+		 pack_info->has_qos_lock, pack_info->dict);
 
 	(*pack_info->jobs_packed)++;
 
@@ -9962,6 +10149,21 @@ static buf_t *_pack_init_job_info(uint16_t protocol_version)
 	return buffer;
 }
 
+/*
+ * Clients that can decode them ask for repeated strings to be sent once per
+ * message, see SLURM_PACK_STR_DICT. The dictionary refers to the strings of
+ * the records packed, so it must not outlive the locks held while packing.
+ */
+static str_dict_t *_pack_str_dict_create(uint16_t show_flags,
+					 uint16_t protocol_version)
+{
+	if (!(show_flags & SHOW_STR_DICT) ||
+	    (protocol_version < SLURM_21_08_1_PROTOCOL_VERSION))
+		return NULL;
+
+	return str_dict_create();
+}
+
 /*
  * pack_all_jobs - dump all job information for all jobs in
  *	machine independent form (for network transmission)
@@ -9996,6 +10198,7 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	pack_info.uid              = uid;
 	pack_info.has_qos_lock = true;
 	pack_info.user_rec.uid = uid;
+	pack_info.dict = _pack_str_dict_create(show_flags, protocol_version);
 	if (!(pack_info.show_flags & SHOW_ALL))
 		_build_allowed_parts(&pack_info);
 
@@ -10015,6 +10218,7 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
 	xfree(pack_info.allowed_parts);
+	str_dict_destroy(pack_info.dict);
 }
 
 /*
@@ -10054,6 +10258,7 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 	pack_info.uid              = uid;
 	pack_info.has_qos_lock = true;
 	pack_info.user_rec.uid = uid;
+	pack_info.dict = _pack_str_dict_create(show_flags, protocol_version);
 	if (!(pack_info.show_flags & SHOW_ALL))
 		_build_allowed_parts(&pack_info);
 
@@ -10073,10 +10278,12 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
 	xfree(pack_info.allowed_parts);
+	str_dict_destroy(pack_info.dict);
 }
 
 static int _pack_het_job(job_record_t *job_ptr, uint16_t show_flags,
-			    buf_t *buffer, uint16_t protocol_version, uid_t uid)
+			 buf_t *buffer, uint16_t protocol_version, uid_t uid,
+			 str_dict_t *dict)
 {
 	job_record_t *het_job_ptr;
 	int job_cnt = 0;
@@ -10088,7 +10295,7 @@ static int _pack_het_job(job_record_t *job_ptr, uint16_t show_flags,
 	while ((het_job_ptr = list_next(iter))) {
 		if (het_job_ptr->het_job_id == job_ptr->het_job_id) {
 			pack_job(het_job_ptr, show_flags, buffer,
-				 protocol_version, uid, true);
+				 protocol_version, uid, true, dict);
 			job_cnt++;
 		} else {
 			error("%s: Bad het_job_list for %pJ",
@@ -10120,11 +10327,13 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 	assoc_mgr_lock_t locks = { .qos = READ_LOCK, .user = READ_LOCK };
 	slurmdb_user_rec_t user_rec = { 0 };
 	bool hide_job = false;
+	str_dict_t *dict;
 
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
 
 	buffer = _pack_init_job_info(protocol_version);
+	dict = _pack_str_dict_create(show_flags, protocol_version);
 
 	assoc_mgr_lock(&locks);
 	user_rec.uid = uid;
@@ -10140,15 +10349,15 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 		/* Pack heterogeneous job components */
 		if (!hide_job) {
 			jobs_packed = _pack_het_job(job_ptr, show_flags,
-						       buffer, protocol_version,
-						       uid);
+						    buffer, protocol_version,
+						    uid, dict);
 		}
 	} else if (job_ptr && (job_ptr->array_task_id == NO_VAL) &&
 		   !job_ptr->array_recs) {
 		/* Pack regular (not array) job */
 		if (!hide_job) {
 			pack_job(job_ptr, show_flags, buffer, protocol_version,
-				 uid, true);
+				 uid, true, dict);
 			jobs_packed++;
 		}
 	} else {
@@ -10159,7 +10368,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 			packed_head = true;
 			if (!hide_job) {
 				pack_job(job_ptr, show_flags, buffer,
-					 protocol_version, uid, true);
+					 protocol_version, uid, true, dict);
 				jobs_packed++;
 			}
 		}
@@ -10173,7 +10382,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 					    job_ptr, &user_rec, show_flags))
 					break;
 				pack_job(job_ptr, show_flags, buffer,
-					 protocol_version, uid, true);
+					 protocol_version, uid, true, dict);
 				jobs_packed++;
 			}
 			job_ptr = job_ptr->job_array_next_j;
@@ -10181,6 +10390,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 	}
 
 	assoc_mgr_unlock(&locks);
+	str_dict_destroy(dict);
 
 	if (jobs_packed == 0) {
 		free_buf(buffer);
@@ -10220,11 +10430,13 @@ static void _pack_job_gres(job_record_t *dump_job_ptr, buf_t *buffer,
  * IN/OUT buffer - buffer in which data is placed, pointers automatically
  *	updated
  * IN uid - user requesting the data
+ * IN dict - string dictionary shared by the jobs of one message, or NULL
  * NOTE: change _unpack_job_info_members() in common/slurm_protocol_pack.c
  *	  whenever the data format changes
  */
 void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
-	      uint16_t protocol_version, uid_t uid, bool has_qos_lock)
+	      uint16_t protocol_version, uid_t uid, bool has_qos_lock,
+	      str_dict_t *dict)
 {
 	struct job_details *detail_ptr;
 	time_t accrue_time = 0, begin_time = 0, start_time = 0, end_time = 0;
@@ -10334,7 +10546,7 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 		pack32(dump_job_ptr->priority, buffer);
 		packdouble(dump_job_ptr->billable_tres, buffer);
 
-		packstr(slurm_conf.cluster_name, buffer);
+		packstr_dict(slurm_conf.cluster_name, dict, buffer);
 		/*
 		 * Only send the allocated nodelist since we are only sending
 		 * the number of cpus and nodes that are currently allocated.
@@ -10351,10 +10563,11 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 		packstr(dump_job_ptr->sched_nodes, buffer);
 
 		if (!IS_JOB_PENDING(dump_job_ptr) && dump_job_ptr->part_ptr)
-			packstr(dump_job_ptr->part_ptr->name, buffer);
+			packstr_dict(dump_job_ptr->part_ptr->name, dict,
+				     buffer);
 		else
-			packstr(dump_job_ptr->partition, buffer);
-		packstr(dump_job_ptr->account, buffer);
+			packstr_dict(dump_job_ptr->partition, dict, buffer);
+		packstr_dict(dump_job_ptr->account, dict, buffer);
 		packstr(dump_job_ptr->admin_comment, buffer);
 		pack32(dump_job_ptr->site_factor, buffer);
 		packstr(dump_job_ptr->network, buffer);
@@ -10369,12 +10582,13 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 		if (!has_qos_lock)
 			assoc_mgr_lock(&locks);
 		if (dump_job_ptr->qos_ptr)
-			packstr(dump_job_ptr->qos_ptr->name, buffer);
+			packstr_dict(dump_job_ptr->qos_ptr->name, dict, buffer);
 		else {
 			if (assoc_mgr_qos_list) {
-				packstr(slurmdb_qos_str(assoc_mgr_qos_list,
-							dump_job_ptr->qos_id),
-					buffer);
+				packstr_dict(slurmdb_qos_str(
+						     assoc_mgr_qos_list,
+						     dump_job_ptr->qos_id),
+					     dict, buffer);
 			} else
 				packnull(buffer);
 		}
@@ -10411,12 +10625,12 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 		}
 
 		packstr(dump_job_ptr->name, buffer);
-		packstr(dump_job_ptr->user_name, buffer);
-		packstr(dump_job_ptr->wckey, buffer);
+		packstr_dict(dump_job_ptr->user_name, dict, buffer);
+		packstr_dict(dump_job_ptr->wckey, dict, buffer);
 		pack32(dump_job_ptr->req_switch, buffer);
 		pack32(dump_job_ptr->wait4switch, buffer);
 
-		packstr(dump_job_ptr->alloc_node, buffer);
+		packstr_dict(dump_job_ptr->alloc_node, dict, buffer);
 		if (!IS_JOB_COMPLETING(dump_job_ptr))
 			pack_bit_str_hex(dump_job_ptr->node_bitmap, buffer);
 		else
@@ -10427,7 +10641,7 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 
 		/* A few details are always dumped here */
 		_pack_default_job_details(dump_job_ptr, buffer,
-					  protocol_version);
+					  protocol_version, dict);
 
 		/*
 		 * other job details are only dumped until the job starts
@@ -10435,13 +10649,13 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 		 */
 		if (detail_ptr)
 			_pack_pending_job_details(detail_ptr, buffer,
-						  protocol_version);
+						  protocol_version, dict);
 		else
 			_pack_pending_job_details(NULL, buffer,
-						  protocol_version);
+						  protocol_version, dict);
 		pack64(dump_job_ptr->bit_flags, buffer);
-		packstr(dump_job_ptr->tres_fmt_alloc_str, buffer);
-		packstr(dump_job_ptr->tres_fmt_req_str, buffer);
+		packstr_dict(dump_job_ptr->tres_fmt_alloc_str, dict, buffer);
+		packstr_dict(dump_job_ptr->tres_fmt_req_str, dict, buffer);
 		pack16(dump_job_ptr->start_protocol_ver, buffer);
 
 		if (dump_job_ptr->fed_details) {
@@ -10467,7 +10681,7 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 		packstr(dump_job_ptr->tres_bind, buffer);
 		packstr(dump_job_ptr->tres_freq, buffer);
 		packstr(dump_job_ptr->tres_per_job, buffer);
-		packstr(dump_job_ptr->tres_per_node, buffer);
+		packstr_dict(dump_job_ptr->tres_per_node, dict, buffer);
 		packstr(dump_job_ptr->tres_per_socket, buffer);
 		packstr(dump_job_ptr->tres_per_task, buffer);
 
@@ -10662,16 +10876,16 @@ void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags, buf_t *buffer,
 
 		/* A few details are always dumped here */
 		_pack_default_job_details(dump_job_ptr, buffer,
-					  protocol_version);
+					  protocol_version, NULL);
 
 		/* other job details are only dumped until the job starts
 		 * running (at which time they become meaningless) */
 		if (detail_ptr)
 			_pack_pending_job_details(detail_ptr, buffer,
-						  protocol_version);
+						  protocol_version, NULL);
 		else
 			_pack_pending_job_details(NULL, buffer,
-						  protocol_version);
+						  protocol_version, NULL);
 		pack32((uint32_t)dump_job_ptr->bit_flags, buffer);
 		packstr(dump_job_ptr->tres_fmt_alloc_str, buffer);
 		packstr(dump_job_ptr->tres_fmt_req_str, buffer);
@@ -10740,7 +10954,8 @@ static void _find_node_config(int *cpu_cnt_ptr, int *core_cnt_ptr)
 
 /* pack default job details for "get_job_info" RPC */
 static void _pack_default_job_details(job_record_t *job_ptr, buf_t *buffer,
-				      uint16_t protocol_version)
+				      uint16_t protocol_version,
+				      str_dict_t *dict)
 {
 	int max_cpu_cnt = -1, max_core_cnt = -1;
 	int i;
@@ -10782,7 +10997,7 @@ static void _pack_default_job_details(job_record_t *job_ptr, buf_t *buffer,
 		if (detail_ptr) {
 			packstr(detail_ptr->features, buffer);
 			packstr(detail_ptr->cluster_features, buffer);
-			packstr(detail_ptr->work_dir, buffer);
+			packstr_dict(detail_ptr->work_dir, dict, buffer);
 			packstr(detail_ptr->dependency, buffer);
 
 			if (detail_ptr->argv) {
@@ -11234,7 +11449,8 @@ static void _pack_default_job_details(job_record_t *job_ptr, buf_t *buffer,
 
 /* pack pending job details for "get_job_info" RPC */
 static void _pack_pending_job_details(struct job_details *detail_ptr,
-				      buf_t *buffer, uint16_t protocol_version)
+				      buf_t *buffer, uint16_t protocol_version,
+				      str_dict_t *dict)
 {
 	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		if (detail_ptr) {
@@ -11251,9 +11467,9 @@ static void _pack_pending_job_details(struct job_details *detail_ptr,
 			packstr(detail_ptr->exc_nodes, buffer);
 			pack_bit_str_hex(detail_ptr->exc_node_bitmap, buffer);
 
-			packstr(detail_ptr->std_err, buffer);
-			packstr(detail_ptr->std_in, buffer);
-			packstr(detail_ptr->std_out, buffer);
+			packstr_dict(detail_ptr->std_err, dict, buffer);
+			packstr_dict(detail_ptr->std_in, dict, buffer);
+			packstr_dict(detail_ptr->std_out, dict, buffer);
 
 			pack_multi_core_data(detail_ptr->mc_ptr, buffer,
 					     protocol_version);
@@ -12985,8 +13201,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 
 	if (new_assoc_ptr) {
 		/* Change account/association */
-		xfree(job_ptr->account);
-		job_ptr->account = xstrdup(new_assoc_ptr->acct);
+		intern_replace(&job_ptr->account, new_assoc_ptr->acct);
 		job_ptr->assoc_id = new_assoc_ptr->id;
 		job_ptr->assoc_ptr = new_assoc_ptr;
 
@@ -13787,8 +14002,8 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 			error_code = ESLURM_JOB_NOT_PENDING;
 			goto fini;
 		} else if (detail_ptr) {
-			xfree(detail_ptr->work_dir);
-			detail_ptr->work_dir = xstrdup(job_specs->work_dir);
+			intern_replace(&detail_ptr->work_dir,
+				       job_specs->work_dir);
 			sched_info("%s: setting work_dir to %s for %pJ",
 				   __func__, detail_ptr->work_dir, job_ptr);
 			update_accounting = true;
@@ -13803,8 +14018,8 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 		if (!IS_JOB_PENDING(job_ptr))
 			error_code = ESLURM_JOB_NOT_PENDING;
 		else if (detail_ptr) {
-			xfree(detail_ptr->std_out);
-			detail_ptr->std_out = xstrdup(job_specs->std_out);
+			intern_replace(&detail_ptr->std_out,
+				       job_specs->std_out);
 		}
 	}
 	if (error_code != SLURM_SUCCESS)
@@ -15918,6 +16133,7 @@ extern void job_array_start(job_record_t *job_ptr)
 		if (base_job_ptr && base_job_ptr->array_recs) {
 			base_job_ptr->array_recs->tot_run_tasks++;
 		}
+		job_array_task_cnt_update(job_ptr);
 	}
 }
 
@@ -15981,6 +16197,7 @@ static void _job_array_comp(job_record_t *job_ptr, bool was_running,
 				base_job_ptr->array_recs->tot_run_tasks--;
 			base_job_ptr->array_recs->tot_comp_tasks++;
 		}
+		job_array_task_cnt_update(job_ptr);
 	}
 }
 
@@ -17150,6 +17367,7 @@ reply:
 	acct_policy_add_job_submit(job_ptr);
 
 	acct_policy_update_pending_job(job_ptr);
+	job_array_task_cnt_update(job_ptr);
 
 	if (flags & JOB_SPECIAL_EXIT) {
 		job_ptr->job_state |= JOB_SPECIAL_EXIT;
@@ -17834,12 +18052,12 @@ extern int update_job_wckey(char *module, job_record_t *job_ptr,
 		}
 	}
 
-	xfree(job_ptr->wckey);
 	if (wckey_rec.name && wckey_rec.name[0] != '\0') {
-		job_ptr->wckey = xstrdup(wckey_rec.name);
+		intern_replace(&job_ptr->wckey, wckey_rec.name);
 		info("%s: setting wckey to %s for %pJ",
 		     module, wckey_rec.name, job_ptr);
 	} else {
+		intern_free(&job_ptr->wckey);
 		info("%s: cleared wckey for %pJ", module, job_ptr);
 	}
 
@@ -18052,6 +18270,7 @@ extern void build_cg_bitmap(job_record_t *job_ptr)
 		job_ptr->node_bitmap_cg = bit_alloc(node_record_count);
 		job_ptr->job_state &= (~JOB_COMPLETING);
 	}
+	job_array_task_cnt_update(job_ptr);
 }
 
 /* job_hold_requeue()
@@ -18133,6 +18352,7 @@ extern bool job_hold_requeue(job_record_t *job_ptr)
 	/* Set the job pending */
 	flags = job_ptr->job_state & JOB_STATE_FLAGS;
 	job_ptr->job_state = JOB_PENDING | flags;
+	job_array_task_cnt_update(job_ptr);
 
 	job_ptr->restart_cnt++;
 
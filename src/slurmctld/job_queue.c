@@ -0,0 +1,335 @@
+/*****************************************************************************\
+ *  job_queue.c - order the pending job queue built by build_job_queue()
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include "src/common/list.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/job_scheduler.h"
+#include "src/slurmctld/preempt.h"
+#include "src/slurmctld/slurmctld.h"
+
+static uint16_t bf_hetjob_prio = 0;
+
+extern void sort_job_queue_set_hetjob_prio(uint16_t hetjob_prio)
+{
+	bf_hetjob_prio = hetjob_prio;
+}
+
+/*
+ * sort_job_queue - sort job_queue in descending priority order
+ * IN/OUT job_queue - sorted job queue
+ */
+extern void sort_job_queue(List job_queue)
+{
+	list_sort(job_queue, sort_job_queue2);
+}
+
+/* Save the values sort_job_queue2() would read from the job record */
+static void _job_queue_rec_sort_keys(job_queue_rec_t *job_queue_rec)
+{
+	job_record_t *job_ptr = job_queue_rec->job_ptr;
+
+	job_queue_rec->sort_has_resv = (job_ptr->resv_id != 0) ||
+				       job_queue_rec->resv_ptr;
+	if (job_queue_rec->part_ptr)
+		job_queue_rec->sort_prio_tier =
+			job_queue_rec->part_ptr->priority_tier;
+	if (job_ptr->part_ptr_list && job_ptr->priority_array)
+		job_queue_rec->sort_prio = job_queue_rec->priority;
+	else
+		job_queue_rec->sort_prio = job_ptr->priority;
+	if (job_ptr->details)
+		job_queue_rec->sort_submit_time = job_ptr->details->submit_time;
+	if (job_queue_rec->array_task_id == NO_VAL)
+		job_queue_rec->sort_job_id = job_queue_rec->job_id;
+	else
+		job_queue_rec->sort_job_id = job_ptr->array_job_id;
+}
+
+/* Same order as sort_job_queue2() without preemption or bf_hetjob_prio */
+static int _job_queue_heap_cmp(job_queue_rec_t *job_rec1,
+			       job_queue_rec_t *job_rec2)
+{
+	if (job_rec1->sort_has_resv != job_rec2->sort_has_resv)
+		return job_rec1->sort_has_resv ? -1 : 1;
+	/* As in sort_job_queue2(), tiers only count if both have a partition */
+	if (job_rec1->part_ptr && job_rec2->part_ptr &&
+	    (job_rec1->sort_prio_tier != job_rec2->sort_prio_tier))
+		return (job_rec1->sort_prio_tier > job_rec2->sort_prio_tier) ?
+			-1 : 1;
+	if (job_rec1->sort_prio != job_rec2->sort_prio)
+		return (job_rec1->sort_prio > job_rec2->sort_prio) ? -1 : 1;
+	if (job_rec1->job_ptr->details && job_rec2->job_ptr->details &&
+	    (job_rec1->sort_submit_time != job_rec2->sort_submit_time))
+		return (job_rec1->sort_submit_time <
+			job_rec2->sort_submit_time) ? -1 : 1;
+	if (job_rec1->sort_job_id != job_rec2->sort_job_id)
+		return (job_rec1->sort_job_id < job_rec2->sort_job_id) ? -1 : 1;
+	if (job_rec1->array_task_id != job_rec2->array_task_id)
+		return (job_rec1->array_task_id < job_rec2->array_task_id) ?
+			-1 : 1;
+	return 0;
+}
+
+/* Move rec[inx] down until neither child sorts before it */
+static void _job_queue_heap_down(job_queue_heap_t *heap, int inx)
+{
+	job_queue_rec_t *tmp;
+	int child;
+
+	while ((child = (inx * 2) + 1) < heap->cnt) {
+		if (((child + 1) < heap->cnt) &&
+		    (_job_queue_heap_cmp(heap->rec[child + 1],
+					 heap->rec[child]) < 0))
+			child++;
+		if (_job_queue_heap_cmp(heap->rec[child],
+					heap->rec[inx]) >= 0)
+			break;
+		tmp = heap->rec[inx];
+		heap->rec[inx] = heap->rec[child];
+		heap->rec[child] = tmp;
+		inx = child;
+	}
+}
+
+extern void job_queue_heap_build(job_queue_heap_t *heap, List job_queue)
+{
+	job_queue_rec_t *job_queue_rec;
+	int i;
+
+	heap->cnt = 0;
+	heap->inx = 0;
+	heap->sorted = (bf_hetjob_prio || slurm_preemption_enabled());
+	heap->rec = xcalloc(list_count(job_queue) + 1,
+			    sizeof(job_queue_rec_t *));
+	if (heap->sorted)
+		sort_job_queue(job_queue);
+	while ((job_queue_rec = list_pop(job_queue))) {
+		_job_queue_rec_sort_keys(job_queue_rec);
+		heap->rec[heap->cnt++] = job_queue_rec;
+	}
+	if (heap->sorted)
+		return;
+
+	for (i = (heap->cnt / 2) - 1; i >= 0; i--)
+		_job_queue_heap_down(heap, i);
+}
+
+extern job_queue_rec_t *job_queue_heap_pop(job_queue_heap_t *heap)
+{
+	job_queue_rec_t *job_queue_rec;
+
+	if (heap->inx >= heap->cnt)
+		return NULL;
+
+	if (heap->sorted) {
+		job_queue_rec = heap->rec[heap->inx];
+		heap->rec[heap->inx++] = NULL;
+		return job_queue_rec;
+	}
+
+	job_queue_rec = heap->rec[0];
+	heap->rec[0] = heap->rec[--heap->cnt];
+	heap->rec[heap->cnt] = NULL;
+	_job_queue_heap_down(heap, 0);
+
+	return job_queue_rec;
+}
+
+extern void job_queue_heap_free(job_queue_heap_t *heap)
+{
+	while (heap->cnt > heap->inx)
+		xfree(heap->rec[--heap->cnt]);
+	xfree(heap->rec);
+}
+
+/* Note this differs from the ListCmpF typedef since we want jobs sorted
+ * in order of decreasing priority then submit time and the by increasing
+ * job id */
+extern int sort_job_queue2(void *x, void *y)
+{
+	job_queue_rec_t *job_rec1 = *(job_queue_rec_t **) x;
+	job_queue_rec_t *job_rec2 = *(job_queue_rec_t **) y;
+	het_job_details_t *details = NULL;
+	bool has_resv1, has_resv2;
+	static time_t config_update = 0;
+	static bool preemption_enabled = true;
+	uint32_t job_id1, job_id2;
+	uint32_t p1, p2;
+
+	/* The following block of code is designed to minimize run time in
+	 * typical configurations for this frequently executed function. */
+	if (config_update != slurm_conf.last_update) {
+		preemption_enabled = slurm_preemption_enabled();
+		config_update = slurm_conf.last_update;
+	}
+	if (preemption_enabled) {
+		if (preempt_g_job_preempt_check(job_rec1, job_rec2))
+			return -1;
+		if (preempt_g_job_preempt_check(job_rec2, job_rec1))
+			return 1;
+	}
+
+	if (bf_hetjob_prio && job_rec1->job_ptr->het_job_id &&
+	    (job_rec1->job_ptr->het_job_id !=
+	     job_rec2->job_ptr->het_job_id)) {
+		if ((details = job_rec1->job_ptr->het_details))
+			has_resv1 = details->any_resv;
+		else
+			has_resv1 = (job_rec1->job_ptr->resv_id != 0) ||
+				job_rec1->resv_ptr;
+	} else
+		has_resv1 = (job_rec1->job_ptr->resv_id != 0) ||
+			job_rec1->resv_ptr;
+
+	if (bf_hetjob_prio && job_rec2->job_ptr->het_job_id &&
+	    (job_rec2->job_ptr->het_job_id !=
+	     job_rec1->job_ptr->het_job_id)) {
+		if ((details = job_rec2->job_ptr->het_details))
+			has_resv2 = details->any_resv;
+		else
+			has_resv2 = (job_rec2->job_ptr->resv_id != 0) ||
+				job_rec2->resv_ptr;
+	} else
+		has_resv2 = (job_rec2->job_ptr->resv_id != 0) ||
+			job_rec2->resv_ptr;
+
+	if (has_resv1 && !has_resv2)
+		return -1;
+	if (!has_resv1 && has_resv2)
+		return 1;
+
+	if (job_rec1->part_ptr && job_rec2->part_ptr) {
+		if (bf_hetjob_prio && job_rec1->job_ptr->het_job_id &&
+		    (job_rec1->job_ptr->het_job_id !=
+		     job_rec2->job_ptr->het_job_id)) {
+			if ((details = job_rec1->job_ptr->het_details))
+				p1 = details->priority_tier;
+			else
+				p1 = job_rec1->part_ptr->priority_tier;
+		} else
+			p1 = job_rec1->part_ptr->priority_tier;
+
+		if (bf_hetjob_prio && job_rec2->job_ptr->het_job_id &&
+		    (job_rec2->job_ptr->het_job_id !=
+		     job_rec1->job_ptr->het_job_id)) {
+			if ((details = job_rec2->job_ptr->het_details))
+				p2 = details->priority_tier;
+			else
+				p2 = job_rec2->part_ptr->priority_tier;
+		} else
+			p2 = job_rec2->part_ptr->priority_tier;
+
+		if (p1 < p2)
+			return 1;
+		if (p1 > p2)
+			return -1;
+	}
+
+	if (bf_hetjob_prio && job_rec1->job_ptr->het_job_id &&
+	    (job_rec1->job_ptr->het_job_id !=
+	     job_rec2->job_ptr->het_job_id)) {
+		if ((details = job_rec1->job_ptr->het_details))
+			p1 = details->priority;
+		else {
+			if (job_rec1->job_ptr->part_ptr_list &&
+			    job_rec1->job_ptr->priority_array)
+				p1 = job_rec1->priority;
+			else
+				p1 = job_rec1->job_ptr->priority;
+		}
+	} else {
+		if (job_rec1->job_ptr->part_ptr_list &&
+		    job_rec1->job_ptr->priority_array)
+			p1 = job_rec1->priority;
+		else
+			p1 = job_rec1->job_ptr->priority;
+	}
+
+	if (bf_hetjob_prio && job_rec2->job_ptr->het_job_id &&
+	    (job_rec2->job_ptr->het_job_id !=
+	     job_rec1->job_ptr->het_job_id)) {
+		if ((details = job_rec2->job_ptr->het_details))
+			p2 = details->priority;
+		else {
+			if (job_rec2->job_ptr->part_ptr_list &&
+			    job_rec2->job_ptr->priority_array)
+				p2 = job_rec2->priority;
+			else
+				p2 = job_rec2->job_ptr->priority;
+		}
+	} else {
+		if (job_rec2->job_ptr->part_ptr_list &&
+		    job_rec2->job_ptr->priority_array)
+			p2 = job_rec2->priority;
+		else
+			p2 = job_rec2->job_ptr->priority;
+	}
+
+	if (p1 < p2)
+		return 1;
+	if (p1 > p2)
+		return -1;
+
+	/* If the priorities are the same sort by submission time */
+	if (job_rec1->job_ptr->details && job_rec2->job_ptr->details) {
+		if (job_rec1->job_ptr->details->submit_time >
+		    job_rec2->job_ptr->details->submit_time)
+			return 1;
+		if (job_rec2->job_ptr->details->submit_time >
+		    job_rec1->job_ptr->details->submit_time)
+			return -1;
+	}
+
+	/* If the submission times are the same sort by increasing job id's */
+	if (job_rec1->array_task_id == NO_VAL)
+		job_id1 = job_rec1->job_id;
+	else
+		job_id1 = job_rec1->job_ptr->array_job_id;
+	if (job_rec2->array_task_id == NO_VAL)
+		job_id2 = job_rec2->job_id;
+	else
+		job_id2 = job_rec2->job_ptr->array_job_id;
+	if (job_id1 > job_id2)
+		return 1;
+	else if (job_id1 < job_id2)
+		return -1;
+
+	/* If job IDs match compare task IDs */
+	if (job_rec1->array_task_id > job_rec2->array_task_id)
+		return 1;
+
+	return -1;
+}
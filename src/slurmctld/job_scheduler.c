@@ -81,6 +81,7 @@
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/gres_ctld.h"
+#include "src/slurmctld/intern.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
@@ -986,6 +987,7 @@ static int _schedule(bool full_queue)
 {
 	ListIterator job_iterator = NULL, part_iterator = NULL;
 	List job_queue = NULL;
+	job_queue_heap_t job_queue_heap = { NULL, 0 };
 	int failed_part_cnt = 0, failed_resv_cnt = 0, job_cnt = 0;
 	int error_code, i, j, part_cnt, time_limit, pend_time;
 	uint32_t job_depth = 0, array_task_id;
@@ -1136,6 +1138,7 @@ static int _schedule(bool full_queue)
 			bf_hetjob_prio |= HETJOB_PRIO_MIN;
 			info("bf_hetjob_immediate automatically sets bf_hetjob_prio=min");
 		}
+		sort_job_queue_set_hetjob_prio(bf_hetjob_prio);
 
 		if ((tmp_ptr = xstrcasestr(slurm_conf.sched_params,
 					   "partition_job_depth="))) {
@@ -1346,7 +1349,7 @@ static int _schedule(bool full_queue)
 	} else {
 		job_queue = build_job_queue(false, false);
 		slurmctld_diag_stats.schedule_queue_len = list_count(job_queue);
-		sort_job_queue(job_queue);
+		job_queue_heap_build(&job_queue_heap, job_queue);
 	}
 
 	job_ptr = NULL;
@@ -1404,7 +1407,7 @@ next_part:
 					continue;
 			}
 		} else {
-			job_queue_rec = list_pop(job_queue);
+			job_queue_rec = job_queue_heap_pop(&job_queue_heap);
 			if (!job_queue_rec)
 				break;
 			array_task_id = job_queue_rec->array_task_id;
@@ -1920,6 +1923,7 @@ fail_this_part:	if (fail_by_part) {
 		if (part_iterator)
 			list_iterator_destroy(part_iterator);
 	} else if (job_queue) {
+		job_queue_heap_free(&job_queue_heap);
 		FREE_NULL_LIST(job_queue);
 	}
 	xfree(sched_part_ptr);
@@ -1940,174 +1944,6 @@ out:
 	return job_cnt;
 }
 
-/*
- * sort_job_queue - sort job_queue in descending priority order
- * IN/OUT job_queue - sorted job queue
- */
-extern void sort_job_queue(List job_queue)
-{
-	list_sort(job_queue, sort_job_queue2);
-}
-
-/* Note this differs from the ListCmpF typedef since we want jobs sorted
- * in order of decreasing priority then submit time and the by increasing
- * job id */
-extern int sort_job_queue2(void *x, void *y)
-{
-	job_queue_rec_t *job_rec1 = *(job_queue_rec_t **) x;
-	job_queue_rec_t *job_rec2 = *(job_queue_rec_t **) y;
-	het_job_details_t *details = NULL;
-	bool has_resv1, has_resv2;
-	static time_t config_update = 0;
-	static bool preemption_enabled = true;
-	uint32_t job_id1, job_id2;
-	uint32_t p1, p2;
-
-	/* The following block of code is designed to minimize run time in
-	 * typical configurations for this frequently executed function. */
-	if (config_update != slurm_conf.last_update) {
-		preemption_enabled = slurm_preemption_enabled();
-		config_update = slurm_conf.last_update;
-	}
-	if (preemption_enabled) {
-		if (preempt_g_job_preempt_check(job_rec1, job_rec2))
-			return -1;
-		if (preempt_g_job_preempt_check(job_rec2, job_rec1))
-			return 1;
-	}
-
-	if (bf_hetjob_prio && job_rec1->job_ptr->het_job_id &&
-	    (job_rec1->job_ptr->het_job_id !=
-	     job_rec2->job_ptr->het_job_id)) {
-		if ((details = job_rec1->job_ptr->het_details))
-			has_resv1 = details->any_resv;
-		else
-			has_resv1 = (job_rec1->job_ptr->resv_id != 0) ||
-				job_rec1->resv_ptr;
-	} else
-		has_resv1 = (job_rec1->job_ptr->resv_id != 0) ||
-			job_rec1->resv_ptr;
-
-	if (bf_hetjob_prio && job_rec2->job_ptr->het_job_id &&
-	    (job_rec2->job_ptr->het_job_id !=
-	     job_rec1->job_ptr->het_job_id)) {
-		if ((details = job_rec2->job_ptr->het_details))
-			has_resv2 = details->any_resv;
-		else
-			has_resv2 = (job_rec2->job_ptr->resv_id != 0) ||
-				job_rec2->resv_ptr;
-	} else
-		has_resv2 = (job_rec2->job_ptr->resv_id != 0) ||
-			job_rec2->resv_ptr;
-
-	if (has_resv1 && !has_resv2)
-		return -1;
-	if (!has_resv1 && has_resv2)
-		return 1;
-
-	if (job_rec1->part_ptr && job_rec2->part_ptr) {
-		if (bf_hetjob_prio && job_rec1->job_ptr->het_job_id &&
-		    (job_rec1->job_ptr->het_job_id !=
-		     job_rec2->job_ptr->het_job_id)) {
-			if ((details = job_rec1->job_ptr->het_details))
-				p1 = details->priority_tier;
-			else
-				p1 = job_rec1->part_ptr->priority_tier;
-		} else
-			p1 = job_rec1->part_ptr->priority_tier;
-
-		if (bf_hetjob_prio && job_rec2->job_ptr->het_job_id &&
-		    (job_rec2->job_ptr->het_job_id !=
-		     job_rec1->job_ptr->het_job_id)) {
-			if ((details = job_rec2->job_ptr->het_details))
-				p2 = details->priority_tier;
-			else
-				p2 = job_rec2->part_ptr->priority_tier;
-		} else
-			p2 = job_rec2->part_ptr->priority_tier;
-
-		if (p1 < p2)
-			return 1;
-		if (p1 > p2)
-			return -1;
-	}
-
-	if (bf_hetjob_prio && job_rec1->job_ptr->het_job_id &&
-	    (job_rec1->job_ptr->het_job_id !=
-	     job_rec2->job_ptr->het_job_id)) {
-		if ((details = job_rec1->job_ptr->het_details))
-			p1 = details->priority;
-		else {
-			if (job_rec1->job_ptr->part_ptr_list &&
-			    job_rec1->job_ptr->priority_array)
-				p1 = job_rec1->priority;
-			else
-				p1 = job_rec1->job_ptr->priority;
-		}
-	} else {
-		if (job_rec1->job_ptr->part_ptr_list &&
-		    job_rec1->job_ptr->priority_array)
-			p1 = job_rec1->priority;
-		else
-			p1 = job_rec1->job_ptr->priority;
-	}
-
-	if (bf_hetjob_prio && job_rec2->job_ptr->het_job_id &&
-	    (job_rec2->job_ptr->het_job_id !=
-	     job_rec1->job_ptr->het_job_id)) {
-		if ((details = job_rec2->job_ptr->het_details))
-			p2 = details->priority;
-		else {
-			if (job_rec2->job_ptr->part_ptr_list &&
-			    job_rec2->job_ptr->priority_array)
-				p2 = job_rec2->priority;
-			else
-				p2 = job_rec2->job_ptr->priority;
-		}
-	} else {
-		if (job_rec2->job_ptr->part_ptr_list &&
-		    job_rec2->job_ptr->priority_array)
-			p2 = job_rec2->priority;
-		else
-			p2 = job_rec2->job_ptr->priority;
-	}
-
-	if (p1 < p2)
-		return 1;
-	if (p1 > p2)
-		return -1;
-
-	/* If the priorities are the same sort by submission time */
-	if (job_rec1->job_ptr->details && job_rec2->job_ptr->details) {
-		if (job_rec1->job_ptr->details->submit_time >
-		    job_rec2->job_ptr->details->submit_time)
-			return 1;
-		if (job_rec2->job_ptr->details->submit_time >
-		    job_rec1->job_ptr->details->submit_time)
-			return -1;
-	}
-
-	/* If the submission times are the same sort by increasing job id's */
-	if (job_rec1->array_task_id == NO_VAL)
-		job_id1 = job_rec1->job_id;
-	else
-		job_id1 = job_rec1->job_ptr->array_job_id;
-	if (job_rec2->array_task_id == NO_VAL)
-		job_id2 = job_rec2->job_id;
-	else
-		job_id2 = job_rec2->job_ptr->array_job_id;
-	if (job_id1 > job_id2)
-		return 1;
-	else if (job_id1 < job_id2)
-		return -1;
-
-	/* If job IDs match compare task IDs */
-	if (job_rec1->array_task_id > job_rec2->array_task_id)
-		return 1;
-
-	return -1;
-}
-
 /* The environment" variable is points to one big xmalloc. In order to
  * manipulate the array for a hetjob, we need to split it into an array
  * containing multiple xmalloc variables */
@@ -4899,6 +4735,7 @@ extern void rebuild_job_part_list(job_record_t *job_ptr)
 {
 	ListIterator part_iterator;
 	part_record_t *part_ptr;
+	char *part_names;
 
 	if (!job_ptr->part_ptr_list)
 		return;
@@ -4908,17 +4745,18 @@ extern void rebuild_job_part_list(job_record_t *job_ptr)
 		return;
 	}
 
-	xfree(job_ptr->partition);
-	job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
+	part_names = xstrdup(job_ptr->part_ptr->name);
 
 	part_iterator = list_iterator_create(job_ptr->part_ptr_list);
 	while ((part_ptr = list_next(part_iterator))) {
 		if (part_ptr == job_ptr->part_ptr)
 			continue;
-		xstrcat(job_ptr->partition, ",");
-		xstrcat(job_ptr->partition, part_ptr->name);
+		xstrcat(part_names, ",");
+		xstrcat(part_names, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
+	intern_replace(&job_ptr->partition, part_names);
+	xfree(part_names);
 }
 
 /* cleanup_completing()
@@ -4945,6 +4783,7 @@ void cleanup_completing(job_record_t *job_ptr)
 
 	delete_step_records(job_ptr);
 	job_ptr->job_state &= (~JOB_COMPLETING);
+	job_array_task_cnt_update(job_ptr);
 	job_hold_requeue(job_ptr);
 
 	/*
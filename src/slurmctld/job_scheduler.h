@@ -54,6 +54,12 @@ typedef struct job_queue_rec {
 	slurmctld_resv_t *resv_ptr;     /* If job didn't ask for a reservation,
 					 * this reservation is one it can run
 					 * in without requesting */
+	/* Sort keys saved by job_queue_heap_build() */
+	bool sort_has_resv;
+	uint16_t sort_prio_tier;
+	uint32_t sort_prio;
+	time_t sort_submit_time;
+	uint32_t sort_job_id;
 } job_queue_rec_t;
 
 /* Use as return values for test_job_dependency. */
@@ -237,6 +243,44 @@ extern void sort_job_queue(List job_queue);
  *	in order of decreasing priority */
 extern int sort_job_queue2(void *x, void *y);
 
+/* Set the SchedulerParameters bf_hetjob_prio used by sort_job_queue2() */
+extern void sort_job_queue_set_hetjob_prio(uint16_t hetjob_prio);
+
+/*
+ * Pending job queue kept as a binary heap in the order of sort_job_queue2().
+ * Building it takes linear time and each pop is logarithmic, so a pass which
+ * stops after the first few jobs does not pay for sorting the whole queue.
+ * The sort keys are saved in each record when the heap is built, since the
+ * scheduler changes the priority and reservation of jobs which still have
+ * other records in the heap. When preemption or bf_hetjob_prio make the
+ * order depend on pairs of records, the queue is fully sorted instead.
+ * Records reference job records, so the job locks must be held from build
+ * to free.
+ */
+typedef struct {
+	job_queue_rec_t **rec;
+	int cnt;
+	int inx;	/* Next record to return if sorted */
+	bool sorted;
+} job_queue_heap_t;
+
+/*
+ * job_queue_heap_build - move all records of a job queue previously made by
+ *	build_job_queue() into a heap, leaving job_queue empty
+ * OUT heap - job queue heap, release with job_queue_heap_free()
+ * IN/OUT job_queue - job queue to take the records from
+ */
+extern void job_queue_heap_build(job_queue_heap_t *heap, List job_queue);
+
+/*
+ * job_queue_heap_pop - remove the highest priority record from the heap
+ * RET record or NULL if the heap is empty, the caller must xfree() it
+ */
+extern job_queue_rec_t *job_queue_heap_pop(job_queue_heap_t *heap);
+
+/* Free the heap and any records still in it */
+extern void job_queue_heap_free(job_queue_heap_t *heap);
+
 /*
  * Determine if a job's dependencies are met
  * Inputs: job_ptr
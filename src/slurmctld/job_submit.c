@@ -74,7 +74,11 @@ static int g_context_cnt = -1;
 static slurm_submit_ops_t *ops = NULL;
 static plugin_context_t **g_context = NULL;
 static char *submit_plugin_list = NULL;
-static pthread_mutex_t g_context_lock = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Plugin calls only read the context and may run concurrently, so each
+ * plugin must protect its own state. init and fini take the write lock.
+ */
+static pthread_rwlock_t g_context_lock = PTHREAD_RWLOCK_INITIALIZER;
 static bool init_run = false;
 
 /*
@@ -92,7 +96,7 @@ extern int job_submit_plugin_init(void)
 	if (init_run && (g_context_cnt >= 0))
 		return rc;
 
-	slurm_mutex_lock(&g_context_lock);
+	slurm_rwlock_wrlock(&g_context_lock);
 	if (g_context_cnt >= 0)
 		goto fini;
 
@@ -129,7 +133,7 @@ extern int job_submit_plugin_init(void)
 	xfree(tmp_plugin_list);
 
 fini:
-	slurm_mutex_unlock(&g_context_lock);
+	slurm_rwlock_unlock(&g_context_lock);
 
 	if (rc != SLURM_SUCCESS)
 		job_submit_plugin_fini();
@@ -146,7 +150,7 @@ extern int job_submit_plugin_fini(void)
 {
 	int i, j, rc = SLURM_SUCCESS;
 
-	slurm_mutex_lock(&g_context_lock);
+	slurm_rwlock_wrlock(&g_context_lock);
 	if (g_context_cnt < 0)
 		goto fini;
 
@@ -163,7 +167,7 @@ extern int job_submit_plugin_fini(void)
 	xfree(submit_plugin_list);
 	g_context_cnt = -1;
 
-fini:	slurm_mutex_unlock(&g_context_lock);
+fini:	slurm_rwlock_unlock(&g_context_lock);
 	return rc;
 }
 
@@ -184,12 +188,12 @@ extern int job_submit_plugin_reconfig(void)
 	if (!slurm_conf.job_submit_plugins && !submit_plugin_list)
 		return rc;
 
-	slurm_mutex_lock(&g_context_lock);
+	slurm_rwlock_rdlock(&g_context_lock);
 	if (xstrcmp(slurm_conf.job_submit_plugins, submit_plugin_list))
 		plugin_change = true;
 	else
 		plugin_change = false;
-	slurm_mutex_unlock(&g_context_lock);
+	slurm_rwlock_unlock(&g_context_lock);
 
 	if (plugin_change) {
 		info("JobSubmitPlugins changed to %s",
@@ -214,7 +218,7 @@ extern int job_submit_plugin_submit(job_desc_msg_t *job_desc,
 				    uint32_t submit_uid, char **err_msg)
 {
 	DEF_TIMERS;
-	int i, rc;
+	int i, rc, cnt;
 
 	xassert(verify_lock(CONF_LOCK, READ_LOCK));
 	xassert(verify_lock(JOB_LOCK, READ_LOCK));
@@ -227,15 +231,18 @@ extern int job_submit_plugin_submit(job_desc_msg_t *job_desc,
 	job_desc->site_factor = NO_VAL;
 
 	rc = job_submit_plugin_init();
-	slurm_mutex_lock(&g_context_lock);
+	slurm_rwlock_rdlock(&g_context_lock);
 	/* NOTE: On function entry read locks are set on config, job, node and
 	 * partition structures. Do not attempt to unlock them and then
 	 * lock again (say with a write lock) since doing so will trigger
 	 * a deadlock with the g_context_lock above. */
 	for (i = 0; ((i < g_context_cnt) && (rc == SLURM_SUCCESS)); i++)
 		rc = (*(ops[i].submit))(job_desc, submit_uid, err_msg);
-	slurm_mutex_unlock(&g_context_lock);
+	cnt = g_context_cnt;
+	slurm_rwlock_unlock(&g_context_lock);
 	END_TIMER2("job_submit_plugin_submit");
+	if (cnt > 0)
+		stats_job_submit_record(false, DELTA_TIMER);
 
 	return rc;
 }
@@ -250,7 +257,7 @@ extern int job_submit_plugin_modify(job_desc_msg_t *job_desc,
 				    uint32_t submit_uid)
 {
 	DEF_TIMERS;
-	int i, rc;
+	int i, rc, cnt;
 
 	xassert(verify_lock(CONF_LOCK, READ_LOCK));
 	xassert(verify_lock(JOB_LOCK, READ_LOCK));
@@ -263,11 +270,14 @@ extern int job_submit_plugin_modify(job_desc_msg_t *job_desc,
 	job_desc->site_factor = NO_VAL;
 
 	rc = job_submit_plugin_init();
-	slurm_mutex_lock(&g_context_lock);
+	slurm_rwlock_rdlock(&g_context_lock);
 	for (i = 0; ((i < g_context_cnt) && (rc == SLURM_SUCCESS)); i++)
 		rc = (*(ops[i].modify))(job_desc, job_ptr, submit_uid);
-	slurm_mutex_unlock(&g_context_lock);
+	cnt = g_context_cnt;
+	slurm_rwlock_unlock(&g_context_lock);
 	END_TIMER2("job_submit_plugin_modify");
+	if (cnt > 0)
+		stats_job_submit_record(true, DELTA_TIMER);
 
 	return rc;
 }
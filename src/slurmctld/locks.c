@@ -40,13 +40,67 @@
 #include <errno.h>
 #include <pthread.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
+#include "src/common/pack.h"
+#include "src/common/xstring.h"
+
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* usec this thread spent waiting in lock_slurmctld() */
+static __thread uint64_t thread_lock_wait = 0;
+
+#define LOCK_TYPE_CNT 5
+#define LOCK_LEVEL_CNT 3
+
+static const char *lock_names[LOCK_TYPE_CNT] = {
+	"config", "job", "node", "partition", "federation"
+};
+
+/*
+ * Optional lock statistics, see lock_stats_reconfig(). Entries are keyed by
+ * the address of the caller's __func__ string, lock type and level.
+ */
+typedef struct {
+	const char *caller;		/* NULL if unused */
+	lock_datatype_t type;
+	lock_level_t level;
+	uint32_t cnt;
+	uint64_t wait_sum;
+	uint32_t wait_max;
+	uint32_t wait_hist[LATENCY_HIST_BUCKETS];
+	uint32_t hold_cnt;		/* hold samples, one per unlock */
+	uint64_t hold_sum;
+	uint32_t hold_max;
+	uint32_t hold_hist[LATENCY_HIST_BUCKETS];
+} lock_stat_t;
+
+typedef struct {
+	const char *writer;		/* caller holding the write lock */
+	time_t write_since;
+	uint32_t readers;		/* count of read lock holders */
+} lock_holder_t;
+
+static bool lock_stats_enabled = false;
+static pthread_mutex_t lock_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lock_stat_t *lock_stats = NULL;
+static uint32_t lock_stats_size = 0;	/* always a power of 2 */
+static uint32_t lock_stats_cnt = 0;
+static lock_holder_t lock_holders[LOCK_TYPE_CNT];
+
+/* Locks held by this thread while lock statistics are enabled */
+typedef struct {
+	const char *caller;		/* caller which acquired the lock */
+	lock_level_t level;
+	struct timeval acquired;	/* tv_sec zero if untracked */
+} lock_held_t;
+
+static __thread lock_held_t thread_locks_held[LOCK_TYPE_CNT];
+
 static pthread_rwlock_t slurmctld_locks[5] = {
 	PTHREAD_RWLOCK_INITIALIZER,
 	PTHREAD_RWLOCK_INITIALIZER,
@@ -74,6 +128,28 @@ static __thread bool slurmctld_locked = false;
  */
 
 static __thread slurmctld_lock_t thread_locks;
+#endif
+
+static lock_level_t _lock_level(slurmctld_lock_t *lock_levels,
+				lock_datatype_t datatype)
+{
+	switch (datatype) {
+	case CONF_LOCK:
+		return lock_levels->conf;
+	case JOB_LOCK:
+		return lock_levels->job;
+	case NODE_LOCK:
+		return lock_levels->node;
+	case PART_LOCK:
+		return lock_levels->part;
+	case FED_LOCK:
+		return lock_levels->fed;
+	default:
+		return NO_LOCK;
+	}
+}
+
+#ifndef NDEBUG
 
 static bool _store_locks(slurmctld_lock_t lock_levels)
 {
@@ -104,61 +180,248 @@ static bool _clear_locks(slurmctld_lock_t lock_levels)
 
 extern bool verify_lock(lock_datatype_t datatype, lock_level_t level)
 {
-	return (((lock_level_t *) &thread_locks)[datatype] >= level);
+	return (_lock_level(&thread_locks, datatype) >= level);
 }
 #endif
 
+static long _delta_usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return ((tv2->tv_sec - tv1->tv_sec) * USEC_IN_SEC) +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
+static uint32_t _usec32(long usec)
+{
+	if (usec <= 0)
+		return 0;
+	return MIN(usec, UINT32_MAX);
+}
+
+/*
+ * Find or add the entry for caller/type/level in lock_stats.
+ * Open addressing with linear probing, lock_stats_mutex must be held.
+ */
+static lock_stat_t *_lock_stat_find(const char *caller, lock_datatype_t type,
+				    lock_level_t level)
+{
+	uint64_t hash;
+	uint32_t inx;
+
+	if ((lock_stats_cnt * 2) >= lock_stats_size) {
+		lock_stat_t *old = lock_stats;
+		uint32_t old_size = lock_stats_size;
+
+		lock_stats_size = old_size ? (old_size * 2) : 256;
+		lock_stats = xcalloc(lock_stats_size, sizeof(lock_stat_t));
+		lock_stats_cnt = 0;
+		for (int i = 0; i < old_size; i++) {
+			if (old[i].caller)
+				*_lock_stat_find(old[i].caller, old[i].type,
+						 old[i].level) = old[i];
+		}
+		xfree(old);
+	}
+
+	hash = (uint64_t) (uintptr_t) caller;
+	hash = (hash * 0x9e3779b97f4a7c15ULL) + (type * LOCK_LEVEL_CNT) + level;
+	inx = (hash >> 32) & (lock_stats_size - 1);
+	while (lock_stats[inx].caller &&
+	       ((lock_stats[inx].caller != caller) ||
+		(lock_stats[inx].type != type) ||
+		(lock_stats[inx].level != level)))
+		inx = (inx + 1) & (lock_stats_size - 1);
+
+	if (!lock_stats[inx].caller) {
+		lock_stats[inx].caller = caller;
+		lock_stats[inx].type = type;
+		lock_stats[inx].level = level;
+		lock_stats_cnt++;
+	}
+
+	return &lock_stats[inx];
+}
+
+static void _lock_stat_acquired(lock_datatype_t type, lock_level_t level,
+				const char *caller, long wait,
+				struct timeval *now)
+{
+	lock_stat_t *stat;
+	lock_held_t *held = &thread_locks_held[type];
+	uint32_t usec = _usec32(wait);
+
+	held->caller = caller;
+	held->level = level;
+	held->acquired = *now;
+
+	slurm_mutex_lock(&lock_stats_mutex);
+	stat = _lock_stat_find(caller, type, level);
+	stat->cnt++;
+	stat->wait_sum += usec;
+	stat->wait_max = MAX(stat->wait_max, usec);
+	stat->wait_hist[latency_hist_bucket(usec)]++;
+
+	if (level == WRITE_LOCK) {
+		lock_holders[type].writer = caller;
+		lock_holders[type].write_since = now->tv_sec;
+	} else {
+		lock_holders[type].readers++;
+	}
+	slurm_mutex_unlock(&lock_stats_mutex);
+}
+
+/* Record one hold sample against the caller which acquired the lock */
+static void _lock_stat_released(lock_datatype_t type, struct timeval *now)
+{
+	lock_stat_t *stat;
+	lock_held_t *held = &thread_locks_held[type];
+	uint32_t usec;
+
+	usec = _usec32(_delta_usec(&held->acquired, now));
+	held->acquired.tv_sec = 0;
+
+	slurm_mutex_lock(&lock_stats_mutex);
+	stat = _lock_stat_find(held->caller, type, held->level);
+	stat->hold_cnt++;
+	stat->hold_sum += usec;
+	stat->hold_max = MAX(stat->hold_max, usec);
+	stat->hold_hist[latency_hist_bucket(usec)]++;
+
+	if (held->level == WRITE_LOCK) {
+		lock_holders[type].writer = NULL;
+		lock_holders[type].write_since = 0;
+	} else if (lock_holders[type].readers) {
+		lock_holders[type].readers--;
+	}
+	slurm_mutex_unlock(&lock_stats_mutex);
+}
+
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld(slurmctld_lock_t lock_levels)
+extern void lock_slurmctld_caller(slurmctld_lock_t lock_levels,
+				  const char *caller)
 {
-	xassert(_store_locks(lock_levels));
+	bool stats = lock_stats_enabled;
+	struct timeval start, tv1, tv2;
 
-	if (lock_levels.conf == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[CONF_LOCK]);
-	else if (lock_levels.conf == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[CONF_LOCK]);
+	xassert(_store_locks(lock_levels));
 
-	if (lock_levels.job == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[JOB_LOCK]);
-	else if (lock_levels.job == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[JOB_LOCK]);
+	gettimeofday(&start, NULL);
+	tv1 = start;
 
-	if (lock_levels.node == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[NODE_LOCK]);
-	else if (lock_levels.node == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[NODE_LOCK]);
+	for (int i = 0; i < LOCK_TYPE_CNT; i++) {
+		lock_level_t level = _lock_level(&lock_levels, i);
 
-	if (lock_levels.part == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[PART_LOCK]);
-	else if (lock_levels.part == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[PART_LOCK]);
+		if (level == READ_LOCK)
+			slurm_rwlock_rdlock(&slurmctld_locks[i]);
+		else if (level == WRITE_LOCK)
+			slurm_rwlock_wrlock(&slurmctld_locks[i]);
+		else
+			continue;
+
+		if (stats) {
+			gettimeofday(&tv2, NULL);
+			_lock_stat_acquired(i, level, caller,
+					    _delta_usec(&tv1, &tv2), &tv2);
+			tv1 = tv2;
+		}
+	}
 
-	if (lock_levels.fed == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[FED_LOCK]);
-	else if (lock_levels.fed == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[FED_LOCK]);
+	gettimeofday(&tv2, NULL);
+	thread_lock_wait += _usec32(_delta_usec(&start, &tv2));
 }
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
 extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 {
+	struct timeval now = { 0, 0 };
+
 	xassert(_clear_locks(lock_levels));
 
-	if (lock_levels.fed)
-		slurm_rwlock_unlock(&slurmctld_locks[FED_LOCK]);
+	for (int i = LOCK_TYPE_CNT - 1; i >= 0; i--) {
+		if (_lock_level(&lock_levels, i) == NO_LOCK)
+			continue;
+
+		/* Locks taken before stats were enabled are not tracked */
+		if (thread_locks_held[i].acquired.tv_sec) {
+			if (!now.tv_sec)
+				gettimeofday(&now, NULL);
+			_lock_stat_released(i, &now);
+		}
 
-	if (lock_levels.part)
-		slurm_rwlock_unlock(&slurmctld_locks[PART_LOCK]);
+		slurm_rwlock_unlock(&slurmctld_locks[i]);
+	}
+}
+
+extern uint64_t lock_slurmctld_wait_reset(void)
+{
+	uint64_t wait = thread_lock_wait;
 
-	if (lock_levels.node)
-		slurm_rwlock_unlock(&slurmctld_locks[NODE_LOCK]);
+	thread_lock_wait = 0;
+	return wait;
+}
+
+extern void lock_stats_reconfig(void)
+{
+	bool enable = xstrcasestr(slurm_conf.slurmctld_params,
+				  "enable_lock_stats");
 
-	if (lock_levels.job)
-		slurm_rwlock_unlock(&slurmctld_locks[JOB_LOCK]);
+	if (enable != lock_stats_enabled)
+		info("%s lock statistics", enable ? "Enabling" : "Disabling");
+	lock_stats_enabled = enable;
+}
 
-	if (lock_levels.conf)
-		slurm_rwlock_unlock(&slurmctld_locks[CONF_LOCK]);
+extern void lock_stats_reset(void)
+{
+	slurm_mutex_lock(&lock_stats_mutex);
+	xfree(lock_stats);
+	lock_stats_size = 0;
+	lock_stats_cnt = 0;
+	slurm_mutex_unlock(&lock_stats_mutex);
+}
+
+extern void lock_stats_pack(buf_t *buffer)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+
+	slurm_mutex_lock(&lock_stats_mutex);
+	pack32(lock_stats_cnt, buffer);
+	for (int i = 0; i < lock_stats_size; i++) {
+		lock_stat_t *stat = &lock_stats[i];
+
+		if (!stat->caller)
+			continue;
+
+		packstr((char *) stat->caller, buffer);
+		packstr((char *) lock_names[stat->type], buffer);
+		pack16(stat->level, buffer);
+		pack32(stat->cnt, buffer);
+
+		pack64(stat->wait_sum, buffer);
+		pack32(stat->wait_max, buffer);
+		pack32(latency_hist_percentile(stat->wait_hist, stat->cnt,
+					       stat->wait_max, 50), buffer);
+		pack32(latency_hist_percentile(stat->wait_hist, stat->cnt,
+					       stat->wait_max, 99), buffer);
+
+		pack32(stat->hold_cnt, buffer);
+		pack64(stat->hold_sum, buffer);
+		pack32(stat->hold_max, buffer);
+		pack32(latency_hist_percentile(stat->hold_hist, stat->hold_cnt,
+					       stat->hold_max, 50), buffer);
+		pack32(latency_hist_percentile(stat->hold_hist, stat->hold_cnt,
+					       stat->hold_max, 99), buffer);
+	}
+
+	pack32(LOCK_TYPE_CNT, buffer);
+	for (int i = 0; i < LOCK_TYPE_CNT; i++) {
+		packstr((char *) lock_names[i], buffer);
+		packstr((char *) lock_holders[i].writer, buffer);
+		pack_time(lock_holders[i].write_since, buffer);
+		pack32(lock_holders[i].readers, buffer);
+	}
+	slurm_mutex_unlock(&lock_stats_mutex);
 }
 
 /*
@@ -91,8 +91,11 @@
 #ifndef _SLURMCTLD_LOCKS_H
 #define _SLURMCTLD_LOCKS_H
 
+#include <inttypes.h>
 #include <stdbool.h>
 
+#include "src/common/pack.h"
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -121,13 +124,40 @@ typedef enum {
 extern bool verify_lock(lock_datatype_t datatype, lock_level_t level);
 #endif
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld (slurmctld_lock_t lock_levels);
+/*
+ * lock_slurmctld - Issue the required lock requests in a well defined order
+ * The calling function is recorded when lock statistics are enabled.
+ */
+#define lock_slurmctld(lock_levels) \
+	lock_slurmctld_caller(lock_levels, __func__)
+extern void lock_slurmctld_caller(slurmctld_lock_t lock_levels,
+				  const char *caller);
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/*
+ * lock_slurmctld_wait_reset - Return the time in usec the calling thread
+ *	spent waiting in lock_slurmctld() since the last call, then reset it
+ */
+extern uint64_t lock_slurmctld_wait_reset(void);
+
+/*
+ * lock_stats_reconfig - Enable or disable the per caller lock wait and hold
+ *	time statistics based upon SlurmctldParameters=enable_lock_stats
+ */
+extern void lock_stats_reconfig(void);
+
+/* lock_stats_reset - Clear all lock statistics */
+extern void lock_stats_reset(void);
+
+/*
+ * lock_stats_pack - Pack lock statistics and the current lock holders
+ *	for REQUEST_STATS_INFO
+ */
+extern void lock_stats_pack(buf_t *buffer);
+
 extern int report_locks_set(void);
 
 /* un/lock semaphore used for saving state of slurmctld */
@@ -75,6 +75,7 @@
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/gres_ctld.h"
+#include "src/slurmctld/intern.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/node_scheduler.h"
@@ -930,6 +931,7 @@ static void _find_qos_grp_node_bitmap(job_record_t *job_ptr,
 		*per_user_limit = true;
 		used_limits = acct_policy_get_user_used_limits(
 			&qos_ptr->usage->user_limit_list,
+			&qos_ptr->usage->user_limit_hash,
 			job_ptr->user_id);
 		if (used_limits && used_limits->node_bitmap) {
 			if (*grp_node_bitmap)
@@ -947,6 +949,7 @@ static void _find_qos_grp_node_bitmap(job_record_t *job_ptr,
 		*per_acct_limit = true;
 		used_limits = acct_policy_get_acct_used_limits(
 			&qos_ptr->usage->acct_limit_list,
+			&qos_ptr->usage->acct_limit_hash,
 			job_ptr->assoc_ptr->acct);
 		if (used_limits && used_limits->node_bitmap) {
 			if (*grp_node_bitmap)
@@ -2925,8 +2928,11 @@ extern void launch_prolog(job_record_t *job_ptr)
 	prolog_msg_ptr->het_job_id = job_ptr->het_job_id;
 	prolog_msg_ptr->uid = job_ptr->user_id;
 	prolog_msg_ptr->gid = job_ptr->group_id;
-	if (!job_ptr->user_name)
-		job_ptr->user_name = uid_to_string_or_null(job_ptr->user_id);
+	if (!job_ptr->user_name) {
+		char *user_name = uid_to_string_or_null(job_ptr->user_id);
+		job_ptr->user_name = intern_str(user_name);
+		xfree(user_name);
+	}
 	prolog_msg_ptr->user_name = xstrdup(job_ptr->user_name);
 	prolog_msg_ptr->alias_list = xstrdup(job_ptr->alias_list);
 	prolog_msg_ptr->nodes = xstrdup(job_ptr->nodes);
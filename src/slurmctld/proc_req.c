@@ -104,15 +104,38 @@
 #include "src/slurmctld/state_save.h"
 #include "src/slurmctld/trigger_mgr.h"
 
-static pthread_mutex_t rpc_mutex = PTHREAD_MUTEX_INITIALIZER;
-#define RPC_TYPE_SIZE 100
-static uint16_t rpc_type_id[RPC_TYPE_SIZE] = { 0 };
-static uint32_t rpc_type_cnt[RPC_TYPE_SIZE] = { 0 };
-static uint64_t rpc_type_time[RPC_TYPE_SIZE] = { 0 };
-#define RPC_USER_SIZE 200
-static uint32_t rpc_user_id[RPC_USER_SIZE] = { 0 };
-static uint32_t rpc_user_cnt[RPC_USER_SIZE] = { 0 };
-static uint64_t rpc_user_time[RPC_USER_SIZE] = { 0 };
+/*
+ * RPC statistics are kept in RPC_STATS_SHARDS independent shards, selected by
+ * a hash of the calling thread, so concurrent RPC threads rarely contend on
+ * the same mutex. The shards are merged when the statistics are requested.
+ */
+#define RPC_STATS_SHARDS 16
+
+typedef struct {
+	bool used;
+	uint32_t id;		/* message type or user id */
+	uint32_t cnt;
+	uint64_t time;		/* total usec */
+	uint32_t time_max;	/* longest usec */
+	uint64_t lock_wait;	/* total usec waiting on slurmctld locks */
+	uint32_t hist[LATENCY_HIST_BUCKETS];
+} rpc_stat_t;
+
+typedef struct {
+	rpc_stat_t *ent;
+	uint32_t size;		/* always a power of 2 */
+	uint32_t cnt;
+} rpc_stat_table_t;
+
+typedef struct {
+	pthread_mutex_t mutex;
+	rpc_stat_table_t type;
+	rpc_stat_table_t user;
+} rpc_stat_shard_t;
+
+static rpc_stat_shard_t rpc_shards[RPC_STATS_SHARDS] = {
+	[0 ... RPC_STATS_SHARDS - 1] = { .mutex = PTHREAD_MUTEX_INITIALIZER }
+};
 static char *slurmd_config_files[] = {
 	"slurm.conf", "acct_gather.conf", "cgroup.conf",
 	"cgroup_allowed_devices_file.conf", "ext_sensors.conf", "gres.conf",
@@ -162,28 +185,88 @@ extern diag_stats_t slurmctld_diag_stats;
 static __thread bool drop_priv = false;
 #endif
 
-extern void record_rpc_stats(slurm_msg_t *msg, long delta)
+static rpc_stat_t *_rpc_stat_find(rpc_stat_table_t *table, uint32_t id);
+
+static void _rpc_stat_grow(rpc_stat_table_t *table)
 {
-	slurm_mutex_lock(&rpc_mutex);
-	for (int i = 0; i < RPC_TYPE_SIZE; i++) {
-		if (rpc_type_id[i] == 0)
-			rpc_type_id[i] = msg->msg_type;
-		else if (rpc_type_id[i] != msg->msg_type)
-			continue;
-		rpc_type_cnt[i]++;
-		rpc_type_time[i] += delta;
-		break;
+	rpc_stat_table_t old = *table;
+
+	table->size = old.size ? (old.size * 2) : 64;
+	table->ent = xcalloc(table->size, sizeof(rpc_stat_t));
+	table->cnt = 0;
+
+	for (int i = 0; i < old.size; i++) {
+		if (old.ent[i].used)
+			*_rpc_stat_find(table, old.ent[i].id) = old.ent[i];
 	}
-	for (int i = 0; i < RPC_USER_SIZE; i++) {
-		if ((rpc_user_id[i] == 0) && (i != 0))
-			rpc_user_id[i] = msg->auth_uid;
-		else if (rpc_user_id[i] != msg->auth_uid)
+	xfree(old.ent);
+}
+
+/* Find or add the entry for id, open addressing with linear probing */
+static rpc_stat_t *_rpc_stat_find(rpc_stat_table_t *table, uint32_t id)
+{
+	uint32_t inx;
+
+	if ((table->cnt * 2) >= table->size)
+		_rpc_stat_grow(table);
+
+	inx = (id * 2654435761U) & (table->size - 1);
+	while (table->ent[inx].used && (table->ent[inx].id != id))
+		inx = (inx + 1) & (table->size - 1);
+
+	if (!table->ent[inx].used) {
+		table->ent[inx].used = true;
+		table->ent[inx].id = id;
+		table->cnt++;
+	}
+
+	return &table->ent[inx];
+}
+
+static void _rpc_stat_add(rpc_stat_t *stat, uint32_t delta,
+			  uint64_t lock_wait, uint32_t bucket)
+{
+	stat->cnt++;
+	stat->time += delta;
+	stat->time_max = MAX(stat->time_max, delta);
+	stat->lock_wait += lock_wait;
+	stat->hist[bucket]++;
+}
+
+static void _rpc_stat_merge(rpc_stat_table_t *dst, rpc_stat_table_t *src)
+{
+	for (int i = 0; i < src->size; i++) {
+		rpc_stat_t *from = &src->ent[i], *to;
+
+		if (!from->used)
 			continue;
-		rpc_user_cnt[i]++;
-		rpc_user_time[i] += delta;
-		break;
+		to = _rpc_stat_find(dst, from->id);
+		to->cnt += from->cnt;
+		to->time += from->time;
+		to->time_max = MAX(to->time_max, from->time_max);
+		to->lock_wait += from->lock_wait;
+		for (int b = 0; b < LATENCY_HIST_BUCKETS; b++)
+			to->hist[b] += from->hist[b];
 	}
-	slurm_mutex_unlock(&rpc_mutex);
+}
+
+extern void record_rpc_stats(slurm_msg_t *msg, long delta)
+{
+	rpc_stat_shard_t *shard;
+	uint64_t lock_wait = lock_slurmctld_wait_reset();
+	uint32_t usec = (delta > 0) ? MIN(delta, UINT32_MAX) : 0;
+	uint32_t bucket = latency_hist_bucket(usec);
+	uint64_t hash = (uint64_t) (uintptr_t) pthread_self();
+
+	hash *= 0x9e3779b97f4a7c15ULL;
+	shard = &rpc_shards[(hash >> 32) % RPC_STATS_SHARDS];
+
+	slurm_mutex_lock(&shard->mutex);
+	_rpc_stat_add(_rpc_stat_find(&shard->type, msg->msg_type), usec,
+		      lock_wait, bucket);
+	_rpc_stat_add(_rpc_stat_find(&shard->user, msg->auth_uid), usec,
+		      lock_wait, bucket);
+	slurm_mutex_unlock(&shard->mutex);
 }
 
 /* These functions prevent certain RPCs from keeping the slurmctld write locks
@@ -766,7 +849,11 @@ static void _kill_job_on_msg_fail(uint32_t job_id)
 	unlock_slurmctld(job_write_lock);
 }
 
-/* create a credential for a given job step, return error code */
+/*
+ * Create an unsigned credential for a given job step, return error code.
+ * The caller must sign it with slurm_cred_sign(), which does not need any
+ * slurmctld locks.
+ */
 static int _make_step_cred(step_record_t *step_ptr, slurm_cred_t **slurm_cred,
 			   uint16_t protocol_version)
 {
@@ -821,15 +908,14 @@ static int _make_step_cred(step_record_t *step_ptr, slurm_cred_t **slurm_cred,
 
 	cred_arg.selinux_context = job_ptr->selinux_context;
 
-	*slurm_cred = slurm_cred_create(slurmctld_config.cred_ctx, &cred_arg,
-					protocol_version);
+	*slurm_cred = slurm_cred_create_unsigned(&cred_arg);
 
 	xfree(cred_arg.job_mem_alloc);
 	xfree(cred_arg.job_mem_alloc_rep_count);
 	xfree(cred_arg.step_mem_alloc);
 	xfree(cred_arg.step_mem_alloc_rep_count);
 	if (*slurm_cred == NULL) {
-		error("slurm_cred_create error");
+		error("slurm_cred_create_unsigned error");
 		return ESLURM_INVALID_JOB_CREDENTIAL;
 	}
 
@@ -1569,6 +1655,8 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 		response_msg.msg_type = RESPONSE_JOB_INFO;
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
+		if (job_info_request_msg->show_flags & SHOW_STR_DICT)
+			response_msg.flags |= SLURM_PACK_STR_DICT;
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
@@ -1606,6 +1694,8 @@ static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 	response_msg.msg_type = RESPONSE_JOB_INFO;
 	response_msg.data = dump;
 	response_msg.data_size = dump_size;
+	if (job_info_request_msg->show_flags & SHOW_STR_DICT)
+		response_msg.flags |= SLURM_PACK_STR_DICT;
 
 	/* send message */
 	slurm_send_node_msg(msg->conn_fd, &response_msg);
@@ -1645,6 +1735,8 @@ static void _slurm_rpc_dump_job_single(slurm_msg_t * msg)
 		response_msg.msg_type = RESPONSE_JOB_INFO;
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
+		if (job_id_msg->show_flags & SHOW_STR_DICT)
+			response_msg.flags |= SLURM_PACK_STR_DICT;
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
 	}
 	xfree(dump);
@@ -2373,6 +2465,20 @@ static void  _slurm_rpc_dump_batch_script(slurm_msg_t *msg)
 	}
 }
 
+/* Return usec elapsed since tv and reset tv to the current time */
+static uint32_t _step_phase_usec(struct timeval *tv)
+{
+	struct timeval now;
+	long delta_t;
+
+	gettimeofday(&now, NULL);
+	delta_t = (now.tv_sec - tv->tv_sec) * USEC_IN_SEC;
+	delta_t += (now.tv_usec - tv->tv_usec);
+	*tv = now;
+
+	return (delta_t > 0) ? delta_t : 0;
+}
+
 /* _slurm_rpc_job_step_create - process RPC to create/register a job step
  *	with the step_mgr */
 static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
@@ -2380,6 +2486,8 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 	static int active_rpc_cnt = 0;
 	int error_code = SLURM_SUCCESS;
 	DEF_TIMERS;
+	struct timeval phase_tv;
+	uint32_t create_usec, sign_usec, resp_usec;
 	slurm_msg_t resp;
 	step_record_t *step_rec;
 	job_step_create_response_msg_t job_step_resp;
@@ -2430,6 +2538,7 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 		_throttle_start(&active_rpc_cnt);
 		lock_slurmctld(job_write_lock);
 	}
+	gettimeofday(&phase_tv, NULL);
 	error_code = step_create(req_step_msg, &step_rec,
 				 msg->protocol_version);
 
@@ -2499,11 +2608,32 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 			unlock_slurmctld(job_write_lock);
 			_throttle_fini(&active_rpc_cnt);
 		}
-		response_init(&resp, msg);
-		resp.msg_type = RESPONSE_JOB_STEP_CREATE;
-		resp.data = &job_step_resp;
+		create_usec = _step_phase_usec(&phase_tv);
 
-		slurm_send_node_msg(msg->conn_fd, &resp);
+		/*
+		 * The credential is a private copy of the step data, so sign
+		 * it without the job write lock. Signing may be a round trip
+		 * to munged, and other RPC threads can sign concurrently.
+		 */
+		if (slurm_cred_sign(slurmctld_config.cred_ctx, slurm_cred,
+				    job_step_resp.use_protocol_ver)) {
+			error("%s: slurm_cred_sign error for JobId=%u",
+			      __func__, req_step_msg->step_id.job_id);
+			error_code = ESLURM_INVALID_JOB_CREDENTIAL;
+		}
+		sign_usec = _step_phase_usec(&phase_tv);
+
+		if (error_code) {
+			slurm_send_rc_msg(msg, error_code);
+		} else {
+			response_init(&resp, msg);
+			resp.msg_type = RESPONSE_JOB_STEP_CREATE;
+			resp.data = &job_step_resp;
+
+			slurm_send_node_msg(msg->conn_fd, &resp);
+		}
+		resp_usec = _step_phase_usec(&phase_tv);
+		stats_step_create_record(create_usec, sign_usec, resp_usec);
 
 		slurm_cred_destroy(slurm_cred);
 		slurm_step_layout_destroy(step_layout);
@@ -3018,6 +3148,37 @@ static void _slurm_rpc_het_job_alloc_info(slurm_msg_t * msg)
 
 /* _slurm_rpc_job_sbcast_cred - process RPC to get details on existing job
  *	plus sbcast credential */
+#ifndef HAVE_FRONT_END
+/*
+ * Return the lowest protocol version of the nodes in node_list
+ * Node read lock must be held
+ */
+static uint16_t _nodes_protocol_version(char *node_list)
+{
+	uint16_t protocol_version = SLURM_PROTOCOL_VERSION;
+	bitstr_t *node_bitmap = NULL;
+	node_record_t *node_ptr;
+	int i, i_first, i_last;
+
+	(void) node_name2bitmap(node_list, true, &node_bitmap);
+	i_first = bit_ffs(node_bitmap);
+	if (i_first >= 0)
+		i_last = bit_fls(node_bitmap);
+	else
+		i_last = i_first - 1;
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(node_bitmap, i))
+			continue;
+		node_ptr = node_record_table_ptr + i;
+		if (protocol_version > node_ptr->protocol_version)
+			protocol_version = node_ptr->protocol_version;
+	}
+	FREE_NULL_BITMAP(node_bitmap);
+
+	return protocol_version;
+}
+#endif
+
 static void _slurm_rpc_job_sbcast_cred(slurm_msg_t * msg)
 {
 #ifdef HAVE_FRONT_END
@@ -3157,6 +3318,8 @@ static void _slurm_rpc_job_sbcast_cred(slurm_msg_t * msg)
 		memset(&job_info_resp_msg, 0, sizeof(job_info_resp_msg));
 		job_info_resp_msg.job_id         = job_ptr->job_id;
 		job_info_resp_msg.node_list      = xstrdup(node_list);
+		job_info_resp_msg.protocol_version =
+			_nodes_protocol_version(node_list);
 		job_info_resp_msg.sbcast_cred    = sbcast_cred;
 		unlock_slurmctld(job_read_lock);
 
@@ -5391,50 +5554,139 @@ static void _slurm_rpc_accounting_register_ctld(slurm_msg_t *msg)
 
 static void _clear_rpc_stats(void)
 {
-	slurm_mutex_lock(&rpc_mutex);
-	memset(rpc_type_cnt, 0, sizeof(rpc_type_cnt));
-	memset(rpc_type_id, 0, sizeof(rpc_type_id));
-	memset(rpc_type_time, 0, sizeof(rpc_type_time));
-	memset(rpc_user_cnt, 0, sizeof(rpc_user_cnt));
-	memset(rpc_user_id, 0, sizeof(rpc_user_id));
-	memset(rpc_user_time, 0, sizeof(rpc_user_time));
-	slurm_mutex_unlock(&rpc_mutex);
+	for (int i = 0; i < RPC_STATS_SHARDS; i++) {
+		rpc_stat_shard_t *shard = &rpc_shards[i];
+
+		slurm_mutex_lock(&shard->mutex);
+		xfree(shard->type.ent);
+		xfree(shard->user.ent);
+		memset(&shard->type, 0, sizeof(shard->type));
+		memset(&shard->user, 0, sizeof(shard->user));
+		slurm_mutex_unlock(&shard->mutex);
+	}
+}
+
+/*
+ * Pack merged statistics from the table in the order of its entries.
+ * The first block is understood by all supported clients, the second block
+ * is only read by 21.08 clients after the pending RPC statistics.
+ */
+static void _pack_rpc_stat_table(rpc_stat_table_t *table, bool type,
+				 buf_t *buffer)
+{
+	uint32_t cnt = 0;
+	uint16_t *id16 = NULL;
+	uint32_t *id32 = NULL, *cnts;
+	uint64_t *times;
+
+	cnts = xcalloc(table->cnt, sizeof(uint32_t));
+	times = xcalloc(table->cnt, sizeof(uint64_t));
+	if (type)
+		id16 = xcalloc(table->cnt, sizeof(uint16_t));
+	else
+		id32 = xcalloc(table->cnt, sizeof(uint32_t));
+
+	for (int i = 0; i < table->size; i++) {
+		rpc_stat_t *stat = &table->ent[i];
+
+		if (!stat->used)
+			continue;
+		if (type)
+			id16[cnt] = stat->id;
+		else
+			id32[cnt] = stat->id;
+		cnts[cnt] = stat->cnt;
+		times[cnt] = stat->time;
+		cnt++;
+	}
+
+	pack32(cnt, buffer);
+	if (type)
+		pack16_array(id16, cnt, buffer);
+	else
+		pack32_array(id32, cnt, buffer);
+	pack32_array(cnts, cnt, buffer);
+	pack64_array(times, cnt, buffer);
+
+	xfree(id16);
+	xfree(id32);
+	xfree(cnts);
+	xfree(times);
+}
+
+static void _pack_rpc_stat_table_hist(rpc_stat_table_t *table, buf_t *buffer)
+{
+	uint32_t cnt = 0;
+	uint32_t *max, *p50, *p99;
+	uint64_t *lock_wait;
+
+	max = xcalloc(table->cnt, sizeof(uint32_t));
+	p50 = xcalloc(table->cnt, sizeof(uint32_t));
+	p99 = xcalloc(table->cnt, sizeof(uint32_t));
+	lock_wait = xcalloc(table->cnt, sizeof(uint64_t));
+
+	for (int i = 0; i < table->size; i++) {
+		rpc_stat_t *stat = &table->ent[i];
+
+		if (!stat->used)
+			continue;
+		max[cnt] = stat->time_max;
+		p50[cnt] = latency_hist_percentile(stat->hist, stat->cnt,
+						   stat->time_max, 50);
+		p99[cnt] = latency_hist_percentile(stat->hist, stat->cnt,
+						   stat->time_max, 99);
+		lock_wait[cnt] = stat->lock_wait;
+		cnt++;
+	}
+
+	pack32_array(max, cnt, buffer);
+	pack32_array(p50, cnt, buffer);
+	pack32_array(p99, cnt, buffer);
+	pack64_array(lock_wait, cnt, buffer);
+
+	xfree(max);
+	xfree(p50);
+	xfree(p99);
+	xfree(lock_wait);
 }
 
 static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 			    uint16_t protocol_version)
 {
-	uint32_t i;
 	buf_t *buffer;
+	rpc_stat_table_t type = { 0 }, user = { 0 };
+
+	for (int i = 0; i < RPC_STATS_SHARDS; i++) {
+		rpc_stat_shard_t *shard = &rpc_shards[i];
+
+		slurm_mutex_lock(&shard->mutex);
+		_rpc_stat_merge(&type, &shard->type);
+		_rpc_stat_merge(&user, &shard->user);
+		slurm_mutex_unlock(&shard->mutex);
+	}
 
-	slurm_mutex_lock(&rpc_mutex);
 	buffer = create_buf(*buffer_ptr, *buffer_size);
 	set_buf_offset(buffer, *buffer_size);
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
-		for (i = 0; i < RPC_TYPE_SIZE; i++) {
-			if (rpc_type_id[i] == 0)
-				break;
-		}
-		pack32(i, buffer);
-		pack16_array(rpc_type_id,   i, buffer);
-		pack32_array(rpc_type_cnt,  i, buffer);
-		pack64_array(rpc_type_time, i, buffer);
-
-		for (i = 1; i < RPC_USER_SIZE; i++) {
-			if (rpc_user_id[i] == 0)
-				break;
-		}
-		pack32(i, buffer);
-		pack32_array(rpc_user_id,   i, buffer);
-		pack32_array(rpc_user_cnt,  i, buffer);
-		pack64_array(rpc_user_time, i, buffer);
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+		_pack_rpc_stat_table(&type, true, buffer);
+		_pack_rpc_stat_table(&user, false, buffer);
 
 		agent_pack_pending_rpc_stats(buffer);
 
+		_pack_rpc_stat_table_hist(&type, buffer);
+		_pack_rpc_stat_table_hist(&user, buffer);
+
+		lock_stats_pack(buffer);
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+		_pack_rpc_stat_table(&type, true, buffer);
+		_pack_rpc_stat_table(&user, false, buffer);
+
+		agent_pack_pending_rpc_stats(buffer);
 	}
 
-	slurm_mutex_unlock(&rpc_mutex);
+	xfree(type.ent);
+	xfree(user.ent);
 
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
@@ -5486,6 +5738,7 @@ static void _slurm_rpc_dump_stats(slurm_msg_t *msg)
 	if (request_msg->command_id == STAT_COMMAND_RESET) {
 		reset_stats(1);
 		_clear_rpc_stats();
+		lock_stats_reset();
 		pack_all_stat(0, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(0, &dump, &dump_size, msg->protocol_version);
 		response_msg.data = dump;
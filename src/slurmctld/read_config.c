@@ -42,6 +42,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -134,6 +135,8 @@ static int  _sync_nodes_to_active_job(job_record_t *job_ptr);
 static void _sync_nodes_to_suspended_job(job_record_t *job_ptr);
 static void _sync_part_prio(void);
 static int  _update_preempt(uint16_t old_enable_preempt);
+static void _prefetch_state_files(char *state_save_dir);
+static void _state_unpack_start(void);
 
 
 /*
@@ -1086,9 +1089,18 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *state_save_dir = xstrdup(slurm_conf.state_save_location);
 	uint16_t old_select_type_p = slurm_conf.select_type_param;
 	bool cgroup_mem_confinement = false;
+	struct timeval phase_tv;
 
 	/* initialization */
 	START_TIMER;
+	gettimeofday(&phase_tv, NULL);
+
+	/*
+	 * Start reading the state files now, so the I/O overlaps with
+	 * building the configuration and unpacking the earlier files.
+	 */
+	if (!reconfig && recover)
+		_prefetch_state_files(state_save_dir);
 
 	if (reconfig) {
 		/*
@@ -1176,6 +1188,7 @@ int read_slurm_conf(int recover, bool reconfig)
 			dump_config_state_lite();
 	}
 	update_logging();
+	lock_stats_reconfig();
 	jobcomp_g_init(slurm_conf.job_comp_loc);
 	if (sched_g_init() != SLURM_SUCCESS) {
 		if (test_config) {
@@ -1272,20 +1285,31 @@ int read_slurm_conf(int recover, bool reconfig)
 		reset_first_job_id();
 		(void) sched_g_reconfig();
 	} else if (recover == 1) {	/* Load job & node state files */
+		stats_recovery_phase("configuration", &phase_tv);
+		_state_unpack_start();
 		(void) load_all_node_state(true);
 		_set_features(node_record_table_ptr, node_record_count,
 			      recover);
+		stats_recovery_phase("node_state", &phase_tv);
 		(void) load_all_front_end_state(true);
+		stats_recovery_phase("front_end_state", &phase_tv);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		stats_recovery_phase("job_state", &phase_tv);
 	} else if (recover > 1) {	/* Load node, part & job state files */
+		stats_recovery_phase("configuration", &phase_tv);
+		_state_unpack_start();
 		(void) load_all_node_state(false);
 		_set_features(old_node_table_ptr, old_node_record_count,
 			      recover);
+		stats_recovery_phase("node_state", &phase_tv);
 		(void) load_all_front_end_state(false);
+		stats_recovery_phase("front_end_state", &phase_tv);
 		(void) load_all_part_state();
+		stats_recovery_phase("part_state", &phase_tv);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		stats_recovery_phase("job_state", &phase_tv);
 	}
 
 	_sync_part_prio();
@@ -1318,6 +1342,8 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	(void) _sync_nodes_to_jobs(reconfig);
 	(void) sync_job_files();
+	if (!reconfig && recover)
+		stats_recovery_phase("plugin_sync", &phase_tv);
 	_purge_old_node_state(old_node_table_ptr, old_node_record_count);
 	_purge_old_part_state(old_part_list, old_def_part_name);
 
@@ -1357,6 +1383,8 @@ int read_slurm_conf(int recover, bool reconfig)
 		build_feature_list_eq();
 	else
 		build_feature_list_ne();
+	if (!reconfig && recover)
+		stats_recovery_phase("node_features", &phase_tv);
 
 	/*
 	 * Must be at after nodes and partitons (e.g.
@@ -1374,10 +1402,14 @@ int read_slurm_conf(int recover, bool reconfig)
 	if (reconfig) {
 		load_all_resv_state(0);
 	} else {
+		if (recover >= 1)
+			stats_recovery_phase("job_node_sync", &phase_tv);
 		load_all_resv_state(recover);
 		if (recover >= 1) {
+			stats_recovery_phase("resv_state", &phase_tv);
 			trigger_state_restore();
 			(void) sched_g_reconfig();
+			stats_recovery_phase("trigger_state", &phase_tv);
 		}
 	}
 	 if (test_config)
@@ -1472,6 +1504,8 @@ int read_slurm_conf(int recover, bool reconfig)
 	 */
 	if (load_job_ret)
 		_acct_restore_active_jobs();
+	if (!reconfig && recover)
+		stats_recovery_phase("job_accounting", &phase_tv);
 
 	/* Sync select plugin with synchronized job/node/part data */
 	gres_reconfig();		/* Clear gres/mps counters */
@@ -2439,6 +2473,60 @@ static int _preserve_select_type_param(slurm_conf_t *ctl_conf_ptr,
 	return rc;
 }
 
+static void *_prefetch_state_file(void *arg)
+{
+	char *file_name = arg;
+	char *buf;
+	int fd;
+
+	if ((fd = open(file_name, O_RDONLY)) < 0) {
+		xfree(file_name);
+		return NULL;
+	}
+
+	(void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	buf = xmalloc(1024 * 1024);
+	while (read(fd, buf, 1024 * 1024) > 0)
+		;
+	close(fd);
+
+	debug2("%s: read %s", __func__, file_name);
+	xfree(buf);
+	xfree(file_name);
+	return NULL;
+}
+
+/*
+ * Read the state files in parallel threads to load them into the page cache
+ * before they are unpacked one after the other. After a failover the files
+ * are usually not cached and are often on a shared file system. The
+ * reservation and trigger files are read by _state_unpack_start() instead.
+ */
+static void _prefetch_state_files(char *state_save_dir)
+{
+	char *files[] = { "node_state", "front_end_state", "part_state",
+			  "job_state", NULL };
+
+	for (int i = 0; files[i]; i++) {
+		char *file_name = xstrdup_printf("%s/%s", state_save_dir,
+						 files[i]);
+		slurm_thread_create_detached(NULL, _prefetch_state_file,
+					     file_name);
+	}
+}
+
+/*
+ * Unpack the reservation and trigger state files in their own threads while
+ * the node, partition and job state files are loaded. They only reference
+ * nodes and jobs once validated, which load_all_resv_state() and
+ * trigger_state_restore() still do at the usual place.
+ */
+static void _state_unpack_start(void)
+{
+	resv_state_unpack_start();
+	trigger_state_unpack_start();
+}
+
 /* Start or stop the gang scheduler module as needed based upon changes in
  *	configuration */
 static int _update_preempt(uint16_t old_preempt_mode)
@@ -0,0 +1,151 @@
+/*****************************************************************************\
+ *  record_pool.c - slab allocator for slurmctld job and step records
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/record_pool.h"
+
+#define RECORD_POOL_SLAB_CNT 256
+
+static pthread_mutex_t pool_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static record_pool_t *pool_list = NULL;
+
+/* Carve a new slab into records on the free list, pool->mutex must be held */
+static void _add_slab(record_pool_t *pool)
+{
+	char *slab;
+
+	if (!pool->registered) {
+		/* Keep the next pointer of free records aligned */
+		pool->size = MAX(pool->size, sizeof(void *));
+		pool->size = (pool->size + sizeof(void *) - 1) &
+			     ~(sizeof(void *) - 1);
+		slurm_mutex_lock(&pool_list_mutex);
+		pool->next = pool_list;
+		pool_list = pool;
+		slurm_mutex_unlock(&pool_list_mutex);
+		pool->registered = true;
+	}
+
+	slab = xmalloc_nz((size_t) pool->size * RECORD_POOL_SLAB_CNT);
+	xrecalloc(pool->slabs, pool->slab_cnt + 1, sizeof(void *));
+	pool->slabs[pool->slab_cnt++] = slab;
+
+	for (int i = RECORD_POOL_SLAB_CNT - 1; i >= 0; i--) {
+		void **rec = (void **) (slab + ((size_t) i * pool->size));
+		*rec = pool->free_list;
+		pool->free_list = rec;
+	}
+	pool->free_cnt += RECORD_POOL_SLAB_CNT;
+}
+
+extern void *record_pool_alloc(record_pool_t *pool)
+{
+	void **rec;
+
+	slurm_mutex_lock(&pool->mutex);
+	if (!pool->free_list)
+		_add_slab(pool);
+	rec = pool->free_list;
+	pool->free_list = *rec;
+	pool->free_cnt--;
+	pool->in_use++;
+	pool->in_use_max = MAX(pool->in_use_max, pool->in_use);
+	pool->alloc_cnt++;
+	slurm_mutex_unlock(&pool->mutex);
+
+	memset(rec, 0, pool->size);
+	return rec;
+}
+
+extern void record_pool_free(record_pool_t *pool, void *rec)
+{
+	if (!rec)
+		return;
+
+	xassert(pool->registered);
+
+	slurm_mutex_lock(&pool->mutex);
+	*(void **) rec = pool->free_list;
+	pool->free_list = rec;
+	pool->free_cnt++;
+	pool->in_use--;
+	slurm_mutex_unlock(&pool->mutex);
+}
+
+extern void record_pool_pack_stats(buf_t *buffer)
+{
+	uint32_t cnt = 0;
+	record_pool_t *pool;
+
+	slurm_mutex_lock(&pool_list_mutex);
+	for (pool = pool_list; pool; pool = pool->next)
+		cnt++;
+	pack32(cnt, buffer);
+	for (pool = pool_list; pool; pool = pool->next) {
+		slurm_mutex_lock(&pool->mutex);
+		packstr((char *) pool->name, buffer);
+		pack32(pool->size, buffer);
+		pack32(pool->slab_cnt * RECORD_POOL_SLAB_CNT, buffer);
+		pack32(pool->in_use, buffer);
+		pack32(pool->in_use_max, buffer);
+		pack64(pool->alloc_cnt, buffer);
+		slurm_mutex_unlock(&pool->mutex);
+	}
+	slurm_mutex_unlock(&pool_list_mutex);
+}
+
+extern void record_pool_fini(void)
+{
+	record_pool_t *pool;
+
+	slurm_mutex_lock(&pool_list_mutex);
+	for (pool = pool_list; pool; pool = pool->next) {
+		slurm_mutex_lock(&pool->mutex);
+		if (pool->in_use)
+			error("%s: %u %s records still in use",
+			      __func__, pool->in_use, pool->name);
+		for (int i = 0; i < pool->slab_cnt; i++)
+			xfree(pool->slabs[i]);
+		xfree(pool->slabs);
+		pool->slab_cnt = 0;
+		pool->free_list = NULL;
+		pool->free_cnt = 0;
+		pool->in_use = 0;
+		slurm_mutex_unlock(&pool->mutex);
+	}
+	slurm_mutex_unlock(&pool_list_mutex);
+}
@@ -0,0 +1,89 @@
+/*****************************************************************************\
+ *  record_pool.h - slab allocator for slurmctld job and step records
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_RECORD_POOL_H
+#define _HAVE_RECORD_POOL_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "src/common/pack.h"
+
+/*
+ * A record pool hands out fixed size, zeroed records carved from slabs of
+ * RECORD_POOL_SLAB_CNT records. Freed records are kept on a free list and
+ * reused, so heavy job churn does not fragment the heap. Slabs are only
+ * released by record_pool_fini().
+ *
+ * Pools are statically initialized with RECORD_POOL_INITIALIZER and register
+ * themselves for statistics on their first allocation.
+ */
+typedef struct record_pool {
+	const char *name;
+	uint32_t size;		/* record size, rounded up on first use */
+
+	pthread_mutex_t mutex;
+	bool registered;
+	void *free_list;	/* next pointer kept in the free record */
+	void **slabs;
+	uint32_t slab_cnt;
+
+	uint32_t free_cnt;
+	uint32_t in_use;
+	uint32_t in_use_max;
+	uint64_t alloc_cnt;
+
+	struct record_pool *next;
+} record_pool_t;
+
+#define RECORD_POOL_INITIALIZER(_name, _size)		\
+	{						\
+		.name = _name,				\
+		.size = _size,				\
+		.mutex = PTHREAD_MUTEX_INITIALIZER,	\
+	}
+
+/* Return a zeroed record from the pool */
+extern void *record_pool_alloc(record_pool_t *pool);
+
+/* Return a record obtained from record_pool_alloc() to its pool */
+extern void record_pool_free(record_pool_t *pool, void *rec);
+
+/* Pack the statistics of all pools used so far for sdiag */
+extern void record_pool_pack_stats(buf_t *buffer);
+
+/* Release the slabs of all pools, any record still in use is lost */
+extern void record_pool_fini(void);
+
+#endif /* !_HAVE_RECORD_POOL_H */
@@ -57,6 +57,7 @@
 #include "src/common/bitstring.h"
 #include "src/common/fd.h"
 #include "src/common/hostlist.h"
+#include "src/common/interval_tree.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
@@ -68,6 +69,7 @@
 #include "src/common/slurm_time.h"
 #include "src/common/uid.h"
 #include "src/common/xassert.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -97,6 +99,9 @@
  * Last bitmap is always a NULL pointer
  */
 #define MAX_BITMAPS 6
+
+/* _resv_time_overlap() looks up to 6 days ahead, allow for DST changes */
+#define RESV_OVERLAP_LOOKAHEAD (7 * 24 * 60 * 60)
 /* Available Nodes without any reservations */
 #define SELECT_NOT_RSVD 0
 /* Available Nodes including overlapping/main reserved nodes */
@@ -121,8 +126,15 @@ typedef struct resv_thread_args {
 time_t    last_resv_update = (time_t) 0;
 List      resv_list = (List) NULL;
 static List magnetic_resv_list = NULL;
+static xhash_t *resv_name_hash = NULL;	/* resv_list records by name */
 uint32_t  top_suffix = 0;
 
+/* Reservation state file unpacked by resv_state_unpack_start() */
+static pthread_t resv_unpack_tid = 0;
+static List resv_unpack_list = NULL;
+static uint32_t resv_unpack_suffix = 0;
+static int resv_unpack_rc = SLURM_SUCCESS;
+
 /*
  * the two following structs enable to build a
  * planning of a constraint evolution over time
@@ -163,7 +175,6 @@ static void _del_resv_rec(void *x);
 static void _dump_resv_req(resv_desc_msg_t *resv_ptr, char *mode);
 static int  _find_resv_id(void *x, void *key);
 static int _find_resv_ptr(void *x, void *key);
-static int  _find_resv_name(void *x, void *key);
 static void *_fork_script(void *x);
 static void _free_script_arg(resv_thread_args_t *args);
 static int  _generate_resv_id(void);
@@ -229,8 +240,186 @@ static void _validate_node_choice(slurmctld_resv_t *resv_ptr);
 static bool _validate_user_access(slurmctld_resv_t *resv_ptr,
 				  List user_assoc_list, uid_t uid);
 
+static void _resv_name_id(void *item, const char **key, uint32_t *key_len)
+{
+	slurmctld_resv_t *resv_ptr = item;
+
+	*key = resv_ptr->name;
+	*key_len = strlen(resv_ptr->name);
+}
+
+/* Index a resv_list record by name, the first record of a given name wins */
+static void _resv_name_hash_add(slurmctld_resv_t *resv_ptr)
+{
+	if (!resv_ptr->name)
+		return;
+	if (!resv_name_hash)
+		resv_name_hash = xhash_init(_resv_name_id, NULL);
+	if (!xhash_get_str(resv_name_hash, resv_ptr->name))
+		xhash_add(resv_name_hash, resv_ptr);
+}
+
+static void _resv_name_hash_remove(slurmctld_resv_t *resv_ptr)
+{
+	if (resv_ptr->name && resv_name_hash &&
+	    (xhash_get_str(resv_name_hash, resv_ptr->name) == resv_ptr))
+		(void) xhash_pop_str(resv_name_hash, resv_ptr->name);
+}
+
+/*
+ * Time window index of resv_list. It is rebuilt by the first lookup after
+ * _resv_index_invalidate(), which must be called whenever records are added
+ * or removed or their start_time, start_time_first, end_time, boot_time or
+ * flags change. TIME_FLOAT reservations are relative to the current time,
+ * so they are left out of the window index and returned by every lookup.
+ */
+typedef struct {
+	slurmctld_resv_t *resv_ptr;
+	int pos;		/* position in resv_list */
+} resv_index_ent_t;
+
+static pthread_mutex_t resv_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool resv_index_stale = true;
+static interval_tree_t *resv_window_index = NULL;
+static interval_tree_t *resv_end_index = NULL;	/* end_time of all records */
+static resv_index_ent_t *resv_index_ents = NULL;
+static resv_index_ent_t **resv_float_ents = NULL;
+static int resv_float_cnt = 0;
+static uint32_t resv_max_boot_time = 0;
+
+static void _resv_index_invalidate(void)
+{
+	slurm_mutex_lock(&resv_index_mutex);
+	resv_index_stale = true;
+	slurm_mutex_unlock(&resv_index_mutex);
+}
+
+/* NOTE: Call with resv_index_mutex locked */
+static void _resv_index_build(void)
+{
+	ListIterator iter;
+	slurmctld_resv_t *resv_ptr;
+	int pos = 0;
+
+	if (!resv_index_stale)
+		return;
+
+	if (!resv_window_index) {
+		resv_window_index = interval_tree_create();
+		resv_end_index = interval_tree_create();
+	}
+	interval_tree_clear(resv_window_index);
+	interval_tree_clear(resv_end_index);
+	xfree(resv_index_ents);
+	xfree(resv_float_ents);
+	resv_float_cnt = 0;
+	resv_max_boot_time = 0;
+
+	if (resv_list) {
+		resv_index_ents = xcalloc(list_count(resv_list),
+					  sizeof(resv_index_ent_t));
+		resv_float_ents = xcalloc(list_count(resv_list),
+					  sizeof(resv_index_ent_t *));
+		iter = list_iterator_create(resv_list);
+		while ((resv_ptr = list_next(iter))) {
+			resv_index_ent_t *ent = &resv_index_ents[pos];
+
+			ent->resv_ptr = resv_ptr;
+			ent->pos = pos++;
+			resv_max_boot_time = MAX(resv_max_boot_time,
+						 resv_ptr->boot_time);
+			interval_tree_add(resv_end_index, resv_ptr->end_time,
+					  resv_ptr->end_time, ent);
+			if (resv_ptr->flags & RESERVE_FLAG_TIME_FLOAT)
+				resv_float_ents[resv_float_cnt++] = ent;
+			else
+				interval_tree_add(
+					resv_window_index,
+					MIN(resv_ptr->start_time,
+					    resv_ptr->start_time_first),
+					resv_ptr->end_time, ent);
+		}
+		list_iterator_destroy(iter);
+	}
+
+	resv_index_stale = false;
+}
+
+static int _cmp_resv_index_ent(const void *x, const void *y)
+{
+	const resv_index_ent_t *a = *(resv_index_ent_t **) x;
+	const resv_index_ent_t *b = *(resv_index_ent_t **) y;
+
+	return a->pos - b->pos;
+}
+
+/*
+ * Get the reservations whose time window may overlap [start, end), plus the
+ * TIME_FLOAT ones, in resv_list order so that callers stopping at the first
+ * match behave as when walking resv_list. Callers must still test each one.
+ * IN add_boot_time - extend end by the largest reservation boot_time
+ * RET xmalloc()ed NULL terminated array, caller must xfree()
+ */
+static slurmctld_resv_t **_resv_index_overlap(time_t start, time_t end,
+					      bool add_boot_time)
+{
+	resv_index_ent_t **ents = NULL;
+	slurmctld_resv_t **resv_array;
+	int cnt;
+
+	slurm_mutex_lock(&resv_index_mutex);
+	_resv_index_build();
+	if (add_boot_time)
+		end += resv_max_boot_time;
+	cnt = interval_tree_overlap(resv_window_index, start, end,
+				    (void ***) &ents);
+	if (resv_float_cnt) {
+		xrecalloc(ents, cnt + resv_float_cnt, sizeof(*ents));
+		memcpy(ents + cnt, resv_float_ents,
+		       resv_float_cnt * sizeof(*ents));
+		cnt += resv_float_cnt;
+		qsort(ents, cnt, sizeof(*ents), _cmp_resv_index_ent);
+	}
+	resv_array = xcalloc(cnt + 1, sizeof(slurmctld_resv_t *));
+	for (int i = 0; i < cnt; i++)
+		resv_array[i] = ents[i]->resv_ptr;
+	slurm_mutex_unlock(&resv_index_mutex);
+
+	xfree(ents);
+	return resv_array;
+}
+
+/*
+ * Advance the recurring reservations which ended, as _get_rel_start_end()
+ * does, before a lookup skips them.
+ */
+static void _resv_index_advance(time_t now)
+{
+	resv_index_ent_t **ents = NULL;
+	slurmctld_resv_t **ended;
+	int cnt;
+
+	slurm_mutex_lock(&resv_index_mutex);
+	_resv_index_build();
+	cnt = interval_tree_ended(resv_end_index, now, (void ***) &ents);
+	ended = xcalloc(cnt, sizeof(slurmctld_resv_t *));
+	for (int i = 0; i < cnt; i++)
+		ended[i] = ents[i]->resv_ptr;
+	slurm_mutex_unlock(&resv_index_mutex);
+	xfree(ents);
+
+	/* _advance_resv_time() invalidates the index */
+	for (int i = 0; i < cnt; i++) {
+		if (!(ended[i]->flags & RESERVE_FLAG_TIME_FLOAT) &&
+		    (ended[i]->end_time <= now))
+			(void) _advance_resv_time(ended[i]);
+	}
+	xfree(ended);
+}
+
 static void _set_boot_time(slurmctld_resv_t *resv_ptr)
 {
+	_resv_index_invalidate();
 	resv_ptr->boot_time = 0;
 	if (!resv_ptr->node_bitmap)
 		return;
@@ -361,6 +550,7 @@ static void _restore_resv(slurmctld_resv_t *dest_resv,
 {
 	int i;
 
+	_resv_index_invalidate();
 	xfree(dest_resv->accounts);
 	dest_resv->accounts = src_resv->accounts;
 	src_resv->accounts = NULL;
@@ -418,9 +608,12 @@ static void _restore_resv(slurmctld_resv_t *dest_resv,
 
 	dest_resv->magic = src_resv->magic;
 
+	/* resv_name_hash keys on the name string, re-index with the new one */
+	_resv_name_hash_remove(dest_resv);
 	xfree(dest_resv->name);
 	dest_resv->name = src_resv->name;
 	src_resv->name = NULL;
+	_resv_name_hash_add(dest_resv);
 
 	FREE_NULL_BITMAP(dest_resv->node_bitmap);
 	dest_resv->node_bitmap = src_resv->node_bitmap;
@@ -478,6 +671,8 @@ static void _del_resv_rec(void *x)
 		    (resv_ptr->flags & RESERVE_FLAG_MAGNETIC))
 			(void)list_remove_first(
 				magnetic_resv_list, _find_resv_ptr, resv_ptr);
+		_resv_name_hash_remove(resv_ptr);
+		_resv_index_invalidate();
 
 		xassert(resv_ptr->magic == RESV_MAGIC);
 		resv_ptr->magic = 0;
@@ -525,6 +720,8 @@ static void _add_resv_to_lists(slurmctld_resv_t *resv_ptr)
 	xassert(magnetic_resv_list);
 
 	list_append(resv_list, resv_ptr);
+	_resv_name_hash_add(resv_ptr);
+	_resv_index_invalidate();
 	if (resv_ptr->flags & RESERVE_FLAG_MAGNETIC)
 		list_append(magnetic_resv_list, resv_ptr);
 }
@@ -594,18 +791,6 @@ static int _find_resv_ptr(void *x, void *key)
 		return 1;	/* match */
 }
 
-static int _find_resv_name(void *x, void *key)
-{
-	slurmctld_resv_t *resv_ptr = (slurmctld_resv_t *) x;
-
-	xassert(resv_ptr->magic == RESV_MAGIC);
-
-	if (xstrcmp(resv_ptr->name, (char *) key))
-		return 0;
-	else
-		return 1;	/* match */
-}
-
 static int _foreach_clear_job_resv(void *x, void *key)
 {
 	job_record_t *job_ptr = (job_record_t *) x;
@@ -1093,6 +1278,7 @@ static int _post_resv_update(slurmctld_resv_t *resv_ptr,
 	if ((resv_ptr->start_time < now) && change) {
 		resv_ptr->start_time_prev = resv_ptr->start_time;
 		resv_ptr->start_time = now;
+		_resv_index_invalidate();
 	}
 
 	/* now set the (maybe new) start_times */
@@ -2156,6 +2342,10 @@ static bool _job_overlap(time_t start_time, uint64_t flags,
 	if (flags & RESERVE_FLAG_TIME_FLOAT)
 		start_time += time(NULL);
 
+	/* Running jobs never use idle nodes, skip walking job_list */
+	if (idle_node_bitmap && bit_super_set(node_bitmap, idle_node_bitmap))
+		return overlap;
+
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = list_next(job_iterator))) {
 		if (IS_JOB_RUNNING(job_ptr)		&&
@@ -2181,8 +2371,8 @@ static bool _resv_overlap(resv_desc_msg_t *resv_desc_ptr,
 			  bitstr_t *node_bitmap,
 			  slurmctld_resv_t *this_resv_ptr)
 {
-	ListIterator iter;
-	slurmctld_resv_t *resv_ptr;
+	slurmctld_resv_t **resv_array, *resv_ptr;
+	time_t end_time = resv_desc_ptr->end_time;
 	bool rc = false;
 
 	if ((resv_desc_ptr->flags & RESERVE_FLAG_MAINT)   ||
@@ -2190,9 +2380,14 @@ static bool _resv_overlap(resv_desc_msg_t *resv_desc_ptr,
 	    (!node_bitmap))
 		return rc;
 
-	iter = list_iterator_create(resv_list);
+	/* Daily reservations of either side are tested a week ahead */
+	if (resv_desc_ptr->flags & RESERVE_FLAG_DAILY)
+		end_time += RESV_OVERLAP_LOOKAHEAD;
+	resv_array = _resv_index_overlap(
+		resv_desc_ptr->start_time - RESV_OVERLAP_LOOKAHEAD, end_time,
+		false);
 
-	while ((resv_ptr = list_next(iter))) {
+	for (int i = 0; (resv_ptr = resv_array[i]); i++) {
 		if (resv_ptr == this_resv_ptr)
 			continue;	/* skip self */
 		if (resv_ptr->node_bitmap == NULL)
@@ -2209,7 +2404,7 @@ static bool _resv_overlap(resv_desc_msg_t *resv_desc_ptr,
 			break;
 		}
 	}
-	list_iterator_destroy(iter);
+	xfree(resv_array);
 
 	return rc;
 }
@@ -2873,6 +3068,18 @@ extern void resv_fini(void)
 {
 	FREE_NULL_LIST(magnetic_resv_list);
 	FREE_NULL_LIST(resv_list);
+	xhash_free(resv_name_hash);
+
+	slurm_mutex_lock(&resv_index_mutex);
+	interval_tree_destroy(resv_window_index);
+	resv_window_index = NULL;
+	interval_tree_destroy(resv_end_index);
+	resv_end_index = NULL;
+	xfree(resv_index_ents);
+	xfree(resv_float_ents);
+	resv_float_cnt = 0;
+	resv_index_stale = true;
+	slurm_mutex_unlock(&resv_index_mutex);
 }
 
 /* Update an exiting resource reservation */
@@ -3372,6 +3579,8 @@ extern int update_resv(resv_desc_msg_t *resv_desc_ptr)
 	}
 
 	_del_resv_rec(resv_backup);
+	/* start_time, end_time and flags may all have changed above */
+	_resv_index_invalidate();
 	(void) set_node_maint_mode(true);
 
 	last_resv_update = now;
@@ -3468,10 +3677,9 @@ extern int delete_resv(reservation_name_msg_t *resv_desc_ptr)
 /* Return pointer to the named reservation or NULL if not found */
 extern slurmctld_resv_t *find_resv_name(char *resv_name)
 {
-	slurmctld_resv_t *resv_ptr;
-	resv_ptr = (slurmctld_resv_t *) list_find_first (resv_list,
-			_find_resv_name, resv_name);
-	return resv_ptr;
+	if (!resv_name || !resv_name_hash)
+		return NULL;
+	return xhash_get_str(resv_name_hash, resv_name);
 }
 
 /* Dump the reservation records to a buffer */
@@ -4169,16 +4377,14 @@ static buf_t *_open_resv_state_file(char **state_file)
 }
 
 /*
- * Load the reservation state from file, recover on slurmctld restart.
- *	Reset reservation pointers for all jobs.
- *	Execute this after loading the configuration file data.
- * IN recover - 0 = validate current reservations ONLY if already recovered,
- *                  otherwise recover from disk
- *              1+ = recover all reservation state from disk
+ * Read and unpack the reservation state file
+ * OUT resv_list_out - unpacked reservations, NULL if there is nothing to
+ *	recover (no file or incompatible version)
+ * OUT suffix - top_suffix saved in the file
  * RET SLURM_SUCCESS or error code
- * NOTE: READ lock_slurmctld config before entry
+ * NOTE: Only touches the state file, so it can run in a separate thread
  */
-extern int load_all_resv_state(int recover)
+static int _unpack_resv_state(List *resv_list_out, uint32_t *suffix)
 {
 	char *state_file, *ver_str = NULL;
 	time_t now;
@@ -4188,14 +4394,7 @@ extern int load_all_resv_state(int recover)
 	slurmctld_resv_t *resv_ptr = NULL;
 	uint16_t protocol_version = NO_VAL16;
 
-	last_resv_update = time(NULL);
-	if ((recover == 0) && resv_list) {
-		_validate_all_reservations();
-		return SLURM_SUCCESS;
-	}
-
-	/* Read state file and validate */
-	_create_resv_lists(true);
+	*resv_list_out = NULL;
 
 	/* read the file */
 	lock_state_files();
@@ -4227,19 +4426,16 @@ extern int load_all_resv_state(int recover)
 	}
 	xfree(ver_str);
 	safe_unpack_time(&now, buffer);
-	safe_unpack32(&top_suffix, buffer);
+	safe_unpack32(suffix, buffer);
 
+	*resv_list_out = list_create(NULL);
 	while (remaining_buf(buffer) > 0) {
 		resv_ptr = _load_reservation_state(buffer, protocol_version);
 		if (!resv_ptr)
 			break;
-
-		_add_resv_to_lists(resv_ptr);
-		info("Recovered state of reservation %s", resv_ptr->name);
+		list_append(*resv_list_out, resv_ptr);
 	}
 
-	_validate_all_reservations();
-	info("Recovered state of %d reservations", list_count(resv_list));
 	free_buf(buffer);
 	return error_code;
 
@@ -4247,12 +4443,81 @@ unpack_error:
 	if (!ignore_state_errors)
 		fatal("Incomplete reservation data checkpoint file, start with '-i' to ignore this. Warning: using -i will lose the data that can't be recovered.");
 	error("Incomplete reservation data checkpoint file");
-	_validate_all_reservations();
-	info("Recovered state of %d reservations", list_count(resv_list));
+	if (!*resv_list_out)
+		*resv_list_out = list_create(NULL);
 	free_buf(buffer);
 	return EFAULT;
 }
 
+static void *_resv_state_unpack(void *arg)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	resv_unpack_rc = _unpack_resv_state(&resv_unpack_list,
+					    &resv_unpack_suffix);
+	stats_recovery_phase("resv_state_unpack", &tv);
+
+	return NULL;
+}
+
+extern void resv_state_unpack_start(void)
+{
+	xassert(!resv_unpack_tid);
+	slurm_thread_create(&resv_unpack_tid, _resv_state_unpack, NULL);
+}
+
+/*
+ * Load the reservation state from file, recover on slurmctld restart.
+ *	Reset reservation pointers for all jobs.
+ *	Execute this after loading the configuration file data.
+ * IN recover - 0 = validate current reservations ONLY if already recovered,
+ *                  otherwise recover from disk
+ *              1+ = recover all reservation state from disk
+ * RET SLURM_SUCCESS or error code
+ * NOTE: READ lock_slurmctld config before entry
+ */
+extern int load_all_resv_state(int recover)
+{
+	int error_code;
+	List unpack_list;
+	uint32_t suffix = top_suffix;
+	slurmctld_resv_t *resv_ptr = NULL;
+
+	last_resv_update = time(NULL);
+	if ((recover == 0) && resv_list) {
+		_validate_all_reservations();
+		return SLURM_SUCCESS;
+	}
+
+	/* Read state file and validate */
+	_create_resv_lists(true);
+
+	if (resv_unpack_tid) {
+		pthread_join(resv_unpack_tid, NULL);
+		resv_unpack_tid = 0;
+		error_code = resv_unpack_rc;
+		unpack_list = resv_unpack_list;
+		resv_unpack_list = NULL;
+		suffix = resv_unpack_suffix;
+	} else
+		error_code = _unpack_resv_state(&unpack_list, &suffix);
+
+	if (!unpack_list)
+		return error_code;
+	top_suffix = suffix;
+
+	while ((resv_ptr = list_pop(unpack_list))) {
+		_add_resv_to_lists(resv_ptr);
+		info("Recovered state of reservation %s", resv_ptr->name);
+	}
+	FREE_NULL_LIST(unpack_list);
+
+	_validate_all_reservations();
+	info("Recovered state of %d reservations", list_count(resv_list));
+	return error_code;
+}
+
 static int _validate_job_resv_internal(job_record_t *job_ptr,
 				      slurmctld_resv_t *resv_ptr)
 {
@@ -6147,8 +6412,8 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 	time_t job_start_time, job_end_time, job_end_time_use, lic_resv_time;
 	time_t start_relative, end_relative;
 	time_t now = time(NULL);
-	ListIterator iter;
-	int i, rc = SLURM_SUCCESS, rc2;
+	slurmctld_resv_t **resv_array;
+	int i, j, rc = SLURM_SUCCESS, rc2;
 
 	*resv_overlap = false;	/* initialize to false */
 	job_start_time = *when;
@@ -6233,8 +6498,10 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 		 * if there are any overlapping reservations, we need to
 		 * prevent the job from using those nodes (e.g. MAINT nodes)
 		 */
-		iter = list_iterator_create(resv_list);
-		while ((res2_ptr = list_next(iter))) {
+		_resv_index_advance(now);
+		resv_array = _resv_index_overlap(job_start_time, job_end_time,
+						 reboot);
+		for (j = 0; (res2_ptr = resv_array[j]); j++) {
 			if (reboot)
 				job_end_time_use =
 					job_end_time + res2_ptr->boot_time;
@@ -6264,7 +6531,7 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 				bit_and_not(*node_bitmap,res2_ptr->node_bitmap);
 			}
 		}
-		list_iterator_destroy(iter);
+		xfree(resv_array);
 
 		if (slurm_conf.debug_flags & DEBUG_FLAG_RESERVATION) {
 			char *nodes = bitmap2node_name(*node_bitmap);
@@ -6296,11 +6563,13 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 	 * Job has no reservation, try to find time when this can
 	 * run and get it's required nodes (if any)
 	 */
+	_resv_index_advance(now);
 	for (i = 0; ; i++) {
 		lic_resv_time = (time_t) 0;
 
-		iter = list_iterator_create(resv_list);
-		while ((resv_ptr = list_next(iter))) {
+		resv_array = _resv_index_overlap(job_start_time, job_end_time,
+						 reboot);
+		for (j = 0; (resv_ptr = resv_array[j]); j++) {
 			_get_rel_start_end(
 				resv_ptr, now, &start_relative, &end_relative);
 
@@ -6389,7 +6658,7 @@ extern int job_test_resv(job_record_t *job_ptr, time_t *when,
 				continue;
 			}
 		}
-		list_iterator_destroy(iter);
+		xfree(resv_array);
 
 		if ((rc == SLURM_SUCCESS) && move_time) {
 			if (license_job_test(job_ptr, job_start_time, reboot)
@@ -6479,21 +6748,16 @@ static int _update_resv_group_uid_access_list(void *x, void *arg)
  */
 extern time_t find_resv_end(time_t start_time, int resolution)
 {
-	ListIterator iter;
-	slurmctld_resv_t *resv_ptr;
 	time_t end_time = 0;
 
 	if (!resv_list)
 		return end_time;
 
-	iter = list_iterator_create(resv_list);
-	while ((resv_ptr = list_next(iter))) {
-		if (start_time > resv_ptr->end_time)
-			continue;
-		if ((end_time == 0) || (resv_ptr->end_time < end_time))
-			end_time = resv_ptr->end_time;
-	}
-	list_iterator_destroy(iter);
+	slurm_mutex_lock(&resv_index_mutex);
+	_resv_index_build();
+	if (!interval_tree_next_end(resv_end_index, start_time, &end_time))
+		end_time = 0;
+	slurm_mutex_unlock(&resv_index_mutex);
 
 	/* Round-up returned time to given resolution */
 	if (resolution > 0) {
@@ -6643,6 +6907,7 @@ static int _advance_resv_time(slurmctld_resv_t *resv_ptr)
 		resv_ptr->start_time_prev = resv_ptr->start_time;
 		resv_ptr->start_time_first = resv_ptr->start_time;
 		_advance_time(&resv_ptr->end_time, day_cnt);
+		_resv_index_invalidate();
 		resv_ptr->ctld_flags &= (~RESV_CTLD_PROLOG);
 		resv_ptr->ctld_flags &= (~RESV_CTLD_EPILOG);
 		_post_resv_create(resv_ptr);
@@ -93,6 +93,14 @@ extern void update_assocs_in_resvs(void);
 */
 extern void update_part_nodes_in_resv(part_record_t *part_ptr);
 
+/*
+ * Start reading and unpacking the reservation state file in a separate
+ * thread. The next load_all_resv_state() waits for it and only adds and
+ * validates the unpacked reservations.
+ * NOTE: Call after the configuration is built, it reads slurm_conf
+ */
+extern void resv_state_unpack_start(void);
+
 /*
  * Load the reservation state from file, recover on slurmctld restart.
  *	Reset reservation pointers for all jobs.
@@ -192,8 +192,27 @@ typedef struct diag_stats {
 	uint32_t bf_table_size;
 	uint32_t bf_table_size_sum;
 	time_t   bf_when_last_cycle;
+	uint32_t bf_shape_cache_hits;
+	uint32_t bf_shape_cache_misses;
 
 	uint32_t latency;
+
+	/* Step creation phases in usec, protected by step_stats_mutex */
+	uint32_t step_create_cnt;
+	uint64_t step_create_time_sum;
+	uint32_t step_create_time_max;
+	uint64_t step_cred_sign_time_sum;
+	uint32_t step_cred_sign_time_max;
+	uint64_t step_resp_time_sum;
+	uint32_t step_resp_time_max;
+
+	/* job_submit plugin calls in usec, protected by job_submit_stats_mutex */
+	uint32_t job_submit_cnt;
+	uint64_t job_submit_time_sum;
+	uint32_t job_submit_time_max;
+	uint32_t job_modify_cnt;
+	uint64_t job_modify_time_sum;
+	uint32_t job_modify_time_max;
 } diag_stats_t;
 
 typedef struct {
@@ -639,6 +658,11 @@ typedef struct job_array_struct {
 	uint32_t pend_run_tasks;	/* Number of tasks ready to run due to
 					 * preempting other jobs */
 	uint32_t tot_comp_tasks;	/* Completed task count */
+	bool task_recs_valid;		/* pend_task_recs and incomp_task_recs
+					 * are set, not saved in state file */
+	uint32_t pend_task_recs;	/* Split out task records pending */
+	uint32_t incomp_task_recs;	/* Split out task records not yet
+					 * completed */
 } job_array_struct_t;
 
 #define ADMIN_SET_LIMIT 0xffff
@@ -759,7 +783,10 @@ struct job_record {
 	uint32_t job_id;		/* job ID */
 	job_record_t *job_next;		/* next entry with same hash index */
 	job_record_t *job_array_next_j;	/* job array linked list by job_id */
+	job_record_t *job_array_prev_j;	/* previous entry in that list */
 	job_record_t *job_array_next_t;	/* job array linked list by task_id */
+	uint8_t job_array_cnt_flags;	/* how this task record is counted in
+					 * array_recs, ARRAY_TASK_CNT_* */
 	job_record_t *job_preempt_comp; /* het job preempt component */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint32_t job_state;		/* state of the job */
@@ -1473,6 +1500,12 @@ extern job_record_t *job_array_split(job_record_t *job_ptr);
 /* Record the start of one job array task */
 extern void job_array_start(job_record_t *job_ptr);
 
+/*
+ * Update the pending and not completed task record counts of a job array
+ * after the state of one of its task records may have changed.
+ */
+extern void job_array_task_cnt_update(job_record_t *job_ptr);
+
 /* Return true if a job array task can be started */
 extern bool job_array_start_test(job_record_t *job_ptr);
 
@@ -2023,12 +2056,13 @@ extern void pack_all_part(char **buffer_ptr, int *buffer_size,
  *	updated
  * IN uid - user requesting the data
  * IN has_qos_lock - true if assoc_lock .qos=READ_LOCK already acquired
+ * IN dict - string dictionary shared by the jobs of one message, or NULL
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
  *	  whenever the data format changes
  */
 extern void pack_job(job_record_t *dump_job_ptr, uint16_t show_flags,
 		     buf_t *buffer, uint16_t protocol_version, uid_t uid,
-		     bool has_qos_lock);
+		     bool has_qos_lock, str_dict_t *dict);
 
 /*
  * pack_part - dump all configuration information about a specific partition
@@ -2221,6 +2255,47 @@ extern void reset_node_free_mem(char *node_name, uint64_t free_mem);
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level);
 
+/*
+ * Record the time spent in each phase of a job step creation RPC
+ * create_usec IN - step record and unsigned credential creation
+ * sign_usec IN - credential signing, done without slurmctld locks
+ * resp_usec IN - sending the response
+ */
+extern void stats_step_create_record(uint32_t create_usec, uint32_t sign_usec,
+				     uint32_t resp_usec);
+
+/*
+ * Record the time spent in one call to the job_submit plugins
+ * modify IN - job_modify() rather than job_submit()
+ * usec IN - time spent in all plugins, including waiting for them
+ */
+extern void stats_job_submit_record(bool modify, uint32_t usec);
+
+/*
+ * Record the time spent in one phase of the state recovery at startup
+ * name IN - phase name, must be a string constant
+ * tv IN/OUT - start of the phase, set to the current time on return
+ */
+extern void stats_recovery_phase(const char *name, struct timeval *tv);
+
+/*
+ * Latency histograms use two buckets per power of two of microseconds,
+ * so percentiles derived from them are within 25% of the real value.
+ */
+#define LATENCY_HIST_BUCKETS 64
+
+/* Return the histogram bucket to count a usec value in */
+extern uint32_t latency_hist_bucket(uint32_t usec);
+
+/*
+ * Estimate the usec value under which pct percent of the samples fall
+ * hist IN - LATENCY_HIST_BUCKETS counters
+ * cnt IN - total count of samples in hist
+ * max IN - largest sample, bounds the estimate
+ */
+extern uint32_t latency_hist_percentile(uint32_t *hist, uint32_t cnt,
+					uint32_t max, int pct);
+
 /*
  * restore_node_features - Make node and config (from slurm.conf) fields
  *	consistent for Features, Gres and Weight
@@ -37,8 +37,11 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/intern.h"
+#include "src/slurmctld/record_pool.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
@@ -47,6 +50,35 @@
 
 extern int retry_list_size(void);
 
+static pthread_mutex_t step_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t job_submit_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Startup state recovery is timed once and not cleared by reset_stats() */
+#define RECOVERY_PHASE_MAX 16
+typedef struct {
+	const char *name;
+	uint32_t usec;
+} recovery_phase_t;
+static pthread_mutex_t recovery_mutex = PTHREAD_MUTEX_INITIALIZER;
+static recovery_phase_t recovery_phase[RECOVERY_PHASE_MAX];
+static uint32_t recovery_phase_cnt = 0;
+
+/* Return the resident set size of slurmctld in bytes, 0 if unknown */
+static uint64_t _get_rss(void)
+{
+	FILE *fp;
+	unsigned long size, resident;
+	uint64_t rss = 0;
+
+	if (!(fp = fopen("/proc/self/statm", "r")))
+		return 0;
+	if (fscanf(fp, "%lu %lu", &size, &resident) == 2)
+		rss = (uint64_t) resident * getpagesize();
+	fclose(fp);
+
+	return rss;
+}
+
 /* Pack all scheduling statistics */
 extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version)
@@ -57,6 +89,9 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	int agent_count;
 	int agent_thread_count;
 	int slurmdbd_queue_size = 0;
+	uint32_t str_cnt, compress_cnt;
+	uint64_t str_bytes, str_refs;
+	uint64_t compress_in, compress_out, compress_usec;
 	time_t now = time(NULL);
 
 	buffer_ptr[0] = NULL;
@@ -140,6 +175,72 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_active, buffer);
 			pack32(slurmctld_diag_stats.backfilled_het_jobs,
 			       buffer);
+
+			if (protocol_version >=
+			    SLURM_21_08_1_PROTOCOL_VERSION) {
+				slurm_mutex_lock(&step_stats_mutex);
+				pack32(slurmctld_diag_stats.step_create_cnt,
+				       buffer);
+				pack64(slurmctld_diag_stats.
+				       step_create_time_sum, buffer);
+				pack32(slurmctld_diag_stats.
+				       step_create_time_max, buffer);
+				pack64(slurmctld_diag_stats.
+				       step_cred_sign_time_sum, buffer);
+				pack32(slurmctld_diag_stats.
+				       step_cred_sign_time_max, buffer);
+				pack64(slurmctld_diag_stats.step_resp_time_sum,
+				       buffer);
+				pack32(slurmctld_diag_stats.step_resp_time_max,
+				       buffer);
+				slurm_mutex_unlock(&step_stats_mutex);
+
+				slurm_mutex_lock(&recovery_mutex);
+				pack32(recovery_phase_cnt, buffer);
+				for (int i = 0; i < recovery_phase_cnt; i++) {
+					packstr((char *) recovery_phase[i].name,
+						buffer);
+					pack32(recovery_phase[i].usec, buffer);
+				}
+				slurm_mutex_unlock(&recovery_mutex);
+
+				pack64(_get_rss(), buffer);
+				record_pool_pack_stats(buffer);
+
+				intern_stats(&str_cnt, &str_bytes, &str_refs);
+				pack32(str_cnt, buffer);
+				pack64(str_bytes, buffer);
+				pack64(str_refs, buffer);
+
+				slurm_get_compress_stats(&compress_cnt,
+							 &compress_in,
+							 &compress_out,
+							 &compress_usec);
+				pack32(compress_cnt, buffer);
+				pack64(compress_in, buffer);
+				pack64(compress_out, buffer);
+				pack64(compress_usec, buffer);
+
+				slurm_mutex_lock(&job_submit_stats_mutex);
+				pack32(slurmctld_diag_stats.job_submit_cnt,
+				       buffer);
+				pack64(slurmctld_diag_stats.
+				       job_submit_time_sum, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_submit_time_max, buffer);
+				pack32(slurmctld_diag_stats.job_modify_cnt,
+				       buffer);
+				pack64(slurmctld_diag_stats.
+				       job_modify_time_sum, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_modify_time_max, buffer);
+				slurm_mutex_unlock(&job_submit_stats_mutex);
+
+				pack32(slurmctld_diag_stats.
+				       bf_shape_cache_hits, buffer);
+				pack32(slurmctld_diag_stats.
+				       bf_shape_cache_misses, buffer);
+			}
 		}
 	}
 
@@ -177,9 +278,133 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_queue_len = 0;
 	slurmctld_diag_stats.bf_queue_len_sum = 0;
 	slurmctld_diag_stats.bf_table_size_sum = 0;
+	slurmctld_diag_stats.bf_shape_cache_hits = 0;
+	slurmctld_diag_stats.bf_shape_cache_misses = 0;
 	slurmctld_diag_stats.bf_cycle_max = 0;
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 
+	slurm_mutex_lock(&step_stats_mutex);
+	slurmctld_diag_stats.step_create_cnt = 0;
+	slurmctld_diag_stats.step_create_time_sum = 0;
+	slurmctld_diag_stats.step_create_time_max = 0;
+	slurmctld_diag_stats.step_cred_sign_time_sum = 0;
+	slurmctld_diag_stats.step_cred_sign_time_max = 0;
+	slurmctld_diag_stats.step_resp_time_sum = 0;
+	slurmctld_diag_stats.step_resp_time_max = 0;
+	slurm_mutex_unlock(&step_stats_mutex);
+
+	slurm_mutex_lock(&job_submit_stats_mutex);
+	slurmctld_diag_stats.job_submit_cnt = 0;
+	slurmctld_diag_stats.job_submit_time_sum = 0;
+	slurmctld_diag_stats.job_submit_time_max = 0;
+	slurmctld_diag_stats.job_modify_cnt = 0;
+	slurmctld_diag_stats.job_modify_time_sum = 0;
+	slurmctld_diag_stats.job_modify_time_max = 0;
+	slurm_mutex_unlock(&job_submit_stats_mutex);
+
+	slurm_reset_compress_stats();
+
 	last_proc_req_start = time(NULL);
 }
+
+extern uint32_t latency_hist_bucket(uint32_t usec)
+{
+	int bit;
+
+	if (usec < 2)
+		return usec;
+	bit = 31 - __builtin_clz(usec);
+	return (bit * 2) + ((usec >> (bit - 1)) & 1);
+}
+
+/* Return the largest usec value which falls into the given bucket */
+static uint32_t _latency_hist_bucket_max(uint32_t bucket)
+{
+	int bit = bucket / 2;
+	uint64_t lo;
+
+	if (bucket < 2)
+		return bucket;
+	lo = (uint64_t) (2 | (bucket & 1)) << (bit - 1);
+	return MIN(lo + ((uint64_t) 1 << (bit - 1)) - 1, UINT32_MAX);
+}
+
+extern uint32_t latency_hist_percentile(uint32_t *hist, uint32_t cnt,
+					uint32_t max, int pct)
+{
+	uint64_t target, sum = 0;
+
+	if (!cnt)
+		return 0;
+
+	target = (((uint64_t) cnt * pct) + 99) / 100;
+	for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum >= target)
+			return MIN(_latency_hist_bucket_max(i), max);
+	}
+	return max;
+}
+
+extern void stats_step_create_record(uint32_t create_usec, uint32_t sign_usec,
+				     uint32_t resp_usec)
+{
+	slurm_mutex_lock(&step_stats_mutex);
+	slurmctld_diag_stats.step_create_cnt++;
+	slurmctld_diag_stats.step_create_time_sum += create_usec;
+	slurmctld_diag_stats.step_create_time_max =
+		MAX(slurmctld_diag_stats.step_create_time_max, create_usec);
+	slurmctld_diag_stats.step_cred_sign_time_sum += sign_usec;
+	slurmctld_diag_stats.step_cred_sign_time_max =
+		MAX(slurmctld_diag_stats.step_cred_sign_time_max, sign_usec);
+	slurmctld_diag_stats.step_resp_time_sum += resp_usec;
+	slurmctld_diag_stats.step_resp_time_max =
+		MAX(slurmctld_diag_stats.step_resp_time_max, resp_usec);
+	slurm_mutex_unlock(&step_stats_mutex);
+}
+
+extern void stats_job_submit_record(bool modify, uint32_t usec)
+{
+	slurm_mutex_lock(&job_submit_stats_mutex);
+	if (modify) {
+		slurmctld_diag_stats.job_modify_cnt++;
+		slurmctld_diag_stats.job_modify_time_sum += usec;
+		slurmctld_diag_stats.job_modify_time_max =
+			MAX(slurmctld_diag_stats.job_modify_time_max, usec);
+	} else {
+		slurmctld_diag_stats.job_submit_cnt++;
+		slurmctld_diag_stats.job_submit_time_sum += usec;
+		slurmctld_diag_stats.job_submit_time_max =
+			MAX(slurmctld_diag_stats.job_submit_time_max, usec);
+	}
+	slurm_mutex_unlock(&job_submit_stats_mutex);
+}
+
+extern void stats_recovery_phase(const char *name, struct timeval *tv)
+{
+	struct timeval now;
+	uint64_t usec;
+
+	gettimeofday(&now, NULL);
+	usec = ((now.tv_sec - tv->tv_sec) * USEC_IN_SEC) +
+	       (now.tv_usec - tv->tv_usec);
+	*tv = now;
+
+	info("State recovery phase %s took %"PRIu64" usec", name, usec);
+
+	slurm_mutex_lock(&recovery_mutex);
+	for (int i = 0; i < recovery_phase_cnt; i++) {
+		if (!xstrcmp(recovery_phase[i].name, name)) {
+			recovery_phase[i].usec = MIN(usec, UINT32_MAX);
+			slurm_mutex_unlock(&recovery_mutex);
+			return;
+		}
+	}
+	if (recovery_phase_cnt < RECOVERY_PHASE_MAX) {
+		recovery_phase[recovery_phase_cnt].name = name;
+		recovery_phase[recovery_phase_cnt].usec = MIN(usec, UINT32_MAX);
+		recovery_phase_cnt++;
+	}
+	slurm_mutex_unlock(&recovery_mutex);
+}
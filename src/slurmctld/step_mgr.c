@@ -75,6 +75,7 @@
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/node_scheduler.h"
 #include "src/slurmctld/port_mgr.h"
+#include "src/slurmctld/record_pool.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
 
@@ -87,6 +88,9 @@ typedef struct {
 	uid_t uid;
 } step_signal_t;
 
+static record_pool_t step_pool =
+	RECORD_POOL_INITIALIZER("step", sizeof(step_record_t));
+
 static void _build_pending_step(job_record_t *job_ptr,
 				job_step_create_request_msg_t *step_specs);
 static int _step_partial_comp(step_record_t *step_ptr,
@@ -170,7 +174,7 @@ static int _opt_node_cnt(uint32_t step_min_nodes, uint32_t step_max_nodes,
  * IN job_ptr - pointer to job table entry to have step record added
  * IN protocol_version - slurm protocol version of client
  * RET a pointer to the record or NULL if error
- * NOTE: allocates memory that should be xfreed with delete_step_record
+ * NOTE: allocates memory that should be freed with delete_step_record
  */
 static step_record_t *_create_step_record(job_record_t *job_ptr,
 					  uint16_t protocol_version)
@@ -187,7 +191,7 @@ static step_record_t *_create_step_record(job_record_t *job_ptr,
 		return NULL;
 	}
 
-	step_ptr = xmalloc(sizeof(*step_ptr));
+	step_ptr = record_pool_alloc(&step_pool);
 
 	last_job_update = time(NULL);
 	step_ptr->job_ptr    = job_ptr;
@@ -468,7 +472,7 @@ extern void free_step_record(void *x)
 	xfree(step_ptr->tres_per_task);
 	xfree(step_ptr->memory_allocated);
 	step_ptr->magic = ~STEP_MAGIC;
-	xfree(step_ptr);
+	record_pool_free(&step_pool, step_ptr);
 }
 
 /*
@@ -56,6 +56,7 @@
 #include "src/common/slurmdbd_defs.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/uid.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -69,6 +70,10 @@
 /* Change TRIGGER_STATE_VERSION value when changing the state save format */
 #define TRIGGER_STATE_VERSION        "PROTOCOL_VERSION"
 
+/* Trigger types which only fire on events recorded in the node bitmaps */
+#define TRIGGER_NODE_EVENT_TYPES (TRIGGER_TYPE_UP   | TRIGGER_TYPE_DOWN | \
+				  TRIGGER_TYPE_FAIL | TRIGGER_TYPE_DRAINED)
+
 List trigger_list;
 uint32_t next_trigger_id = 1;
 static pthread_mutex_t trigger_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -91,6 +96,7 @@ static bool trigger_pri_dbd_fail = false;
 static bool trigger_pri_dbd_res_op = false;
 static bool trigger_pri_db_fail = false;
 static bool trigger_pri_db_res_op = false;
+static uint32_t trigger_test_types = 0;	/* TRIGGER_TYPE_* worth testing */
 
 /* Current trigger pull states (saved and restored) */
 uint8_t ctld_failure = 0;
@@ -119,9 +125,78 @@ typedef struct trig_mgr_info {
 	time_t   orig_time;	/* offset (pending) or time stamp (complete) */
 } trig_mgr_info_t;
 
+/* Job triggers of one job, the records are owned by trigger_list */
+typedef struct {
+	uint32_t job_id;
+	List trig_list;		/* trig_mgr_info_t's for this job */
+} trig_job_t;
+
+static xhash_t *trig_job_hash = NULL;	/* trig_job_t's by job id */
+
+static void _trig_job_id(void *item, const char **key, uint32_t *key_len)
+{
+	trig_job_t *trig_job = item;
+
+	*key = (const char *) &trig_job->job_id;
+	*key_len = sizeof(trig_job->job_id);
+}
+
+static void _trig_job_free(void *x)
+{
+	trig_job_t *trig_job = x;
+
+	FREE_NULL_LIST(trig_job->trig_list);
+	xfree(trig_job);
+}
+
+/* Add a trigger to trigger_list, indexing job triggers by job id */
+static void _trig_add(trig_mgr_info_t *trig_ptr, bool prepend)
+{
+	trig_job_t *trig_job;
+
+	if (prepend)
+		list_prepend(trigger_list, trig_ptr);
+	else
+		list_append(trigger_list, trig_ptr);
+
+	if (trig_ptr->res_type != TRIGGER_RES_TYPE_JOB)
+		return;
+
+	if (!trig_job_hash)
+		trig_job_hash = xhash_init(_trig_job_id, _trig_job_free);
+	if (!(trig_job = xhash_get(trig_job_hash,
+				   (const char *) &trig_ptr->job_id,
+				   sizeof(trig_ptr->job_id)))) {
+		trig_job = xmalloc(sizeof(*trig_job));
+		trig_job->job_id = trig_ptr->job_id;
+		trig_job->trig_list = list_create(NULL);
+		xhash_add(trig_job_hash, trig_job);
+	}
+	list_append(trig_job->trig_list, trig_ptr);
+}
+
+static List _trig_job_list(uint32_t job_id)
+{
+	trig_job_t *trig_job;
+
+	if (!trig_job_hash ||
+	    !(trig_job = xhash_get(trig_job_hash, (const char *) &job_id,
+				   sizeof(job_id))))
+		return NULL;
+	return trig_job->trig_list;
+}
+
 /* Prototype for ListDelF */
 void _trig_del(void *x) {
 	trig_mgr_info_t * tmp = (trig_mgr_info_t *) x;
+	List trig_list;
+
+	if ((tmp->res_type == TRIGGER_RES_TYPE_JOB) &&
+	    (trig_list = _trig_job_list(tmp->job_id)) &&
+	    list_delete_ptr(trig_list, tmp) &&
+	    !list_count(trig_list))
+		xhash_delete(trig_job_hash, (const char *) &tmp->job_id,
+			     sizeof(tmp->job_id));
 	xfree(tmp->res_id);
 	xfree(tmp->orig_res_id);
 	xfree(tmp->program);
@@ -367,13 +442,19 @@ extern trigger_info_msg_t * trigger_get(uid_t uid, trigger_info_msg_t *msg)
 	return resp_data;
 }
 
-static bool _duplicate_trigger(trigger_info_t *trig_desc)
+static bool _duplicate_trigger(trigger_info_t *trig_desc, uint32_t job_id)
 {
 	bool found_dup = false;
 	ListIterator trig_iter;
 	trig_mgr_info_t *trig_rec;
+	List trig_list = trigger_list;
 
-	trig_iter = list_iterator_create(trigger_list);
+	/* Job triggers can only duplicate other triggers of the same job */
+	if ((trig_desc->res_type == TRIGGER_RES_TYPE_JOB) &&
+	    !(trig_list = _trig_job_list(job_id)))
+		return false;
+
+	trig_iter = list_iterator_create(trig_list);
 	while ((trig_rec = list_next(trig_iter))) {
 		if ((trig_desc->flags     == trig_rec->flags)      &&
 		    (trig_desc->res_type  == trig_rec->res_type)   &&
@@ -453,7 +534,7 @@ extern int trigger_set(uid_t uid, gid_t gid, trigger_info_msg_t *msg)
 			}
 		}
 		msg->trigger_array[i].user_id = (uint32_t) uid;
-		if (_duplicate_trigger(&msg->trigger_array[i])) {
+		if (_duplicate_trigger(&msg->trigger_array[i], job_id)) {
 			FREE_NULL_BITMAP(bitmap);
 			rc = ESLURM_TRIGGER_DUP;
 			continue;
@@ -492,7 +573,7 @@ extern int trigger_set(uid_t uid, gid_t gid, trigger_info_msg_t *msg)
 			xfree(trig_add);
 			continue;
 		}
-		list_append(trigger_list, trig_add);
+		_trig_add(trig_add, false);
 		schedule_trigger_save();
 	}
 
@@ -730,21 +811,35 @@ static void _dump_trigger_state(trig_mgr_info_t *trig_ptr, buf_t *buffer)
 	pack8    (trig_ptr->state,     buffer);
 }
 
-static int _load_trigger_state(buf_t *buffer, uint16_t protocol_version)
+/* Trigger pull states of the last record of an unpacked state file */
+typedef struct {
+	uint8_t ctld_failure;
+	uint8_t bu_ctld_failure;
+	uint8_t dbd_failure;
+	uint8_t db_failure;
+} trig_pull_state_t;
+
+/* Trigger state file unpacked by trigger_state_unpack_start() */
+static pthread_t trig_unpack_tid = 0;
+static List trig_unpack_list = NULL;
+static trig_pull_state_t trig_unpack_pull;
+static int trig_unpack_rc = SLURM_SUCCESS;
+
+static trig_mgr_info_t *_unpack_trigger_state(buf_t *buffer,
+					      uint16_t protocol_version,
+					      trig_pull_state_t *pull)
 {
 	trig_mgr_info_t *trig_ptr;
 	uint32_t str_len;
 
-	xassert(verify_lock(JOB_LOCK, READ_LOCK));
-
 	trig_ptr = xmalloc(sizeof(trig_mgr_info_t));
 
 	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		/* restore trigger pull state flags */
-		safe_unpack8(&ctld_failure, buffer);
-		safe_unpack8(&bu_ctld_failure, buffer);
-		safe_unpack8(&dbd_failure, buffer);
-		safe_unpack8(&db_failure, buffer);
+		safe_unpack8(&pull->ctld_failure, buffer);
+		safe_unpack8(&pull->bu_ctld_failure, buffer);
+		safe_unpack8(&pull->dbd_failure, buffer);
+		safe_unpack8(&pull->db_failure, buffer);
 
 		safe_unpack16   (&trig_ptr->flags,     buffer);
 		safe_unpack32   (&trig_ptr->trig_id,   buffer);
@@ -759,8 +854,8 @@ static int _load_trigger_state(buf_t *buffer, uint16_t protocol_version)
 		safe_unpackstr_xmalloc(&trig_ptr->program, &str_len, buffer);
 		safe_unpack8    (&trig_ptr->state,     buffer);
 	} else {
-		error("_load_trigger_state: protocol_version "
-		      "%hu not supported", protocol_version);
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
 		goto unpack_error;
 	}
 
@@ -768,6 +863,22 @@ static int _load_trigger_state(buf_t *buffer, uint16_t protocol_version)
 	    (trig_ptr->res_type > TRIGGER_RES_TYPE_OTHER) ||
 	    (trig_ptr->state > 2))
 		goto unpack_error;
+
+	return trig_ptr;
+
+unpack_error:
+	error("Incomplete trigger record");
+	xfree(trig_ptr->res_id);
+	xfree(trig_ptr->program);
+	xfree(trig_ptr);
+	return NULL;
+}
+
+/* Validate an unpacked trigger against the job and node tables, add it */
+static int _load_trigger_state(trig_mgr_info_t *trig_ptr)
+{
+	xassert(verify_lock(JOB_LOCK, READ_LOCK));
+
 	if (trig_ptr->res_type == TRIGGER_RES_TYPE_JOB) {
 		job_record_t *job_ptr;
 		trig_ptr->job_id = (uint32_t) atol(trig_ptr->res_id);
@@ -792,7 +903,7 @@ static int _load_trigger_state(buf_t *buffer, uint16_t protocol_version)
 	slurm_mutex_lock(&trigger_mutex);
 	if (trigger_list == NULL)
 		trigger_list = list_create(_trig_del);
-	list_append(trigger_list, trig_ptr);
+	_trig_add(trig_ptr, false);
 	next_trigger_id = MAX(next_trigger_id, trig_ptr->trig_id + 1);
 	slurm_mutex_unlock(&trigger_mutex);
 
@@ -915,25 +1026,32 @@ static buf_t *_open_trigger_state_file(char **state_file)
 	return create_mmap_buf(*state_file);;
 }
 
-extern void trigger_state_restore(void)
+/*
+ * Read and unpack the trigger state file
+ * OUT trig_list_out - unpacked triggers, NULL if there is nothing to recover
+ * OUT pull - trigger pull state flags saved in the file
+ * RET SLURM_SUCCESS or SLURM_ERROR if the file is incomplete
+ * NOTE: Only touches the state file, so it can run in a separate thread
+ */
+static int _unpack_trigger_state_file(List *trig_list_out,
+				      trig_pull_state_t *pull)
 {
 	uint16_t protocol_version = NO_VAL16;
-	int trigger_cnt = 0;
 	char *state_file;
 	buf_t *buffer;
 	time_t buf_time;
 	char *ver_str = NULL;
 	uint32_t ver_str_len;
+	trig_mgr_info_t *trig_ptr;
 
-	/* read the file */
-	xassert(verify_lock(CONF_LOCK, READ_LOCK));
+	*trig_list_out = NULL;
 
 	lock_state_files();
 	if (!(buffer = _open_trigger_state_file(&state_file))) {
 		info("No trigger state file (%s) to recover", state_file);
 		xfree(state_file);
 		unlock_state_files();
-		return;
+		return SLURM_SUCCESS;
 	}
 	xfree(state_file);
 	unlock_state_files();
@@ -949,27 +1067,99 @@ extern void trigger_state_restore(void)
 		      "incompatible");
 		xfree(ver_str);
 		free_buf(buffer);
-		return;
+		return SLURM_SUCCESS;
 	}
 	xfree(ver_str);
 
 	safe_unpack_time(&buf_time, buffer);
-	if (trigger_list)
-		list_flush(trigger_list);
+	*trig_list_out = list_create(NULL);
 	while (remaining_buf(buffer) > 0) {
-		if (_load_trigger_state(buffer, protocol_version) !=
-		    SLURM_SUCCESS)
+		if (!(trig_ptr = _unpack_trigger_state(buffer, protocol_version,
+						       pull)))
 			goto unpack_error;
-		trigger_cnt++;
+		list_append(*trig_list_out, trig_ptr);
 	}
-	goto fini;
+	free_buf(buffer);
+	return SLURM_SUCCESS;
 
 unpack_error:
-	if (!ignore_state_errors)
-		fatal("Incomplete trigger data checkpoint file, start with '-i' to ignore this. Warning: using -i will lose the data that can't be recovered.");
-	error("Incomplete trigger data checkpoint file");
-fini:	verbose("State of %d triggers recovered", trigger_cnt);
+	xfree(ver_str);
+	if (!*trig_list_out)
+		*trig_list_out = list_create(NULL);
 	free_buf(buffer);
+	return SLURM_ERROR;
+}
+
+static void *_trigger_state_unpack(void *arg)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	trig_unpack_rc = _unpack_trigger_state_file(&trig_unpack_list,
+						    &trig_unpack_pull);
+	stats_recovery_phase("trigger_state_unpack", &tv);
+
+	return NULL;
+}
+
+extern void trigger_state_unpack_start(void)
+{
+	xassert(!trig_unpack_tid);
+	slurm_thread_create(&trig_unpack_tid, _trigger_state_unpack, NULL);
+}
+
+extern void trigger_state_restore(void)
+{
+	int trigger_cnt = 0, rc;
+	List unpack_list;
+	trig_pull_state_t pull = {
+		.ctld_failure = ctld_failure,
+		.bu_ctld_failure = bu_ctld_failure,
+		.dbd_failure = dbd_failure,
+		.db_failure = db_failure,
+	};
+	trig_mgr_info_t *trig_ptr;
+
+	xassert(verify_lock(CONF_LOCK, READ_LOCK));
+
+	if (trig_unpack_tid) {
+		pthread_join(trig_unpack_tid, NULL);
+		trig_unpack_tid = 0;
+		rc = trig_unpack_rc;
+		unpack_list = trig_unpack_list;
+		trig_unpack_list = NULL;
+		pull = trig_unpack_pull;
+	} else
+		rc = _unpack_trigger_state_file(&unpack_list, &pull);
+
+	if (!unpack_list)
+		return;
+
+	/* Pull states of the last record read, as when unpacked in place */
+	ctld_failure = pull.ctld_failure;
+	bu_ctld_failure = pull.bu_ctld_failure;
+	dbd_failure = pull.dbd_failure;
+	db_failure = pull.db_failure;
+
+	if (trigger_list)
+		list_flush(trigger_list);
+	while ((trig_ptr = list_pop(unpack_list))) {
+		if (_load_trigger_state(trig_ptr) != SLURM_SUCCESS) {
+			rc = SLURM_ERROR;
+			break;
+		}
+		trigger_cnt++;
+	}
+	while ((trig_ptr = list_pop(unpack_list)))
+		_trig_del(trig_ptr);
+	FREE_NULL_LIST(unpack_list);
+
+	if (rc != SLURM_SUCCESS) {
+		if (!ignore_state_errors)
+			fatal("Incomplete trigger data checkpoint file, start with '-i' to ignore this. Warning: using -i will lose the data that can't be recovered.");
+		error("Incomplete trigger data checkpoint file");
+	}
+	verbose("State of %d triggers recovered", trigger_cnt);
 }
 
 static bool _front_end_job_test(bitstr_t *front_end_bitmap,
@@ -1031,6 +1221,10 @@ static void _trigger_job_event(trig_mgr_info_t *trig_in, time_t now)
 		}
 	}
 
+	/* The remaining tests are for node events */
+	if (!(trig_in->trig_type & trigger_test_types))
+		return;
+
 	if (trig_in->trig_type & TRIGGER_TYPE_DOWN) {
 		if (_front_end_job_test(trigger_down_front_end_bitmap,
 					job_ptr)) {
@@ -1557,7 +1751,31 @@ static void _trigger_clone(trig_mgr_info_t *trig_in)
 	trig_add->user_id   = trig_in->user_id;
 	trig_add->group_id  = trig_in->group_id;
 	trig_add->program   = xstrdup(trig_in->program);;
-	list_prepend(trigger_list, trig_add);
+	_trig_add(trig_add, true);
+}
+
+static bool _bitmap_set(bitstr_t *bitmap)
+{
+	return (bitmap && (bit_ffs(bitmap) != -1));
+}
+
+/* Return the TRIGGER_NODE_EVENT_TYPES with events recorded since last pass */
+static uint32_t _node_event_types(void)
+{
+	uint32_t event_types = 0;
+
+	if (_bitmap_set(trigger_up_nodes_bitmap) ||
+	    _bitmap_set(trigger_up_front_end_bitmap))
+		event_types |= TRIGGER_TYPE_UP;
+	if (_bitmap_set(trigger_down_nodes_bitmap) ||
+	    _bitmap_set(trigger_down_front_end_bitmap))
+		event_types |= TRIGGER_TYPE_DOWN;
+	if (_bitmap_set(trigger_fail_nodes_bitmap))
+		event_types |= TRIGGER_TYPE_FAIL;
+	if (_bitmap_set(trigger_drained_nodes_bitmap))
+		event_types |= TRIGGER_TYPE_DRAINED;
+
+	return event_types;
 }
 
 extern void trigger_process(void)
@@ -1573,9 +1791,18 @@ extern void trigger_process(void)
 	if (trigger_list == NULL)
 		trigger_list = list_create(_trig_del);
 
+	/*
+	 * Pending triggers which only wait for node events that did not
+	 * happen since the last pass can not fire, so don't test them.
+	 * Job triggers are always tested to purge those of defunct jobs.
+	 */
+	trigger_test_types = ~TRIGGER_NODE_EVENT_TYPES | _node_event_types();
+
 	trig_iter = list_iterator_create(trigger_list);
 	while ((trig_in = list_next(trig_iter))) {
-		if (trig_in->state == 0) {
+		if ((trig_in->state == 0) &&
+		    ((trig_in->res_type == TRIGGER_RES_TYPE_JOB) ||
+		     (trig_in->trig_type & trigger_test_types))) {
 			if (trig_in->res_type == TRIGGER_RES_TYPE_OTHER)
 				_trigger_other_event(trig_in, now);
 			else if (trig_in->res_type == TRIGGER_RES_TYPE_JOB)
@@ -1663,6 +1890,7 @@ extern void trigger_process(void)
 extern void trigger_fini(void)
 {
 	FREE_NULL_LIST(trigger_list);
+	xhash_free(trig_job_hash);
 	FREE_NULL_BITMAP(trigger_down_front_end_bitmap);
 	FREE_NULL_BITMAP(trigger_up_front_end_bitmap);
 	FREE_NULL_BITMAP(trigger_down_nodes_bitmap);
@@ -79,6 +79,14 @@ extern void trigger_primary_db_res_op(void);
 extern int  trigger_state_save(void);
 extern void trigger_state_restore(void);
 
+/*
+ * Start reading and unpacking the trigger state file in a separate thread.
+ * The next trigger_state_restore() waits for it and only validates and adds
+ * the unpacked triggers.
+ * NOTE: Call after the configuration is built, it reads slurm_conf
+ */
+extern void trigger_state_unpack_start(void);
+
 /* Free all allocated memory */
 extern void trigger_fini(void);
 
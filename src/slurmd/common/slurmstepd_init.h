@@ -51,6 +51,17 @@
 //#define SLURMSTEPD_MEMCHECK 3	/* Run slurmstepd with valgrind/drd */
 //#define SLURMSTEPD_MEMCHECK 4	/* Run slurmstepd with valgrind/helgrind */
 
+/*
+ * With LaunchParameters=slurmstepd_zygote, slurmd runs "slurmstepd zygote"
+ * processes which are initialized once and fork a new slurmstepd for each
+ * launch request. A request is one int (SLURMSTEPD_ZYGOTE_FORK) followed by
+ * the read end of the pipe to the slurmstepd and the write end of the pipe
+ * back to slurmd, both passed with send_fd_over_pipe(). The zygote replies
+ * with an int return code once the new slurmstepd was forked.
+ */
+#define SLURMSTEPD_ZYGOTE_ARG	"zygote"
+#define SLURMSTEPD_ZYGOTE_FORK	1
+
 typedef enum slurmd_step_tupe {
 	LAUNCH_BATCH_JOB = 0,
 	LAUNCH_TASKS,
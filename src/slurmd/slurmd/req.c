@@ -262,6 +262,21 @@ static List bcast_libdir_list = NULL;
 
 static pthread_mutex_t waiter_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* Pool of slurmstepd zygotes, see LaunchParameters=slurmstepd_zygote */
+#define STEPD_ZYGOTE_CNT 2
+typedef struct {
+	pthread_mutex_t mutex;
+	int fd;			/* control socket, -1 if not running */
+} stepd_zygote_t;
+static pthread_mutex_t stepd_zygote_mutex = PTHREAD_MUTEX_INITIALIZER;
+static stepd_zygote_t stepd_zygote[STEPD_ZYGOTE_CNT] = {
+	[0 ... STEPD_ZYGOTE_CNT - 1] = {
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+		.fd = -1,
+	}
+};
+static int stepd_zygote_next = 0;
+
 void
 slurmd_req(slurm_msg_t *msg)
 {
@@ -642,6 +657,119 @@ rwfail:
 }
 
 
+#if (SLURMSTEPD_MEMCHECK == 0)
+/*
+ * Start a slurmstepd zygote. It is detached from slurmd like any other
+ * slurmstepd and exits when its control socket is closed.
+ */
+static int _stepd_zygote_start(stepd_zygote_t *zygote)
+{
+	char *const argv[3] = { (char *) conf->stepd_loc,
+				SLURMSTEPD_ZYGOTE_ARG, NULL };
+	int sock[2];
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sock) < 0) {
+		error("%s: socketpair: %m", __func__);
+		return SLURM_ERROR;
+	}
+
+	if ((pid = fork()) < 0) {
+		error("%s: fork: %m", __func__);
+		close(sock[0]);
+		close(sock[1]);
+		return SLURM_ERROR;
+	} else if (pid == 0) {
+		if (setsid() < 0)
+			error("%s: setsid: %m", __func__);
+		if ((pid = fork()) < 0)
+			_exit(1);
+		else if (pid > 0)
+			_exit(0);
+
+		for (int i = 3; i < 256; i++)
+			(void) fcntl(i, F_SETFD, FD_CLOEXEC);
+		if ((dup2(sock[1], STDIN_FILENO) == -1) ||
+		    (dup2(devnull, STDOUT_FILENO) == -1) ||
+		    (dup2(devnull, STDERR_FILENO) == -1))
+			_exit(1);
+		log_fini();
+		execvp(argv[0], argv);
+		_exit(2);
+	}
+
+	close(sock[1]);
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+	fd_set_close_on_exec(sock[0]);
+	zygote->fd = sock[0];
+	debug("%s: started slurmstepd zygote", __func__);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Have a slurmstepd zygote fork the slurmstepd for a launch request
+ * in_fd IN - read end of the pipe to the new slurmstepd
+ * out_fd IN - write end of the pipe back to slurmd
+ * RET SLURM_SUCCESS or SLURM_ERROR to fork and exec slurmstepd instead
+ */
+static int _stepd_zygote_launch(int in_fd, int out_fd)
+{
+	stepd_zygote_t *zygote;
+	int cmd = SLURMSTEPD_ZYGOTE_FORK, rc = SLURM_ERROR;
+
+	if (!xstrcasestr(slurm_conf.launch_params, "slurmstepd_zygote"))
+		return SLURM_ERROR;
+
+	slurm_mutex_lock(&stepd_zygote_mutex);
+	zygote = &stepd_zygote[stepd_zygote_next];
+	stepd_zygote_next = (stepd_zygote_next + 1) % STEPD_ZYGOTE_CNT;
+	slurm_mutex_unlock(&stepd_zygote_mutex);
+
+	slurm_mutex_lock(&zygote->mutex);
+	if ((zygote->fd < 0) && _stepd_zygote_start(zygote)) {
+		slurm_mutex_unlock(&zygote->mutex);
+		return SLURM_ERROR;
+	}
+
+	safe_write(zygote->fd, &cmd, sizeof(int));
+	send_fd_over_pipe(zygote->fd, in_fd);
+	send_fd_over_pipe(zygote->fd, out_fd);
+	if (wait_fd_readable(zygote->fd, slurm_conf.msg_timeout) < 0)
+		goto rwfail;
+	safe_read(zygote->fd, &rc, sizeof(int));
+	slurm_mutex_unlock(&zygote->mutex);
+
+	return rc;
+
+rwfail:
+	error("%s: slurmstepd zygote failed, restarting it: %m", __func__);
+	close(zygote->fd);
+	zygote->fd = -1;
+	slurm_mutex_unlock(&zygote->mutex);
+	return SLURM_ERROR;
+}
+#else
+static int _stepd_zygote_launch(int in_fd, int out_fd)
+{
+	return SLURM_ERROR;
+}
+#endif
+
+extern void stepd_zygote_fini(void)
+{
+	for (int i = 0; i < STEPD_ZYGOTE_CNT; i++) {
+		slurm_mutex_lock(&stepd_zygote[i].mutex);
+		if (stepd_zygote[i].fd >= 0) {
+			/* The zygote exits when it reads end of file */
+			close(stepd_zygote[i].fd);
+			stepd_zygote[i].fd = -1;
+		}
+		slurm_mutex_unlock(&stepd_zygote[i].mutex);
+	}
+}
+
 /*
  * Fork and exec the slurmstepd, then send the slurmstepd its
  * initialization data.  Then wait for slurmstepd to send an "ok"
@@ -651,16 +779,19 @@ rwfail:
  *
  * Note that this code forks twice and it is the grandchild that
  * becomes the slurmstepd process, so the slurmstepd's parent process
- * will be init, not slurmd.
+ * will be init, not slurmd. A slurmstepd zygote, if enabled, forks the
+ * slurmstepd the same way instead of slurmd.
  */
 static int
 _forkexec_slurmstepd(uint16_t type, void *req,
 		     slurm_addr_t *cli, slurm_addr_t *self,
 		     const hostset_t step_hset, uint16_t protocol_version)
 {
-	pid_t pid;
+	pid_t pid = 0;
 	int to_stepd[2] = {-1, -1};
 	int to_slurmd[2] = {-1, -1};
+	bool zygote = false;
+	DEF_TIMERS;
 
 	if (pipe(to_stepd) < 0 || pipe(to_slurmd) < 0) {
 		error("%s: pipe failed: %m", __func__);
@@ -672,7 +803,11 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		return SLURM_ERROR;
 	}
 
-	if ((pid = fork()) < 0) {
+	START_TIMER;
+	if (_stepd_zygote_launch(to_stepd[0], to_slurmd[1]) ==
+	    SLURM_SUCCESS) {
+		zygote = true;
+	} else if ((pid = fork()) < 0) {
 		error("%s: fork: %m", __func__);
 		close(to_stepd[0]);
 		close(to_stepd[1]);
@@ -680,7 +815,9 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		close(to_slurmd[1]);
 		_remove_starting_step(type, req);
 		return SLURM_ERROR;
-	} else if (pid > 0) {
+	}
+
+	if (zygote || (pid > 0)) {
 		int rc = SLURM_SUCCESS;
 #if (SLURMSTEPD_MEMCHECK == 0)
 		int i;
@@ -727,6 +864,10 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 			if (rc != SLURM_SUCCESS)
 				error("slurmstepd return code %d: %s",
 				      rc, slurm_strerror(rc));
+			END_TIMER;
+			debug("%s: slurmstepd %s and initialized in %s",
+			      __func__, zygote ? "forked by zygote" : "started",
+			      TIME_STR);
 
 			cc = SLURM_SUCCESS;
 			cc = write(to_stepd[1], &cc, sizeof(int));
@@ -741,7 +882,7 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 			error("Error cleaning up starting_step list");
 
 		/* Reap child */
-		if (waitpid(pid, NULL, 0) < 0)
+		if (!zygote && (waitpid(pid, NULL, 0) < 0))
 			error("Unable to reap slurmd child process");
 		if (close(to_stepd[1]) < 0)
 			error("close write to_stepd in parent: %m");
@@ -4156,10 +4297,16 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 		goto done;
 	}
 
+	/*
+	 * Write at the block's offset, so blocks of the same file sent in
+	 * parallel by sbcast are written concurrently by their RPC threads.
+	 * sbcast relies on this for SLURM_21_08_1_PROTOCOL_VERSION and later.
+	 */
 	offset = 0;
 	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
+		inx = pwrite(file_info->fd, &req->block[offset],
+			     (req->block_len - offset),
+			     req->block_offset + offset);
 		if (inx == -1) {
 			if ((errno == EINTR) || (errno == EAGAIN))
 				continue;
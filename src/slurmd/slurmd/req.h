@@ -62,6 +62,9 @@ extern void record_launched_jobs(void);
 void file_bcast_init(void);
 void file_bcast_purge(void);
 
+/* Stop all slurmstepd zygotes, new ones are started on the next launch */
+extern void stepd_zygote_fini(void);
+
 /*
  * ume_notify - Notify all jobs and steps on this node that a Uncorrectable
  *	Memory Error (UME) has occured by sending SIG_UME (to log event in
@@ -397,6 +397,7 @@ main (int argc, char **argv)
 		      slurm_conf.slurmd_pidfile);
 
 	_wait_for_all_threads(120);
+	stepd_zygote_fini();
 	_slurmd_fini();
 	_destroy_conf();
 	slurm_cred_fini();	/* must be after _destroy_conf() */
@@ -1112,6 +1113,9 @@ _reconfigure(void)
 	cgroup_conf_reinit();
 	_read_config();
 
+	/* slurmstepd zygotes were initialized with the old configuration */
+	stepd_zygote_fini();
+
 	/*
 	 * Rebuild topology information and refresh slurmd topo infos
 	 */
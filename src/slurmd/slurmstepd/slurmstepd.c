@@ -43,10 +43,12 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/cpu_frequency.h"
+#include "src/common/fd.h"
 #include "src/common/gres.h"
 #include "src/common/node_select.h"
 #include "src/common/plugstack.h"
@@ -89,6 +91,7 @@ static stepd_step_rec_t *_step_setup(slurm_addr_t *cli, slurm_addr_t *self,
 static void _step_cleanup(stepd_step_rec_t *job, slurm_msg_t *msg, int rc);
 #endif
 static int _process_cmdline (int argc, char **argv);
+static void _run_zygote(void);
 
 /*
  *  List of signals to block in this process
@@ -103,6 +106,8 @@ int slurmstepd_blocked_signals[] = {
 slurmd_conf_t * conf;
 extern char  ** environ;
 
+static bool zygote_mode = false;
+
 int
 main (int argc, char **argv)
 {
@@ -131,6 +136,10 @@ main (int argc, char **argv)
 	if (slurm_auth_init(NULL) != SLURM_SUCCESS)
 		fatal( "failed to initialize authentication plugin" );
 
+	/* Only returns in a newly forked slurmstepd */
+	if (zygote_mode)
+		_run_zygote();
+
 	/* Receive job parameters from the slurmd */
 	_init_from_slurmd(STDIN_FILENO, argv, &cli, &self, &msg);
 
@@ -433,9 +442,66 @@ static int _process_cmdline (int argc, char **argv)
 			exit (1);
 		exit (0);
 	}
+	if ((argc == 2) && !xstrcmp(argv[1], SLURMSTEPD_ZYGOTE_ARG))
+		zygote_mode = true;
 	return (0);
 }
 
+/*
+ *  Fork a new slurmstepd for every request from slurmd on STDIN_FILENO,
+ *  see SLURMSTEPD_ZYGOTE_FORK. The configuration and plugins loaded so far
+ *  are inherited, the rest is received from slurmd as usual. Returns in the
+ *  new slurmstepd with its pipes to slurmd as stdin and stdout, exits when
+ *  slurmd closes the socket.
+ */
+static void _run_zygote(void)
+{
+	int cmd, in_fd, out_fd, rc, status;
+	pid_t pid;
+
+	while (read(STDIN_FILENO, &cmd, sizeof(int)) == sizeof(int)) {
+		in_fd = receive_fd_over_pipe(STDIN_FILENO);
+		out_fd = receive_fd_over_pipe(STDIN_FILENO);
+		if ((cmd != SLURMSTEPD_ZYGOTE_FORK) || (in_fd < 0) ||
+		    (out_fd < 0)) {
+			rc = SLURM_ERROR;
+		} else if ((pid = fork()) < 0) {
+			error("%s: fork: %m", __func__);
+			rc = SLURM_ERROR;
+		} else if (pid == 0) {
+			/* Fork again so the slurmstepd's parent is init */
+			if (setsid() < 0)
+				error("%s: setsid: %m", __func__);
+			if ((pid = fork()) < 0)
+				_exit(1);
+			else if (pid > 0)
+				_exit(0);
+
+			/* This also closes the socket to slurmd */
+			if ((dup2(in_fd, STDIN_FILENO) == -1) ||
+			    (dup2(out_fd, STDOUT_FILENO) == -1))
+				_exit(1);
+			close(in_fd);
+			close(out_fd);
+			return;
+		} else if ((waitpid(pid, &status, 0) < 0) ||
+			   !WIFEXITED(status) || WEXITSTATUS(status)) {
+			rc = SLURM_ERROR;
+		} else {
+			rc = SLURM_SUCCESS;
+		}
+
+		if (in_fd >= 0)
+			close(in_fd);
+		if (out_fd >= 0)
+			close(out_fd);
+		safe_write(STDIN_FILENO, &rc, sizeof(int));
+	}
+
+rwfail:
+	exit(0);
+}
+
 
 static void
 _send_ok_to_slurmd(int sock)
@@ -0,0 +1,222 @@
+/* Avoid duplicate wait() definition in testsuite/dejagnu.h and sys/wait.h */
+#define _SYS_WAIT_H 1
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <src/common/pack.h>
+#include <src/common/slurmdbd_defs.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <src/plugins/accounting_storage/common/common_as.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Symbols the accounting_storage plugins provide to common_as.c */
+const char plugin_type[] = "accounting_storage/archive_file_test";
+char *assoc_day_table = "assoc_usage_day_table";
+char *assoc_hour_table = "assoc_usage_hour_table";
+char *assoc_month_table = "assoc_usage_month_table";
+char *cluster_day_table = "usage_day_table";
+char *cluster_hour_table = "usage_hour_table";
+char *cluster_month_table = "usage_month_table";
+char *wckey_day_table = "wckey_usage_day_table";
+char *wckey_hour_table = "wckey_usage_hour_table";
+char *wckey_month_table = "wckey_usage_month_table";
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) 				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+#define TEST_CLUSTER "archtest"
+#define TEST_STRING "a job string repeated in every archived record"
+
+/* Return the one archive file in dir not starting with '.', NULL otherwise */
+static char *_archive_path(char *dir)
+{
+	DIR *dp;
+	struct dirent *ent;
+	char *path = NULL;
+	int cnt = 0;
+
+	if (!(dp = opendir(dir)))
+		return NULL;
+	while ((ent = readdir(dp))) {
+		if (ent->d_name[0] == '.')
+			continue;
+		cnt++;
+		xfree(path);
+		path = xstrdup_printf("%s/%s", dir, ent->d_name);
+	}
+	closedir(dp);
+	if (cnt != 1)
+		xfree(path);
+	return path;
+}
+
+/* Count every entry of dir, hidden ones included */
+static int _dir_entries(char *dir)
+{
+	DIR *dp;
+	struct dirent *ent;
+	int cnt = 0;
+
+	if (!(dp = opendir(dir)))
+		return -1;
+	while ((ent = readdir(dp))) {
+		if (xstrcmp(ent->d_name, ".") && xstrcmp(ent->d_name, ".."))
+			cnt++;
+	}
+	closedir(dp);
+	return cnt;
+}
+
+/*
+ * Write rec_cnt records to an archive file, then read them back frame by
+ * frame and check every record comes back in order.
+ */
+static void _test_round_trip(uint32_t rec_cnt)
+{
+	char dir[] = "/tmp/archive_file-test.XXXXXX";
+	char *path = NULL, *cluster = NULL, *str, msg[128];
+	archive_file_t *arch_file;
+	buf_t *buffer;
+	uint16_t rpc_version = 0, type = 0, period = 0;
+	uint32_t i, frame_cnt, frames = 0, read_cnt = 0, hdr_cnt = 0, val;
+	uint32_t str_len;
+	time_t create_time = 0;
+	bool match = true;
+	int rc;
+
+	if (!mkdtemp(dir)) {
+		snprintf(msg, sizeof(msg), "%u records: mkdtemp", rec_cnt);
+		fail(msg);
+		return;
+	}
+
+	arch_file = archive_file_create(dir, TEST_CLUSTER, "job",
+					DBD_GOT_JOBS, 0);
+	snprintf(msg, sizeof(msg), "%u records: create", rec_cnt);
+	TEST(!arch_file, msg);
+	if (!arch_file)
+		goto cleanup;
+
+	for (i = 0; i < rec_cnt; i++) {
+		buffer = archive_file_buf(arch_file);
+		pack32(i, buffer);
+		packstr(TEST_STRING, buffer);
+		if (archive_file_add_record(arch_file) != SLURM_SUCCESS)
+			match = false;
+	}
+	snprintf(msg, sizeof(msg), "%u records: add records", rec_cnt);
+	TEST(!match, msg);
+	snprintf(msg, sizeof(msg), "%u records: record count", rec_cnt);
+	TEST(archive_file_rec_cnt(arch_file) != rec_cnt, msg);
+
+	rc = archive_file_close(arch_file, 1000, 2000, 0);
+	snprintf(msg, sizeof(msg), "%u records: close", rec_cnt);
+	TEST(rc != SLURM_SUCCESS, msg);
+	snprintf(msg, sizeof(msg), "%u records: no temporary file left",
+		 rec_cnt);
+	TEST(_dir_entries(dir) != 1, msg);
+
+	path = _archive_path(dir);
+	snprintf(msg, sizeof(msg), "%u records: archive file named", rec_cnt);
+	TEST(!path || !xstrstr(path, TEST_CLUSTER "_job_archive_"), msg);
+	if (!path)
+		goto cleanup;
+
+	arch_file = NULL;
+	rc = archive_file_open(path, &arch_file, &rpc_version, &create_time,
+			       &type, &cluster, &period, &hdr_cnt);
+	snprintf(msg, sizeof(msg), "%u records: open", rec_cnt);
+	TEST((rc != SLURM_SUCCESS) || !arch_file, msg);
+	if ((rc != SLURM_SUCCESS) || !arch_file)
+		goto cleanup;
+	snprintf(msg, sizeof(msg), "%u records: header", rec_cnt);
+	TEST((rpc_version != SLURM_PROTOCOL_VERSION) || !create_time ||
+	     (type != DBD_GOT_JOBS) || xstrcmp(cluster, TEST_CLUSTER) ||
+	     period || (hdr_cnt != rec_cnt), msg);
+
+	match = true;
+	while (match) {
+		buffer = NULL;
+		frame_cnt = 0;
+		if (archive_file_read_frame(arch_file, &buffer, &frame_cnt) !=
+		    SLURM_SUCCESS) {
+			match = false;
+			break;
+		}
+		if (!buffer)
+			break;
+		frames++;
+		for (i = 0; i < frame_cnt; i++) {
+			str = NULL;
+			if (unpack32(&val, buffer) ||
+			    unpackstr_xmalloc_chooser(&str, &str_len, buffer) ||
+			    (val != read_cnt) || xstrcmp(str, TEST_STRING))
+				match = false;
+			xfree(str);
+			read_cnt++;
+		}
+		if (remaining_buf(buffer))
+			match = false;
+	}
+	archive_file_free(arch_file);
+	snprintf(msg, sizeof(msg), "%u records: read back in order", rec_cnt);
+	TEST(!match || (read_cnt != rec_cnt), msg);
+	/* Frames hold at most 1000 records */
+	snprintf(msg, sizeof(msg), "%u records: frame count", rec_cnt);
+	TEST(frames != ((rec_cnt + 999) / 1000), msg);
+
+cleanup:
+	if (path)
+		unlink(path);
+	xfree(path);
+	xfree(cluster);
+	rmdir(dir);
+}
+
+/* An aborted archive file must not leave anything behind */
+static void _test_abort(void)
+{
+	char dir[] = "/tmp/archive_file-test.XXXXXX";
+	archive_file_t *arch_file;
+	uint32_t i;
+
+	if (!mkdtemp(dir)) {
+		fail("abort: mkdtemp");
+		return;
+	}
+	arch_file = archive_file_create(dir, TEST_CLUSTER, "job",
+					DBD_GOT_JOBS, 0);
+	TEST(!arch_file, "abort: create");
+	if (arch_file) {
+		for (i = 0; i < 1500; i++) {
+			pack32(i, archive_file_buf(arch_file));
+			archive_file_add_record(arch_file);
+		}
+		archive_file_abort(arch_file);
+	}
+	TEST(_dir_entries(dir) != 0, "abort: no file left");
+	rmdir(dir);
+}
+
+int main(int argc, char *argv[])
+{
+	_test_round_trip(0);
+	_test_round_trip(1);
+	_test_round_trip(5000);
+	_test_abort();
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,94 @@
+/*
+ * Time the hostlist index against pushing every name into a hostlist and
+ * shifting every name back out, as node_conf.c did, on a 100k node table.
+ * Not run by "make check", build it with "make hostlist_index-bench".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/hostlist.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#define BENCH_NODE_CNT 100000
+
+int main(int argc, char *argv[])
+{
+	char **names = xcalloc(BENCH_NODE_CNT, sizeof(char *));
+	bitstr_t *bitmap = bit_alloc(BENCH_NODE_CNT);
+	bitstr_t *bitmap2 = bit_alloc(BENCH_NODE_CNT);
+	hostlist_index_t hi;
+	hostlist_t hl;
+	char *expect, *got, *name;
+	int rc = 0;
+	DEF_TIMERS;
+
+	for (int i = 0; i < BENCH_NODE_CNT; i++)
+		names[i] = xstrdup_printf("node%05d", i);
+
+	/* every third node plus a solid block: many ranges and one big one */
+	for (int i = 0; i < BENCH_NODE_CNT; i += 3)
+		bit_set(bitmap, i);
+	bit_nset(bitmap, BENCH_NODE_CNT / 2, BENCH_NODE_CNT - 1);
+
+	START_TIMER;
+	hi = hostlist_index_create(names, BENCH_NODE_CNT, 1);
+	END_TIMER;
+	printf("hostlist_index_create(%d):  %s\n", BENCH_NODE_CNT, TIME_STR);
+
+	START_TIMER;
+	hl = hostlist_create(NULL);
+	for (int i = 0; i < BENCH_NODE_CNT; i++) {
+		if (bit_test(bitmap, i))
+			hostlist_push_host(hl, names[i]);
+	}
+	hostlist_sort(hl);
+	expect = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	END_TIMER;
+	printf("bitmap to string (push):    %s\n", TIME_STR);
+
+	START_TIMER;
+	got = hostlist_index_ranged_string(hi, bitmap, true);
+	END_TIMER;
+	printf("bitmap to string (index):   %s\n", TIME_STR);
+	if (xstrcmp(got, expect)) {
+		printf("bitmap to string MISMATCH\n");
+		rc = 1;
+	}
+
+	hl = hostlist_create(got);
+	START_TIMER;
+	while ((name = hostlist_shift(hl))) {
+		bit_set(bitmap2, atoi(name + 4));
+		free(name);
+	}
+	END_TIMER;
+	printf("string to bitmap (shift):   %s\n", TIME_STR);
+	hostlist_destroy(hl);
+
+	bit_clear_all(bitmap2);
+	hl = hostlist_create(got);
+	START_TIMER;
+	(void) hostlist_index_hostlist2bitmap(hi, hl, bitmap2);
+	END_TIMER;
+	printf("string to bitmap (index):   %s\n", TIME_STR);
+	if (!bit_equal(bitmap, bitmap2)) {
+		printf("string to bitmap MISMATCH\n");
+		rc = 1;
+	}
+	hostlist_destroy(hl);
+
+	xfree(expect);
+	xfree(got);
+	bit_free(bitmap);
+	bit_free(bitmap2);
+	hostlist_index_destroy(hi);
+	for (int i = 0; i < BENCH_NODE_CNT; i++)
+		xfree(names[i]);
+	xfree(names);
+
+	return rc;
+}
@@ -0,0 +1,213 @@
+/*****************************************************************************\
+ *  Copyright (C) 2021 SchedMD LLC
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "slurm.h"
+#include "src/common/bitstring.h"
+#include "src/common/hostlist.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#define LARGE_NODE_CNT 3000
+
+static char **_make_names(int cnt, const char *prefix)
+{
+	char **names = xcalloc(cnt, sizeof(char *));
+
+	for (int i = 0; i < cnt; i++)
+		names[i] = xstrdup_printf("%s%05d", prefix, i);
+	return names;
+}
+
+static void _free_names(char **names, int cnt)
+{
+	for (int i = 0; i < cnt; i++)
+		xfree(names[i]);
+	xfree(names);
+}
+
+/* Reference implementation: push every name in turn */
+static char *_ranged_string(char **names, bitstr_t *bitmap, bool sort)
+{
+	hostlist_t hl = hostlist_create(NULL);
+	char *buf;
+
+	for (int i = 0; i < bit_size(bitmap); i++) {
+		if (bit_test(bitmap, i))
+			hostlist_push_host(hl, names[i]);
+	}
+	if (sort)
+		hostlist_sort(hl);
+	buf = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	return buf;
+}
+
+START_TEST(hostlist_index_bitmap_check)
+{
+	char *names[] = { "n1", "n2", "n3", "n10", "n011", "n012", "login",
+			  NULL, "gpu7", "n4", "n9", "gpu8", "n10x" };
+	int cnt = sizeof(names) / sizeof(names[0]);
+	hostlist_index_t hi = hostlist_index_create(names, cnt, 1);
+	bitstr_t *bitmap = bit_alloc(cnt);
+	char *expect, *got;
+	hostlist_t hl;
+
+	ck_assert_int_eq(hostlist_index_count(hi), cnt);
+
+	got = hostlist_index_ranged_string(hi, bitmap, true);
+	ck_assert_str_eq(got, "");
+	xfree(got);
+	ck_assert_ptr_eq(hostlist_index_bitmap2hostlist(hi, bitmap), NULL);
+
+	/* every subset of the names must match the reference output */
+	for (int mask = 1; mask < (1 << cnt); mask += 7) {
+		bit_clear_all(bitmap);
+		for (int i = 0; i < cnt; i++) {
+			if (mask & (1 << i))
+				bit_set(bitmap, i);
+		}
+		for (int sort = 0; sort < 2; sort++) {
+			expect = _ranged_string(names, bitmap, sort);
+			got = hostlist_index_ranged_string(hi, bitmap, sort);
+			ck_assert_str_eq(got, expect);
+			xfree(got);
+			xfree(expect);
+		}
+	}
+
+	bit_nset(bitmap, 0, cnt - 1);
+	hl = hostlist_index_bitmap2hostlist(hi, bitmap);
+	ck_assert_int_eq(hostlist_count(hl), cnt - 1);
+	hostlist_destroy(hl);
+
+	bit_free(bitmap);
+	hostlist_index_destroy(hi);
+}
+END_TEST
+
+START_TEST(hostlist_index_hostlist_check)
+{
+	char *names[] = { "n1", "n2", "n3", "n10", "n011", "n012", "login",
+			  NULL, "gpu7", "n4", "n9", "gpu8" };
+	int cnt = sizeof(names) / sizeof(names[0]);
+	hostlist_index_t hi = hostlist_index_create(names, cnt, 1);
+	bitstr_t *bitmap = bit_alloc(cnt);
+	hostlist_t hl;
+	char *str;
+
+	hl = hostlist_create("n[1-4,9-12],login,gpu[7-8]");
+	ck_assert_int_eq(hostlist_index_hostlist2bitmap(hi, hl, bitmap), 2);
+	str = hostlist_index_ranged_string(hi, bitmap, true);
+	ck_assert_str_eq(str, "gpu[7-8],login,n[1-4,9-10]");
+	xfree(str);
+	hostlist_destroy(hl);
+
+	bit_clear_all(bitmap);
+	hl = hostlist_create("n[011-012],n01,foo[1-3]");
+	ck_assert_int_eq(hostlist_index_hostlist2bitmap(hi, hl, bitmap), 4);
+	ck_assert_int_eq(bit_set_count(bitmap), 2);
+	ck_assert(bit_test(bitmap, 4) && bit_test(bitmap, 5));
+	hostlist_destroy(hl);
+
+	bit_free(bitmap);
+	hostlist_index_destroy(hi);
+}
+END_TEST
+
+/* Check the index against the reference path on a larger table */
+START_TEST(hostlist_index_large_check)
+{
+	char **names = _make_names(LARGE_NODE_CNT, "node");
+	bitstr_t *bitmap = bit_alloc(LARGE_NODE_CNT), *bitmap2;
+	hostlist_index_t hi = hostlist_index_create(names, LARGE_NODE_CNT, 1);
+	hostlist_t hl;
+	char *expect, *got;
+
+	/* every third node plus a solid block: many ranges and one big one */
+	for (int i = 0; i < LARGE_NODE_CNT; i += 3)
+		bit_set(bitmap, i);
+	bit_nset(bitmap, LARGE_NODE_CNT / 2, LARGE_NODE_CNT - 1);
+
+	expect = _ranged_string(names, bitmap, true);
+	got = hostlist_index_ranged_string(hi, bitmap, true);
+	ck_assert_str_eq(got, expect);
+
+	hl = hostlist_create(got);
+	bitmap2 = bit_alloc(LARGE_NODE_CNT);
+	ck_assert_int_eq(hostlist_index_hostlist2bitmap(hi, hl, bitmap2), 0);
+	ck_assert(bit_equal(bitmap, bitmap2));
+	hostlist_destroy(hl);
+
+	xfree(expect);
+	xfree(got);
+	bit_free(bitmap);
+	bit_free(bitmap2);
+	hostlist_index_destroy(hi);
+	_free_names(names, LARGE_NODE_CNT);
+}
+END_TEST
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *make_hostlist_index_suite(void)
+{
+	Suite *s = suite_create("hostlist_index");
+	TCase *tc_core = tcase_create("hostlist_index");
+	tcase_add_test(tc_core, hostlist_index_bitmap_check);
+	tcase_add_test(tc_core, hostlist_index_hostlist_check);
+	tcase_add_test(tc_core, hostlist_index_large_check);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(make_hostlist_index_suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
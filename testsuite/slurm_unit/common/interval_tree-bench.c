@@ -0,0 +1,90 @@
+/*
+ * Compare interval_tree_overlap() with a linear scan of the same intervals,
+ * as job_test_resv() walking resv_list did. Not run by "make check", build
+ * it with "make interval_tree-bench".
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <src/common/interval_tree.h>
+#include <src/common/xmalloc.h>
+
+#define QUERY_CNT 100000
+#define DAY (24 * 60 * 60)
+
+static double _elapsed(struct timespec *begin)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) +
+	       ((now.tv_nsec - begin->tv_nsec) / 1e9);
+}
+
+static void _bench(int resv_cnt)
+{
+	interval_tree_t *tree = interval_tree_create();
+	time_t *starts = xcalloc(resv_cnt, sizeof(time_t));
+	time_t *ends = xcalloc(resv_cnt, sizeof(time_t));
+	void **args = NULL;
+	struct timespec begin;
+	uint64_t scan_hits = 0, tree_hits = 0;
+	double scan_time, tree_time;
+	int i, q;
+
+	/* Reservations of one hour to two days spread over a year */
+	srand(resv_cnt);
+	for (i = 0; i < resv_cnt; i++) {
+		starts[i] = rand() % (365 * DAY);
+		ends[i] = starts[i] + 3600 + (rand() % (2 * DAY));
+		interval_tree_add(tree, starts[i], ends[i], &starts[i]);
+	}
+	/* Build the index outside of the timed loop */
+	(void) interval_tree_overlap(tree, 0, 1, &args);
+	xfree(args);
+
+	/* Jobs of up to one day */
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	srand(1);
+	for (q = 0; q < QUERY_CNT; q++) {
+		time_t start = rand() % (365 * DAY);
+		time_t end = start + (rand() % DAY);
+
+		for (i = 0; i < resv_cnt; i++) {
+			if ((starts[i] >= end) || (ends[i] <= start))
+				continue;
+			scan_hits++;
+		}
+	}
+	scan_time = _elapsed(&begin);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	srand(1);
+	for (q = 0; q < QUERY_CNT; q++) {
+		time_t start = rand() % (365 * DAY);
+		time_t end = start + (rand() % DAY);
+
+		tree_hits += interval_tree_overlap(tree, start, end, &args);
+		xfree(args);
+	}
+	tree_time = _elapsed(&begin);
+
+	printf("%6d reservations: scan %8.3f us/query, index %8.3f us/query%s\n",
+	       resv_cnt, scan_time * 1e6 / QUERY_CNT,
+	       tree_time * 1e6 / QUERY_CNT,
+	       (scan_hits != tree_hits) ? " MISMATCH" : "");
+
+	interval_tree_destroy(tree);
+	xfree(starts);
+	xfree(ends);
+}
+
+int main(int argc, char *argv[])
+{
+	_bench(100);
+	_bench(1000);
+	_bench(10000);
+	return 0;
+}
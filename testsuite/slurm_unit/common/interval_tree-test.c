@@ -0,0 +1,111 @@
+/* Avoid duplicate wait() definition in testsuite/dejagnu.h and sys/wait.h */
+#define _SYS_WAIT_H 1
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <src/common/interval_tree.h>
+#include <src/common/xmalloc.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure: */
+#define TEST(_tst, _msg) do {			\
+	if (_tst)				\
+		fail(_msg);			\
+	else					\
+		pass(_msg);			\
+} while (0)
+
+#define INTERVAL_CNT 500
+#define QUERY_CNT 2000
+
+static time_t starts[INTERVAL_CNT], ends[INTERVAL_CNT];
+
+/* Check a lookup result against a linear scan, both in insertion order */
+static int _check(void **args, int cnt, bool (*match)(int, time_t, time_t),
+		  time_t a, time_t b)
+{
+	int i, j = 0;
+
+	for (i = 0; i < INTERVAL_CNT; i++) {
+		if (!match(i, a, b))
+			continue;
+		if ((j >= cnt) || (args[j] != (void *) &starts[i]))
+			return 1;
+		j++;
+	}
+	return (j != cnt);
+}
+
+static bool _overlaps(int i, time_t start, time_t end)
+{
+	return ((starts[i] < end) && (ends[i] > start));
+}
+
+static bool _ended(int i, time_t when, time_t unused)
+{
+	return (ends[i] <= when);
+}
+
+int main(int argc, char *argv[])
+{
+	interval_tree_t *tree = interval_tree_create();
+	void **args = NULL;
+	time_t end, next_end;
+	int i, q, cnt, overlap_fail = 0, ended_fail = 0, next_fail = 0;
+
+	TEST(interval_tree_overlap(tree, 0, 100, &args) || args,
+	     "empty tree overlap");
+	TEST(interval_tree_next_end(tree, 0, &end), "empty tree next end");
+
+	srand(1234);
+	for (i = 0; i < INTERVAL_CNT; i++) {
+		starts[i] = rand() % 10000;
+		/* Include empty and long intervals */
+		ends[i] = starts[i] + ((i % 50) ? (rand() % 200) : 5000);
+		interval_tree_add(tree, starts[i], ends[i], &starts[i]);
+	}
+	TEST(interval_tree_count(tree) != INTERVAL_CNT, "interval count");
+
+	for (q = 0; q < QUERY_CNT; q++) {
+		time_t a = (rand() % 16000) - 1000;
+		time_t b = a + (rand() % 500);
+
+		cnt = interval_tree_overlap(tree, a, b, &args);
+		overlap_fail += _check(args, cnt, _overlaps, a, b);
+		xfree(args);
+
+		cnt = interval_tree_ended(tree, a, &args);
+		ended_fail += _check(args, cnt, _ended, a, 0);
+		xfree(args);
+
+		next_end = 0;
+		for (i = 0; i < INTERVAL_CNT; i++) {
+			if ((ends[i] >= a) &&
+			    (!next_end || (ends[i] < next_end)))
+				next_end = ends[i];
+		}
+		if (interval_tree_next_end(tree, a, &end) ?
+		    (end != next_end) : (next_end != 0))
+			next_fail++;
+	}
+	TEST(overlap_fail, "overlap matches linear scan");
+	TEST(ended_fail, "ended matches linear scan");
+	TEST(next_fail, "next end matches linear scan");
+
+	/* Changes after a lookup are seen by the next one */
+	interval_tree_add(tree, 20000, 20010, &starts[0]);
+	cnt = interval_tree_overlap(tree, 20005, 20006, &args);
+	TEST((cnt != 1) || (args[0] != &starts[0]), "add after lookup");
+	xfree(args);
+
+	interval_tree_clear(tree);
+	TEST(interval_tree_count(tree) ||
+	     interval_tree_overlap(tree, 0, 30000, &args),
+	     "clear");
+	interval_tree_destroy(tree);
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,169 @@
+/* Avoid duplicate wait() definition in testsuite/dejagnu.h and sys/wait.h */
+#define _SYS_WAIT_H 1
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <src/common/list.h>
+#include <src/common/xmalloc.h>
+#include <src/slurmctld/job_scheduler.h>
+#include <src/slurmctld/preempt.h>
+#include <src/slurmctld/slurmctld.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Symbols preempt.c provides to job_queue.c */
+extern bool slurm_preemption_enabled(void)
+{
+	return false;
+}
+
+extern bool preempt_g_job_preempt_check(job_queue_rec_t *preemptor,
+					job_queue_rec_t *preemptee)
+{
+	return false;
+}
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) 				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+#define REC_CNT 500
+#define PART_CNT 3
+
+enum {
+	PART_ALL,	/* Every record has a partition */
+	PART_SAME_TIER,	/* Some without a partition, all tiers equal */
+	PART_TOP_PRIO,	/* Those without a partition have the top priority */
+};
+
+static part_record_t parts[PART_CNT];
+static List test_part_list = NULL;
+
+static job_queue_rec_t *_make_rec(int inx, int part_mode)
+{
+	job_queue_rec_t *job_queue_rec = xmalloc(sizeof(*job_queue_rec));
+	job_record_t *job_ptr = xmalloc(sizeof(*job_ptr));
+
+	job_ptr->details = xmalloc(sizeof(*job_ptr->details));
+	job_ptr->details->submit_time = 1000 + (random() % 4);
+	job_ptr->priority = random() % 5;
+	if (!(random() % 8))
+		job_ptr->resv_id = 1;
+	if (!(random() % 4)) {
+		/* Partition based priority */
+		job_ptr->part_ptr_list = test_part_list;
+		job_ptr->priority_array = xcalloc(1, sizeof(uint32_t));
+		job_queue_rec->priority = random() % 5;
+	}
+
+	job_queue_rec->job_id = 100 + inx;
+	job_queue_rec->array_task_id = NO_VAL;
+	if (!(random() % 3)) {
+		/* Tasks of a few array jobs, in random job id order */
+		job_ptr->array_job_id = 50 + (random() % 3);
+		job_queue_rec->array_task_id = inx;
+	}
+	job_queue_rec->job_ptr = job_ptr;
+	job_queue_rec->part_ptr = &parts[random() % PART_CNT];
+
+	if ((part_mode != PART_ALL) && !(random() % 5)) {
+		job_queue_rec->part_ptr = NULL;
+		if (part_mode == PART_TOP_PRIO) {
+			job_ptr->part_ptr_list = NULL;
+			job_ptr->priority = 10 + (random() % 3);
+		}
+	}
+
+	return job_queue_rec;
+}
+
+static void _free_rec(job_queue_rec_t *job_queue_rec)
+{
+	xfree(job_queue_rec->job_ptr->details);
+	xfree(job_queue_rec->job_ptr->priority_array);
+	xfree(job_queue_rec->job_ptr);
+	xfree(job_queue_rec);
+}
+
+/*
+ * Build a random job queue, then check job_queue_heap_pop() hands the
+ * records out in the order sort_job_queue() puts them in.
+ */
+static void _test_heap_order(unsigned int seed, int part_mode)
+{
+	List job_queue = list_create(NULL);
+	job_queue_rec_t **recs = xcalloc(REC_CNT, sizeof(job_queue_rec_t *));
+	job_queue_rec_t **sorted = xcalloc(REC_CNT, sizeof(job_queue_rec_t *));
+	job_queue_rec_t *job_queue_rec;
+	job_queue_heap_t heap;
+	ListIterator iter;
+	bool match = true;
+	char msg[128];
+	int i, cnt = 0;
+
+	srandom(seed);
+	for (i = 0; i < PART_CNT; i++) {
+		if (part_mode == PART_ALL)
+			parts[i].priority_tier = random() % 3;
+		else
+			parts[i].priority_tier = 1;
+	}
+	for (i = 0; i < REC_CNT; i++) {
+		recs[i] = _make_rec(i, part_mode);
+		list_append(job_queue, recs[i]);
+	}
+
+	sort_job_queue(job_queue);
+	iter = list_iterator_create(job_queue);
+	while ((job_queue_rec = list_next(iter)))
+		sorted[cnt++] = job_queue_rec;
+	list_iterator_destroy(iter);
+
+	/* Hand the heap the records in their original random order */
+	list_flush(job_queue);
+	for (i = 0; i < REC_CNT; i++)
+		list_append(job_queue, recs[i]);
+	job_queue_heap_build(&heap, job_queue);
+	snprintf(msg, sizeof(msg), "seed %u mode %d: heap built", seed,
+		 part_mode);
+	TEST(heap.sorted || (heap.cnt != REC_CNT) || list_count(job_queue),
+	     msg);
+
+	for (i = 0; (job_queue_rec = job_queue_heap_pop(&heap)); i++) {
+		if ((i >= cnt) || (job_queue_rec != sorted[i]))
+			match = false;
+	}
+	snprintf(msg, sizeof(msg), "seed %u mode %d: pop order", seed,
+		 part_mode);
+	TEST(!match || (i != cnt), msg);
+
+	job_queue_heap_free(&heap);
+	for (i = 0; i < cnt; i++)
+		_free_rec(sorted[i]);
+	xfree(recs);
+	xfree(sorted);
+	FREE_NULL_LIST(job_queue);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int seed;
+
+	test_part_list = list_create(NULL);
+	for (seed = 1; seed <= 5; seed++) {
+		_test_heap_order(seed, PART_ALL);
+		_test_heap_order(seed, PART_SAME_TIER);
+		_test_heap_order(seed, PART_TOP_PRIO);
+	}
+	FREE_NULL_LIST(test_part_list);
+
+	totals();
+	return failed;
+}
@@ -1,10 +1,15 @@
+/* Avoid duplicate wait() definition in testsuite/dejagnu.h and sys/wait.h */
+#define _SYS_WAIT_H 1
 #include <errno.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <src/common/pack.h>
+#include <src/common/read_config.h>
+#include <src/common/slurm_protocol_api.h>
 #include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
 
 #include <testsuite/dejagnu.h>
 
@@ -17,6 +22,181 @@
 		pass( _msg );       \
 } while (0)
 
+/*
+ * Round trip a message body through slurm_compress_msg_body() and
+ * slurm_uncompress_msg_body(). Without lz4 the body must be left alone.
+ */
+static void _test_compress(void)
+{
+	header_t header;
+	buf_t *buffer, *body;
+	uint32_t body_len, hdr_len = sizeof(uint32_t);
+	char *orig;
+	int i;
+
+	slurm_conf.comm_params = "CompressMinSize=1024";
+	memset(&header, 0, sizeof(header));
+	header.msg_type = RESPONSE_JOB_INFO;
+
+	buffer = init_buf(0);
+	pack32(0, buffer);	/* stands in for the message header */
+	for (i = 0; i < 2000; i++)
+		packstr("a job string repeated in every record", buffer);
+	body_len = get_buf_offset(buffer) - hdr_len;
+	orig = xmalloc(body_len);
+	memcpy(orig, get_buf_data(buffer) + hdr_len, body_len);
+
+	header.body_length = slurm_compress_msg_body(&header, buffer, hdr_len,
+						     body_len);
+	if (!(header.flags & SLURM_COMPRESSED)) {
+		TEST((header.body_length != body_len) ||
+		     memcmp(get_buf_data(buffer) + hdr_len, orig, body_len),
+		     "uncompressed message body left unchanged");
+	} else {
+		TEST(header.body_length >= body_len,
+		     "compressed message body is smaller");
+		TEST(get_buf_offset(buffer) != (hdr_len + header.body_length),
+		     "compressed message body length");
+
+		set_buf_offset(buffer, hdr_len);
+		body = slurm_uncompress_msg_body(&header, buffer);
+		TEST(!body || (size_buf(body) != body_len) ||
+		     memcmp(get_buf_data(body), orig, body_len),
+		     "un/compress message body");
+		TEST(get_buf_offset(buffer) != (hdr_len + header.body_length),
+		     "uncompress consumes the message body");
+		if (body)
+			free_buf(body);
+
+		/* Claim a longer original body than the block holds */
+		set_buf_offset(buffer, hdr_len);
+		pack32(body_len + 1, buffer);
+		set_buf_offset(buffer, hdr_len);
+		body = slurm_uncompress_msg_body(&header, buffer);
+		TEST(body != NULL, "uncompress rejects a corrupted body");
+		if (body)
+			free_buf(body);
+	}
+	free_buf(buffer);
+
+	/* Bodies below CompressMinSize are never compressed */
+	memset(&header, 0, sizeof(header));
+	header.msg_type = RESPONSE_JOB_INFO;
+	buffer = init_buf(0);
+	pack32(0, buffer);
+	packstr("short", buffer);
+	body_len = get_buf_offset(buffer) - hdr_len;
+	header.body_length = slurm_compress_msg_body(&header, buffer, hdr_len,
+						     body_len);
+	TEST((header.body_length != body_len) ||
+	     (header.flags & SLURM_COMPRESSED),
+	     "small message body is not compressed");
+	free_buf(buffer);
+
+	slurm_conf.comm_params = NULL;
+	xfree(orig);
+}
+
+/*
+ * Round trip strings through packstr_dict() and unpackstr_dict(): each
+ * distinct string is sent once and later copies as a reference.
+ */
+static void _test_dict(void)
+{
+	str_dict_t *pack_dict, *unpack_dict;
+	buf_t *buffer;
+	char *strs[200], *out = NULL;
+	uint32_t size;
+	int i, bad = 0;
+
+	/* Empty and NULL strings, and a repeated string sent once */
+	pack_dict = str_dict_create();
+	buffer = init_buf(0);
+	packstr_dict("", pack_dict, buffer);
+	packstr_dict(NULL, pack_dict, buffer);
+	packstr_dict("repeated", pack_dict, buffer);
+	size = get_buf_offset(buffer);
+	packstr_dict("repeated", pack_dict, buffer);
+	TEST(get_buf_offset(buffer) != (size + sizeof(uint32_t)),
+	     "packstr_dict sends a repeated string as a reference");
+	packstr_dict("", pack_dict, buffer);
+	str_dict_destroy(pack_dict);
+	size = get_buf_offset(buffer);
+
+	unpack_dict = str_dict_create();
+	set_buf_offset(buffer, 0);
+	TEST(unpackstr_dict(&out, unpack_dict, buffer) || !out || out[0],
+	     "un/packstr_dict of string \"\"");
+	xfree(out);
+	TEST(unpackstr_dict(&out, unpack_dict, buffer) || out,
+	     "un/packstr_dict of null string");
+	TEST(unpackstr_dict(&out, unpack_dict, buffer) ||
+	     xstrcmp(out, "repeated"), "un/packstr_dict of string");
+	xfree(out);
+	TEST(unpackstr_dict(&out, unpack_dict, buffer) ||
+	     xstrcmp(out, "repeated"), "un/packstr_dict of repeated string");
+	xfree(out);
+	TEST(unpackstr_dict(&out, unpack_dict, buffer) || !out || out[0],
+	     "un/packstr_dict of repeated string \"\"");
+	xfree(out);
+	TEST(get_buf_offset(buffer) != size,
+	     "un/packstr_dict consumes the packed strings");
+	str_dict_destroy(unpack_dict);
+	free_buf(buffer);
+
+	/* More distinct strings than the initial dictionary capacity */
+	pack_dict = str_dict_create();
+	buffer = init_buf(0);
+	for (i = 0; i < 200; i++) {
+		strs[i] = xstrdup_printf("string %d", i);
+		packstr_dict(strs[i], pack_dict, buffer);
+	}
+	for (i = 199; i >= 0; i--)
+		packstr_dict(strs[i], pack_dict, buffer);
+	str_dict_destroy(pack_dict);
+
+	unpack_dict = str_dict_create();
+	set_buf_offset(buffer, 0);
+	for (i = 0; i < 400; i++) {
+		char *str = strs[(i < 200) ? i : (399 - i)];
+
+		if (unpackstr_dict(&out, unpack_dict, buffer) ||
+		    xstrcmp(out, str))
+			bad++;
+		xfree(out);
+	}
+	TEST(bad, "un/packstr_dict over the dictionary capacity");
+	str_dict_destroy(unpack_dict);
+	free_buf(buffer);
+	for (i = 0; i < 200; i++)
+		xfree(strs[i]);
+
+	/* References to strings which were not sent are rejected */
+	buffer = init_buf(0);
+	pack32(2, buffer);
+	set_buf_offset(buffer, 0);
+	unpack_dict = str_dict_create();
+	TEST(unpackstr_dict(&out, unpack_dict, buffer) != SLURM_ERROR,
+	     "unpackstr_dict rejects an unknown reference");
+	str_dict_destroy(unpack_dict);
+	free_buf(buffer);
+
+	/* Without a dictionary strings are packed as with packstr() */
+	buffer = init_buf(0);
+	packstr_dict("no dictionary", NULL, buffer);
+	packstr_dict("no dictionary", NULL, buffer);
+	set_buf_offset(buffer, 0);
+	bad = 0;
+	for (i = 0; i < 2; i++) {
+		if (unpackstr_xmalloc(&out, &size, buffer) ||
+		    xstrcmp(out, "no dictionary"))
+			bad++;
+		xfree(out);
+	}
+	TEST(bad, "packstr_dict without a dictionary");
+	free_buf(buffer);
+}
+
 int main (int argc, char *argv[])
 {
 	buf_t *buffer;
@@ -83,6 +263,10 @@ int main (int argc, char *argv[])
 	xfree(outstring);
 
 	free_buf(buffer);
+
+	_test_compress();
+	_test_dict();
+
 	totals();
 	return failed;
 
@@ -0,0 +1,202 @@
+/* Avoid duplicate wait() definition in testsuite/dejagnu.h and sys/wait.h */
+#define _SYS_WAIT_H 1
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <src/common/pack.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <src/slurmctld/record_pool.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) 				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+/* Records per slab, see record_pool.c */
+#define SLAB_CNT 256
+#define REC_CNT ((SLAB_CNT * 2) + 10)
+
+typedef struct {
+	uint32_t a;
+	uint64_t b;
+	char c[5];
+} test_rec_t;
+
+static record_pool_t test_pool =
+	RECORD_POOL_INITIALIZER("test_rec", sizeof(test_rec_t));
+static record_pool_t tiny_pool = RECORD_POOL_INITIALIZER("tiny_rec", 1);
+
+static bool _is_zero(void *rec, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++) {
+		if (((char *) rec)[i])
+			return false;
+	}
+	return true;
+}
+
+static int _cmp_ptr(const void *x, const void *y)
+{
+	uintptr_t p1 = (uintptr_t) *(void **) x;
+	uintptr_t p2 = (uintptr_t) *(void **) y;
+
+	if (p1 < p2)
+		return -1;
+	return (p1 > p2);
+}
+
+/* A freed record is handed out again, zeroed */
+static void _test_reuse(void)
+{
+	test_rec_t *rec, *rec2;
+
+	rec = record_pool_alloc(&test_pool);
+	TEST(!rec, "alloc: record returned");
+	TEST(!test_pool.registered || (test_pool.slab_cnt != 1),
+	     "alloc: first slab added");
+	TEST(test_pool.size % sizeof(void *),
+	     "alloc: size rounded to a pointer");
+	TEST(test_pool.size < sizeof(test_rec_t), "alloc: size kept");
+	TEST(!_is_zero(rec, test_pool.size), "alloc: record zeroed");
+
+	rec->a = 1;
+	rec->b = 2;
+	strlcpy(rec->c, "abcd", sizeof(rec->c));
+	record_pool_free(&test_pool, rec);
+	TEST(test_pool.in_use != 0, "free: in_use");
+
+	rec2 = record_pool_alloc(&test_pool);
+	TEST(rec2 != rec, "reuse: freed record handed out again");
+	TEST(!_is_zero(rec2, test_pool.size), "reuse: record zeroed");
+	TEST(test_pool.slab_cnt != 1, "reuse: no slab added");
+	record_pool_free(&test_pool, rec2);
+
+	record_pool_free(&test_pool, NULL);
+	TEST(test_pool.in_use != 0, "free: NULL ignored");
+
+	rec = record_pool_alloc(&tiny_pool);
+	TEST(tiny_pool.size != sizeof(void *),
+	     "alloc: size raised to a pointer");
+	record_pool_free(&tiny_pool, rec);
+}
+
+/* More records than a slab holds, all distinct and not overlapping */
+static void _test_growth(void)
+{
+	void **recs = xcalloc(REC_CNT, sizeof(void *));
+	void **sorted = xcalloc(REC_CNT, sizeof(void *));
+	uint64_t alloc_cnt = test_pool.alloc_cnt;
+	bool overlap = false, zero = true;
+	int i;
+
+	for (i = 0; i < REC_CNT; i++) {
+		recs[i] = record_pool_alloc(&test_pool);
+		if (!_is_zero(recs[i], test_pool.size))
+			zero = false;
+		memset(recs[i], 0xff, test_pool.size);
+	}
+	TEST(!zero, "growth: records zeroed");
+	TEST(test_pool.slab_cnt != ((REC_CNT + SLAB_CNT - 1) / SLAB_CNT),
+	     "growth: slab count");
+	TEST(test_pool.in_use != REC_CNT, "growth: in_use");
+	TEST(test_pool.in_use_max != REC_CNT, "growth: in_use_max");
+	TEST(test_pool.alloc_cnt != (alloc_cnt + REC_CNT),
+	     "growth: alloc_cnt");
+	TEST(test_pool.free_cnt !=
+	     ((test_pool.slab_cnt * SLAB_CNT) - REC_CNT),
+	     "growth: free_cnt");
+
+	memcpy(sorted, recs, REC_CNT * sizeof(void *));
+	qsort(sorted, REC_CNT, sizeof(void *), _cmp_ptr);
+	for (i = 1; i < REC_CNT; i++) {
+		if (((uintptr_t) sorted[i] - (uintptr_t) sorted[i - 1]) <
+		    test_pool.size)
+			overlap = true;
+	}
+	TEST(overlap, "growth: records distinct");
+
+	for (i = 0; i < REC_CNT; i++)
+		record_pool_free(&test_pool, recs[i]);
+	TEST(test_pool.in_use != 0, "growth: all freed");
+	TEST(test_pool.in_use_max != REC_CNT, "growth: in_use_max kept");
+	TEST(test_pool.free_cnt != (test_pool.slab_cnt * SLAB_CNT),
+	     "growth: all records free");
+
+	xfree(recs);
+	xfree(sorted);
+}
+
+/* The packed statistics match the pool counters */
+static void _test_stats(void)
+{
+	buf_t *buffer = init_buf(1024);
+	uint32_t cnt = 0, i, size, total, in_use, in_use_max, len, end;
+	uint64_t alloc_cnt;
+	char *name = NULL;
+	bool found = false, match = true;
+
+	record_pool_pack_stats(buffer);
+	end = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	if (unpack32(&cnt, buffer))
+		match = false;
+	TEST(cnt != 2, "stats: pool count");
+	for (i = 0; match && (i < cnt); i++) {
+		if (unpackstr_xmalloc(&name, &len, buffer) ||
+		    unpack32(&size, buffer) || unpack32(&total, buffer) ||
+		    unpack32(&in_use, buffer) ||
+		    unpack32(&in_use_max, buffer) ||
+		    unpack64(&alloc_cnt, buffer)) {
+			match = false;
+			break;
+		}
+		if (!xstrcmp(name, "test_rec")) {
+			found = true;
+			if ((size != test_pool.size) ||
+			    (total != (test_pool.slab_cnt * SLAB_CNT)) ||
+			    (in_use != test_pool.in_use) ||
+			    (in_use_max != test_pool.in_use_max) ||
+			    (alloc_cnt != test_pool.alloc_cnt))
+				match = false;
+		}
+		xfree(name);
+	}
+	TEST(!match || !found, "stats: counters packed");
+	TEST(get_buf_offset(buffer) != end, "stats: whole buffer read");
+	free_buf(buffer);
+}
+
+/* The slabs are released and a new slab is added on the next alloc */
+static void _test_fini(void)
+{
+	void *rec;
+
+	record_pool_fini();
+	TEST(test_pool.slab_cnt || test_pool.free_cnt || test_pool.free_list,
+	     "fini: slabs released");
+
+	rec = record_pool_alloc(&test_pool);
+	TEST(!rec || (test_pool.slab_cnt != 1), "fini: alloc after fini");
+	record_pool_free(&test_pool, rec);
+	record_pool_fini();
+}
+
+int main(int argc, char *argv[])
+{
+	_test_reuse();
+	_test_growth();
+	_test_stats();
+	_test_fini();
+
+	totals();
+	return failed;
+}